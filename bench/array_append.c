@@ -0,0 +1,76 @@
+#define NOBUILD_IMPLEMENTATION
+#include "../nobuild.h"
+
+#include <time.h>
+
+// Measures append throughput of `Cstr_Array`. The old implementation grew the
+// array by 10 elements at a time, so it called realloc every 10 appends and
+// copied O(n^2) elements whenever the block could not grow in place (how often
+// that happens depends on the allocator). It is reproduced here
+// as `append_linear()` for comparison with the geometric growth of
+// `cstr_array_append()` and the in place `ARRAY_APPEND()`.
+//
+//   $ cc -O2 bench/array_append.c -o bench/array_append
+//   $ ./bench/array_append
+
+static double seconds_since(clock_t start)
+{
+    return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+static Cstr_Array append_linear(Cstr_Array cstrs, size_t *spare, Cstr cstr)
+{
+    if (*spare < 1) {
+        cstrs.elems = realloc(cstrs.elems, sizeof *cstrs.elems * (cstrs.count + 10));
+        *spare += 10;
+        if (cstrs.elems == NULL) {
+            PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+        }
+    }
+
+    cstrs.elems[cstrs.count++] = cstr;
+    *spare -= 1;
+    return cstrs;
+}
+
+static void bench(size_t n)
+{
+    Cstr_Array linear = {0};
+    size_t spare = 0;
+    clock_t start = clock();
+    for (size_t i = 0; i < n; ++i) {
+        linear = append_linear(linear, &spare, "file.c");
+    }
+    double linear_time = seconds_since(start);
+
+    Cstr_Array by_value = {0};
+    start = clock();
+    for (size_t i = 0; i < n; ++i) {
+        by_value = cstr_array_append(by_value, "file.c");
+    }
+    double by_value_time = seconds_since(start);
+
+    Cstr_Array in_place = {0};
+    start = clock();
+    for (size_t i = 0; i < n; ++i) {
+        ARRAY_APPEND(&in_place, "file.c");
+    }
+    double in_place_time = seconds_since(start);
+
+    assert(linear.count == n && by_value.count == n && in_place.count == n);
+    INFO("%8zu elements: +10 growth %8.4fs, cstr_array_append %7.4fs, ARRAY_APPEND %7.4fs",
+         n, linear_time, by_value_time, in_place_time);
+
+    free(linear.elems);
+    ARRAY_FREE(&by_value);
+    ARRAY_FREE(&in_place);
+}
+
+int main(void)
+{
+    bench(10000);
+    bench(100000);
+    bench(1000000);
+    bench(10000000);
+    return 0;
+}
@@ -0,0 +1,59 @@
+#define NOBUILD_IMPLEMENTATION
+#include "../nobuild.h"
+
+#include <time.h>
+
+// Compares `cstr_array_contains()` against `cstr_set_contains()` by looking up
+// every element of arrays of paths, the way deduplicating a source list would.
+//
+//   $ cc bench/cstr_set.c -o bench/cstr_set
+//   $ ./bench/cstr_set
+
+static double seconds_since(clock_t start)
+{
+    return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void bench(size_t n)
+{
+    Cstr_Array paths = {0};
+    for (size_t i = 0; i < n; ++i) {
+        char *path = malloc(64);
+        snprintf(path, 64, "src/module%zu/file%zu.c", i % 97, i);
+        paths = cstr_array_append(paths, path);
+    }
+
+    size_t found = 0;
+    clock_t start = clock();
+    for (size_t i = 0; i < paths.count; ++i) {
+        found += (size_t) cstr_array_contains(paths, paths.elems[i]);
+    }
+    double array_time = seconds_since(start);
+
+    start = clock();
+    Cstr_Set set = {0};
+    for (size_t i = 0; i < paths.count; ++i) {
+        cstr_set_add(&set, paths.elems[i]);
+    }
+    double insert_time = seconds_since(start);
+
+    start = clock();
+    for (size_t i = 0; i < paths.count; ++i) {
+        found += (size_t) cstr_set_contains(&set, paths.elems[i]);
+    }
+    double set_time = seconds_since(start);
+
+    assert(found == 2 * n);
+    INFO("%7zu elements: cstr_array_contains %9.4fs, cstr_set_add %7.4fs, cstr_set_contains %7.4fs",
+         n, array_time, insert_time, set_time);
+
+    cstr_set_free(&set);
+}
+
+int main(void)
+{
+    bench(1000);
+    bench(10000);
+    bench(100000);
+    return 0;
+}
@@ -0,0 +1,134 @@
+#define NOBUILD_IMPLEMENTATION
+#include "../nobuild.h"
+
+#include <time.h>
+
+// Measures the throughput of `file_to_c_array()` on a 100 MiB input against
+// the two implementations it replaced, reproduced below: `fd_printf()` for
+// every byte, and `sb_appendf()` for every byte with one write per 4 KiB
+// chunk. The per-byte `fd_printf()` only gets the first MiB, it would take
+// minutes on the whole input. `file_to_c_embed()` and `file_to_c_incbin()`
+// are listed for reference, they do not read the input at all.
+//
+//   $ cc -O2 bench/file_to_c_array.c -o bench/file_to_c_array
+//   $ ./bench/file_to_c_array
+
+#define INPUT_PATH "file_to_c_array.bin"
+#define OUTPUT_PATH "file_to_c_array.out.c"
+
+static double seconds_since(clock_t start)
+{
+    return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void to_c_array_fd_printf(Cstr path, Cstr out_path, size_t limit)
+{
+    Fd file = fd_open_for_read(path);
+    Fd output_file = fd_open_for_write(out_path);
+
+    fd_printf(output_file, "%s %s[] = {\n", "unsigned char", "data");
+    unsigned char buffer[4096];
+    size_t total_bytes_read = 0;
+    while (total_bytes_read < limit) {
+        size_t bytes_read = fd_read(file, buffer, sizeof(buffer));
+        if (bytes_read == 0) {
+            break;
+        }
+
+        for (size_t i = 0; i < bytes_read; i += 16) {
+            fd_printf(output_file, "\t");
+            for (size_t j = i; j < i + 16 && j < bytes_read; j++) {
+                fd_printf(output_file, "0x%02x, ", buffer[j]);
+            }
+            fd_printf(output_file, "\n");
+        }
+        total_bytes_read += bytes_read;
+    }
+    fd_printf(output_file, "};\n");
+    fd_printf(output_file, "unsigned long %s_len = %lu;\n", "data", (unsigned long) total_bytes_read);
+
+    fd_close(file);
+    fd_close(output_file);
+}
+
+static void to_c_array_sb(Cstr path, Cstr out_path)
+{
+    Fd file = fd_open_for_read(path);
+    Fd output_file = fd_open_for_write(out_path);
+
+    String_Builder sb = {0};
+    sb_appendf(&sb, "%s %s[] = {\n", "unsigned char", "data");
+    unsigned char buffer[4096];
+    size_t total_bytes_read = 0;
+    while (1) {
+        size_t bytes_read = fd_read(file, buffer, sizeof(buffer));
+        if (bytes_read == 0) {
+            break;
+        }
+
+        for (size_t i = 0; i < bytes_read; i += 16) {
+            sb_append_cstr(&sb, "\t");
+            for (size_t j = i; j < i + 16 && j < bytes_read; j++) {
+                sb_appendf(&sb, "0x%02x, ", buffer[j]);
+            }
+            sb_append_cstr(&sb, "\n");
+        }
+        total_bytes_read += bytes_read;
+
+        fd_write_sb(output_file, &sb);
+        sb.count = 0;
+    }
+    sb_append_cstr(&sb, "};\n");
+    sb_appendf(&sb, "unsigned long %s_len = %lu;\n", "data", (unsigned long) total_bytes_read);
+    fd_write_sb(output_file, &sb);
+    ARRAY_FREE(&sb);
+
+    fd_close(file);
+    fd_close(output_file);
+}
+
+static void report(Cstr name, size_t bytes, double seconds)
+{
+    INFO("%-28s %5zu MiB in %8.4fs, %9.2f MiB/s",
+         name, bytes / (1024 * 1024), seconds, (double) bytes / (1024 * 1024) / seconds);
+}
+
+int main(void)
+{
+    const size_t size = 100 * 1024 * 1024;
+    const size_t limit = 1024 * 1024;
+
+    // Not random, but every byte value shows up
+    Fd_Writer input = fdw_make(fd_open_for_write(INPUT_PATH), 0);
+    unsigned int state = 69;
+    for (size_t i = 0; i < size; ++i) {
+        state = state * 1103515245 + 12345;
+        unsigned char byte = (unsigned char) (state >> 16);
+        fdw_write(&input, &byte, 1);
+    }
+    fdw_close(&input);
+
+    clock_t start = clock();
+    to_c_array_fd_printf(INPUT_PATH, OUTPUT_PATH, limit);
+    report("fd_printf per byte", limit, seconds_since(start));
+
+    start = clock();
+    to_c_array_sb(INPUT_PATH, OUTPUT_PATH);
+    report("sb_appendf per byte", size, seconds_since(start));
+
+    start = clock();
+    FILE_TO_C_ARRAY(INPUT_PATH, OUTPUT_PATH, "data");
+    report("file_to_c_array", size, seconds_since(start));
+
+    start = clock();
+    FILE_TO_C_EMBED(INPUT_PATH, OUTPUT_PATH, "data");
+    INFO("%-28s %8.4fs", "file_to_c_embed", seconds_since(start));
+
+    start = clock();
+    FILE_TO_C_INCBIN(INPUT_PATH, OUTPUT_PATH, "data");
+    INFO("%-28s %8.4fs", "file_to_c_incbin", seconds_since(start));
+
+    path_rm(INPUT_PATH);
+    path_rm(OUTPUT_PATH);
+    return 0;
+}
@@ -0,0 +1,70 @@
+#define NOBUILD_MODULE_CACHE_DIR "bench_modules"
+#define NOBUILD_IMPLEMENTATION
+#include "../nobuild.h"
+
+// Checks the flags `module_flags()` gives to a source that imports `a`, which
+// imports `b`, which imports `c`: the compile has to find the BMIs of all
+// three modules, and each of them once, for both Clang and GCC.
+//
+//   $ cc bench/module_flags.c -o bench/module_flags
+//   $ ./bench/module_flags
+
+static size_t count_lines(Cstr_Array line, Cstr flag)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < line.count; ++i) {
+        count += strcmp(line.elems[i], flag) == 0;
+    }
+    return count;
+}
+
+static size_t count_substrings(Cstr haystack, Cstr needle)
+{
+    size_t count = 0;
+    for (Cstr p = strstr(haystack, needle); p != NULL; p = strstr(p + 1, needle)) {
+        count += 1;
+    }
+    return count;
+}
+
+int main(void)
+{
+    // `b` is imported both directly by `main` and through `a`
+    Module_Deps deps[4] = {
+        { .source = "c.cppm", .object = "c.o", .provides = "c", .bmi = "c.pcm", .is_interface = 1 },
+        { .source = "b.cppm", .object = "b.o", .provides = "b", .bmi = "b.pcm", .is_interface = 1 },
+        { .source = "a.cppm", .object = "a.o", .provides = "a", .bmi = "a.pcm", .is_interface = 1 },
+        { .source = "main.cpp", .object = "main.o" },
+    };
+    deps[1].requires = cstr_array_make("c", NULL);
+    deps[2].requires = cstr_array_make("b", NULL);
+    deps[3].requires = cstr_array_make("a", "b", "std", NULL);
+    if (!module_sort(deps, 4)) {
+        PANIC("%s", "module_sort failed");
+    }
+    const size_t main_index = 3;
+
+    Cmd clang = {0};
+    module_flags(MODULE_SCANNER_CLANG, &clang, deps, 4, main_index);
+    assert(count_lines(clang.line, "-fmodule-file=a=a.pcm") == 1);
+    assert(count_lines(clang.line, "-fmodule-file=b=b.pcm") == 1);
+    assert(count_lines(clang.line, "-fmodule-file=c=c.pcm") == 1);
+    assert(clang.line.count == 3);
+    INFO("clang: %s", cstr_array_join(" ", clang.line));
+
+    Cmd gcc = {0};
+    module_flags(MODULE_SCANNER_GCC, &gcc, deps, 4, main_index);
+    assert(gcc.line.count == 2);
+    Cstr mapper = gcc.line.elems[1] + strlen("-fmodule-mapper=");
+    char *modmap = read_entire_file(mapper, NULL);
+    assert(modmap != NULL);
+    assert(count_substrings(modmap, "a a.pcm\n") == 1);
+    assert(count_substrings(modmap, "b b.pcm\n") == 1);
+    assert(count_substrings(modmap, "c c.pcm\n") == 1);
+    assert(count_substrings(modmap, "\n") == 3);
+    INFO("gcc: %s", cstr_array_join(" ", gcc.line));
+    free(modmap);
+
+    path_rm(NOBUILD_MODULE_CACHE_DIR);
+    return 0;
+}
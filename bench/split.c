@@ -0,0 +1,141 @@
+#define NOBUILD_IMPLEMENTATION
+#include "../nobuild.h"
+
+#include <time.h>
+
+// Compares `cstr_array_from_cstr()` against the implementation it replaced,
+// reproduced below as `split_bytewise()`: two passes comparing the whole
+// delimiter at every byte and one allocation per substring. The input looks
+// like `pkg-config --cflags` output and like a compiler `-M` dependency list.
+//
+//   $ cc -O2 bench/split.c -o bench/split
+//   $ ./bench/split
+
+static double seconds_since(clock_t start)
+{
+    return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+static Cstr_Array split_bytewise(Cstr cstr, Cstr delim)
+{
+    size_t len = strlen(cstr);
+    size_t d_len = strlen(delim);
+    size_t substr_count = 1;
+    for (size_t i = 0; i < len; ++i) {
+        if ((len - i) < d_len) {
+            break;
+        }
+
+        size_t delim_found = 0;
+        for (size_t j = 0; j < d_len; ++j) {
+            if (cstr[i+j] != delim[j]) {
+                delim_found = 0;
+                break;
+            }
+            delim_found = 1;
+        }
+
+        if (delim_found) {
+            substr_count++;
+            i += d_len - 1;
+        }
+    }
+
+    // if dlen == 0 or was never found
+    if (substr_count == 1) {
+        // TODO: differentiate between delim == null and delim == "" and delim not found
+        //       Split the string into an array of strings, where each string is a single character
+        return cstr_array_make(cstr);
+    }
+
+    Cstr_Array ret = { .count = substr_count };
+    ret.elems = malloc(sizeof(Cstr) * ret.count);
+    if (ret.elems == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+
+    size_t substr_start = 0;
+    size_t substr_index = 0;
+    for (size_t i = 0; i < len; ++i) {
+        if ((len - i) < d_len) {
+            break;
+        }
+
+        size_t delim_found = 0;
+        for (size_t j = 0; j < d_len; ++j) {
+            if (cstr[i+j] != delim[j]) {
+                delim_found = 0;
+                break;
+            }
+            delim_found = 1;
+        }
+
+        if (!delim_found) {
+            continue;
+        }
+
+        size_t substr_len = i - substr_start;
+        char *substr = calloc(substr_len + 1, sizeof(unsigned char));
+        if (substr == NULL) {
+            PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+        }
+
+        ret.elems[substr_index++] = memcpy(substr, (cstr+substr_start), substr_len * sizeof(unsigned char));
+        i += d_len - 1;
+        substr_start = i + 1;
+    }
+
+    // Add the last substring
+    size_t substr_len = len - substr_start;
+    char *substr = calloc(substr_len + 1, sizeof(unsigned char));
+    if (substr == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+
+    ret.elems[substr_index++] = memcpy(substr, (cstr+substr_start), substr_len * sizeof(unsigned char));
+    return ret;
+}
+
+static void bench(Cstr name, Cstr input, Cstr delim)
+{
+    clock_t start = clock();
+    Cstr_Array bytewise = split_bytewise(input, delim);
+    double bytewise_time = seconds_since(start);
+
+    start = clock();
+    Cstr_Array split = cstr_array_from_cstr(input, delim);
+    double split_time = seconds_since(start);
+
+    assert(bytewise.count == split.count);
+    for (size_t i = 0; i < split.count; ++i) {
+        assert(strcmp(bytewise.elems[i], split.elems[i]) == 0);
+    }
+    INFO("%-8s %8zu substrings of %5zu KiB: bytewise %7.4fs, cstr_array_from_cstr %7.4fs",
+         name, split.count, strlen(input) / 1024, bytewise_time, split_time);
+
+    for (size_t i = 0; i < bytewise.count; ++i) {
+        free((char *) bytewise.elems[i]);
+    }
+    free(bytewise.elems);
+    free((char *) split.elems[0]);
+    free(split.elems);
+}
+
+int main(void)
+{
+    const size_t size = 16 * 1024 * 1024;
+
+    String_Builder cflags = {0};
+    while (cflags.count < size) {
+        sb_appendf(&cflags, "-I/usr/include/lib%zu/include ", cflags.count % 1000);
+    }
+
+    String_Builder deps = {0};
+    while (deps.count < size) {
+        sb_appendf(&deps, "  /usr/include/x86_64-linux-gnu/bits/header%zu.h \\\n", deps.count % 1000);
+    }
+
+    bench("cflags", sb_to_cstr(&cflags), " ");
+    bench("deps", sb_to_cstr(&deps), " \\\n");
+    return 0;
+}
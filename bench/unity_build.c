@@ -0,0 +1,126 @@
+#define NOBUILD_IMPLEMENTATION
+#include "../nobuild.h"
+
+// Counts how many unity files `unity_build()` rewrites when one source of a
+// project grows or a source is added, for both kinds of limits. Each change
+// must only touch the batch of the source and the next one.
+//
+//   $ cc bench/unity_build.c -o bench/unity_build
+//   $ ./bench/unity_build
+
+#define SOURCE_COUNT 200
+#define BENCH_DIR "bench_unity"
+// Between 8 and 24 KB
+#define SOURCE_SIZE(i) (8000 + (i) * 7919 % 16000)
+
+typedef struct {
+    Cstr_Map contents;
+} Snapshot;
+
+static Snapshot snapshot(Cstr_Array unity_files)
+{
+    Snapshot snapshot = {0};
+    for (size_t i = 0; i < unity_files.count; ++i) {
+        cstr_map_put(&snapshot.contents, unity_files.elems[i], read_entire_file(unity_files.elems[i], NULL));
+    }
+    return snapshot;
+}
+
+// Unity files of `after` that are not in `before` with the same contents
+static size_t changed_files(const Snapshot *before, const Snapshot *after)
+{
+    size_t changed = 0;
+    for (size_t i = 0; i < after->contents.capacity; ++i) {
+        const Cstr_Map_Entry *e = &after->contents.entries[i];
+        if (e->hash != 0) {
+            const char *old = cstr_map_get(&before->contents, e->key);
+            changed += old == NULL || strcmp(old, e->value) != 0;
+        }
+    }
+    return changed;
+}
+
+static void snapshot_free(Snapshot *snapshot)
+{
+    for (size_t i = 0; i < snapshot->contents.capacity; ++i) {
+        if (snapshot->contents.entries[i].hash != 0) {
+            free(snapshot->contents.entries[i].value);
+        }
+    }
+    cstr_map_free(&snapshot->contents);
+}
+
+static void write_source(Cstr path, size_t size)
+{
+    char *contents = malloc(size + 1);
+    memset(contents, ' ', size);
+    contents[size] = '\0';
+    path_write_if_changed(path, contents, size);
+    free(contents);
+}
+
+static void bench(Cstr label, Unity_Options options)
+{
+    Cstr_Array sources = cstr_array_make(NULL);
+    for (size_t i = 0; i < SOURCE_COUNT; ++i) {
+        char name[32];
+        snprintf(name, sizeof(name), "source%zu.c", i);
+        Cstr path = PATH(BENCH_DIR, "src", name);
+        write_source(path, SOURCE_SIZE(i));
+        sources = cstr_array_append(sources, path);
+    }
+
+    size_t worst_grow = 0;
+    size_t worst_add = 0;
+    size_t batches = 0;
+    for (size_t i = 0; i < SOURCE_COUNT; i += 5) {
+        Snapshot before = snapshot(unity_build(sources, options));
+        batches = before.contents.count;
+
+        // Grow one source by 30 KB
+        write_source(sources.elems[i], SOURCE_SIZE(i) + 30000);
+        Snapshot grown = snapshot(unity_build(sources, options));
+        const size_t grow = changed_files(&before, &grown);
+        worst_grow = grow > worst_grow ? grow : worst_grow;
+        write_source(sources.elems[i], SOURCE_SIZE(i));
+
+        // Add one source
+        char name[32];
+        snprintf(name, sizeof(name), "added%zu.c", i);
+        Cstr added = PATH(BENCH_DIR, "src", name);
+        write_source(added, SOURCE_SIZE(i + 1));
+        Snapshot extended = snapshot(unity_build(cstr_array_append(cstr_array_concat(cstr_array_make(NULL), sources), added), options));
+        const size_t add = changed_files(&before, &extended);
+        worst_add = add > worst_add ? add : worst_add;
+        path_rm(added);
+
+        snapshot_free(&before);
+        snapshot_free(&grown);
+        snapshot_free(&extended);
+    }
+
+    INFO("%-12s %zu sources in %3zu batches: at most %zu unity files changed when a source grows, %zu when one is added",
+         label, (size_t) SOURCE_COUNT, batches, worst_grow, worst_add);
+    assert(worst_grow <= 2);
+    assert(worst_add <= 2);
+}
+
+int main(void)
+{
+    if (path_exists(BENCH_DIR)) {
+        path_rm(BENCH_DIR);
+    }
+    path_mkdirs(cstr_array_make(BENCH_DIR, "src", NULL));
+
+    bench("max_sources", (Unity_Options) {
+        .out_dir = PATH(BENCH_DIR, "unity"),
+        .max_sources = 16,
+    });
+    bench("max_bytes", (Unity_Options) {
+        .out_dir = PATH(BENCH_DIR, "unity"),
+        .max_bytes = 16 * NOBUILD_UNITY_SOURCE_BYTES,
+    });
+
+    path_rm(BENCH_DIR);
+    return 0;
+}
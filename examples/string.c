@@ -7,12 +7,19 @@
 #define DEMO_D(expr)                         \
     INFO("    " #expr " == %d", expr)
 
+#define DEMO_SV(expr)                        \
+    INFO("    " #expr " == \"" SV_FMT "\"", SV_ARG(expr))
+
 int main(void)
 {
     DEMO_S(CONCAT("foo", "bar", "baz"));
     DEMO_S(PATH("foo", "bar", "baz"));
     DEMO_S(JOIN("++", "foo", "bar", "baz"));
     DEMO_S(NOEXT("main.c"));
+    DEMO_S(BASENAME("src/main.c"));
+    DEMO_S(DIRNAME("src/main.c"));
+    DEMO_SV(path_extension_sv("src/main.c"));
+    DEMO_SV(path_stem_sv("src/main.c"));
     DEMO_D(ENDS_WITH("main.c", ".c"));
     DEMO_D(ENDS_WITH("main.java", ".c"));
     DEMO_D(ENDS_WITH("", ".c"));
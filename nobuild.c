@@ -53,7 +53,7 @@ void foreach_file_in_dir(const char *dirpath,void (*func)(const char*,const char
 typedef struct {
     Cstr_Array deps;
     Cstr_Array filewaiting;
-    Fd to_write;
+    Fd_Writer *to_write;
 } write_data_t;
 int has_dep(char* buffer, size_t size){
     char* dep = strstr(buffer,"#include \"nobuild_");
@@ -90,7 +90,7 @@ char* remove_deps(char* buffer, size_t size){
             buffer[move+1] = '\n';
         }
     }
-    char* out = allocate(strlen(buffer));
+    char* out = allocate(strlen(buffer) + 1);
     strcpy(out,buffer);
 
     return out;
@@ -103,11 +103,12 @@ void write_h(const char* dirpath, const char* filename, void* udata){
         char* dep = data->deps.elems[i];
         
         if(strcmp(filename,dep) == 0){
-            unsigned char buffer[4096];
+            unsigned char buffer[4096 + 1];
             char* path = allocate(sizeof(char) * 260);
             snprintf(path,260,"%s%s%s",dirpath,PATH_SEP,filename);
             Fd r_h = fd_open_for_read(path);
             size_t bytes = fd_read(r_h,buffer,4096);
+            buffer[bytes] = '\0';
             if(has_dep(buffer,bytes) && cstr_ends_with(filename,".h")){
                 if(data->filewaiting.count == 0){
                     data->filewaiting = CSTR_ARRAY_MAKE(path);
@@ -118,15 +119,11 @@ void write_h(const char* dirpath, const char* filename, void* udata){
             }
             else{
                 char* out = remove_deps(buffer,bytes);
-                fd_write(data->to_write,out,bytes);
-                while(1){
-                    bytes = fd_read(r_h,buffer,4096);
-                    if(bytes == 0){
-                        fd_write(data->to_write,"\n",1);
-                        break;
-                    }
-                    fd_write(data->to_write,buffer,bytes);
-                }
+                fdw_write(data->to_write,out,bytes);
+                // Let the kernel copy the rest of the file
+                fdw_flush(data->to_write);
+                fd_sendfile(data->to_write->fd,r_h,0);
+                fdw_write(data->to_write,"\n",1);
             }
             fd_close(r_h);
             break;
@@ -144,16 +141,17 @@ int main(int argc, char **argv)
         MKDIRS("generate");
     }
 
-    Fd nbh = fd_open_for_read("src/nobuild.h");
-    Fd nbsh = fd_open_for_write("generate/nobuild.h");
+    char *nbh = read_entire_file("src/nobuild.h", NULL);
+    if (nbh == NULL) {
+        return 1;
+    }
+    Output_File nbsh = output_file_open("generate/nobuild.h");
 
 
-    unsigned char buffer[4096] = {0};
-    size_t bytes = fd_read(nbh,buffer,sizeof(buffer));
     char* minirent = allocate(strlen("#include \"minirent.h\""));
     strcpy(minirent,"#include \"minirent.h\"");
     Cstr_Array deps = CSTR_ARRAY_MAKE(minirent);
-    char* dep = strstr(buffer,"#include \"nobuild_");
+    char* dep = strstr(nbh,"#include \"nobuild_");
     char* dep2 = strstr(dep,"\"\n");
     while(dep != NULL && dep2 != NULL){
         char* out_name = allocate(sizeof(char) * 260);
@@ -165,16 +163,17 @@ int main(int argc, char **argv)
         while(c != out_len+1){
             dep[c++] = '/';
         }
-        size_t move = dep2 - (char*)buffer;
-        dep = strstr(buffer+move,"#include \"nobuild_");
+        size_t move = dep2 - nbh;
+        dep = strstr(nbh+move,"#include \"nobuild_");
         if(dep != NULL)
             dep2 = strstr(dep,"\"\n");
         else {
-            buffer[move+1] = '\n';
+            nbh[move+1] = '\n';
         }
     }
-    char* nobuild_h = allocate(strlen(buffer));
-    strcpy(nobuild_h,buffer);
+    char* nobuild_h = allocate(strlen(nbh) + 1);
+    strcpy(nobuild_h,nbh);
+    free(nbh);
 
     for (size_t elem_index = 0; elem_index < deps.count; ++elem_index){
         char *dep = deps.elems[elem_index];
@@ -190,7 +189,7 @@ int main(int argc, char **argv)
         }
         strcpy(dep,temp);
     }
-    write_data_t w_data = {.deps = deps,.to_write=nbsh,.filewaiting={0}};
+    write_data_t w_data = {.deps = deps,.to_write=&nbsh.writer,.filewaiting={0}};
     foreach_file_in_dir("src",write_h,&w_data);
     char cjson_path[260] = {0};
     snprintf(cjson_path,260,"src%scJSON.h",PATH_SEP);
@@ -198,29 +197,26 @@ int main(int argc, char **argv)
     for(int i = 0; i < w_data.filewaiting.count;++i){
         char* path = w_data.filewaiting.elems[i];
         Fd fd = fd_open_for_read(path);
-        unsigned char buffer[4096] = {0};
+        unsigned char buffer[4096 + 1] = {0};
         size_t bytes = fd_read(fd,buffer,4096);
+        buffer[bytes] = '\0';
         char* out = remove_deps(buffer,bytes);
-        fd_write(nbsh,out,strlen(out));
-        while(1){
-            bytes = fd_read(fd,buffer,4096);
-            if(bytes == 0){
-                fd_write(nbsh,"\n",1);
-                break;
-            }
-            fd_write(nbsh,buffer,bytes);
-        }
+        fdw_write(&nbsh.writer,out,strlen(out));
+        fdw_flush(&nbsh.writer);
+        fd_sendfile(nbsh.writer.fd,fd,0);
+        fdw_write(&nbsh.writer,"\n",1);
+        fd_close(fd);
     }
 
     // Write the nobuild.h header
-    fd_write(nbsh,nobuild_h,strlen(nobuild_h));
+    fdw_write(&nbsh.writer,nobuild_h,strlen(nobuild_h));
 
     //Start writing the implementation
     const char* def = 
     "\n////////////////////////////////////////////////////////////////////////////////\n"
     "#ifdef NOBUILD_IMPLEMENTATION\n\n"
     "////////////////////////////////////////////////////////////////////////////////\n";
-    fd_write(nbsh,def,strlen(def));
+    fdw_write(&nbsh.writer,def,strlen(def));
     memset(&w_data.filewaiting,0,sizeof(w_data.filewaiting));
     for(int i= 0; i < deps.count;++i){
         char* name = deps.elems[i];
@@ -231,24 +227,19 @@ int main(int argc, char **argv)
     // Write cJSON.c file
     cjson_path[strlen(cjson_path)-1] = 'c';
     Fd cjson_c = fd_open_for_read(cjson_path);
-    memset(buffer,0,4096);
-    while(1){
-        bytes = fd_read(cjson_c,buffer,4096);
-        if(bytes == 0){
-            fd_write(nbsh,"\n",1);
-            break;
-        }
-        fd_write(nbsh,buffer,bytes);
-    }
+    fdw_flush(&nbsh.writer);
+    fd_sendfile(nbsh.writer.fd,cjson_c,0);
+    fdw_write(&nbsh.writer,"\n",1);
+    fd_close(cjson_c);
 
     const char* enddef = 
     "////////////////////////////////////////////////////////////////////////////////\n"
     "#endif //NOBUILD_IMPLEMENTATION\n\n"
     "////////////////////////////////////////////////////////////////////////////////\n";
 
-    fd_write(nbsh,enddef,strlen(enddef));
+    fdw_write(&nbsh.writer,enddef,strlen(enddef));
 
-    fd_close(nbsh);
+    output_file_close(&nbsh);
     Cstr_Array output = cstr_array_make("");
     // int i = 0;
     // while(1){
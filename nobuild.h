@@ -47,6 +47,8 @@ void todo_safe(const char *fmt, ...) NOBUILD_PRINTF_FORMAT(1, 2);
 
 
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 
 #ifndef NOBUILD__DEPRECATED
 #	if defined(__GNUC__) || (defined(__clang__) && !defined(_MSC_VER))
@@ -56,6 +58,15 @@ void todo_safe(const char *fmt, ...) NOBUILD_PRINTF_FORMAT(1, 2);
 #	endif
 #endif
 
+#ifndef NOBUILD_PRINTF_FORMAT
+#	if defined(__GNUC__) || defined(__clang__)
+#		// https://gcc.gnu.org/onlinedocs/gcc-4.7.2/gcc/Function-Attributes.html
+#		define NOBUILD_PRINTF_FORMAT(STRING_INDEX, FIRST_TO_CHECK) __attribute__ ((format (printf, STRING_INDEX, FIRST_TO_CHECK)))
+#	else
+#		define NOBUILD_PRINTF_FORMAT(STRING_INDEX, FIRST_TO_CHECK)
+#	endif
+#endif
+
 typedef const char * Cstr;
 
 int cstr_ends_with(Cstr cstr, Cstr postfix);
@@ -64,12 +75,96 @@ int cstr_ends_with(Cstr cstr, Cstr postfix);
 int cstr_starts_with(Cstr cstr, Cstr prefix);
 #define STARTS_WITH(cstr, prefix) cstr_starts_with(cstr, prefix)
 
+// Generic dynamic arrays. Any struct with `elems`, `count` and `capacity`
+// fields works with these macros, where `capacity` is the number of allocated
+// elements. They take a pointer to the array and modify it in place, growing
+// the storage geometrically so appending n elements costs O(n) overall.
+//
+//   typedef struct { int *elems; size_t count; size_t capacity; } Ints;
+//   Ints ints = {0};
+//   ARRAY_APPEND(&ints, 69);
+//   ARRAY_FREE(&ints);
+#ifndef ARRAY_INIT_CAPACITY
+#define ARRAY_INIT_CAPACITY 16
+#endif
+
+void *nobuild__array_grow(void *elems, size_t elem_size, size_t *capacity, size_t expected_capacity);
+
+#define ARRAY_RESERVE(array, expected_capacity)                         \
+    do {                                                                \
+        if ((expected_capacity) > (array)->capacity) {                  \
+            (array)->elems = nobuild__array_grow(                       \
+                (array)->elems, sizeof *(array)->elems,                 \
+                &(array)->capacity, (expected_capacity));               \
+        }                                                               \
+    } while (0)
+
+#define ARRAY_APPEND(array, elem)                                       \
+    do {                                                                \
+        ARRAY_RESERVE(array, (array)->count + 1);                       \
+        (array)->elems[(array)->count++] = (elem);                      \
+    } while (0)
+
+#define ARRAY_APPEND_MANY(array, new_elems, new_count)                  \
+    do {                                                                \
+        ARRAY_RESERVE(array, (array)->count + (new_count));             \
+        memcpy((array)->elems + (array)->count, (new_elems),            \
+               sizeof *(array)->elems * (new_count));                   \
+        (array)->count += (new_count);                                  \
+    } while (0)
+
+// Removes the element at `index` by moving the last element into its place.
+// O(1), but does not keep the order of the elements.
+#define ARRAY_SWAP_REMOVE(array, index)                                 \
+    do {                                                                \
+        (array)->elems[(index)] = (array)->elems[--(array)->count];     \
+    } while (0)
+
+// Removes the element at `index` and shifts the following ones left.
+#define ARRAY_REMOVE(array, index)                                      \
+    do {                                                                \
+        size_t nobuild__index = (index);                                \
+        memmove((array)->elems + nobuild__index,                        \
+                (array)->elems + nobuild__index + 1,                    \
+                sizeof *(array)->elems                                  \
+                * ((array)->count - nobuild__index - 1));               \
+        (array)->count--;                                               \
+    } while (0)
+
+#define ARRAY_FREE(array)                                               \
+    do {                                                                \
+        free((array)->elems);                                           \
+        (array)->elems = NULL;                                          \
+        (array)->count = 0;                                             \
+        (array)->capacity = 0;                                          \
+    } while (0)
+
 typedef struct {
     Cstr *elems;
     size_t count;
     size_t capacity;
 } Cstr_Array;
 
+// Non-owning view into a string that is not necessarily null terminated.
+// Print it with `printf(SV_FMT, SV_ARG(sv))`.
+typedef struct {
+    const char *data;
+    size_t count;
+} String_View;
+
+#define SV_FMT "%.*s"
+#define SV_ARG(sv) (int) (sv).count, (sv).data
+#define SV_STATIC(cstr_lit) { (cstr_lit), sizeof(cstr_lit) - 1 }
+
+String_View sv_from_parts(const char *data, size_t count);
+String_View sv_from_cstr(Cstr cstr);
+int sv_eq(String_View a, String_View b);
+int sv_eq_cstr(String_View sv, Cstr cstr);
+
+// Copies the view into a new null terminated string, interned with
+// `NOBUILD_INTERN_CSTRS`
+Cstr sv_to_cstr(String_View sv);
+
 Cstr_Array cstr_array_make(Cstr first, ...);
 #define CSTR_ARRAY_MAKE(first, ...) cstr_array_make(first, ##__VA_ARGS__, NULL)
 
@@ -81,6 +176,9 @@ Cstr_Array cstr_array_concat(Cstr_Array cstrs_a, Cstr_Array cstrs_b);
 
 int cstr_array_contains(Cstr_Array cstrs, Cstr cstr);
 
+// Splits `cstr` on every occurrence of `delim`. The substrings all point into
+// one copy of `cstr` that starts at `elems[0]`, so freeing `elems[0]` and
+// `elems` releases the whole result.
 Cstr_Array cstr_array_from_cstr(Cstr cstr, Cstr delim);
 #define SPLIT(cstr, delim) cstr_array_from_cstr(cstr, delim)
 
@@ -88,19 +186,110 @@ Cstr cstr_array_join(Cstr sep, Cstr_Array cstrs);
 #define JOIN(sep, ...) cstr_array_join(sep, cstr_array_make(__VA_ARGS__, NULL))
 #define CONCAT(...) JOIN("", __VA_ARGS__)
 
+size_t cstr_hash(Cstr cstr);
+size_t cstr_hash_n(const char *data, size_t len);
+
+typedef struct {
+    size_t hash;
+    Cstr key;
+} Cstr_Set_Entry;
+
+// Open addressing hash set of strings. The keys are not copied, so they must
+// outlive the set. A zero initialized set is empty and ready to use.
+typedef struct {
+    Cstr_Set_Entry *entries;
+    size_t count;
+    size_t capacity;
+} Cstr_Set;
+
+int cstr_set_contains(const Cstr_Set *set, Cstr cstr);
+// Returns 1 if `cstr` was added, 0 if it was already in the set
+int cstr_set_add(Cstr_Set *set, Cstr cstr);
+// Returns 1 if `cstr` was removed, 0 if it was not in the set
+int cstr_set_remove(Cstr_Set *set, Cstr cstr);
+void cstr_set_clear(Cstr_Set *set);
+void cstr_set_free(Cstr_Set *set);
+
+typedef struct {
+    size_t hash;
+    Cstr key;
+    void *value;
+} Cstr_Map_Entry;
+
+// Open addressing hash map from strings to pointers. Same ownership rules as `Cstr_Set`.
+typedef struct {
+    Cstr_Map_Entry *entries;
+    size_t count;
+    size_t capacity;
+} Cstr_Map;
+
+// Returns the entry of `key` or NULL if there is none. The entry stays valid until the map is modified.
+Cstr_Map_Entry *cstr_map_find(const Cstr_Map *map, Cstr key);
+// Returns the value of `key` or NULL if there is none
+void *cstr_map_get(const Cstr_Map *map, Cstr key);
+// Returns the previous value of `key` or NULL if there was none
+void *cstr_map_put(Cstr_Map *map, Cstr key, void *value);
+// Returns the removed value of `key` or NULL if there was none
+void *cstr_map_remove(Cstr_Map *map, Cstr key);
+void cstr_map_clear(Cstr_Map *map);
+void cstr_map_free(Cstr_Map *map);
+
+// Returns the one copy of `cstr` shared by the whole process, so interned
+// strings can be compared by pointer. The copies live until the process exits.
+//
+// Define `NOBUILD_INTERN_CSTRS` before including nobuild to have the string
+// helpers (`JOIN`, `CONCAT`, `PATH`, `NOEXT`, `DIRNAME`, `BASENAME`, ...)
+// return interned strings as well.
+Cstr cstr_intern(Cstr cstr);
+Cstr cstr_intern_n(const char *data, size_t len);
+#define INTERN(cstr) cstr_intern(cstr)
+
+// Used by the string helpers to hand out their results: `cstr` must be allocated
+// with malloc() and is swapped for its interned copy with `NOBUILD_INTERN_CSTRS`
+Cstr nobuild__cstr_result(char *cstr, size_t len);
+
+// Growable string buffer, a dynamic array of chars that works with the
+// `ARRAY_*` macros. `elems` is not null terminated until `sb_to_cstr()`.
+// A zero initialized builder is empty and ready to use.
+//
+//   String_Builder sb = {0};
+//   sb_append_cstr(&sb, "cc");
+//   sb_appendf(&sb, " -O%d", 2);
+//   Cstr line = sb_to_cstr(&sb);
+typedef struct {
+    char *elems;
+    size_t count;
+    size_t capacity;
+} String_Builder;
+
+void sb_append_buf(String_Builder *sb, const char *buf, size_t size);
+void sb_append_cstr(String_Builder *sb, Cstr cstr);
+void sb_append_sv(String_Builder *sb, String_View sv);
+int sb_appendf(String_Builder *sb, const char *fmt, ...) NOBUILD_PRINTF_FORMAT(2, 3);
+
+// Null terminates the builder and hands its buffer over as a `Cstr`, leaving
+// the builder empty. Use `ARRAY_FREE()` instead to discard the contents.
+Cstr sb_to_cstr(String_Builder *sb);
+
 
 ////////////////////////////////////////////////////////////////////////////////
 
 
 #ifndef _WIN32
 #    include <sys/types.h>
+#    include <sys/uio.h>
 typedef pid_t Pid;
 typedef int Fd;
+typedef struct iovec Fd_Iovec;
 #else
 #    define WIN32_MEAN_AND_LEAN
 #    include <windows.h>
 typedef HANDLE Pid;
 typedef HANDLE Fd;
+typedef struct {
+    void *iov_base;
+    size_t iov_len;
+} Fd_Iovec;
 #endif
 
 #ifndef NOBUILD_PRINTF_FORMAT
@@ -121,11 +310,165 @@ Pipe pipe_make(void);
 
 Fd fd_open_for_read(const char *path);
 Fd fd_open_for_write(const char *path);
+// Opens for reading and writing, creates the file but keeps its contents
+Fd fd_open_for_update(const char *path);
 size_t fd_read(Fd fd, void *buf, unsigned long count);
 size_t fd_write(Fd fd, void *buf, unsigned long count);
+// Keeps writing until all of `buf` is written, returns 0 on error
+int fd_write_all(Fd fd, const void *buf, size_t count);
+// Like `fd_write_all()` at `offset`, without moving the file offset
+int fd_pwrite_all(Fd fd, const void *buf, size_t count, unsigned long long offset);
+// Cuts or extends the file to `size` bytes, returns 0 on error
+int fd_truncate(Fd fd, unsigned long long size);
+// Writes all of the buffers, with as few syscalls as possible, returns 0 on error
+int fd_writev(Fd fd, const Fd_Iovec *iov, int count);
+// Reads into the buffers in order with one syscall, returns the bytes read
+size_t fd_readv(Fd fd, const Fd_Iovec *iov, int count);
+
+// Size of the intermediate buffer used when none of the kernel side copy
+// mechanisms (reflink, copy_file_range, sendfile, splice) are available
+#ifndef NOBUILD_COPY_BUFFER_SIZE
+#	define NOBUILD_COPY_BUFFER_SIZE (1024 * 1024)
+#endif
+
+// Copy `count` bytes, or everything up to the end of the file if `count` is 0,
+// from the current offset of `src` to `dst` without going through user space
+// when the kernel allows it. Return the number of bytes copied.
+//
+// `fd_sendfile()` is meant for a regular file as `src`, `fd_splice()` for
+// pipes on either end. Both fall back to a read/write loop.
+size_t fd_sendfile(Fd dst, Fd src, size_t count);
+size_t fd_splice(Fd dst, Fd src, size_t count);
+
+// Batches of independent stat/open/read operations. Define `NOBUILD_IO_URING`
+// before including nobuild to run them through io_uring on Linux, with up to
+// `NOBUILD_IO_URING_ENTRIES` of them in flight per syscall. Without it, or when
+// the kernel refuses io_uring, they run one by one with the usual syscalls.
+//
+//   Fd_Batch batch = {0};
+//   for (size_t i = 0; i < paths.count; ++i) {
+//       fd_batch_stat(&batch, paths.elems[i]);
+//   }
+//   fd_batch_submit(&batch);
+//   // batch.elems[i].error, .is_dir, .file_size, .mtime
+//   ARRAY_FREE(&batch);
+//
+// The operations of one batch may complete in any order, so open a batch of
+// files and read them in the next one.
+#ifndef NOBUILD_IO_URING_ENTRIES
+#define NOBUILD_IO_URING_ENTRIES 256
+#endif
+
+typedef enum {
+    FD_BATCH_STAT,
+    FD_BATCH_OPEN,
+    FD_BATCH_READ,
+} Fd_Batch_Kind;
+
+typedef struct {
+    Fd_Batch_Kind kind;
+    Cstr path;
+    // Input of FD_BATCH_READ, result of FD_BATCH_OPEN
+    Fd fd;
+    void *buf;
+    size_t size;
+    unsigned long long offset;
+
+    // Results, `error` is 0 on success or an errno value
+    int error;
+    size_t bytes;
+    int is_dir;
+    unsigned long long file_size;
+    // Nanoseconds on POSIX, 100ns ticks on Windows
+    long long mtime;
+} Fd_Batch_Op;
+
+typedef struct {
+    Fd_Batch_Op *elems;
+    size_t count;
+    size_t capacity;
+} Fd_Batch;
+
+void fd_batch_stat(Fd_Batch *batch, Cstr path);
+// Opens `path` for reading
+void fd_batch_open(Fd_Batch *batch, Cstr path);
+// Reads at most `size` bytes at `offset` without moving the file offset
+void fd_batch_read(Fd_Batch *batch, Fd fd, void *buf, size_t size, unsigned long long offset);
+// Runs every operation of the batch and fills in their results
+void fd_batch_submit(Fd_Batch *batch);
 int fd_printf(Fd fd, const char *fmt, ...) NOBUILD_PRINTF_FORMAT(2, 3);
+// Writes the whole contents of the builder, returns 0 on error
+int fd_write_sb(Fd fd, const String_Builder *sb);
 void fd_close(Fd fd);
 
+// Reads the whole file into one allocation sized from its file size. The
+// result is null terminated and must be freed with free(). `size` may be NULL.
+// Returns NULL on error.
+char *read_entire_file(Cstr path, size_t *size);
+
+#ifndef NOBUILD_MAP_THRESHOLD
+#define NOBUILD_MAP_THRESHOLD (64 * 1024)
+#endif
+
+// Read-only view of a whole file. Files of at least `NOBUILD_MAP_THRESHOLD`
+// bytes are memory mapped, smaller ones are cheaper to read with
+// `read_entire_file()`. `data` is not null terminated when the file is mapped.
+typedef struct {
+    const char *data;
+    size_t size;
+    int is_mapped;
+} File_Map;
+
+// `data` is NULL on error
+File_Map file_map(Cstr path);
+void file_unmap(File_Map *map);
+
+#ifndef NOBUILD_FD_BUFFER_SIZE
+#define NOBUILD_FD_BUFFER_SIZE (64 * 1024)
+#endif
+
+// Buffered writer, so many small writes cost one write syscall per
+// `buffer_size` bytes. Writes larger than the buffer go straight to the fd.
+//
+//   Fd_Writer out = fdw_make(fd_open_for_write("out.txt"), 0);
+//   fdw_printf(&out, "%d\n", 69);
+//   fdw_close(&out);
+typedef struct {
+    Fd fd;
+    char *buffer;
+    size_t count;
+    size_t capacity;
+} Fd_Writer;
+
+// A `buffer_size` of 0 uses `NOBUILD_FD_BUFFER_SIZE`
+Fd_Writer fdw_make(Fd fd, size_t buffer_size);
+// The write functions return 0 on error
+int fdw_write(Fd_Writer *writer, const void *buf, size_t count);
+int fdw_write_cstr(Fd_Writer *writer, Cstr cstr);
+int fdw_printf(Fd_Writer *writer, const char *fmt, ...) NOBUILD_PRINTF_FORMAT(2, 3);
+int fdw_flush(Fd_Writer *writer);
+// Flushes the writer, closes its fd and frees the buffer
+void fdw_close(Fd_Writer *writer);
+
+// Buffered reader, the counterpart of `Fd_Writer`
+typedef struct {
+    Fd fd;
+    char *buffer;
+    size_t begin;
+    size_t end;
+    size_t capacity;
+} Fd_Reader;
+
+// A `buffer_size` of 0 uses `NOBUILD_FD_BUFFER_SIZE`
+Fd_Reader fdr_make(Fd fd, size_t buffer_size);
+size_t fdr_read(Fd_Reader *reader, void *buf, size_t count);
+// Reads the next line without its line ending. `line` points into the buffer
+// of the reader and stays valid until the next read. Returns 0 at the end of
+// the file. The buffer grows to fit lines longer than it.
+int fdr_read_line(Fd_Reader *reader, String_View *line);
+// Closes the fd of the reader and frees the buffer
+void fdr_close(Fd_Reader *reader);
+
 void pid_wait(Pid pid);
 
 
@@ -151,6 +494,25 @@ typedef struct {
     Cstr_Array line;
 } Cmd;
 
+// Builds a command in place, reusing the storage of `cmd->line` across
+// commands. For many commands that share their flags, build the shared part
+// once as a template and extend a reset command with it:
+//
+//   Cmd cc = {0};
+//   CMD_APPEND(&cc, "cc", "-Wall", "-O2", "-c");
+//
+//   Cmd cmd = {0};
+//   for (size_t i = 0; i < sources.count; ++i) {
+//       cmd_reset(&cmd);
+//       cmd_extend(&cmd, cc.line);
+//       CMD_APPEND(&cmd, "-o", objects.elems[i], sources.elems[i]);
+//       cmd_run_sync(cmd);
+//   }
+void cmd_append(Cmd *cmd, ...);
+#define CMD_APPEND(cmd, ...) cmd_append(cmd, __VA_ARGS__, NULL)
+void cmd_extend(Cmd *cmd, Cstr_Array args);
+void cmd_reset(Cmd *cmd);
+
 Cstr cmd_show(Cmd cmd);
 Pid cmd_run_async(Cmd cmd, Fd *fdin, Fd *fdout);
 void cmd_run_sync(Cmd cmd);
@@ -225,6 +587,10 @@ void chain_echo(Chain chain);
 ////////////////////////////////////////////////////////////////////////////////
 
 
+#ifndef _WIN32
+#	include <dirent.h>
+#endif
+
 #ifndef NOBUILD__DEPRECATED
 #	if defined(__GNUC__) || (defined(__clang__) && !defined(_MSC_VER))
 #		define NOBUILD__DEPRECATED(func) __attribute__ ((deprecated)) func
@@ -254,6 +620,41 @@ Cstr path_dirname(Cstr path);
 Cstr path_basename(Cstr path);
 #define BASENAME(path) path_basename(path)
 
+// Variants of the helpers above that return a view into `path` (or into a
+// string literal) instead of allocating. Use `sv_to_cstr()` to keep the result.
+String_View path_no_ext_sv(Cstr path);
+String_View path_dirname_sv(Cstr path);
+String_View path_basename_sv(Cstr path);
+
+// Extension of the basename without the dot, "c" for "src/main.c". Empty if the
+// basename has no dot or only a leading one, like ".gitignore".
+String_View path_extension_sv(Cstr path);
+
+// Basename without its extension, "main" for "src/main.c"
+String_View path_stem_sv(Cstr path);
+
+// Iterates over the components of `path`, skipping repeated separators. Start
+// with a zero initialized `component`, returns 0 once there are no more.
+//
+//   String_View component = {0};
+//   while (path_next_component(path, &component)) {
+//       INFO(SV_FMT, SV_ARG(component));
+//   }
+int path_next_component(Cstr path, String_View *component);
+
+// Collapses `.`, `..` and repeated separators without touching the filesystem,
+// so `./src/a.c`, `src//a.c` and `src/../src/a.c` all become `src/a.c`. The
+// result is interned. Note that `..` is removed lexically, which differs from
+// what the filesystem does when the previous component is a symlink.
+Cstr path_normalize(Cstr path);
+#define NORMALIZE(path) path_normalize(path)
+
+// Normalized absolute path with the symlinks resolved. Results are memoized
+// for the rest of the run; paths that do not exist yet are only normalized.
+Cstr path_realpath(Cstr path);
+#define REALPATH(path) path_realpath(path)
+void path_realpath_cache_clear(void);
+
 int path_is_dir(Cstr path);
 #define IS_DIR(path) path_is_dir(path)
 
@@ -267,6 +668,53 @@ NOBUILD__DEPRECATED(int is_path1_modified_after_path2(Cstr path1, Cstr path2));
 int path_is_newer(Cstr path1, Cstr path2);
 #define IS_NEWER(path1, path2) path_is_newer(path1, path2)
 
+// Returns 1 if any of `outputs` is missing or older than any of `inputs`.
+// Every path is stat'ed at most once per run: the results are cached and only
+// the outputs reported as stale are forgotten, since the caller is about to
+// regenerate them. Call `path_stat_cache_clear()` after changing files behind
+// nobuild's back.
+int path_needs_rebuild(Cstr_Array outputs, Cstr_Array inputs);
+#define NEEDS_REBUILD(output, ...) path_needs_rebuild(cstr_array_make(output, NULL), cstr_array_make(__VA_ARGS__, NULL))
+void path_stat_cache_clear(void);
+
+// Early cutoff for commands that rewrite their outputs with the same contents.
+// `path_restat()` hashes the outputs after the command ran and records them in
+// `NOBUILD_RESTAT_LOG`. Outputs whose hash did not change keep the modification
+// time of their previous contents when `path_needs_rebuild()` and
+// `path_is_newer()` look at them as inputs, so their dependents stay clean:
+//
+//   if (NEEDS_REBUILD("build/parser.h", "parser.y")) {
+//       CMD("bison", "--header=build/parser.h", "-o", "build/parser.c", "parser.y");
+//       RESTAT("build/parser.h", "build/parser.c");
+//   }
+#ifndef NOBUILD_RESTAT_LOG
+#define NOBUILD_RESTAT_LOG ".nobuild_restat"
+#endif
+
+void path_restat(Cstr_Array outputs);
+#define RESTAT(...) path_restat(cstr_array_make(__VA_ARGS__, NULL))
+
+// Headers that `path` includes, directly or through other headers, found the
+// way the compiler would: `"..."` next to the including file and then in
+// `include_dirs`, `<...>` only in `include_dirs`. The directories may be given
+// as `-I` flags. Headers outside of them, like the system headers, are left
+// out. Meant as the inputs of `path_needs_rebuild()` before a depfile exists:
+//
+//   Cstr_Array deps = SCAN_INCLUDES("src/main.c", "-Iinclude");
+//   if (path_needs_rebuild(cstr_array_make("build/main.o", NULL), cstr_array_append(deps, "src/main.c"))) ...
+//
+// The `#include` lines of each file are cached by content hash in
+// `NOBUILD_INCLUDE_LOG`, across runs, and a file is only read again when its
+// size or modification time changes.
+#ifndef NOBUILD_INCLUDE_LOG
+#define NOBUILD_INCLUDE_LOG ".nobuild_includes"
+#endif
+
+Cstr_Array path_scan_includes(Cstr path, Cstr_Array include_dirs);
+#define SCAN_INCLUDES(path, ...) path_scan_includes(path, cstr_array_make(__VA_ARGS__, NULL))
+
+// Directories created or found by `path_mkdirs()` are remembered for the rest of
+// the process, so calling it again for the same directory is cheap
 void path_mkdirs(Cstr_Array path);
 #define MKDIRS(...)                                             \
     do {                                                        \
@@ -275,6 +723,9 @@ void path_mkdirs(Cstr_Array path);
         path_mkdirs(path);                                      \
     } while (0)
 
+// Make sure the directory that will contain `path` exists
+void path_mkdirs_parent(Cstr path);
+
 void path_rename(Cstr old_path, Cstr new_path);
 #define RENAME(old_path, new_path)                    \
     do {                                              \
@@ -289,6 +740,64 @@ void path_copy(Cstr old_path, Cstr new_path);
         path_copy(old_path, new_path);              \
     } while(0)
 
+// Generated files that keep their modification time when regenerated with
+// the same contents, so whatever depends on them is not rebuilt:
+//
+//   Output_File out = output_file_open("build/config.h");
+//   fdw_printf(&out.writer, "#define VERSION %d\n", 69);
+//   output_file_close(&out);
+//
+// The contents go to `<path>.tmp` first. Closing compares it to `path`, size
+// first, and renames it over `path` only if they differ.
+typedef struct {
+    Fd_Writer writer;
+    Cstr path;
+    Cstr temp_path;
+} Output_File;
+
+Output_File output_file_open(Cstr path);
+// Returns 1 if `path` was replaced, 0 if it was left alone
+int output_file_close(Output_File *file);
+// Same for contents that are already in memory, no temporary file is written
+// when `path` already holds them
+int path_write_if_changed(Cstr path, const void *data, size_t size);
+
+typedef struct {
+    // Remove the files and directories of the destination that are not in the source
+    int delete_extraneous;
+    // Compare the contents of files of the same size instead of their modification times
+    int compare_contents;
+    // Number of threads copying files, 0 means one per CPU
+    size_t jobs;
+} Sync_Options;
+
+typedef struct {
+    size_t files_copied;
+    size_t files_skipped;
+    size_t files_deleted;
+    // Files that could not be copied, each one is logged with `ERRO`
+    size_t files_failed;
+    unsigned long long bytes_copied;
+    unsigned long long bytes_skipped;
+} Sync_Stats;
+
+// Make `dst_path` a copy of `src_path` by only copying the files that differ
+// in size or modification time. Directories are walked up front and the
+// copies are then spread over a pool of worker threads. Check `files_failed`
+// to know whether every file made it.
+Sync_Stats path_sync(Cstr src_path, Cstr dst_path, Sync_Options options);
+#define SYNC(src_path, dst_path)                                                    \
+    do {                                                                            \
+        INFO("SYNC: %s -> %s", src_path, dst_path);                                 \
+        Sync_Stats stats = path_sync(src_path, dst_path, (Sync_Options) {0});       \
+        INFO("SYNC: copied %zu files (%llu bytes), skipped %zu files (%llu bytes)", \
+             stats.files_copied, stats.bytes_copied,                                \
+             stats.files_skipped, stats.bytes_skipped);                             \
+        if (stats.files_failed > 0) {                                               \
+            PANIC("SYNC: could not copy %zu files", stats.files_failed);            \
+        }                                                                           \
+    } while(0)
+
 void path_rm(Cstr path);
 #define RM(path)                                \
     do {                                        \
@@ -296,6 +805,37 @@ void path_rm(Cstr path);
         path_rm(path);                          \
     } while(0)
 
+// Rename `path` aside and remove it on a background thread so that `path`
+// can be recreated right away. Pending removals are finished by
+// `path_rm_wait()`, which also runs at exit.
+void path_rm_background(Cstr path);
+void path_rm_wait(void);
+#define RM_BACKGROUND(path)                     \
+    do {                                        \
+        INFO("RM_BACKGROUND: %s", path);        \
+        path_rm_background(path);               \
+    } while(0)
+
+// One stat of one path, for the modules that need a single size or modification
+// time. Many paths are better stat'ed with an `Fd_Batch`.
+typedef struct {
+    int exists;
+    int is_dir;
+    unsigned long long size;
+    // Nanoseconds on POSIX (whole seconds when the platform lacks POSIX.1-2008
+    // timestamps), 100ns ticks on Windows. Only meaningful when compared to
+    // another `Nobuild__Stat` or an `Fd_Batch_Op`.
+    long long mtime;
+} Nobuild__Stat;
+
+// Returns 1 and fills `st` if `path` exists, 0 otherwise
+int nobuild__stat(Cstr path, Nobuild__Stat *st);
+
+int nobuild__is_path_sep(char c);
+
+// Defined by the cmd and path modules, behind `NOBUILD__STRERROR`
+Cstr nobuild__strerror(int errnum);
+
 #define FOREACH_FILE_IN_DIR(file, dirpath, body)        \
     do {                                                \
         struct dirent *dp = NULL;                       \
@@ -321,6 +861,309 @@ void path_rm(Cstr path);
 
 ////////////////////////////////////////////////////////////////////////////////
 
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+#ifndef cJSON__h
+#define cJSON__h
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#if !defined(__WINDOWS__) && (defined(WIN32) || defined(WIN64) || defined(_MSC_VER) || defined(_WIN32))
+#define __WINDOWS__
+#endif
+
+#ifdef __WINDOWS__
+
+/* When compiling for windows, we specify a specific calling convention to avoid issues where we are being called from a project with a different default calling convention.  For windows you have 3 define options:
+
+CJSON_HIDE_SYMBOLS - Define this in the case where you don't want to ever dllexport symbols
+CJSON_EXPORT_SYMBOLS - Define this on library build when you want to dllexport symbols (default)
+CJSON_IMPORT_SYMBOLS - Define this if you want to dllimport symbol
+
+For *nix builds that support visibility attribute, you can define similar behavior by
+
+setting default visibility to hidden by adding
+-fvisibility=hidden (for gcc)
+or
+-xldscope=hidden (for sun cc)
+to CFLAGS
+
+then using the CJSON_API_VISIBILITY flag to "export" the same symbols the way CJSON_EXPORT_SYMBOLS does
+
+*/
+
+#define CJSON_CDECL __cdecl
+#define CJSON_STDCALL __stdcall
+
+/* export symbols by default, this is necessary for copy pasting the C and header file */
+#if !defined(CJSON_HIDE_SYMBOLS) && !defined(CJSON_IMPORT_SYMBOLS) && !defined(CJSON_EXPORT_SYMBOLS)
+#define CJSON_EXPORT_SYMBOLS
+#endif
+
+#if defined(CJSON_HIDE_SYMBOLS)
+#define CJSON_PUBLIC(type)   type CJSON_STDCALL
+#elif defined(CJSON_EXPORT_SYMBOLS)
+#define CJSON_PUBLIC(type)   __declspec(dllexport) type CJSON_STDCALL
+#elif defined(CJSON_IMPORT_SYMBOLS)
+#define CJSON_PUBLIC(type)   __declspec(dllimport) type CJSON_STDCALL
+#endif
+#else /* !__WINDOWS__ */
+#define CJSON_CDECL
+#define CJSON_STDCALL
+
+#if (defined(__GNUC__) || defined(__SUNPRO_CC) || defined (__SUNPRO_C)) && defined(CJSON_API_VISIBILITY)
+#define CJSON_PUBLIC(type)   __attribute__((visibility("default"))) type
+#else
+#define CJSON_PUBLIC(type) type
+#endif
+#endif
+
+/* project version */
+#define CJSON_VERSION_MAJOR 1
+#define CJSON_VERSION_MINOR 7
+#define CJSON_VERSION_PATCH 16
+
+#include <stddef.h>
+
+/* cJSON Types: */
+#define cJSON_Invalid (0)
+#define cJSON_False  (1 << 0)
+#define cJSON_True   (1 << 1)
+#define cJSON_NULL   (1 << 2)
+#define cJSON_Number (1 << 3)
+#define cJSON_String (1 << 4)
+#define cJSON_Array  (1 << 5)
+#define cJSON_Object (1 << 6)
+#define cJSON_Raw    (1 << 7) /* raw json */
+
+#define cJSON_IsReference 256
+#define cJSON_StringIsConst 512
+
+/* The cJSON structure: */
+typedef struct cJSON
+{
+    /* next/prev allow you to walk array/object chains. Alternatively, use GetArraySize/GetArrayItem/GetObjectItem */
+    struct cJSON *next;
+    struct cJSON *prev;
+    /* An array or object item will have a child pointer pointing to a chain of the items in the array/object. */
+    struct cJSON *child;
+
+    /* The type of the item, as above. */
+    int type;
+
+    /* The item's string, if type==cJSON_String  and type == cJSON_Raw */
+    char *valuestring;
+    /* writing to valueint is DEPRECATED, use cJSON_SetNumberValue instead */
+    int valueint;
+    /* The item's number, if type==cJSON_Number */
+    double valuedouble;
+
+    /* The item's name string, if this item is the child of, or is in the list of subitems of an object. */
+    char *string;
+} cJSON;
+
+typedef struct cJSON_Hooks
+{
+      /* malloc/free are CDECL on Windows regardless of the default calling convention of the compiler, so ensure the hooks allow passing those functions directly. */
+      void *(CJSON_CDECL *malloc_fn)(size_t sz);
+      void (CJSON_CDECL *free_fn)(void *ptr);
+} cJSON_Hooks;
+
+typedef int cJSON_bool;
+
+/* Limits how deeply nested arrays/objects can be before cJSON rejects to parse them.
+ * This is to prevent stack overflows. */
+#ifndef CJSON_NESTING_LIMIT
+#define CJSON_NESTING_LIMIT 1000
+#endif
+
+/* returns the version of cJSON as a string */
+CJSON_PUBLIC(const char*) cJSON_Version(void);
+
+/* Supply malloc, realloc and free functions to cJSON */
+CJSON_PUBLIC(void) cJSON_InitHooks(cJSON_Hooks* hooks);
+
+/* Memory Management: the caller is always responsible to free the results from all variants of cJSON_Parse (with cJSON_Delete) and cJSON_Print (with stdlib free, cJSON_Hooks.free_fn, or cJSON_free as appropriate). The exception is cJSON_PrintPreallocated, where the caller has full responsibility of the buffer. */
+/* Supply a block of JSON, and this returns a cJSON object you can interrogate. */
+CJSON_PUBLIC(cJSON *) cJSON_Parse(const char *value);
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithLength(const char *value, size_t buffer_length);
+/* ParseWithOpts allows you to require (and check) that the JSON is null terminated, and to retrieve the pointer to the final byte parsed. */
+/* If you supply a ptr in return_parse_end and parsing fails, then return_parse_end will contain a pointer to the error so will match cJSON_GetErrorPtr(). */
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated);
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated);
+
+/* Render a cJSON entity to text for transfer/storage. */
+CJSON_PUBLIC(char *) cJSON_Print(const cJSON *item);
+/* Render a cJSON entity to text for transfer/storage without any formatting. */
+CJSON_PUBLIC(char *) cJSON_PrintUnformatted(const cJSON *item);
+/* Render a cJSON entity to text using a buffered strategy. prebuffer is a guess at the final size. guessing well reduces reallocation. fmt=0 gives unformatted, =1 gives formatted */
+CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON_bool fmt);
+/* Render a cJSON entity to text using a buffer already allocated in memory with given length. Returns 1 on success and 0 on failure. */
+/* NOTE: cJSON is not always 100% accurate in estimating how much memory it will use, so to be safe allocate 5 bytes more than you actually need */
+CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buffer, const int length, const cJSON_bool format);
+/* Delete a cJSON entity and all subentities. */
+CJSON_PUBLIC(void) cJSON_Delete(cJSON *item);
+
+/* Returns the number of items in an array (or object). */
+CJSON_PUBLIC(int) cJSON_GetArraySize(const cJSON *array);
+/* Retrieve item number "index" from array "array". Returns NULL if unsuccessful. */
+CJSON_PUBLIC(cJSON *) cJSON_GetArrayItem(const cJSON *array, int index);
+/* Get item "string" from object. Case insensitive. */
+CJSON_PUBLIC(cJSON *) cJSON_GetObjectItem(const cJSON * const object, const char * const string);
+CJSON_PUBLIC(cJSON *) cJSON_GetObjectItemCaseSensitive(const cJSON * const object, const char * const string);
+CJSON_PUBLIC(cJSON_bool) cJSON_HasObjectItem(const cJSON *object, const char *string);
+/* For analysing failed parses. This returns a pointer to the parse error. You'll probably need to look a few chars back to make sense of it. Defined when cJSON_Parse() returns 0. 0 when cJSON_Parse() succeeds. */
+CJSON_PUBLIC(const char *) cJSON_GetErrorPtr(void);
+
+/* Check item type and return its value */
+CJSON_PUBLIC(char *) cJSON_GetStringValue(const cJSON * const item);
+CJSON_PUBLIC(double) cJSON_GetNumberValue(const cJSON * const item);
+
+/* These functions check the type of an item */
+CJSON_PUBLIC(cJSON_bool) cJSON_IsInvalid(const cJSON * const item);
+CJSON_PUBLIC(cJSON_bool) cJSON_IsFalse(const cJSON * const item);
+CJSON_PUBLIC(cJSON_bool) cJSON_IsTrue(const cJSON * const item);
+CJSON_PUBLIC(cJSON_bool) cJSON_IsBool(const cJSON * const item);
+CJSON_PUBLIC(cJSON_bool) cJSON_IsNull(const cJSON * const item);
+CJSON_PUBLIC(cJSON_bool) cJSON_IsNumber(const cJSON * const item);
+CJSON_PUBLIC(cJSON_bool) cJSON_IsString(const cJSON * const item);
+CJSON_PUBLIC(cJSON_bool) cJSON_IsArray(const cJSON * const item);
+CJSON_PUBLIC(cJSON_bool) cJSON_IsObject(const cJSON * const item);
+CJSON_PUBLIC(cJSON_bool) cJSON_IsRaw(const cJSON * const item);
+
+/* These calls create a cJSON item of the appropriate type. */
+CJSON_PUBLIC(cJSON *) cJSON_CreateNull(void);
+CJSON_PUBLIC(cJSON *) cJSON_CreateTrue(void);
+CJSON_PUBLIC(cJSON *) cJSON_CreateFalse(void);
+CJSON_PUBLIC(cJSON *) cJSON_CreateBool(cJSON_bool boolean);
+CJSON_PUBLIC(cJSON *) cJSON_CreateNumber(double num);
+CJSON_PUBLIC(cJSON *) cJSON_CreateString(const char *string);
+/* raw json */
+CJSON_PUBLIC(cJSON *) cJSON_CreateRaw(const char *raw);
+CJSON_PUBLIC(cJSON *) cJSON_CreateArray(void);
+CJSON_PUBLIC(cJSON *) cJSON_CreateObject(void);
+
+/* Create a string where valuestring references a string so
+ * it will not be freed by cJSON_Delete */
+CJSON_PUBLIC(cJSON *) cJSON_CreateStringReference(const char *string);
+/* Create an object/array that only references it's elements so
+ * they will not be freed by cJSON_Delete */
+CJSON_PUBLIC(cJSON *) cJSON_CreateObjectReference(const cJSON *child);
+CJSON_PUBLIC(cJSON *) cJSON_CreateArrayReference(const cJSON *child);
+
+/* These utilities create an Array of count items.
+ * The parameter count cannot be greater than the number of elements in the number array, otherwise array access will be out of bounds.*/
+CJSON_PUBLIC(cJSON *) cJSON_CreateIntArray(const int *numbers, int count);
+CJSON_PUBLIC(cJSON *) cJSON_CreateFloatArray(const float *numbers, int count);
+CJSON_PUBLIC(cJSON *) cJSON_CreateDoubleArray(const double *numbers, int count);
+CJSON_PUBLIC(cJSON *) cJSON_CreateStringArray(const char *const *strings, int count);
+
+/* Append item to the specified array/object. */
+CJSON_PUBLIC(cJSON_bool) cJSON_AddItemToArray(cJSON *array, cJSON *item);
+CJSON_PUBLIC(cJSON_bool) cJSON_AddItemToObject(cJSON *object, const char *string, cJSON *item);
+/* Use this when string is definitely const (i.e. a literal, or as good as), and will definitely survive the cJSON object.
+ * WARNING: When this function was used, make sure to always check that (item->type & cJSON_StringIsConst) is zero before
+ * writing to `item->string` */
+CJSON_PUBLIC(cJSON_bool) cJSON_AddItemToObjectCS(cJSON *object, const char *string, cJSON *item);
+/* Append reference to item to the specified array/object. Use this when you want to add an existing cJSON to a new cJSON, but don't want to corrupt your existing cJSON. */
+CJSON_PUBLIC(cJSON_bool) cJSON_AddItemReferenceToArray(cJSON *array, cJSON *item);
+CJSON_PUBLIC(cJSON_bool) cJSON_AddItemReferenceToObject(cJSON *object, const char *string, cJSON *item);
+
+/* Remove/Detach items from Arrays/Objects. */
+CJSON_PUBLIC(cJSON *) cJSON_DetachItemViaPointer(cJSON *parent, cJSON * const item);
+CJSON_PUBLIC(cJSON *) cJSON_DetachItemFromArray(cJSON *array, int which);
+CJSON_PUBLIC(void) cJSON_DeleteItemFromArray(cJSON *array, int which);
+CJSON_PUBLIC(cJSON *) cJSON_DetachItemFromObject(cJSON *object, const char *string);
+CJSON_PUBLIC(cJSON *) cJSON_DetachItemFromObjectCaseSensitive(cJSON *object, const char *string);
+CJSON_PUBLIC(void) cJSON_DeleteItemFromObject(cJSON *object, const char *string);
+CJSON_PUBLIC(void) cJSON_DeleteItemFromObjectCaseSensitive(cJSON *object, const char *string);
+
+/* Update array items. */
+CJSON_PUBLIC(cJSON_bool) cJSON_InsertItemInArray(cJSON *array, int which, cJSON *newitem); /* Shifts pre-existing items to the right. */
+CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemViaPointer(cJSON * const parent, cJSON * const item, cJSON * replacement);
+CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemInArray(cJSON *array, int which, cJSON *newitem);
+CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemInObject(cJSON *object,const char *string,cJSON *newitem);
+CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemInObjectCaseSensitive(cJSON *object,const char *string,cJSON *newitem);
+
+/* Duplicate a cJSON item */
+CJSON_PUBLIC(cJSON *) cJSON_Duplicate(const cJSON *item, cJSON_bool recurse);
+/* Duplicate will create a new, identical cJSON item to the one you pass, in new memory that will
+ * need to be released. With recurse!=0, it will duplicate any children connected to the item.
+ * The item->next and ->prev pointers are always zero on return from Duplicate. */
+/* Recursively compare two cJSON items for equality. If either a or b is NULL or invalid, they will be considered unequal.
+ * case_sensitive determines if object keys are treated case sensitive (1) or case insensitive (0) */
+CJSON_PUBLIC(cJSON_bool) cJSON_Compare(const cJSON * const a, const cJSON * const b, const cJSON_bool case_sensitive);
+
+/* Minify a strings, remove blank characters(such as ' ', '\t', '\r', '\n') from strings.
+ * The input pointer json cannot point to a read-only address area, such as a string constant, 
+ * but should point to a readable and writable address area. */
+CJSON_PUBLIC(void) cJSON_Minify(char *json);
+
+/* Helper functions for creating and adding items to an object at the same time.
+ * They return the added item or NULL on failure. */
+CJSON_PUBLIC(cJSON*) cJSON_AddNullToObject(cJSON * const object, const char * const name);
+CJSON_PUBLIC(cJSON*) cJSON_AddTrueToObject(cJSON * const object, const char * const name);
+CJSON_PUBLIC(cJSON*) cJSON_AddFalseToObject(cJSON * const object, const char * const name);
+CJSON_PUBLIC(cJSON*) cJSON_AddBoolToObject(cJSON * const object, const char * const name, const cJSON_bool boolean);
+CJSON_PUBLIC(cJSON*) cJSON_AddNumberToObject(cJSON * const object, const char * const name, const double number);
+CJSON_PUBLIC(cJSON*) cJSON_AddStringToObject(cJSON * const object, const char * const name, const char * const string);
+CJSON_PUBLIC(cJSON*) cJSON_AddRawToObject(cJSON * const object, const char * const name, const char * const raw);
+CJSON_PUBLIC(cJSON*) cJSON_AddObjectToObject(cJSON * const object, const char * const name);
+CJSON_PUBLIC(cJSON*) cJSON_AddArrayToObject(cJSON * const object, const char * const name);
+
+/* When assigning an integer value, it needs to be propagated to valuedouble too. */
+#define cJSON_SetIntValue(object, number) ((object) ? (object)->valueint = (object)->valuedouble = (number) : (number))
+/* helper for the cJSON_SetNumberValue macro */
+CJSON_PUBLIC(double) cJSON_SetNumberHelper(cJSON *object, double number);
+#define cJSON_SetNumberValue(object, number) ((object != NULL) ? cJSON_SetNumberHelper(object, (double)number) : (number))
+/* Change the valuestring of a cJSON_String object, only takes effect when type of object is cJSON_String */
+CJSON_PUBLIC(char*) cJSON_SetValuestring(cJSON *object, const char *valuestring);
+
+/* If the object is not a boolean type this does nothing and returns cJSON_Invalid else it returns the new type*/
+#define cJSON_SetBoolValue(object, boolValue) ( \
+    (object != NULL && ((object)->type & (cJSON_False|cJSON_True))) ? \
+    (object)->type=((object)->type &(~(cJSON_False|cJSON_True)))|((boolValue)?cJSON_True:cJSON_False) : \
+    cJSON_Invalid\
+)
+
+/* Macro for iterating over an array or object */
+#define cJSON_ArrayForEach(element, array) for(element = (array != NULL) ? (array)->child : NULL; element != NULL; element = element->next)
+
+/* malloc/free objects using the malloc/free functions that have been set with cJSON_InitHooks */
+CJSON_PUBLIC(void *) cJSON_malloc(size_t size);
+CJSON_PUBLIC(void) cJSON_free(void *object);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
 
 #define FOREACH_ARRAY(type, elem, array, body)                                  \
     for (size_t elem_##index = 0; elem_##index < array.count; ++elem_##index) { \
@@ -387,8 +1230,253 @@ void path_rm(Cstr path);
 
 char *shift_args(int *argc, char ***argv);
 
+// Embed the file at `path` into `array_name`, with its size in `<array_name>_len`.
+// `file_to_c_array()` writes the bytes out as an initializer, which works with
+// any compiler but gets slow to compile for large files. `file_to_c_embed()`
+// writes a C23 `#embed` directive instead and `file_to_c_incbin()` an
+// assembler `.incbin` stub for GCC and Clang, both of which compile in no
+// time. The last two refer to `path` relative to the directory of `out_path`:
+// `#embed` finds it from there, the `.incbin` stub needs that directory on
+// the assembler include path, like `-Wa,-I<dir>`, and records its size at
+// generation time.
 void file_to_c_array(Cstr path, Cstr out_path, Cstr array_type,  Cstr array_name, int null_term);
+void file_to_c_embed(Cstr path, Cstr out_path, Cstr array_type, Cstr array_name, int null_term);
+void file_to_c_incbin(Cstr path, Cstr out_path, Cstr array_type, Cstr array_name, int null_term);
 #define FILE_TO_C_ARRAY(path, out_path, array_name) file_to_c_array(path, out_path, "unsigned char", array_name, 1)
+#define FILE_TO_C_EMBED(path, out_path, array_name) file_to_c_embed(path, out_path, "unsigned char", array_name, 1)
+#define FILE_TO_C_INCBIN(path, out_path, array_name) file_to_c_incbin(path, out_path, "unsigned char", array_name, 1)
+
+// Resource packs bundle many assets into one archive, so they are embedded
+// once instead of once per file:
+//
+//   Pack_Assets assets = {0};
+//   pack_add(&assets, "shaders/blit.frag", "assets/blit.frag");
+//   pack_add(&assets, "fonts/mono.ttf", "assets/mono.ttf");
+//   pack_write("build/assets.pack", assets);
+//   PACK_TO_C("build/assets.pack", "build/assets.c", "assets");
+//
+// `pack_write()` only writes the assets whose contents changed since the last
+// run, and leaves the archive alone when none did. At runtime:
+//
+//   Pack pack = pack_open("assets.pack");   // or pack_from_memory(assets, assets_len)
+//   String_View font = pack_find(&pack, "fonts/mono.ttf");
+//
+// The archive is a header, the asset data aligned to `NOBUILD_PACK_ALIGN`, the
+// names and an index sorted by name. Integers are 64 bits in the byte order of
+// the machine that wrote it.
+#ifndef NOBUILD_PACK_ALIGN
+#define NOBUILD_PACK_ALIGN 16
+#endif
+
+#define NOBUILD_PACK_MAGIC "NBPACK\0\1"
+
+typedef struct {
+    char magic[8];
+    unsigned long long count;
+    // End of the asset data
+    unsigned long long names_offset;
+    unsigned long long index_offset;
+} Pack_Header;
+
+typedef struct {
+    unsigned long long name_offset;
+    unsigned long long offset;
+    unsigned long long size;
+    unsigned long long hash;
+    // Modification time of the source, so unchanged assets are not hashed again
+    long long mtime;
+} Pack_Entry;
+
+typedef struct {
+    Cstr name;
+    Cstr path;
+} Pack_Asset;
+
+typedef struct {
+    Pack_Asset *elems;
+    size_t count;
+    size_t capacity;
+} Pack_Assets;
+
+void pack_add(Pack_Assets *assets, Cstr name, Cstr path);
+// Returns 0 on error
+int pack_write(Cstr pack_path, Pack_Assets assets);
+// Embeds the archive through `file_to_c_incbin()`, which keeps it aligned
+#define PACK_TO_C(pack_path, out_path, array_name) file_to_c_incbin(pack_path, out_path, "unsigned char", array_name, 0)
+
+typedef struct {
+    File_Map map;
+    const Pack_Header *header;
+    const Pack_Entry *index;
+    const char *names;
+} Pack;
+
+// `header` is NULL if the archive could not be read, or if any of its entries lies outside of it
+Pack pack_open(Cstr path);
+Pack pack_from_memory(const void *data, size_t size);
+// `data` is NULL if there is no asset called `name`
+String_View pack_find(const Pack *pack, Cstr name);
+void pack_close(Pack *pack);
+
+// C++20 modules: the order in which sources must be compiled is only known
+// after asking the compiler which modules each source provides and imports,
+// in the P1689 format.
+//
+//   Cmd cxx = {0};
+//   CMD_APPEND(&cxx, "clang++", "-std=c++20");
+//   Module_Deps deps[2];
+//   module_scan(MODULE_SCANNER_CLANG, cxx, "src/math.cppm", "build/math.o", &deps[0]);
+//   module_scan(MODULE_SCANNER_CLANG, cxx, "src/main.cpp", "build/main.o", &deps[1]);
+//   module_sort(deps, 2);
+//
+//   // Compile level 0, then level 1, ... The sources of one level can be compiled in parallel.
+//   for (size_t i = 0; i < 2; ++i) {
+//       Cmd cmd = {0};
+//       cmd_extend(&cmd, cxx.line);
+//       module_flags(MODULE_SCANNER_CLANG, &cmd, deps, 2, i);
+//       CMD_APPEND(&cmd, "-c", deps[i].source, "-o", deps[i].object);
+//       cmd_run_sync(cmd);
+//   }
+//
+// `compile` is the compiler with the flags of the compile, without the source
+// and the output. Scan results are cached in `NOBUILD_MODULE_CACHE_DIR` along
+// with the depfile of the scan, and only computed again when the source,
+// `compile` or one of the headers the source includes changes.
+#ifndef NOBUILD_MODULE_CACHE_DIR
+#define NOBUILD_MODULE_CACHE_DIR ".nobuild_modules"
+#endif
+
+#ifndef NOBUILD_CLANG_SCAN_DEPS
+#define NOBUILD_CLANG_SCAN_DEPS "clang-scan-deps"
+#endif
+
+typedef enum {
+    // clang-scan-deps -format=p1689
+    MODULE_SCANNER_CLANG,
+    // g++ -fdeps-format=p1689r5
+    MODULE_SCANNER_GCC,
+} Module_Scanner;
+
+typedef struct {
+    Cstr source;
+    Cstr object;
+    // Name of the module the source provides, NULL if it is not a module unit
+    // that other sources can import
+    Cstr provides;
+    // Where the compile of the source writes the BMI of `provides`: the path
+    // the scanner gives, or `<name>.pcm` (`.gcm` for GCC) next to the object
+    Cstr bmi;
+    // 0 for the implementation partitions, which a module cannot export
+    int is_interface;
+    // Names of the modules the source imports
+    Cstr_Array requires;
+    // BMI of each of `requires` if the scanner knows it, NULL otherwise. The
+    // BMIs of modules provided by the other scanned sources take precedence.
+    Cstr_Array required_bmis;
+    // Set by `module_sort()`, a source only imports modules of lower levels
+    size_t level;
+} Module_Deps;
+
+// Returns 0 if the scanner output could not be understood
+int module_scan(Module_Scanner scanner, Cmd compile, Cstr source, Cstr object, Module_Deps *deps);
+// Orders `deps` by level. Imports of modules that none of `deps` provide, like
+// `std`, are left to the compiler. Returns 0 if the imports form a cycle.
+int module_sort(Module_Deps *deps, size_t count);
+// Appends the flags that make the compile of `deps[index]` write the BMI of
+// the module it provides and find the BMIs of the modules it imports,
+// including the ones imported by those modules:
+// `-fmodule-output=` and `-fmodule-file=<name>=<bmi>` for Clang, a
+// `-fmodule-mapper=` file in `NOBUILD_MODULE_CACHE_DIR` for GCC
+void module_flags(Module_Scanner scanner, Cmd *cmd, const Module_Deps *deps, size_t count, size_t index);
+
+// Unity builds: compile many sources as one translation unit, so the headers
+// they share are parsed once per batch instead of once per source.
+//
+//   Unity_Options options = {
+//       .out_dir = "build/unity",
+//       .name = "game",
+//       .max_sources = 16,
+//       .excluded = cstr_array_make("src/uses_static_globals.c", NULL),
+//   };
+//   Cstr_Array to_compile = unity_build(sources, options);
+//
+// Each batch becomes `<out_dir>/<name>_<hash>.c` (`.cpp` for C++ sources),
+// which only `#include`s its sources. A batch ends after a source whose path
+// hashes to a multiple of a spacing that only depends on the options, or
+// when it is full, so adding, removing or editing a source usually only
+// changes the batch it is in and the next one. The spacing is half of the
+// limit, so batches hold about half of it and are rarely cut by it.
+//
+// Unity files are written with `path_write_if_changed()`, and the files of
+// the same `name` in `out_dir` whose batches no longer exist are removed, so
+// targets that share `out_dir` need different names.
+#ifndef NOBUILD_UNITY_SIZE
+#define NOBUILD_UNITY_SIZE 8
+#endif
+
+// Typical size of a source, turns `max_bytes` into a number of sources to space batches by
+#ifndef NOBUILD_UNITY_SOURCE_BYTES
+#define NOBUILD_UNITY_SOURCE_BYTES 16384
+#endif
+
+typedef struct {
+    // Directory of the unity files, created if needed
+    Cstr out_dir;
+    // Prefix of the unity files, "unity" if NULL
+    Cstr name;
+    // At most that many sources per batch. `NOBUILD_UNITY_SIZE` when neither
+    // this nor `max_bytes` is set.
+    size_t max_sources;
+    // At most that many bytes of sources per batch, unless a single source is bigger
+    unsigned long long max_bytes;
+    // Sources that must be compiled on their own
+    Cstr_Array excluded;
+} Unity_Options;
+
+// Returns the unity files followed by the excluded sources, which together
+// are what needs to be compiled
+Cstr_Array unity_build(Cstr_Array sources, Unity_Options options);
+
+// Precompiled headers: a heavy header shared by many sources is parsed once
+// per compiler and flags instead of once per compile.
+//
+//   Cmd cc = {0};
+//   CMD_APPEND(&cc, "cc", "-O2", "-Iinclude");
+//   Pch pch = pch_build(PCH_COMPILER_GCC, cc, "include/common.h");
+//
+//   Cmd cmd = {0};
+//   cmd_extend(&cmd, cc.line);
+//   pch_use(&cmd, pch);
+//   CMD_APPEND(&cmd, "-c", "src/main.c", "-o", "build/main.o");
+//
+// `compile` is the compiler with the flags of the compiles, without the
+// source and the output, as a PCH only loads with the flags it was built
+// with. Each PCH is stored in `NOBUILD_PCH_DIR` under a hash of the compiler,
+// `compile` and the header, so different flags get different PCHs, and it is
+// only built again when the header or the headers it includes change, found
+// with `path_scan_includes()` and the `-I` flags of `compile`.
+#ifndef NOBUILD_PCH_DIR
+#define NOBUILD_PCH_DIR ".nobuild_pch"
+#endif
+
+typedef enum {
+    // `<header>.gch` next to a stub that includes the header, used with `-include`
+    PCH_COMPILER_GCC,
+    // `<header>.pch`, used with `-include-pch`
+    PCH_COMPILER_CLANG,
+} Pch_Compiler;
+
+typedef struct {
+    Pch_Compiler compiler;
+    // The `.gch` or `.pch` file, NULL if it could not be built
+    Cstr path;
+    // What `-include` names for GCC, which looks for `<include>.gch` first
+    Cstr include;
+} Pch;
+
+Pch pch_build(Pch_Compiler compiler, Cmd compile, Cstr header);
+// Appends the flags that make the compile use `pch`, nothing if it was not built
+void pch_use(Cmd *cmd, Pch pch);
 
 #endif  // NOBUILD_H_
 
@@ -471,6 +1559,7 @@ void todo_safe(const char *fmt, ...)
 
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
 #include <errno.h>
@@ -494,6 +1583,30 @@ Cstr nobuild__strerror(int errnum)
 }
 #endif // NOBUILD__STRERROR
 
+// Multiple modules could define these, so add a guard around them to prevent redefinition
+#ifndef NOBUILD__MUTEX
+#define NOBUILD__MUTEX
+#ifdef NOBUILD_NO_THREADS
+typedef int Nobuild__Mutex;
+#	define NOBUILD__MUTEX_INIT 0
+#	define nobuild__mutex_lock(mutex) ((void) (mutex))
+#	define nobuild__mutex_unlock(mutex) ((void) (mutex))
+#elif !defined(_WIN32)
+#	include <pthread.h>
+typedef pthread_mutex_t Nobuild__Mutex;
+#	define NOBUILD__MUTEX_INIT PTHREAD_MUTEX_INITIALIZER
+#	define nobuild__mutex_lock(mutex) pthread_mutex_lock(mutex)
+#	define nobuild__mutex_unlock(mutex) pthread_mutex_unlock(mutex)
+#else
+#	define WIN32_MEAN_AND_LEAN
+#	include <windows.h>
+typedef SRWLOCK Nobuild__Mutex;
+#	define NOBUILD__MUTEX_INIT SRWLOCK_INIT
+#	define nobuild__mutex_lock(mutex) AcquireSRWLockExclusive(mutex)
+#	define nobuild__mutex_unlock(mutex) ReleaseSRWLockExclusive(mutex)
+#endif
+#endif // NOBUILD__MUTEX
+
 int cstr_ends_with(Cstr cstr, Cstr postfix)
 {
     const size_t cstr_len = strlen(cstr);
@@ -509,6 +1622,62 @@ int cstr_starts_with(Cstr cstr, Cstr prefix)
     return prefix_len <= cstr_len && strncmp(cstr, prefix, prefix_len) == 0;
 }
 
+String_View sv_from_parts(const char *data, size_t count)
+{
+    String_View sv = {
+        .data = data,
+        .count = count,
+    };
+    return sv;
+}
+
+String_View sv_from_cstr(Cstr cstr)
+{
+    return sv_from_parts(cstr, strlen(cstr));
+}
+
+int sv_eq(String_View a, String_View b)
+{
+    return a.count == b.count && (a.count == 0 || memcmp(a.data, b.data, a.count) == 0);
+}
+
+int sv_eq_cstr(String_View sv, Cstr cstr)
+{
+    return sv_eq(sv, sv_from_cstr(cstr));
+}
+
+Cstr sv_to_cstr(String_View sv)
+{
+#ifdef NOBUILD_INTERN_CSTRS
+    return cstr_intern_n(sv.data, sv.count);
+#else
+    char *result = malloc(sv.count + 1);
+    if (result == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+
+    memcpy(result, sv.data, sv.count);
+    result[sv.count] = '\0';
+    return result;
+#endif
+}
+
+void *nobuild__array_grow(void *elems, size_t elem_size, size_t *capacity, size_t expected_capacity)
+{
+    size_t new_capacity = *capacity > 0 ? *capacity : ARRAY_INIT_CAPACITY;
+    while (new_capacity < expected_capacity) {
+        new_capacity *= 2;
+    }
+
+    elems = realloc(elems, elem_size * new_capacity);
+    if (elems == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+
+    *capacity = new_capacity;
+    return elems;
+}
+
 Cstr_Array cstr_array_make(Cstr first, ...)
 {
     Cstr_Array result = {0};
@@ -527,10 +1696,7 @@ Cstr_Array cstr_array_make(Cstr first, ...)
     }
     va_end(args);
 
-    result.elems = malloc(sizeof *result.elems * result.count);
-    if (result.elems == NULL) {
-        PANIC("could not allocate memory: %s", nobuild__strerror(errno));
-    }
+    ARRAY_RESERVE(&result, result.count);
 
     result.count = 0;
     result.elems[result.count++] = first;
@@ -548,16 +1714,7 @@ Cstr_Array cstr_array_make(Cstr first, ...)
 
 Cstr_Array cstr_array_append(Cstr_Array cstrs, Cstr cstr)
 {
-    if (cstrs.capacity < 1) {
-        cstrs.elems = realloc(cstrs.elems, sizeof *cstrs.elems * (cstrs.count + 10));
-        cstrs.capacity += 10;
-        if (cstrs.elems == NULL) {
-            PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
-        }
-    }
-
-    cstrs.elems[cstrs.count++] = cstr;
-    cstrs.capacity--;
+    ARRAY_APPEND(&cstrs, cstr);
     return cstrs;
 }
 
@@ -569,28 +1726,15 @@ Cstr_Array cstr_array_remove(Cstr_Array cstrs, Cstr cstr)
     }
 
     if (cstr == NULL) {
-        --cstrs.count;
-        cstrs.capacity++;
+        cstrs.count--;
         return cstrs;
     }
 
-    // Find the index of the element to be removed
-    const size_t cstr_len = strlen(cstr);
     for (size_t i = 0; i < cstrs.count; i++) {
-        const size_t elem_len = strlen(cstrs.elems[i]);
-        if (elem_len != cstr_len || strcmp(cstrs.elems[i], cstr) != 0) {
-            continue;
-        }
-
-        // Shift elements left if found the cstr
-        for (size_t j = i; j < cstrs.count - 1; j++) {
-            cstrs.elems[j] = cstrs.elems[j + 1];
+        if (strcmp(cstrs.elems[i], cstr) == 0) {
+            ARRAY_REMOVE(&cstrs, i);
+            return cstrs;
         }
-        cstrs.count--;
-        cstrs.capacity++;
-
-        // TODO: Might want to realloc array if capacity is too high
-        return cstrs;
     }
 
     // The string was not found
@@ -599,17 +1743,7 @@ Cstr_Array cstr_array_remove(Cstr_Array cstrs, Cstr cstr)
 
 Cstr_Array cstr_array_concat(Cstr_Array cstrs_a, Cstr_Array cstrs_b)
 {
-    if (cstrs_a.capacity < cstrs_b.count) {
-        cstrs_a.elems = realloc(cstrs_a.elems, sizeof *cstrs_a.elems * (cstrs_a.count + cstrs_b.count));
-        cstrs_a.capacity += cstrs_b.count;
-        if (cstrs_a.elems == NULL) {
-            PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
-        }
-    }
-
-    memcpy(cstrs_a.elems + cstrs_a.count, cstrs_b.elems, sizeof *cstrs_a.elems * cstrs_b.count);
-    cstrs_a.count += cstrs_b.count;
-    cstrs_a.capacity -= cstrs_b.count;
+    ARRAY_APPEND_MANY(&cstrs_a, cstrs_b.elems, cstrs_b.count);
     return cstrs_a;
 }
 
@@ -624,115 +1758,433 @@ int cstr_array_contains(Cstr_Array cstrs, Cstr cstr) {
 
 Cstr_Array cstr_array_from_cstr(Cstr cstr, Cstr delim)
 {
-    size_t len = strlen(cstr);
-    size_t d_len = strlen(delim);
-    size_t substr_count = 1;
-    for (size_t i = 0; i < len; ++i) {
-        if ((len - i) < d_len) {
-            break;
-        }
+    const size_t len = strlen(cstr);
+    const size_t d_len = strlen(delim);
+
+    // Copy the input once and cut it in place, so the substrings are views
+    // into the same buffer terminated where the delimiters were
+    char *buffer = malloc(len + 1);
+    if (buffer == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+    memcpy(buffer, cstr, len + 1);
 
-        size_t delim_found = 0;
-        for (size_t j = 0; j < d_len; ++j) {
-            if (cstr[i+j] != delim[j]) {
-                delim_found = 0;
+    Cstr_Array result = {0};
+    char *substr = buffer;
+    char *const end = buffer + len;
+
+    // TODO: differentiate between delim == null and delim == "" and delim not found
+    //       Split the string into an array of strings, where each string is a single character
+    if (d_len > 0) {
+        char *p = buffer;
+        while ((size_t) (end - p) >= d_len) {
+            // memchr() is vectorized by the C library, let it find the candidates
+            p = memchr(p, delim[0], (size_t) (end - p) - d_len + 1);
+            if (p == NULL) {
                 break;
             }
-            delim_found = 1;
+
+            if (memcmp(p + 1, delim + 1, d_len - 1) != 0) {
+                p += 1;
+                continue;
+            }
+
+            *p = '\0';
+            ARRAY_APPEND(&result, substr);
+            p += d_len;
+            substr = p;
         }
+    }
+
+    ARRAY_APPEND(&result, substr);
+    return result;
+}
+
+Cstr cstr_array_join(Cstr sep, Cstr_Array cstrs)
+{
+    if (cstrs.count == 0) {
+        return "";
+    }
 
-        if (delim_found) {
-            substr_count++;
-            i += d_len - 1;
+    const size_t sep_len = strlen(sep);
+    size_t len = 0;
+    for (size_t i = 0; i < cstrs.count; ++i) {
+        len += strlen(cstrs.elems[i]);
+    }
+
+    String_Builder sb = {0};
+    ARRAY_RESERVE(&sb, (cstrs.count - 1) * sep_len + len + 1);
+    for (size_t i = 0; i < cstrs.count; ++i) {
+        if (i > 0) {
+            sb_append_buf(&sb, sep, sep_len);
         }
+        sb_append_cstr(&sb, cstrs.elems[i]);
     }
 
-    // if dlen == 0 or was never found
-    if (substr_count == 1) {
-        // TODO: differentiate between delim == null and delim == "" and delim not found
-        //       Split the string into an array of strings, where each string is a single character
-        return cstr_array_make(cstr);
+    return sb_to_cstr(&sb);
+}
+
+size_t cstr_hash_n(const char *data, size_t len)
+{
+    // Mix 8 bytes at a time and finish with the murmur3 finalizer
+    const unsigned long long k = 0x9E3779B97F4A7C15ULL;
+    unsigned long long hash = (unsigned long long) len * k;
+
+    while (len >= 8) {
+        unsigned long long word;
+        memcpy(&word, data, 8);
+        hash = ((hash << 5) | (hash >> 59)) ^ word;
+        hash *= k;
+        data += 8;
+        len -= 8;
     }
 
-    Cstr_Array ret = { .count = substr_count };
-    ret.elems = malloc(sizeof(Cstr) * ret.count);
-    if (ret.elems == NULL) {
-        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    if (len > 0) {
+        unsigned long long word = 0;
+        memcpy(&word, data, len);
+        hash = ((hash << 5) | (hash >> 59)) ^ word;
+        hash *= k;
     }
 
-    size_t substr_start = 0;
-    size_t substr_index = 0;
-    for (size_t i = 0; i < len; ++i) {
-        if ((len - i) < d_len) {
-            break;
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+
+    // A zero hash marks an empty slot in `Cstr_Set` and `Cstr_Map`
+    return (size_t) hash != 0 ? (size_t) hash : 1;
+}
+
+size_t cstr_hash(Cstr cstr)
+{
+    return cstr_hash_n(cstr, strlen(cstr));
+}
+
+// Both `Cstr_Set_Entry` and `Cstr_Map_Entry` start with the hash and the key,
+// so the probing is shared through the entry size
+static size_t nobuild__hash_table_probe(const void *entries, size_t entry_size, size_t capacity,
+                                        size_t hash, Cstr key)
+{
+    const size_t mask = capacity - 1;
+    size_t i = hash & mask;
+    for (;;) {
+        const Cstr_Set_Entry *entry = (const Cstr_Set_Entry *) ((const char *) entries + i * entry_size);
+        // Interned keys compare equal by pointer
+        if (entry->hash == 0 || (entry->hash == hash && (entry->key == key || strcmp(entry->key, key) == 0))) {
+            return i;
         }
+        i = (i + 1) & mask;
+    }
+}
 
-        size_t delim_found = 0;
-        for (size_t j = 0; j < d_len; ++j) {
-            if (cstr[i+j] != delim[j]) {
-                delim_found = 0;
-                break;
+static void *nobuild__hash_table_grow(void *entries, size_t entry_size, size_t *capacity)
+{
+    size_t old_capacity = *capacity;
+    size_t new_capacity = old_capacity == 0 ? 16 : old_capacity * 2;
+    char *new_entries = calloc(new_capacity, entry_size);
+    if (new_entries == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+
+    for (size_t i = 0; i < old_capacity; ++i) {
+        const Cstr_Set_Entry *entry = (const Cstr_Set_Entry *) ((const char *) entries + i * entry_size);
+        if (entry->hash != 0) {
+            size_t j = entry->hash & (new_capacity - 1);
+            while (((Cstr_Set_Entry *) (new_entries + j * entry_size))->hash != 0) {
+                j = (j + 1) & (new_capacity - 1);
             }
-            delim_found = 1;
+            memcpy(new_entries + j * entry_size, entry, entry_size);
         }
+    }
 
-        if (!delim_found) {
-            continue;
-        }
+    free(entries);
+    *capacity = new_capacity;
+    return new_entries;
+}
 
-        size_t substr_len = i - substr_start;
-        char *substr = calloc(substr_len + 1, sizeof(unsigned char));
-        if (substr == NULL) {
-            PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+// Remove the entry at `i` and shift the rest of its probe sequence back, so no tombstones are needed
+static void nobuild__hash_table_erase(void *entries, size_t entry_size, size_t capacity, size_t i)
+{
+    const size_t mask = capacity - 1;
+    char *base = entries;
+    ((Cstr_Set_Entry *) (base + i * entry_size))->hash = 0;
+
+    for (size_t j = (i + 1) & mask; ((Cstr_Set_Entry *) (base + j * entry_size))->hash != 0; j = (j + 1) & mask) {
+        size_t home = ((Cstr_Set_Entry *) (base + j * entry_size))->hash & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            memcpy(base + i * entry_size, base + j * entry_size, entry_size);
+            ((Cstr_Set_Entry *) (base + j * entry_size))->hash = 0;
+            i = j;
         }
+    }
+}
 
-        ret.elems[substr_index++] = memcpy(substr, (cstr+substr_start), substr_len * sizeof(unsigned char));
-        i += d_len - 1;
-        substr_start = i + 1;
+int cstr_set_contains(const Cstr_Set *set, Cstr cstr)
+{
+    if (set->count == 0) {
+        return 0;
     }
 
-    // Add the last substring
-    size_t substr_len = len - substr_start;
-    char *substr = malloc(substr_len * sizeof(unsigned char));
-    if (substr == NULL) {
-        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    size_t i = nobuild__hash_table_probe(set->entries, sizeof *set->entries, set->capacity, cstr_hash(cstr), cstr);
+    return set->entries[i].hash != 0;
+}
+
+int cstr_set_add(Cstr_Set *set, Cstr cstr)
+{
+    // Keep the load factor under 3/4
+    if ((set->count + 1) * 4 > set->capacity * 3) {
+        set->entries = nobuild__hash_table_grow(set->entries, sizeof *set->entries, &set->capacity);
+    }
+
+    size_t hash = cstr_hash(cstr);
+    size_t i = nobuild__hash_table_probe(set->entries, sizeof *set->entries, set->capacity, hash, cstr);
+    if (set->entries[i].hash != 0) {
+        return 0;
     }
 
-    ret.elems[substr_index++] = memcpy(substr, (cstr+substr_start), substr_len * sizeof(unsigned char));
-    return ret;
+    set->entries[i].hash = hash;
+    set->entries[i].key = cstr;
+    set->count += 1;
+    return 1;
 }
 
-Cstr cstr_array_join(Cstr sep, Cstr_Array cstrs)
+int cstr_set_remove(Cstr_Set *set, Cstr cstr)
 {
-    if (cstrs.count == 0) {
-        return "";
+    if (set->count == 0) {
+        return 0;
     }
 
-    const size_t sep_len = strlen(sep);
-    size_t len = 0;
-    for (size_t i = 0; i < cstrs.count; ++i) {
-        len += strlen(cstrs.elems[i]);
+    size_t i = nobuild__hash_table_probe(set->entries, sizeof *set->entries, set->capacity, cstr_hash(cstr), cstr);
+    if (set->entries[i].hash == 0) {
+        return 0;
     }
 
-    const size_t result_len = (cstrs.count - 1) * sep_len + len + 1;
-    char *result = malloc(sizeof(char) * result_len);
-    if (result == NULL) {
-        PANIC("could not allocate memory: %s", nobuild__strerror(errno));
+    nobuild__hash_table_erase(set->entries, sizeof *set->entries, set->capacity, i);
+    set->count -= 1;
+    return 1;
+}
+
+void cstr_set_clear(Cstr_Set *set)
+{
+    if (set->entries != NULL) {
+        memset(set->entries, 0, sizeof *set->entries * set->capacity);
     }
+    set->count = 0;
+}
 
-    len = 0;
-    for (size_t i = 0; i < cstrs.count; ++i) {
-        if (i > 0) {
-            memcpy(result + len, sep, sep_len);
-            len += sep_len;
+void cstr_set_free(Cstr_Set *set)
+{
+    free(set->entries);
+    set->entries = NULL;
+    set->count = 0;
+    set->capacity = 0;
+}
+
+Cstr_Map_Entry *cstr_map_find(const Cstr_Map *map, Cstr key)
+{
+    if (map->count == 0) {
+        return NULL;
+    }
+
+    size_t i = nobuild__hash_table_probe(map->entries, sizeof *map->entries, map->capacity, cstr_hash(key), key);
+    return map->entries[i].hash != 0 ? &map->entries[i] : NULL;
+}
+
+void *cstr_map_get(const Cstr_Map *map, Cstr key)
+{
+    Cstr_Map_Entry *entry = cstr_map_find(map, key);
+    return entry != NULL ? entry->value : NULL;
+}
+
+void *cstr_map_put(Cstr_Map *map, Cstr key, void *value)
+{
+    if ((map->count + 1) * 4 > map->capacity * 3) {
+        map->entries = nobuild__hash_table_grow(map->entries, sizeof *map->entries, &map->capacity);
+    }
+
+    size_t hash = cstr_hash(key);
+    size_t i = nobuild__hash_table_probe(map->entries, sizeof *map->entries, map->capacity, hash, key);
+    Cstr_Map_Entry *entry = &map->entries[i];
+    if (entry->hash != 0) {
+        void *previous = entry->value;
+        entry->value = value;
+        return previous;
+    }
+
+    entry->hash = hash;
+    entry->key = key;
+    entry->value = value;
+    map->count += 1;
+    return NULL;
+}
+
+void *cstr_map_remove(Cstr_Map *map, Cstr key)
+{
+    if (map->count == 0) {
+        return NULL;
+    }
+
+    size_t i = nobuild__hash_table_probe(map->entries, sizeof *map->entries, map->capacity, cstr_hash(key), key);
+    if (map->entries[i].hash == 0) {
+        return NULL;
+    }
+
+    void *value = map->entries[i].value;
+    nobuild__hash_table_erase(map->entries, sizeof *map->entries, map->capacity, i);
+    map->count -= 1;
+    return value;
+}
+
+void cstr_map_clear(Cstr_Map *map)
+{
+    if (map->entries != NULL) {
+        memset(map->entries, 0, sizeof *map->entries * map->capacity);
+    }
+    map->count = 0;
+}
+
+void cstr_map_free(Cstr_Map *map)
+{
+    free(map->entries);
+    map->entries = NULL;
+    map->count = 0;
+    map->capacity = 0;
+}
+
+#ifndef NOBUILD_INTERN_BLOCK_SIZE
+#	define NOBUILD_INTERN_BLOCK_SIZE (64 * 1024)
+#endif
+
+// The interned strings are packed into big blocks that are never freed
+static Cstr_Set nobuild__interned = {0};
+static char *nobuild__intern_block = NULL;
+static size_t nobuild__intern_block_left = 0;
+static Nobuild__Mutex nobuild__intern_lock = NOBUILD__MUTEX_INIT;
+
+static Cstr nobuild__intern_store(const char *data, size_t len)
+{
+    char *result = NULL;
+    if (len + 1 > NOBUILD_INTERN_BLOCK_SIZE / 4) {
+        // Big strings get their own allocation, so they don't waste the rest of a block
+        result = malloc(len + 1);
+    } else {
+        if (len + 1 > nobuild__intern_block_left) {
+            nobuild__intern_block = malloc(NOBUILD_INTERN_BLOCK_SIZE);
+            nobuild__intern_block_left = NOBUILD_INTERN_BLOCK_SIZE;
         }
+        result = nobuild__intern_block;
+        nobuild__intern_block += len + 1;
+        nobuild__intern_block_left -= len + 1;
+    }
 
-        size_t elem_len = strlen(cstrs.elems[i]);
-        memcpy(result + len, cstrs.elems[i], elem_len);
-        len += elem_len;
+    if (result == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
     }
+
+    memcpy(result, data, len);
     result[len] = '\0';
+    return result;
+}
+
+Cstr cstr_intern_n(const char *data, size_t len)
+{
+    const size_t hash = cstr_hash_n(data, len);
+
+    nobuild__mutex_lock(&nobuild__intern_lock);
+    if ((nobuild__interned.count + 1) * 4 > nobuild__interned.capacity * 3) {
+        nobuild__interned.entries = nobuild__hash_table_grow(nobuild__interned.entries,
+                                    sizeof *nobuild__interned.entries,
+                                    &nobuild__interned.capacity);
+    }
+
+    const size_t mask = nobuild__interned.capacity - 1;
+    size_t i = hash & mask;
+    for (;;) {
+        Cstr_Set_Entry *entry = &nobuild__interned.entries[i];
+        if (entry->hash == 0) {
+            entry->hash = hash;
+            entry->key = nobuild__intern_store(data, len);
+            nobuild__interned.count += 1;
+            break;
+        }
+
+        if (entry->hash == hash && strncmp(entry->key, data, len) == 0 && entry->key[len] == '\0') {
+            break;
+        }
+
+        i = (i + 1) & mask;
+    }
+
+    Cstr result = nobuild__interned.entries[i].key;
+    nobuild__mutex_unlock(&nobuild__intern_lock);
+    return result;
+}
+
+Cstr cstr_intern(Cstr cstr)
+{
+    return cstr_intern_n(cstr, strlen(cstr));
+}
+
+Cstr nobuild__cstr_result(char *cstr, size_t len)
+{
+#ifdef NOBUILD_INTERN_CSTRS
+    Cstr interned = cstr_intern_n(cstr, len);
+    free(cstr);
+    return interned;
+#else
+    (void) len;
+    return cstr;
+#endif
+}
+
+void sb_append_buf(String_Builder *sb, const char *buf, size_t size)
+{
+    ARRAY_APPEND_MANY(sb, buf, size);
+}
 
+void sb_append_cstr(String_Builder *sb, Cstr cstr)
+{
+    sb_append_buf(sb, cstr, strlen(cstr));
+}
+
+void sb_append_sv(String_Builder *sb, String_View sv)
+{
+    sb_append_buf(sb, sv.data, sv.count);
+}
+
+int sb_appendf(String_Builder *sb, const char *fmt, ...)
+{
+    // Format straight into the spare capacity, and only when it does not fit
+    // grow the builder and format a second time
+    const size_t spare = sb->capacity - sb->count;
+
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(sb->elems == NULL ? NULL : sb->elems + sb->count, spare, fmt, args);
+    va_end(args);
+    if (len < 0) {
+        return len;
+    }
+
+    if ((size_t) len >= spare) {
+        ARRAY_RESERVE(sb, sb->count + (size_t) len + 1);
+        va_start(args, fmt);
+        vsnprintf(sb->elems + sb->count, (size_t) len + 1, fmt, args);
+        va_end(args);
+    }
+
+    sb->count += (size_t) len;
+    return len;
+}
+
+Cstr sb_to_cstr(String_Builder *sb)
+{
+    ARRAY_APPEND(sb, '\0');
+    Cstr result = nobuild__cstr_result(sb->elems, sb->count - 1);
+    sb->elems = NULL;
+    sb->count = 0;
+    sb->capacity = 0;
     return result;
 }
 
@@ -744,16 +2196,38 @@ Cstr cstr_array_join(Cstr sep, Cstr_Array cstrs)
 #ifndef _WIN32
 #	include <sys/wait.h>
 #	include <sys/stat.h>
+#	include <sys/mman.h>
+#	include <sys/uio.h>
 #	include <unistd.h>
 #	include <fcntl.h>
+#	ifdef __linux__
+#		include <sys/sendfile.h>
+#		include <sys/syscall.h>
+#		ifndef SPLICE_F_MOVE
+#			define SPLICE_F_MOVE 1
+#		endif
+
+#		ifdef NOBUILD_IO_URING
+#			include <linux/io_uring.h>
+#			include <linux/stat.h>
+#			define NOBUILD__IO_URING
+#		endif
+
+// Avoid requiring the user to define `_DEFAULT_SOURCE`
+long syscall(long number, ...);
+#	endif
 
 // Avoid requiring the user to define `_POSIX_C_SOURCE` as `200809L`
 char *strsignal(int sig);
-#else
-#	include <assert.h>
+ssize_t pread(int fd, void *buf, size_t count, off_t offset);
+ssize_t pwrite(int fd, const void *buf, size_t count, off_t offset);
+int ftruncate(int fd, off_t length);
 #endif
 
+#include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
 #include <errno.h>
@@ -878,10 +2352,46 @@ Fd fd_open_for_write(const char *path)
 #endif // _WIN32
 }
 
+Fd fd_open_for_update(const char *path)
+{
+#ifndef _WIN32
+    Fd result = open(path,
+                     O_RDWR | O_CREAT,
+                     S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (result < 0) {
+        PANIC("Could not open file %s: %s", path, strerror(errno));
+    }
+    return result;
+#else
+    SECURITY_ATTRIBUTES saAttr = {0};
+    saAttr.nLength = sizeof(SECURITY_ATTRIBUTES);
+    saAttr.bInheritHandle = TRUE;
+
+    Fd result = CreateFile(
+                    path,
+                    GENERIC_READ | GENERIC_WRITE,
+                    0,
+                    &saAttr,
+                    OPEN_ALWAYS,           // Same as `O_CREAT` without `O_TRUNC`
+                    FILE_ATTRIBUTE_NORMAL,
+                    NULL
+                );
+
+    if (result == INVALID_HANDLE_VALUE) {
+        PANIC("Could not open file %s: %s", path, nobuild__GetLastErrorAsString());
+    }
+
+    return result;
+#endif // _WIN32
+}
+
 size_t fd_read(Fd fd, void *buf, unsigned long count)
 {
 #ifndef _WIN32
-    ssize_t bytes = read(fd, buf, count);
+    ssize_t bytes;
+    do {
+        bytes = read(fd, buf, count);
+    } while (bytes == -1 && errno == EINTR);
     if (bytes == -1) {
         ERRO("Read error: %s", strerror(errno));
         return 0;
@@ -900,7 +2410,10 @@ size_t fd_read(Fd fd, void *buf, unsigned long count)
 size_t fd_write(Fd fd, void *buf, unsigned long count)
 {
 #ifndef _WIN32
-    ssize_t bytes = write(fd, buf, (size_t) count);
+    ssize_t bytes;
+    do {
+        bytes = write(fd, buf, (size_t) count);
+    } while (bytes == -1 && errno == EINTR);
     if (bytes == -1) {
         ERRO("Write error: %s", strerror(errno));
         return 0;
@@ -916,400 +2429,1003 @@ size_t fd_write(Fd fd, void *buf, unsigned long count)
     return (size_t) bytes;
 }
 
-int fd_printf(Fd fd, const char *fmt, ...) {
-    va_list args;
-
-    va_start(args, fmt);
-    int len = vsnprintf(NULL, 0, fmt, args);
-    va_end(args);
-    if (len < 0) {
-        return len;
+int fd_write_all(Fd fd, const void *buf, size_t count)
+{
+    const char *bytes = buf;
+    while (count > 0) {
+        size_t written = fd_write(fd, (void *) bytes, (unsigned long) count);
+        if (written == 0) {
+            return 0;
+        }
+        bytes += written;
+        count -= written;
     }
+    return 1;
+}
 
-    // MSVC does not support variable length arrays
+int fd_pwrite_all(Fd fd, const void *buf, size_t count, unsigned long long offset)
+{
+    const char *bytes = buf;
+    while (count > 0) {
 #ifndef _WIN32
-     char buffer[len + 1];
+        ssize_t written = pwrite(fd, bytes, count, (off_t) offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ERRO("Write error: %s", strerror(errno));
+            return 0;
+        }
 #else
-     char *buffer = malloc(sizeof *buffer * (len + 1));
-#endif
-
-    va_start(args, fmt);
-    int result = vsnprintf(buffer, (size_t)(len + 1), fmt, args);
-    va_end(args);
-    if (result < 0) {
-        return result;
+        OVERLAPPED overlapped = {0};
+        overlapped.Offset = (DWORD) offset;
+        overlapped.OffsetHigh = (DWORD) (offset >> 32);
+        DWORD written;
+        if (!WriteFile(fd, bytes, count > 0x7fffffff ? 0x7fffffff : (DWORD) count, &written, &overlapped)) {
+            ERRO("Write error: %s", nobuild__GetLastErrorAsString());
+            return 0;
+        }
+#endif // _WIN32
+        bytes += written;
+        count -= (size_t) written;
+        offset += (unsigned long long) written;
     }
-
-    fd_write(fd, buffer, (unsigned long) result);
-
-#ifdef _WIN32
-    free(buffer);
-#endif
-
-    return result;
+    return 1;
 }
 
-void fd_close(Fd fd)
+int fd_truncate(Fd fd, unsigned long long size)
 {
 #ifndef _WIN32
-    close(fd);
+    if (ftruncate(fd, (off_t) size) < 0) {
+        ERRO("Could not truncate file: %s", strerror(errno));
+        return 0;
+    }
 #else
-    CloseHandle(fd);
+    LARGE_INTEGER position;
+    position.QuadPart = (LONGLONG) size;
+    if (!SetFilePointerEx(fd, position, NULL, FILE_BEGIN) || !SetEndOfFile(fd)) {
+        ERRO("Could not truncate file: %s", nobuild__GetLastErrorAsString());
+        return 0;
+    }
 #endif // _WIN32
+    return 1;
 }
 
-void pid_wait(Pid pid)
+int fd_writev(Fd fd, const Fd_Iovec *iov, int count)
 {
 #ifndef _WIN32
-    for (;;) {
-        int wstatus = 0;
-        if (waitpid(pid, &wstatus, 0) < 0) {
-            PANIC("Could not wait on command (pid %d): %s", pid, strerror(errno));
-        }
-
-        if (WIFEXITED(wstatus)) {
-            int exit_status = WEXITSTATUS(wstatus);
-            if (exit_status != 0) {
-                PANIC("Command exited with exit code %d", exit_status);
+    while (count > 0) {
+        // Linux and the BSDs accept at most 1024 buffers per call
+        ssize_t bytes = writev(fd, iov, count < 1024 ? count : 1024);
+        if (bytes < 0) {
+            if (errno == EINTR) {
+                continue;
             }
+            ERRO("Write error: %s", strerror(errno));
+            return 0;
+        }
 
-            break;
+        // Skip the buffers that were written completely
+        while (count > 0 && (size_t) bytes >= iov->iov_len) {
+            bytes -= (ssize_t) iov->iov_len;
+            iov += 1;
+            count -= 1;
         }
 
-        if (WIFSIGNALED(wstatus)) {
-            PANIC("Command process was terminated by %s", strsignal(WTERMSIG(wstatus)));
+        // Finish the buffer that was written partially
+        if (count > 0 && bytes > 0) {
+            if (!fd_write_all(fd, (char *) iov->iov_base + bytes, iov->iov_len - (size_t) bytes)) {
+                return 0;
+            }
+            iov += 1;
+            count -= 1;
         }
     }
 #else
-    DWORD result = WaitForSingleObject(
-                       pid,     // HANDLE hHandle,
-                       INFINITE // DWORD  dwMilliseconds
-                   );
+    for (int i = 0; i < count; ++i) {
+        if (!fd_write_all(fd, iov[i].iov_base, iov[i].iov_len)) {
+            return 0;
+        }
+    }
+#endif
+    return 1;
+}
 
-    if (result == WAIT_FAILED) {
-        PANIC("Could not wait on child process: %s", nobuild__GetLastErrorAsString());
+size_t fd_readv(Fd fd, const Fd_Iovec *iov, int count)
+{
+#ifndef _WIN32
+    ssize_t bytes;
+    do {
+        bytes = readv(fd, iov, count < 1024 ? count : 1024);
+    } while (bytes == -1 && errno == EINTR);
+    if (bytes == -1) {
+        ERRO("Read error: %s", strerror(errno));
+        return 0;
+    }
+    return (size_t) bytes;
+#else
+    size_t total = 0;
+    for (int i = 0; i < count; ++i) {
+        size_t bytes = fd_read(fd, iov[i].iov_base, (unsigned long) iov[i].iov_len);
+        total += bytes;
+        if (bytes < iov[i].iov_len) {
+            break;
+        }
     }
+    return total;
+#endif
+}
 
-    DWORD exit_status;
-    if (GetExitCodeProcess(pid, &exit_status) == 0) {
-        PANIC("Could not get process exit code: %lu", GetLastError());
+// The largest transfer asked of the kernel at once, which also makes a
+// `count` of 0 (until the end of the file) fit the syscalls
+#define NOBUILD__TRANSFER_CHUNK ((size_t) 1 << 30)
+
+// Copies through user space, the fallback of `fd_sendfile()` and `fd_splice()`
+static size_t nobuild__fd_copy(Fd dst, Fd src, size_t count)
+{
+    char *buffer = malloc(NOBUILD_COPY_BUFFER_SIZE);
+    if (buffer == NULL) {
+        PANIC("Could not allocate memory: %s", strerror(errno));
     }
 
-    if (exit_status != 0) {
-        PANIC("Command exited with exit code %lu", exit_status);
+    size_t copied = 0;
+    while (count == 0 || copied < count) {
+        size_t want = NOBUILD_COPY_BUFFER_SIZE;
+        if (count > 0 && count - copied < want) {
+            want = count - copied;
+        }
+
+        size_t bytes = fd_read(src, buffer, (unsigned long) want);
+        if (bytes == 0 || !fd_write_all(dst, buffer, bytes)) {
+            break;
+        }
+        copied += bytes;
     }
 
-    CloseHandle(pid);
-#endif // _WIN32
+    free(buffer);
+    return copied;
 }
 
+size_t fd_sendfile(Fd dst, Fd src, size_t count)
+{
+    size_t copied = 0;
+
+#ifdef __linux__
+    // copy_file_range() works between regular files and can share extents or
+    // copy on the server for NFS/SMB. It fails between filesystems on older
+    // kernels, then sendfile(), which takes any destination, continues.
+#ifdef SYS_copy_file_range
+    while (count == 0 || copied < count) {
+        size_t want = count == 0 || count - copied > NOBUILD__TRANSFER_CHUNK ? NOBUILD__TRANSFER_CHUNK : count - copied;
+        long bytes = syscall(SYS_copy_file_range, src, NULL, dst, NULL, want, 0);
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes <= 0) {
+            break;
+        }
+        copied += (size_t) bytes;
+    }
+#endif // SYS_copy_file_range
 
+    while (count == 0 || copied < count) {
+        size_t want = count == 0 || count - copied > NOBUILD__TRANSFER_CHUNK ? NOBUILD__TRANSFER_CHUNK : count - copied;
+        ssize_t bytes = sendfile(dst, src, NULL, want);
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes <= 0) {
+            break;
+        }
+        copied += (size_t) bytes;
+    }
+    errno = 0;
+#endif // __linux__
 
-////////////////////////////////////////////////////////////////////////////////
+    // Some files (procfs, sysfs) report 0 bytes to the calls above without
+    // being empty, so let read() have the last word on the end of the file
+    if (count == 0 || copied < count) {
+        copied += nobuild__fd_copy(dst, src, count == 0 ? 0 : count - copied);
+    }
+    return copied;
+}
 
+size_t fd_splice(Fd dst, Fd src, size_t count)
+{
+    size_t copied = 0;
+
+#if defined(__linux__) && defined(SYS_splice)
+    // Only works when one of the ends is a pipe, fails right away otherwise
+    while (count == 0 || copied < count) {
+        size_t want = count == 0 || count - copied > NOBUILD__TRANSFER_CHUNK ? NOBUILD__TRANSFER_CHUNK : count - copied;
+        long bytes = syscall(SYS_splice, src, NULL, dst, NULL, want, SPLICE_F_MOVE);
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes == 0) {
+            return copied;
+        }
+        if (bytes < 0) {
+            break;
+        }
+        copied += (size_t) bytes;
+    }
+    errno = 0;
 
-#include <assert.h>
-#include <string.h>
-#include <stdio.h>
-#include <stdarg.h>
-#include <stdlib.h>
-#include <errno.h>
+    if (count > 0 && copied == count) {
+        return copied;
+    }
+#endif
 
+    return copied + fd_sendfile(dst, src, count == 0 ? 0 : count - copied);
+}
 
-////////////////////////////////////////////////////////////////////////////////
+int fd_printf(Fd fd, const char *fmt, ...) {
+    // Format into a stack buffer and only format a second time into a heap
+    // buffer when the output does not fit
+    char stack_buffer[1024];
+    char *buffer = stack_buffer;
 
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(buffer, sizeof(stack_buffer), fmt, args);
+    va_end(args);
+    if (len < 0) {
+        return len;
+    }
 
+    if ((size_t) len >= sizeof(stack_buffer)) {
+        buffer = malloc(sizeof *buffer * ((size_t) len + 1));
+        if (buffer == NULL) {
+            PANIC("Could not allocate memory: %s", strerror(errno));
+        }
 
-////////////////////////////////////////////////////////////////////////////////
+        va_start(args, fmt);
+        len = vsnprintf(buffer, (size_t) len + 1, fmt, args);
+        va_end(args);
+    }
 
+    if (len >= 0) {
+        fd_write_all(fd, buffer, (size_t) len);
+    }
 
+    if (buffer != stack_buffer) {
+        free(buffer);
+    }
 
-////////////////////////////////////////////////////////////////////////////////
+    return len;
+}
 
+int fd_write_sb(Fd fd, const String_Builder *sb)
+{
+    return fd_write_all(fd, sb->elems, sb->count);
+}
 
-// Multiple modules could define this function, so add a guard around it to prevent redefinition
-#ifndef NOBUILD__STRERROR
-#define NOBUILD__STRERROR
-Cstr nobuild__strerror(int errnum)
+void fd_close(Fd fd)
 {
 #ifndef _WIN32
-    return nobuild__strerror(errnum);
+    close(fd);
 #else
-    static char buffer[1024];
-    strerror_s(buffer, 1024, errnum);
-    return buffer;
-#endif
+    CloseHandle(fd);
+#endif // _WIN32
 }
-#endif // NOBUILD__STRERROR
 
-// Multiple modules could define this function, so add a guard around it to prevent redefinition
-#if defined(_WIN32) && !defined(NOBUILD__GETLASTERROR)
-#define NOBUILD__GETLASTERROR
-LPSTR nobuild__GetLastErrorAsString(void)
+// Reads the rest of `fd` into one null terminated allocation. `file_size` is
+// the size of a regular file, which is read in exactly that many bytes, or 0
+// when it is unknown and the buffer has to grow.
+static char *nobuild__read_fd(Fd fd, size_t file_size, size_t *size)
 {
-    // https://stackoverflow.com/q/1387064/21582981
-    DWORD errorMessageId = GetLastError();
-    assert(errorMessageId != 0);
+    size_t capacity = file_size > 0 ? file_size + 1 : 4096;
+    char *data = malloc(capacity);
+    if (data == NULL) {
+        PANIC("Could not allocate memory: %s", strerror(errno));
+    }
 
-    LPSTR messageBuffer = NULL;
+    size_t count = 0;
+    while (file_size == 0 || count < file_size) {
+        if (count + 1 == capacity) {
+            capacity *= 2;
+            data = realloc(data, capacity);
+            if (data == NULL) {
+                PANIC("Could not allocate memory: %s", strerror(errno));
+            }
+        }
 
-    FormatMessage(
-        FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, // DWORD   dwFlags,
-        NULL, // LPCVOID lpSource,
-        errorMessageId, // DWORD   dwMessageId,
-        MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), // DWORD   dwLanguageId,
-        (LPSTR) &messageBuffer, // LPTSTR  lpBuffer,
-        0, // DWORD   nSize,
-        NULL // va_list *Arguments
-    );
+        size_t bytes = fd_read(fd, data + count, (unsigned long) (capacity - count - 1));
+        if (bytes == 0) {
+            break;
+        }
+        count += bytes;
+    }
 
-    return messageBuffer;
+    data[count] = '\0';
+    if (size != NULL) {
+        *size = count;
+    }
+    return data;
 }
-#endif // NOBUILD__GETLASTERROR
 
-Cstr cmd_show(Cmd cmd)
+// Opens `path` for reading and gets the size of the file, 0 if it is not a
+// regular file. Unlike `fd_open_for_read()` it reports errors instead of panicking.
+static int nobuild__open_sized(Cstr path, Fd *fd, size_t *file_size)
 {
-    // TODO(#31): cmd_show does not render the command line properly
-    // - No string literals when arguments contains space
-    // - No escaping of special characters
-    // - Etc.
-    return cstr_array_join(" ", cmd.line);
+#ifndef _WIN32
+    *fd = open(path, O_RDONLY);
+    if (*fd < 0) {
+        ERRO("Could not open file %s: %s", path, strerror(errno));
+        return 0;
+    }
+
+    struct stat statbuf;
+    *file_size = fstat(*fd, &statbuf) == 0 && S_ISREG(statbuf.st_mode) ? (size_t) statbuf.st_size : 0;
+#else
+    *fd = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (*fd == INVALID_HANDLE_VALUE) {
+        ERRO("Could not open file %s: %s", path, nobuild__GetLastErrorAsString());
+        return 0;
+    }
+
+    LARGE_INTEGER size;
+    *file_size = GetFileType(*fd) == FILE_TYPE_DISK && GetFileSizeEx(*fd, &size) ? (size_t) size.QuadPart : 0;
+#endif
+    return 1;
 }
 
-Pid cmd_run_async(Cmd cmd, Fd *fdin, Fd *fdout)
+char *read_entire_file(Cstr path, size_t *size)
 {
-#ifndef _WIN32
-    pid_t cpid = fork();
-    if (cpid < 0) {
-        PANIC("Could not fork child process: %s: %s",
-              cmd_show(cmd), nobuild__strerror(errno));
+    Fd fd;
+    size_t file_size;
+    if (!nobuild__open_sized(path, &fd, &file_size)) {
+        return NULL;
     }
 
-    if (cpid == 0) {
-        Cstr_Array args = {
-            .count = cmd.line.count
-        };
-        args.elems = malloc(sizeof(Cstr) * args.count+1);
-        memcpy(args.elems, cmd.line.elems, args.count * sizeof(Cstr));
-        args.elems[args.count++] = NULL;
+    char *data = nobuild__read_fd(fd, file_size, size);
+    fd_close(fd);
+    return data;
+}
 
-        if (fdin) {
-            if (dup2(*fdin, STDIN_FILENO) < 0) {
-                PANIC("Could not setup stdin for child process: %s", nobuild__strerror(errno));
-            }
-        }
+File_Map file_map(Cstr path)
+{
+    File_Map map = {0};
 
-        if (fdout) {
-            if (dup2(*fdout, STDOUT_FILENO) < 0) {
-                PANIC("Could not setup stdout for child process: %s", nobuild__strerror(errno));
-            }
-        }
+    Fd fd;
+    size_t file_size;
+    if (!nobuild__open_sized(path, &fd, &file_size)) {
+        return map;
+    }
 
-        if (execvp(args.elems[0], (char * const*) args.elems) < 0) {
-            PANIC("Could not exec child process: %s: %s",
-                  cmd_show(cmd), nobuild__strerror(errno));
+    if (file_size >= NOBUILD_MAP_THRESHOLD) {
+#ifndef _WIN32
+        void *data = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+#if defined(MADV_SEQUENTIAL) && defined(MADV_WILLNEED)
+            // The scanners read the file front to back, so ask for aggressive
+            // read-ahead and start paging it in right away
+            madvise(data, file_size, MADV_SEQUENTIAL);
+            madvise(data, file_size, MADV_WILLNEED);
+#endif
+            map.data = data;
+        }
+#else
+        HANDLE mapping = CreateFileMapping(fd, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping != NULL) {
+            // The view keeps the mapping alive
+            map.data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+#endif
+        if (map.data != NULL) {
+            map.size = file_size;
+            map.is_mapped = 1;
+            fd_close(fd);
+            return map;
         }
     }
 
-    return cpid;
+    map.data = nobuild__read_fd(fd, file_size, &map.size);
+    fd_close(fd);
+    return map;
+}
+
+void file_unmap(File_Map *map)
+{
+    if (map->is_mapped) {
+#ifndef _WIN32
+        munmap((void *) map->data, map->size);
 #else
-    // https://docs.microsoft.com/en-us/windows/win32/procthread/creating-a-child-process-with-redirected-input-and-output
+        UnmapViewOfFile(map->data);
+#endif
+    } else {
+        free((void *) map->data);
+    }
 
-    STARTUPINFO siStartInfo;
-    ZeroMemory(&siStartInfo, sizeof(siStartInfo));
-    siStartInfo.cb = sizeof(STARTUPINFO);
-    // NOTE: theoretically setting NULL to std handles should not be a problem
-    // https://docs.microsoft.com/en-us/windows/console/getstdhandle?redirectedfrom=MSDN#attachdetach-behavior
-    siStartInfo.hStdError = GetStdHandle(STD_ERROR_HANDLE);
-    // TODO(#32): check for errors in GetStdHandle
-    siStartInfo.hStdOutput = fdout ? *fdout : GetStdHandle(STD_OUTPUT_HANDLE);
-    siStartInfo.hStdInput = fdin ? *fdin : GetStdHandle(STD_INPUT_HANDLE);
-    siStartInfo.dwFlags |= STARTF_USESTDHANDLES;
+    map->data = NULL;
+    map->size = 0;
+    map->is_mapped = 0;
+}
 
-    PROCESS_INFORMATION piProcInfo;
-    ZeroMemory(&piProcInfo, sizeof(PROCESS_INFORMATION));
+Fd_Writer fdw_make(Fd fd, size_t buffer_size)
+{
+    Fd_Writer writer = {
+        .fd = fd,
+        .capacity = buffer_size > 0 ? buffer_size : NOBUILD_FD_BUFFER_SIZE,
+    };
+    writer.buffer = malloc(writer.capacity);
+    if (writer.buffer == NULL) {
+        PANIC("Could not allocate memory: %s", strerror(errno));
+    }
+    return writer;
+}
 
-    BOOL bSuccess =
-        CreateProcess(
-            NULL,
-            // TODO(#33): cmd_run_async on Windows does not render command line properly
-            // It may require wrapping some arguments with double-quotes if they contains spaces, etc.
-            (LPSTR) cstr_array_join(" ", cmd.line),
-            NULL,
-            NULL,
-            TRUE,
-            0,
-            NULL,
-            NULL,
-            &siStartInfo,
-            &piProcInfo
-        );
+int fdw_flush(Fd_Writer *writer)
+{
+    int ok = fd_write_all(writer->fd, writer->buffer, writer->count);
+    writer->count = 0;
+    return ok;
+}
 
-    if (!bSuccess) {
-        PANIC("Could not create child process %s: %s\n",
-              cmd_show(cmd), nobuild__GetLastErrorAsString());
+int fdw_write(Fd_Writer *writer, const void *buf, size_t count)
+{
+    if (writer->count + count > writer->capacity) {
+        if (!fdw_flush(writer)) {
+            return 0;
+        }
+        if (count >= writer->capacity) {
+            return fd_write_all(writer->fd, buf, count);
+        }
     }
 
-    CloseHandle(piProcInfo.hThread);
-
-    return piProcInfo.hProcess;
-#endif // _WIN32
+    memcpy(writer->buffer + writer->count, buf, count);
+    writer->count += count;
+    return 1;
 }
 
-void cmd_run_sync(Cmd cmd)
+int fdw_write_cstr(Fd_Writer *writer, Cstr cstr)
 {
-    pid_wait(cmd_run_async(cmd, NULL, NULL));
+    return fdw_write(writer, cstr, strlen(cstr));
 }
 
-static void chain_set_input_output_files_or_count_cmds(Chain *chain, Chain_Token token)
+int fdw_printf(Fd_Writer *writer, const char *fmt, ...)
 {
-    switch (token.type) {
-    case CHAIN_TOKEN_CMD: {
-        chain->cmds.count += 1;
-    }
-    break;
+    // Format straight into the buffer, flush and try again if it did not fit
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        const size_t spare = writer->capacity - writer->count;
+
+        va_list args;
+        va_start(args, fmt);
+        int len = vsnprintf(writer->buffer + writer->count, spare, fmt, args);
+        va_end(args);
+        if (len < 0) {
+            return 0;
+        }
 
-    case CHAIN_TOKEN_IN: {
-        if (chain->input_filepath) {
-            PANIC("Input file path was already set");
+        if ((size_t) len < spare) {
+            writer->count += (size_t) len;
+            return 1;
         }
 
-        chain->input_filepath = token.args.elems[0];
-    }
-    break;
+        if (attempt == 0 && (size_t) len < writer->capacity) {
+            if (!fdw_flush(writer)) {
+                return 0;
+            }
+            continue;
+        }
 
-    case CHAIN_TOKEN_OUT: {
-        if (chain->output_filepath) {
-            PANIC("Output file path was already set");
+        // Bigger than the whole buffer, format it on the heap
+        char *buffer = malloc((size_t) len + 1);
+        if (buffer == NULL) {
+            PANIC("Could not allocate memory: %s", strerror(errno));
         }
+        va_start(args, fmt);
+        vsnprintf(buffer, (size_t) len + 1, fmt, args);
+        va_end(args);
 
-        chain->output_filepath = token.args.elems[0];
+        int ok = fdw_write(writer, buffer, (size_t) len);
+        free(buffer);
+        return ok;
     }
-    break;
 
-    case CHAIN_TOKEN_END:
-    default: {
-        assert(0 && "unreachable");
-        exit(1);
+    return 0;
+}
+
+void fdw_close(Fd_Writer *writer)
+{
+    fdw_flush(writer);
+    fd_close(writer->fd);
+    free(writer->buffer);
+    writer->buffer = NULL;
+    writer->capacity = 0;
+}
+
+Fd_Reader fdr_make(Fd fd, size_t buffer_size)
+{
+    Fd_Reader reader = {
+        .fd = fd,
+        .capacity = buffer_size > 0 ? buffer_size : NOBUILD_FD_BUFFER_SIZE,
+    };
+    reader.buffer = malloc(reader.capacity);
+    if (reader.buffer == NULL) {
+        PANIC("Could not allocate memory: %s", strerror(errno));
+    }
+    return reader;
+}
+
+// Moves the unread bytes to the front of the buffer and reads more after
+// them. Returns the number of bytes read, 0 at the end of the file.
+static size_t nobuild__fdr_fill(Fd_Reader *reader)
+{
+    if (reader->begin > 0) {
+        memmove(reader->buffer, reader->buffer + reader->begin, reader->end - reader->begin);
+        reader->end -= reader->begin;
+        reader->begin = 0;
     }
+
+    if (reader->end == reader->capacity) {
+        reader->capacity *= 2;
+        reader->buffer = realloc(reader->buffer, reader->capacity);
+        if (reader->buffer == NULL) {
+            PANIC("Could not allocate memory: %s", strerror(errno));
+        }
     }
+
+    size_t bytes = fd_read(reader->fd, reader->buffer + reader->end, (unsigned long) (reader->capacity - reader->end));
+    reader->end += bytes;
+    return bytes;
 }
 
-static void chain_push_cmd(Chain *chain, Chain_Token token)
+size_t fdr_read(Fd_Reader *reader, void *buf, size_t count)
 {
-    if (token.type == CHAIN_TOKEN_CMD) {
-        chain->cmds.elems[chain->cmds.count++] = (Cmd) {
-            .line = token.args
-        };
+    if (reader->begin == reader->end) {
+        reader->begin = reader->end = 0;
+        // Large reads skip the buffer
+        if (count >= reader->capacity) {
+            return fd_read(reader->fd, buf, (unsigned long) count);
+        }
+        nobuild__fdr_fill(reader);
+    }
+
+    size_t available = reader->end - reader->begin;
+    if (count > available) {
+        count = available;
     }
+    memcpy(buf, reader->buffer + reader->begin, count);
+    reader->begin += count;
+    return count;
 }
 
-Chain chain_build_from_tokens(Chain_Token first, ...)
+int fdr_read_line(Fd_Reader *reader, String_View *line)
 {
-    Chain result = {0};
+    size_t scanned = reader->begin;
+    for (;;) {
+        char *newline = memchr(reader->buffer + scanned, '\n', reader->end - scanned);
+        if (newline != NULL) {
+            size_t end = (size_t) (newline - reader->buffer);
+            *line = sv_from_parts(reader->buffer + reader->begin, end - reader->begin);
+            reader->begin = end + 1;
+            break;
+        }
 
-    chain_set_input_output_files_or_count_cmds(&result, first);
-    va_list args;
-    va_start(args, first);
-    Chain_Token next = va_arg(args, Chain_Token);
-    while (next.type != CHAIN_TOKEN_END) {
-        chain_set_input_output_files_or_count_cmds(&result, next);
-        next = va_arg(args, Chain_Token);
+        scanned = reader->end - reader->begin;
+        if (nobuild__fdr_fill(reader) == 0) {
+            if (reader->begin == reader->end) {
+                return 0;
+            }
+
+            // Last line without a line ending
+            *line = sv_from_parts(reader->buffer + reader->begin, reader->end - reader->begin);
+            reader->begin = reader->end;
+            break;
+        }
     }
-    va_end(args);
 
-    result.cmds.elems = malloc(sizeof(result.cmds.elems[0]) * result.cmds.count);
-    if (result.cmds.elems == NULL) {
-        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    if (line->count > 0 && line->data[line->count - 1] == '\r') {
+        line->count -= 1;
     }
-    result.cmds.count = 0;
+    return 1;
+}
 
-    chain_push_cmd(&result, first);
+void fdr_close(Fd_Reader *reader)
+{
+    fd_close(reader->fd);
+    free(reader->buffer);
+    reader->buffer = NULL;
+    reader->capacity = 0;
+}
 
-    va_start(args, first);
-    next = va_arg(args, Chain_Token);
-    while (next.type != CHAIN_TOKEN_END) {
-        chain_push_cmd(&result, next);
-        next = va_arg(args, Chain_Token);
+void fd_batch_stat(Fd_Batch *batch, Cstr path)
+{
+    Fd_Batch_Op op = {
+        .kind = FD_BATCH_STAT,
+        .path = path,
+    };
+    ARRAY_APPEND(batch, op);
+}
+
+void fd_batch_open(Fd_Batch *batch, Cstr path)
+{
+    Fd_Batch_Op op = {
+        .kind = FD_BATCH_OPEN,
+        .path = path,
+    };
+    ARRAY_APPEND(batch, op);
+}
+
+void fd_batch_read(Fd_Batch *batch, Fd fd, void *buf, size_t size, unsigned long long offset)
+{
+    Fd_Batch_Op op = {
+        .kind = FD_BATCH_READ,
+        .fd = fd,
+        .buf = buf,
+        .size = size,
+        .offset = offset,
+    };
+    ARRAY_APPEND(batch, op);
+}
+
+// Runs `op` with the regular blocking syscalls
+static void nobuild__fd_batch_run(Fd_Batch_Op *op)
+{
+    op->error = 0;
+
+    switch (op->kind) {
+    case FD_BATCH_STAT: {
+#ifndef _WIN32
+        struct stat statbuf;
+        if (stat(op->path, &statbuf) < 0) {
+            op->error = errno;
+            break;
+        }
+
+        op->is_dir = S_ISDIR(statbuf.st_mode);
+        op->file_size = (unsigned long long) statbuf.st_size;
+#if defined(UTIME_NOW)
+#	ifdef __APPLE__
+        op->mtime = (long long) statbuf.st_mtimespec.tv_sec * 1000000000LL + statbuf.st_mtimespec.tv_nsec;
+#	else
+        op->mtime = (long long) statbuf.st_mtim.tv_sec * 1000000000LL + statbuf.st_mtim.tv_nsec;
+#	endif
+#else
+        op->mtime = (long long) statbuf.st_mtime * 1000000000LL;
+#endif
+#else
+        WIN32_FILE_ATTRIBUTE_DATA data;
+        if (!GetFileAttributesEx(op->path, GetFileExInfoStandard, &data)) {
+            DWORD error = GetLastError();
+            op->error = error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND ? ENOENT : EIO;
+            break;
+        }
+
+        op->is_dir = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        op->file_size = ((unsigned long long) data.nFileSizeHigh) << 32 | data.nFileSizeLow;
+        op->mtime = ((long long) data.ftLastWriteTime.dwHighDateTime) << 32 | data.ftLastWriteTime.dwLowDateTime;
+#endif // _WIN32
     }
-    va_end(args);
+    break;
 
-    return result;
+    case FD_BATCH_OPEN: {
+#ifndef _WIN32
+        op->fd = open(op->path, O_RDONLY);
+        if (op->fd < 0) {
+            op->error = errno;
+        }
+#else
+        op->fd = CreateFile(op->path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (op->fd == INVALID_HANDLE_VALUE) {
+            DWORD error = GetLastError();
+            op->error = error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND ? ENOENT : EIO;
+        }
+#endif // _WIN32
+    }
+    break;
+
+    case FD_BATCH_READ: {
+#ifndef _WIN32
+        ssize_t bytes;
+        do {
+            bytes = pread(op->fd, op->buf, op->size, (off_t) op->offset);
+        } while (bytes < 0 && errno == EINTR);
+        if (bytes < 0) {
+            op->error = errno;
+            break;
+        }
+        op->bytes = (size_t) bytes;
+#else
+        OVERLAPPED overlapped = {0};
+        overlapped.Offset = (DWORD) op->offset;
+        overlapped.OffsetHigh = (DWORD) (op->offset >> 32);
+        DWORD bytes;
+        if (!ReadFile(op->fd, op->buf, (DWORD) op->size, &bytes, &overlapped) && GetLastError() != ERROR_HANDLE_EOF) {
+            op->error = EIO;
+            break;
+        }
+        op->bytes = (size_t) bytes;
+#endif // _WIN32
+    }
+    break;
+
+    default:
+        assert(0 && "unreachable");
+    }
 }
 
-void chain_run_sync(Chain chain)
+#ifdef NOBUILD__IO_URING
+#ifndef AT_FDCWD
+#	define AT_FDCWD -100
+#endif
+
+typedef struct {
+    int fd;
+    unsigned entries;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+} Nobuild__Uring;
+
+static int nobuild__uring_init(Nobuild__Uring *ring, unsigned entries)
 {
-    if (chain.cmds.count == 0) {
-        return;
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(*ring));
+
+    ring->fd = (int) syscall(SYS_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        return 0;
     }
 
-    Pid *cpids = malloc(sizeof(Pid) * chain.cmds.count);
+    ring->entries = params.sq_entries;
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size) {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+        ring->cq_ring_size = 0;
+    }
 
-    Pipe pip = {0};
-    Fd fdin = 0;
-    Fd *fdprev = NULL;
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, IORING_OFF_SQ_RING);
+    ring->cq_ring = ring->cq_ring_size == 0
+        ? ring->sq_ring
+        : mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, IORING_OFF_CQ_RING);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, IORING_OFF_SQES);
+    if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        if (ring->sq_ring != MAP_FAILED) {
+            munmap(ring->sq_ring, ring->sq_ring_size);
+        }
+        if (ring->cq_ring_size != 0 && ring->cq_ring != MAP_FAILED) {
+            munmap(ring->cq_ring, ring->cq_ring_size);
+        }
+        if (ring->sqes != MAP_FAILED) {
+            munmap(ring->sqes, ring->sqes_size);
+        }
+        close(ring->fd);
+        return 0;
+    }
 
-    if (chain.input_filepath) {
-        fdin = fd_open_for_read(chain.input_filepath);
-        fdprev = &fdin;
+    char *sq = ring->sq_ring;
+    ring->sq_tail = (unsigned *) (sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *) (sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *) (sq + params.sq_off.array);
+
+    char *cq = ring->cq_ring;
+    ring->cq_head = (unsigned *) (cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *) (cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *) (cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+
+    return 1;
+}
+
+static void nobuild__uring_free(Nobuild__Uring *ring)
+{
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring_size != 0) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
     }
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+}
 
-    for (size_t i = 0; i < chain.cmds.count - 1; ++i) {
-        pip = pipe_make();
+static void nobuild__uring_prep(struct io_uring_sqe *sqe, Fd_Batch_Op *op, struct statx *statxbuf)
+{
+    memset(sqe, 0, sizeof(*sqe));
+    switch (op->kind) {
+    case FD_BATCH_STAT:
+        sqe->opcode = IORING_OP_STATX;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (unsigned long long) (uintptr_t) op->path;
+        sqe->len = STATX_TYPE | STATX_SIZE | STATX_MTIME;
+        sqe->off = (unsigned long long) (uintptr_t) statxbuf;
+        break;
+
+    case FD_BATCH_OPEN:
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (unsigned long long) (uintptr_t) op->path;
+        sqe->open_flags = O_RDONLY;
+        break;
+
+    case FD_BATCH_READ:
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = op->fd;
+        sqe->addr = (unsigned long long) (uintptr_t) op->buf;
+        sqe->len = op->size > 0x7ffff000 ? 0x7ffff000 : (unsigned) op->size;
+        sqe->off = op->offset;
+        break;
+
+    default:
+        assert(0 && "unreachable");
+    }
+}
 
-        cpids[i] = cmd_run_async(
-                       chain.cmds.elems[i],
-                       fdprev,
-                       &pip.write);
+static void nobuild__uring_complete(Fd_Batch_Op *op, int res, const struct statx *statxbuf)
+{
+    if (res == -EINVAL || res == -EOPNOTSUPP) {
+        // The kernel predates this opcode (io_uring got STATX, OPENAT and READ in 5.6)
+        nobuild__fd_batch_run(op);
+        return;
+    }
 
-        if (fdprev) fd_close(*fdprev);
-        fd_close(pip.write);
-        fdprev = &fdin;
-        fdin = pip.read;
+    op->error = res < 0 ? -res : 0;
+    if (res < 0) {
+        return;
     }
 
-    {
-        Fd fdout = 0;
-        Fd *fdnext = NULL;
+    switch (op->kind) {
+    case FD_BATCH_STAT:
+        op->is_dir = S_ISDIR(statxbuf->stx_mode);
+        op->file_size = statxbuf->stx_size;
+        op->mtime = (long long) statxbuf->stx_mtime.tv_sec * 1000000000LL + statxbuf->stx_mtime.tv_nsec;
+        break;
+    case FD_BATCH_OPEN:
+        op->fd = res;
+        break;
+    case FD_BATCH_READ:
+        op->bytes = (size_t) res;
+        break;
+    default:
+        assert(0 && "unreachable");
+    }
+}
 
-        if (chain.output_filepath) {
-            fdout = fd_open_for_write(chain.output_filepath);
-            fdnext = &fdout;
+// Returns 0 if io_uring is not available, the caller then runs the batch itself
+static int nobuild__fd_batch_submit_uring(Fd_Batch *batch)
+{
+    Nobuild__Uring ring;
+    if (!nobuild__uring_init(&ring, NOBUILD_IO_URING_ENTRIES)) {
+        return 0;
+    }
+
+    // Every operation in flight owns a slot, which holds its statx buffer and
+    // goes back to the free list when the operation completes
+    const unsigned slots = ring.entries;
+    struct statx *statxbufs = malloc(sizeof(*statxbufs) * slots);
+    size_t *slot_op = malloc(sizeof(*slot_op) * slots);
+    unsigned *free_slots = malloc(sizeof(*free_slots) * slots);
+    if (statxbufs == NULL || slot_op == NULL || free_slots == NULL) {
+        PANIC("Could not allocate memory: %s", strerror(errno));
+    }
+    for (unsigned i = 0; i < slots; ++i) {
+        free_slots[i] = slots - 1 - i;
+    }
+
+    unsigned free_count = slots;
+    unsigned to_submit = 0;
+    size_t next = 0;
+    size_t done = 0;
+    while (done < batch->count) {
+        unsigned tail = *ring.sq_tail;
+        while (next < batch->count && free_count > 0) {
+            unsigned slot = free_slots[--free_count];
+            unsigned index = tail & *ring.sq_mask;
+            nobuild__uring_prep(&ring.sqes[index], &batch->elems[next], &statxbufs[slot]);
+            ring.sqes[index].user_data = slot;
+            ring.sq_array[index] = index;
+            slot_op[slot] = next;
+            tail += 1;
+            to_submit += 1;
+            next += 1;
         }
+        __atomic_store_n(ring.sq_tail, tail, __ATOMIC_RELEASE);
 
-        const size_t last = chain.cmds.count - 1;
-        cpids[last] =
-            cmd_run_async(
-                chain.cmds.elems[last],
-                fdprev,
-                fdnext);
+        long submitted = syscall(SYS_io_uring_enter, ring.fd, to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (submitted < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                continue;
+            }
+            PANIC("Could not submit to io_uring: %s", strerror(errno));
+        }
+        to_submit -= (unsigned) submitted;
+
+        unsigned head = *ring.cq_head;
+        unsigned cq_tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        while (head != cq_tail) {
+            struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+            unsigned slot = (unsigned) cqe->user_data;
+            nobuild__uring_complete(&batch->elems[slot_op[slot]], cqe->res, &statxbufs[slot]);
+            free_slots[free_count++] = slot;
+            head += 1;
+            done += 1;
+        }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+    }
 
-        if (fdprev) fd_close(*fdprev);
-        if (fdnext) fd_close(*fdnext);
+    free(free_slots);
+    free(slot_op);
+    free(statxbufs);
+    nobuild__uring_free(&ring);
+    return 1;
+}
+#endif // NOBUILD__IO_URING
+
+void fd_batch_submit(Fd_Batch *batch)
+{
+#ifdef NOBUILD__IO_URING
+    // Setting up a ring costs a few syscalls of its own
+    if (batch->count >= 16 && nobuild__fd_batch_submit_uring(batch)) {
+        return;
     }
+#endif
 
-    for (size_t i = 0; i < chain.cmds.count; ++i) {
-        pid_wait(cpids[i]);
+    for (size_t i = 0; i < batch->count; ++i) {
+        nobuild__fd_batch_run(&batch->elems[i]);
     }
 }
 
-void chain_echo(Chain chain)
+void pid_wait(Pid pid)
 {
-    printf("[INFO] CHAIN:");
-    if (chain.input_filepath) {
-        printf(" %s", chain.input_filepath);
+#ifndef _WIN32
+    for (;;) {
+        int wstatus = 0;
+        if (waitpid(pid, &wstatus, 0) < 0) {
+            PANIC("Could not wait on command (pid %d): %s", pid, strerror(errno));
+        }
+
+        if (WIFEXITED(wstatus)) {
+            int exit_status = WEXITSTATUS(wstatus);
+            if (exit_status != 0) {
+                PANIC("Command exited with exit code %d", exit_status);
+            }
+
+            break;
+        }
+
+        if (WIFSIGNALED(wstatus)) {
+            PANIC("Command process was terminated by %s", strsignal(WTERMSIG(wstatus)));
+        }
     }
+#else
+    DWORD result = WaitForSingleObject(
+                       pid,     // HANDLE hHandle,
+                       INFINITE // DWORD  dwMilliseconds
+                   );
 
-    for (size_t cmd_index = 0; cmd_index < chain.cmds.count; ++cmd_index) {
-        Cmd *cmd = &chain.cmds.elems[cmd_index];
-        printf(" |> %s", cmd_show(*cmd));
+    if (result == WAIT_FAILED) {
+        PANIC("Could not wait on child process: %s", nobuild__GetLastErrorAsString());
     }
 
-    if (chain.output_filepath) {
-        printf(" |> %s", chain.output_filepath);
+    DWORD exit_status;
+    if (GetExitCodeProcess(pid, &exit_status) == 0) {
+        PANIC("Could not get process exit code: %lu", GetLastError());
     }
 
-    printf("\n");
+    if (exit_status != 0) {
+        PANIC("Command exited with exit code %lu", exit_status);
+    }
+
+    CloseHandle(pid);
+#endif // _WIN32
 }
 
 
@@ -1318,9 +3434,10 @@ void chain_echo(Chain chain)
 
 
 #include <assert.h>
+#include <string.h>
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdlib.h>
-#include <string.h>
 #include <errno.h>
 
 
@@ -1335,645 +3452,6784 @@ void chain_echo(Chain chain)
 ////////////////////////////////////////////////////////////////////////////////
 
 
+// Multiple modules could define this function, so add a guard around it to prevent redefinition
+#ifndef NOBUILD__STRERROR
+#define NOBUILD__STRERROR
+Cstr nobuild__strerror(int errnum)
+{
 #ifndef _WIN32
-#	include <sys/types.h>
-#	include <sys/stat.h>
-#	include <unistd.h>
-#	include <dirent.h>
+    return nobuild__strerror(errnum);
 #else
-#	define WIN32_MEAN_AND_LEAN
-#	include <windows.h>
-#	include <direct.h>
-// Copyright 2021 Alexey Kutepov <reximkut@gmail.com>
-//
-// Permission is hereby granted, free of charge, to any person obtaining
-// a copy of this software and associated documentation files (the
-// "Software"), to deal in the Software without restriction, including
-// without limitation the rights to use, copy, modify, merge, publish,
-// distribute, sublicense, and/or sell copies of the Software, and to
-// permit persons to whom the Software is furnished to do so, subject to
-// the following conditions:
-//
-// The above copyright notice and this permission notice shall be
-// included in all copies or substantial portions of the Software.
-//
-// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
-// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
-// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
-// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
-// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
-// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
-// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
-//
-// ============================================================
-//
-// minirent — 0.0.1 — A subset of dirent interface for Windows.
-//
-// https://github.com/tsoding/minirent
-//
-// ============================================================
-//
-// ChangeLog (https://semver.org/ is implied)
-//
-//    0.0.1 First Official Release
+    static char buffer[1024];
+    strerror_s(buffer, 1024, errnum);
+    return buffer;
+#endif
+}
+#endif // NOBUILD__STRERROR
 
+// Multiple modules could define this function, so add a guard around it to prevent redefinition
+#if defined(_WIN32) && !defined(NOBUILD__GETLASTERROR)
+#define NOBUILD__GETLASTERROR
+LPSTR nobuild__GetLastErrorAsString(void)
+{
+    // https://stackoverflow.com/q/1387064/21582981
+    DWORD errorMessageId = GetLastError();
+    assert(errorMessageId != 0);
 
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
+    LPSTR messageBuffer = NULL;
 
-struct dirent
+    FormatMessage(
+        FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, // DWORD   dwFlags,
+        NULL, // LPCVOID lpSource,
+        errorMessageId, // DWORD   dwMessageId,
+        MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), // DWORD   dwLanguageId,
+        (LPSTR) &messageBuffer, // LPTSTR  lpBuffer,
+        0, // DWORD   nSize,
+        NULL // va_list *Arguments
+    );
+
+    return messageBuffer;
+}
+#endif // NOBUILD__GETLASTERROR
+
+void cmd_append(Cmd *cmd, ...)
 {
-    char d_name[MAX_PATH+1];
-};
+    va_list args;
+    va_start(args, cmd);
+    for (Cstr arg = va_arg(args, Cstr);
+            arg != NULL;
+            arg = va_arg(args, Cstr)) {
+        // Keep a spare slot so `cmd_run_async()` can terminate argv in place
+        ARRAY_RESERVE(&cmd->line, cmd->line.count + 2);
+        cmd->line.elems[cmd->line.count++] = arg;
+    }
+    va_end(args);
+}
 
-typedef struct DIR DIR;
+void cmd_extend(Cmd *cmd, Cstr_Array args)
+{
+    ARRAY_RESERVE(&cmd->line, cmd->line.count + args.count + 1);
+    ARRAY_APPEND_MANY(&cmd->line, args.elems, args.count);
+}
 
-DIR *opendir(const char *dirpath);
-struct dirent *readdir(DIR *dirp);
-int closedir(DIR *dirp);
+void cmd_reset(Cmd *cmd)
+{
+    cmd->line.count = 0;
+}
+
+Cstr cmd_show(Cmd cmd)
+{
+    // TODO(#31): cmd_show does not render the command line properly
+    // - No string literals when arguments contains space
+    // - No escaping of special characters
+    // - Etc.
+    return cstr_array_join(" ", cmd.line);
+}
 
+Pid cmd_run_async(Cmd cmd, Fd *fdin, Fd *fdout)
+{
+#ifndef _WIN32
+    pid_t cpid = fork();
+    if (cpid < 0) {
+        PANIC("Could not fork child process: %s: %s",
+              cmd_show(cmd), nobuild__strerror(errno));
+    }
 
-////////////////////////////////////////////////////////////////////////////////
+    if (cpid == 0) {
+        // The child owns a copy of the parent memory, so argv can be terminated
+        // in place when the array has room for it
+        Cstr_Array args = cmd.line;
+        if (args.capacity <= args.count) {
+            args.elems = malloc(sizeof(Cstr) * (args.count + 1));
+            if (args.elems == NULL) {
+                PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+            }
+            memcpy(args.elems, cmd.line.elems, args.count * sizeof(Cstr));
+        }
+        args.elems[args.count] = NULL;
 
+        if (fdin) {
+            if (dup2(*fdin, STDIN_FILENO) < 0) {
+                PANIC("Could not setup stdin for child process: %s", nobuild__strerror(errno));
+            }
+        }
 
-struct DIR
+        if (fdout) {
+            if (dup2(*fdout, STDOUT_FILENO) < 0) {
+                PANIC("Could not setup stdout for child process: %s", nobuild__strerror(errno));
+            }
+        }
+
+        if (execvp(args.elems[0], (char * const*) args.elems) < 0) {
+            PANIC("Could not exec child process: %s: %s",
+                  cmd_show(cmd), nobuild__strerror(errno));
+        }
+    }
+
+    return cpid;
+#else
+    // https://docs.microsoft.com/en-us/windows/win32/procthread/creating-a-child-process-with-redirected-input-and-output
+
+    STARTUPINFO siStartInfo;
+    ZeroMemory(&siStartInfo, sizeof(siStartInfo));
+    siStartInfo.cb = sizeof(STARTUPINFO);
+    // NOTE: theoretically setting NULL to std handles should not be a problem
+    // https://docs.microsoft.com/en-us/windows/console/getstdhandle?redirectedfrom=MSDN#attachdetach-behavior
+    siStartInfo.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+    // TODO(#32): check for errors in GetStdHandle
+    siStartInfo.hStdOutput = fdout ? *fdout : GetStdHandle(STD_OUTPUT_HANDLE);
+    siStartInfo.hStdInput = fdin ? *fdin : GetStdHandle(STD_INPUT_HANDLE);
+    siStartInfo.dwFlags |= STARTF_USESTDHANDLES;
+
+    PROCESS_INFORMATION piProcInfo;
+    ZeroMemory(&piProcInfo, sizeof(PROCESS_INFORMATION));
+
+    BOOL bSuccess =
+        CreateProcess(
+            NULL,
+            // TODO(#33): cmd_run_async on Windows does not render command line properly
+            // It may require wrapping some arguments with double-quotes if they contains spaces, etc.
+            (LPSTR) cstr_array_join(" ", cmd.line),
+            NULL,
+            NULL,
+            TRUE,
+            0,
+            NULL,
+            NULL,
+            &siStartInfo,
+            &piProcInfo
+        );
+
+    if (!bSuccess) {
+        PANIC("Could not create child process %s: %s\n",
+              cmd_show(cmd), nobuild__GetLastErrorAsString());
+    }
+
+    CloseHandle(piProcInfo.hThread);
+
+    return piProcInfo.hProcess;
+#endif // _WIN32
+}
+
+void cmd_run_sync(Cmd cmd)
 {
-    HANDLE hFind;
-    WIN32_FIND_DATA data;
-    struct dirent *dirent;
-};
+    pid_wait(cmd_run_async(cmd, NULL, NULL));
+}
 
-DIR *opendir(const char *dirpath)
+static void chain_set_input_output_files_or_count_cmds(Chain *chain, Chain_Token token)
 {
-    assert(dirpath);
+    switch (token.type) {
+    case CHAIN_TOKEN_CMD: {
+        chain->cmds.count += 1;
+    }
+    break;
 
-    char buffer[MAX_PATH];
-    snprintf(buffer, MAX_PATH, "%s\\*", dirpath);
+    case CHAIN_TOKEN_IN: {
+        if (chain->input_filepath) {
+            PANIC("Input file path was already set");
+        }
 
-    DIR *dir = (DIR*)calloc(1, sizeof(DIR));
+        chain->input_filepath = token.args.elems[0];
+    }
+    break;
 
-    dir->hFind = FindFirstFile(buffer, &dir->data);
-    if (dir->hFind == INVALID_HANDLE_VALUE) {
-        // TODO: opendir should set errno accordingly on FindFirstFile fail
-        // https://docs.microsoft.com/en-us/windows/win32/api/errhandlingapi/nf-errhandlingapi-getlasterror
-        errno = ENOSYS;
-        goto fail;
+    case CHAIN_TOKEN_OUT: {
+        if (chain->output_filepath) {
+            PANIC("Output file path was already set");
+        }
+
+        chain->output_filepath = token.args.elems[0];
     }
+    break;
 
-    return dir;
+    case CHAIN_TOKEN_END:
+    default: {
+        assert(0 && "unreachable");
+        exit(1);
+    }
+    }
+}
+
+static void chain_push_cmd(Chain *chain, Chain_Token token)
+{
+    if (token.type == CHAIN_TOKEN_CMD) {
+        chain->cmds.elems[chain->cmds.count++] = (Cmd) {
+            .line = token.args
+        };
+    }
+}
+
+Chain chain_build_from_tokens(Chain_Token first, ...)
+{
+    Chain result = {0};
+
+    chain_set_input_output_files_or_count_cmds(&result, first);
+    va_list args;
+    va_start(args, first);
+    Chain_Token next = va_arg(args, Chain_Token);
+    while (next.type != CHAIN_TOKEN_END) {
+        chain_set_input_output_files_or_count_cmds(&result, next);
+        next = va_arg(args, Chain_Token);
+    }
+    va_end(args);
+
+    result.cmds.elems = malloc(sizeof(result.cmds.elems[0]) * result.cmds.count);
+    if (result.cmds.elems == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+    result.cmds.count = 0;
+
+    chain_push_cmd(&result, first);
+
+    va_start(args, first);
+    next = va_arg(args, Chain_Token);
+    while (next.type != CHAIN_TOKEN_END) {
+        chain_push_cmd(&result, next);
+        next = va_arg(args, Chain_Token);
+    }
+    va_end(args);
+
+    return result;
+}
+
+void chain_run_sync(Chain chain)
+{
+    if (chain.cmds.count == 0) {
+        return;
+    }
+
+    Pid *cpids = malloc(sizeof(Pid) * chain.cmds.count);
+
+    Pipe pip = {0};
+    Fd fdin = 0;
+    Fd *fdprev = NULL;
+
+    if (chain.input_filepath) {
+        fdin = fd_open_for_read(chain.input_filepath);
+        fdprev = &fdin;
+    }
+
+    for (size_t i = 0; i < chain.cmds.count - 1; ++i) {
+        pip = pipe_make();
+
+        cpids[i] = cmd_run_async(
+                       chain.cmds.elems[i],
+                       fdprev,
+                       &pip.write);
+
+        if (fdprev) fd_close(*fdprev);
+        fd_close(pip.write);
+        fdprev = &fdin;
+        fdin = pip.read;
+    }
+
+    {
+        Fd fdout = 0;
+        Fd *fdnext = NULL;
+
+        if (chain.output_filepath) {
+            fdout = fd_open_for_write(chain.output_filepath);
+            fdnext = &fdout;
+        }
+
+        const size_t last = chain.cmds.count - 1;
+        cpids[last] =
+            cmd_run_async(
+                chain.cmds.elems[last],
+                fdprev,
+                fdnext);
+
+        if (fdprev) fd_close(*fdprev);
+        if (fdnext) fd_close(*fdnext);
+    }
+
+    for (size_t i = 0; i < chain.cmds.count; ++i) {
+        pid_wait(cpids[i]);
+    }
+}
+
+void chain_echo(Chain chain)
+{
+    printf("[INFO] CHAIN:");
+    if (chain.input_filepath) {
+        printf(" %s", chain.input_filepath);
+    }
+
+    for (size_t cmd_index = 0; cmd_index < chain.cmds.count; ++cmd_index) {
+        Cmd *cmd = &chain.cmds.elems[cmd_index];
+        printf(" |> %s", cmd_show(*cmd));
+    }
+
+    if (chain.output_filepath) {
+        printf(" |> %s", chain.output_filepath);
+    }
+
+    printf("\n");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef _WIN32
+#	include <sys/types.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#	include <dirent.h>
+#	include <fcntl.h>
+#	include <utime.h>
+#	ifdef __linux__
+#		include <sys/ioctl.h>
+#		ifndef FICLONE
+#			define FICLONE _IOW(0x94, 9, int)
+#		endif
+#	endif
+
+// Avoid requiring the user to define `_XOPEN_SOURCE`
+char *realpath(const char *path, char *resolved_path);
+#else
+#	define WIN32_MEAN_AND_LEAN
+#	include <windows.h>
+#	include <direct.h>
+// Copyright 2021 Alexey Kutepov <reximkut@gmail.com>
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// ============================================================
+//
+// minirent — 0.0.1 — A subset of dirent interface for Windows.
+//
+// https://github.com/tsoding/minirent
+//
+// ============================================================
+//
+// ChangeLog (https://semver.org/ is implied)
+//
+//    0.0.1 First Official Release
+
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+struct dirent
+{
+    char d_name[MAX_PATH+1];
+};
+
+typedef struct DIR DIR;
+
+DIR *opendir(const char *dirpath);
+struct dirent *readdir(DIR *dirp);
+int closedir(DIR *dirp);
+
+
+////////////////////////////////////////////////////////////////////////////////
+
+
+struct DIR
+{
+    HANDLE hFind;
+    WIN32_FIND_DATA data;
+    struct dirent *dirent;
+};
+
+DIR *opendir(const char *dirpath)
+{
+    assert(dirpath);
+
+    char buffer[MAX_PATH];
+    snprintf(buffer, MAX_PATH, "%s\\*", dirpath);
+
+    DIR *dir = (DIR*)calloc(1, sizeof(DIR));
+
+    dir->hFind = FindFirstFile(buffer, &dir->data);
+    if (dir->hFind == INVALID_HANDLE_VALUE) {
+        // TODO: opendir should set errno accordingly on FindFirstFile fail
+        // https://docs.microsoft.com/en-us/windows/win32/api/errhandlingapi/nf-errhandlingapi-getlasterror
+        errno = ENOSYS;
+        goto fail;
+    }
+
+    return dir;
+
+fail:
+    if (dir) {
+        free(dir);
+    }
+
+    return NULL;
+}
+
+struct dirent *readdir(DIR *dirp)
+{
+    assert(dirp);
+
+    if (dirp->dirent == NULL) {
+        dirp->dirent = (struct dirent*)calloc(1, sizeof(struct dirent));
+    } else {
+        if(!FindNextFile(dirp->hFind, &dirp->data)) {
+            if (GetLastError() != ERROR_NO_MORE_FILES) {
+                // TODO: readdir should set errno accordingly on FindNextFile fail
+                // https://docs.microsoft.com/en-us/windows/win32/api/errhandlingapi/nf-errhandlingapi-getlasterror
+                errno = ENOSYS;
+            }
+
+            return NULL;
+        }
+    }
+
+    memset(dirp->dirent->d_name, 0, sizeof(dirp->dirent->d_name));
+
+    strncpy(
+        dirp->dirent->d_name,
+        dirp->data.cFileName,
+        sizeof(dirp->dirent->d_name) - 1);
+
+    return dirp->dirent;
+}
+
+int closedir(DIR *dirp)
+{
+    assert(dirp);
+
+    if(!FindClose(dirp->hFind)) {
+        // TODO: closedir should set errno accordingly on FindClose fail
+        // https://docs.microsoft.com/en-us/windows/win32/api/errhandlingapi/nf-errhandlingapi-getlasterror
+        errno = ENOSYS;
+        return -1;
+    }
+
+    if (dirp->dirent) {
+        free(dirp->dirent);
+    }
+    free(dirp);
+
+    return 0;
+}
+
+#endif // _WIN32
+
+#if !defined(NOBUILD_NO_THREADS) && !defined(_WIN32)
+#	include <pthread.h>
+#endif
+
+// Multiple modules could define these, so add a guard around them to prevent redefinition
+#ifndef NOBUILD__MUTEX
+#define NOBUILD__MUTEX
+#ifdef NOBUILD_NO_THREADS
+typedef int Nobuild__Mutex;
+#	define NOBUILD__MUTEX_INIT 0
+#	define nobuild__mutex_lock(mutex) ((void) (mutex))
+#	define nobuild__mutex_unlock(mutex) ((void) (mutex))
+#elif !defined(_WIN32)
+#	include <pthread.h>
+typedef pthread_mutex_t Nobuild__Mutex;
+#	define NOBUILD__MUTEX_INIT PTHREAD_MUTEX_INITIALIZER
+#	define nobuild__mutex_lock(mutex) pthread_mutex_lock(mutex)
+#	define nobuild__mutex_unlock(mutex) pthread_mutex_unlock(mutex)
+#else
+#	define WIN32_MEAN_AND_LEAN
+#	include <windows.h>
+typedef SRWLOCK Nobuild__Mutex;
+#	define NOBUILD__MUTEX_INIT SRWLOCK_INIT
+#	define nobuild__mutex_lock(mutex) AcquireSRWLockExclusive(mutex)
+#	define nobuild__mutex_unlock(mutex) ReleaseSRWLockExclusive(mutex)
+#endif
+#endif // NOBUILD__MUTEX
+
+// Multiple modules could define this function, so add a guard around it to prevent redefinition
+#ifndef NOBUILD__STRERROR
+#define NOBUILD__STRERROR
+Cstr nobuild__strerror(int errnum)
+{
+#ifndef _WIN32
+    return strerror(errnum);
+#else
+    static char buffer[1024];
+    strerror_s(buffer, 1024, errnum);
+    return buffer;
+#endif
+}
+#endif // NOBUILD__STRERROR
+
+// Multiple modules could define this function, so add a guard around it to prevent redefinition
+#if defined(_WIN32) && !defined(NOBUILD__GETLASTERROR)
+#define NOBUILD__GETLASTERROR
+LPSTR nobuild__GetLastErrorAsString(void)
+{
+    // https://stackoverflow.com/q/1387064/21582981
+    DWORD errorMessageId = GetLastError();
+    assert(errorMessageId != 0);
+
+    LPSTR messageBuffer = NULL;
+
+    FormatMessage(
+        FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, // DWORD   dwFlags,
+        NULL, // LPCVOID lpSource,
+        errorMessageId, // DWORD   dwMessageId,
+        MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), // DWORD   dwLanguageId,
+        (LPSTR) &messageBuffer, // LPTSTR  lpBuffer,
+        0, // DWORD   nSize,
+        NULL // va_list *Arguments
+    );
+
+    return messageBuffer;
+}
+#endif // NOBUILD__GETLASTERROR
+
+int nobuild__mkdir(const char *pathname, unsigned int mode)
+{
+#ifndef _WIN32
+    return mkdir(pathname, mode);
+#else
+    _Pragma("unused(mode)");
+    return _mkdir(pathname);
+#endif
+}
+
+int nobuild__rmdir(const char *pathname)
+{
+#ifndef _WIN32
+    return rmdir(pathname);
+#else
+    return _rmdir(pathname);
+#endif
+}
+
+int nobuild__unlink(const char *pathname)
+{
+#ifndef _WIN32
+    return unlink(pathname);
+#else
+    return _unlink(pathname);
+#endif
+}
+
+// Index of the dot that starts the extension of `basename`, 0 if there is none
+static size_t nobuild__extension_dot(String_View basename)
+{
+    for (size_t i = basename.count; i > 1; --i) {
+        if (basename.data[i - 1] == '.') {
+            return i - 1;
+        }
+    }
+    return 0;
+}
+
+String_View path_no_ext_sv(Cstr path)
+{
+    String_View basename = path_basename_sv(path);
+    size_t dot = nobuild__extension_dot(basename);
+    if (dot == 0) {
+        return sv_from_cstr(path);
+    }
+    return sv_from_parts(path, (size_t) (basename.data + dot - path));
+}
+
+String_View path_dirname_sv(Cstr path)
+{
+    char path_sep = *PATH_SEP;
+    size_t prefix_len = 0;
+
+    // Get length of directory prefix
+    for (size_t i = 1; path[i - 1] != '\0' && path[i] != '\0'; ++i) {
+        if (path[i] != path_sep && path[i-1] == path_sep) {
+            prefix_len = i;
+        }
+    }
+
+    if (prefix_len == 0) {
+        return sv_from_cstr(*path == path_sep ? PATH_SEP : ".");
+    }
+
+    // Strip trailing slashes
+    while (prefix_len > 1 && path[prefix_len-1] == path_sep) {
+        --prefix_len;
+    }
+
+    return sv_from_parts(path, prefix_len);
+}
+
+String_View path_basename_sv(Cstr path)
+{
+    char path_sep = *PATH_SEP;
+    Cstr last_sep = strrchr(path, path_sep);
+    if (last_sep == NULL) {
+        return sv_from_cstr(path);
+    }
+
+    // Last character is not a separator
+    if (*(last_sep + 1) != '\0') {
+        return sv_from_cstr(last_sep + 1);
+    }
+
+    // Skip consecutive seprators
+    while (last_sep > path && *(last_sep - 1) == path_sep) {
+        --last_sep;
+    }
+
+    if (last_sep == path) {
+        return sv_from_cstr(PATH_SEP);
+    }
+
+    // Find the start of the basename
+    Cstr start = last_sep;
+    while (start > path && *(start - 1) != path_sep) {
+        --start;
+    }
+    assert(last_sep >= start && "last_sep must never be less than start");
+
+    return sv_from_parts(start, (size_t)(last_sep - start));
+}
+
+String_View path_extension_sv(Cstr path)
+{
+    String_View basename = path_basename_sv(path);
+    size_t dot = nobuild__extension_dot(basename);
+    if (dot == 0) {
+        return sv_from_parts(basename.data + basename.count, 0);
+    }
+    return sv_from_parts(basename.data + dot + 1, basename.count - dot - 1);
+}
+
+String_View path_stem_sv(Cstr path)
+{
+    String_View basename = path_basename_sv(path);
+    size_t dot = nobuild__extension_dot(basename);
+    return dot == 0 ? basename : sv_from_parts(basename.data, dot);
+}
+
+int path_next_component(Cstr path, String_View *component)
+{
+    char path_sep = *PATH_SEP;
+    Cstr start = component->data == NULL ? path : component->data + component->count;
+
+    // Keep the root as its own component
+    if (component->data == NULL && *start == path_sep) {
+        *component = sv_from_parts(start, 1);
+        return 1;
+    }
+
+    while (*start == path_sep) {
+        ++start;
+    }
+    if (*start == '\0') {
+        return 0;
+    }
+
+    Cstr end = start;
+    while (*end != '\0' && *end != path_sep) {
+        ++end;
+    }
+
+    *component = sv_from_parts(start, (size_t) (end - start));
+    return 1;
+}
+
+Cstr path_no_ext(Cstr path)
+{
+    return sv_to_cstr(path_no_ext_sv(path));
+}
+
+Cstr path_dirname(Cstr path)
+{
+    return sv_to_cstr(path_dirname_sv(path));
+}
+
+Cstr path_basename(Cstr path)
+{
+    return sv_to_cstr(path_basename_sv(path));
+}
+
+int path_is_dir(Cstr path)
+{
+#ifndef _WIN32
+    struct stat statbuf = {0};
+    if (stat(path, &statbuf) < 0) {
+        if (errno == ENOENT) {
+            errno = 0;
+            return 0;
+        }
+
+        PANIC("could not retrieve information about file %s: %s",
+              path, nobuild__strerror(errno));
+    }
+
+    return S_ISDIR(statbuf.st_mode);
+#else
+    DWORD dwAttrib = GetFileAttributes(path);
+
+    return (dwAttrib != INVALID_FILE_ATTRIBUTES &&
+            (dwAttrib & FILE_ATTRIBUTE_DIRECTORY));
+#endif // _WIN32
+}
+
+int path_is_file(Cstr path)
+{
+#ifndef _WIN32
+    struct stat statbuf = {0};
+    if (stat(path, &statbuf) < 0) {
+        if (errno == ENOENT) {
+            errno = 0;
+            return 0;
+        }
+
+        PANIC("Could not retrieve information about file %s: %s",
+              path, nobuild__strerror(errno));
+    }
+
+    return S_ISREG(statbuf.st_mode);
+#else
+    DWORD dwAttrib = GetFileAttributes(path);
+    return (dwAttrib != INVALID_FILE_ATTRIBUTES &&
+            !(dwAttrib & FILE_ATTRIBUTE_DIRECTORY));
+#endif // _WIN32
+}
+
+int path_exists(Cstr path)
+{
+#ifndef _WIN32
+    struct stat statbuf = {0};
+    if (stat(path, &statbuf) < 0) {
+        if (errno == ENOENT) {
+            errno = 0;
+            return 0;
+        }
+
+        PANIC("could not retrieve information about file %s: %s",
+              path, nobuild__strerror(errno));
+    }
+
+    return 1;
+#else
+    DWORD dwAttrib = GetFileAttributes(path);
+    return (dwAttrib != INVALID_FILE_ATTRIBUTES);
+#endif
+}
+
+int is_path1_modified_after_path2(Cstr path1, Cstr path2)
+{
+    WARN("This function is deprecated. Use `path_is_newer()` instead.");
+    return path_is_newer(path1, path2);
+}
+
+long long nobuild__get_modification_time(Cstr path) {
+    if (IS_DIR(path)) {
+        long long mod_time = -1;
+        FOREACH_FILE_IN_DIR(file, path, {
+            if (strcmp(file, ".") == 0 || strcmp(file, "..") == 0) {
+                continue;
+            }
+
+            long long path_mod_time = nobuild__get_modification_time(PATH(path, file));
+            mod_time = path_mod_time > mod_time ? path_mod_time : mod_time;
+        });
+        return mod_time;
+    } else {
+#ifndef _WIN32
+        struct stat statbuf = {0};
+
+        if (stat(path, &statbuf) < 0) {
+            PANIC("Could not stat %s: %s\n", path, nobuild__strerror(errno));
+        }
+#if defined(UTIME_NOW)
+#	ifdef __APPLE__
+        return (long long) statbuf.st_mtimespec.tv_sec * 1000000000LL + statbuf.st_mtimespec.tv_nsec;
+#	else
+        return (long long) statbuf.st_mtim.tv_sec * 1000000000LL + statbuf.st_mtim.tv_nsec;
+#	endif
+#else
+        return (long long) statbuf.st_mtime * 1000000000LL;
+#endif
+#else
+        FILETIME path_time;
+        Fd path_fd = fd_open_for_read(path);
+        if (!GetFileTime(path_fd, NULL, NULL, &path_time)) {
+            PANIC("could not get time of %s: %s", path, nobuild__GetLastErrorAsString());
+        }
+        fd_close(path_fd);
+        return ((long long) path_time.dwHighDateTime) << 32 | path_time.dwLowDateTime;
+#endif
+    }
+}
+
+static long long nobuild__restat_mtime(Cstr path, long long mtime);
+
+// Returns 1 and fills `st` if `path` exists, 0 otherwise
+int nobuild__stat(Cstr path, Nobuild__Stat *st)
+{
+    memset(st, 0, sizeof *st);
+
+#ifndef _WIN32
+    struct stat statbuf = {0};
+    if (stat(path, &statbuf) < 0) {
+        if (errno == ENOENT || errno == ENOTDIR) {
+            errno = 0;
+            return 0;
+        }
+
+        PANIC("Could not stat %s: %s", path, nobuild__strerror(errno));
+    }
+
+    st->exists = 1;
+    st->is_dir = S_ISDIR(statbuf.st_mode);
+    st->size = (unsigned long long) statbuf.st_size;
+#if defined(UTIME_NOW)
+#	ifdef __APPLE__
+    st->mtime = (long long) statbuf.st_mtimespec.tv_sec * 1000000000LL + statbuf.st_mtimespec.tv_nsec;
+#	else
+    st->mtime = (long long) statbuf.st_mtim.tv_sec * 1000000000LL + statbuf.st_mtim.tv_nsec;
+#	endif
+#else
+    st->mtime = (long long) statbuf.st_mtime * 1000000000LL;
+#endif
+#else
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesEx(path, GetFileExInfoStandard, &data)) {
+        DWORD error = GetLastError();
+        if (error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND) {
+            return 0;
+        }
+
+        PANIC("Could not stat %s: %s", path, nobuild__GetLastErrorAsString());
+    }
+
+    st->exists = 1;
+    st->is_dir = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    st->size = ((unsigned long long) data.nFileSizeHigh) << 32 | data.nFileSizeLow;
+    st->mtime = ((long long) data.ftLastWriteTime.dwHighDateTime) << 32 | data.ftLastWriteTime.dwLowDateTime;
+#endif // _WIN32
+
+    return 1;
+}
+
+int path_is_newer(Cstr path1, Cstr path2)
+{
+    // Warn the user that the path is missing
+    if (!PATH_EXISTS(path1)) {
+        WARN("File %s does not exist", path2);
+        return 0;
+    }
+
+    if (!PATH_EXISTS(path2)) {
+        return 1;
+    }
+
+    const long long mtime1 = nobuild__restat_mtime(path1, nobuild__get_modification_time(path1));
+    return mtime1 > nobuild__get_modification_time(path2);
+}
+
+// Process wide set of directories that are known to exist, so creating the
+// output directories of thousands of files does not hit the filesystem again
+static Cstr_Set nobuild__dir_cache = {0};
+static Nobuild__Mutex nobuild__dir_cache_lock = NOBUILD__MUTEX_INIT;
+
+static int nobuild__dir_cache_contains(Cstr path)
+{
+    nobuild__mutex_lock(&nobuild__dir_cache_lock);
+    int found = cstr_set_contains(&nobuild__dir_cache, path);
+    nobuild__mutex_unlock(&nobuild__dir_cache_lock);
+    return found;
+}
+
+static void nobuild__dir_cache_add(Cstr path)
+{
+    nobuild__mutex_lock(&nobuild__dir_cache_lock);
+    if (!cstr_set_contains(&nobuild__dir_cache, path)) {
+        size_t len = strlen(path);
+        char *key = malloc(len + 1);
+        if (key == NULL) {
+            PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+        }
+        cstr_set_add(&nobuild__dir_cache, memcpy(key, path, len + 1));
+    }
+    nobuild__mutex_unlock(&nobuild__dir_cache_lock);
+}
+
+// Forget every cached directory. Called whenever nobuild removes or renames
+// something, since that could have been one of the cached directories.
+static void nobuild__dir_cache_clear(void)
+{
+    nobuild__mutex_lock(&nobuild__dir_cache_lock);
+    for (size_t i = 0; i < nobuild__dir_cache.capacity; ++i) {
+        if (nobuild__dir_cache.entries[i].hash != 0) {
+            free((char *) nobuild__dir_cache.entries[i].key);
+        }
+    }
+    cstr_set_clear(&nobuild__dir_cache);
+    nobuild__mutex_unlock(&nobuild__dir_cache_lock);
+}
+
+int nobuild__is_path_sep(char c)
+{
+#ifndef _WIN32
+    return c == '/';
+#else
+    return c == '\\' || c == '/';
+#endif
+}
+
+Cstr path_normalize(Cstr path)
+{
+    const size_t len = strlen(path);
+
+    // Most paths are short enough to be normalized on the stack before they
+    // are interned
+    char buffer[256];
+    char *result = len + 2 <= sizeof(buffer) ? buffer : malloc(len + 2);
+    if (result == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+
+    // `root` is the prefix that `..` can not go above
+    size_t count = 0;
+    size_t root = 0;
+    Cstr p = path;
+#ifdef _WIN32
+    if (((p[0] >= 'a' && p[0] <= 'z') || (p[0] >= 'A' && p[0] <= 'Z')) && p[1] == ':') {
+        result[count++] = *p++;
+        result[count++] = *p++;
+        root = count;
+    }
+#endif
+    if (nobuild__is_path_sep(*p)) {
+        result[count++] = *PATH_SEP;
+        root = count;
+    }
+
+    while (*p != '\0') {
+        while (nobuild__is_path_sep(*p)) {
+            ++p;
+        }
+        if (*p == '\0') {
+            break;
+        }
+
+        Cstr start = p;
+        while (*p != '\0' && !nobuild__is_path_sep(*p)) {
+            ++p;
+        }
+        const size_t comp_len = (size_t) (p - start);
+
+        if (comp_len == 1 && start[0] == '.') {
+            continue;
+        }
+
+        if (comp_len == 2 && start[0] == '.' && start[1] == '.') {
+            size_t last = count;
+            while (last > root && !nobuild__is_path_sep(result[last - 1])) {
+                --last;
+            }
+
+            const int last_is_dotdot = count - last == 2 && result[last] == '.' && result[last + 1] == '.';
+            if (count > root && !last_is_dotdot) {
+                // Drop the previous component and the separator in front of it
+                count = last > root ? last - 1 : last;
+                continue;
+            }
+            if (count == root && root > 0) {
+                // There is nothing above the root
+                continue;
+            }
+        }
+
+        if (count > root) {
+            result[count++] = *PATH_SEP;
+        }
+        memcpy(result + count, start, comp_len);
+        count += comp_len;
+    }
+
+    if (count == 0) {
+        result[count++] = '.';
+    }
+
+    Cstr interned = cstr_intern_n(result, count);
+    if (result != buffer) {
+        free(result);
+    }
+    return interned;
+}
+
+// `path_realpath()` results for the rest of the run, keyed by normalized path
+static Cstr_Map nobuild__realpath_cache = {0};
+static Nobuild__Mutex nobuild__realpath_cache_lock = NOBUILD__MUTEX_INIT;
+
+Cstr path_realpath(Cstr path)
+{
+    Cstr normalized = path_normalize(path);
+
+    nobuild__mutex_lock(&nobuild__realpath_cache_lock);
+    Cstr cached = cstr_map_get(&nobuild__realpath_cache, normalized);
+    nobuild__mutex_unlock(&nobuild__realpath_cache_lock);
+    if (cached != NULL) {
+        return cached;
+    }
+
+#ifndef _WIN32
+    char *resolved = realpath(normalized, NULL);
+#else
+    char *resolved = _fullpath(NULL, normalized, 0);
+#endif
+    Cstr result = resolved != NULL ? path_normalize(resolved) : normalized;
+    free(resolved);
+
+    nobuild__mutex_lock(&nobuild__realpath_cache_lock);
+    cstr_map_put(&nobuild__realpath_cache, normalized, (void *) result);
+    nobuild__mutex_unlock(&nobuild__realpath_cache_lock);
+
+    return result;
+}
+
+void path_realpath_cache_clear(void)
+{
+    nobuild__mutex_lock(&nobuild__realpath_cache_lock);
+    cstr_map_clear(&nobuild__realpath_cache);
+    nobuild__mutex_unlock(&nobuild__realpath_cache_lock);
+}
+
+// Forget the resolved path of `path`, it is about to be replaced
+static void nobuild__realpath_cache_evict(Cstr path)
+{
+    path = path_normalize(path);
+
+    nobuild__mutex_lock(&nobuild__realpath_cache_lock);
+    cstr_map_remove(&nobuild__realpath_cache, path);
+    nobuild__mutex_unlock(&nobuild__realpath_cache_lock);
+}
+
+// Create `path` and its missing parents. `path` is modified temporarily while
+// walking up, so it must be writable.
+static void nobuild__mkdirs(char *path)
+{
+    if (*path == '\0' || nobuild__dir_cache_contains(path)) {
+        return;
+    }
+
+    // Most of the time the parent already exists, so try the full path first
+    // and only walk up when the kernel tells us that a parent is missing
+    if (nobuild__mkdir(path, 0755) < 0) {
+        if (errno == ENOENT) {
+            size_t len = strlen(path);
+            while (len > 1 && nobuild__is_path_sep(path[len - 1])) {
+                len -= 1;
+            }
+            while (len > 0 && !nobuild__is_path_sep(path[len - 1])) {
+                len -= 1;
+            }
+            while (len > 1 && nobuild__is_path_sep(path[len - 1])) {
+                len -= 1;
+            }
+
+            if (len > 0) {
+                char sep = path[len];
+                path[len] = '\0';
+                nobuild__mkdirs(path);
+                path[len] = sep;
+            }
+
+            errno = 0;
+            if (nobuild__mkdir(path, 0755) < 0 && errno != EEXIST) {
+                PANIC("could not create directory %s: %s", path, nobuild__strerror(errno));
+            }
+        } else if (errno != EEXIST) {
+            PANIC("could not create directory %s: %s", path, nobuild__strerror(errno));
+        } else if (!path_is_dir(path)) {
+            PANIC("could not create directory %s: %s", path, nobuild__strerror(ENOTDIR));
+        }
+        errno = 0;
+    }
+
+    nobuild__dir_cache_add(path);
+}
+
+void path_mkdirs(Cstr_Array path)
+{
+    if (path.count == 0) {
+        return;
+    }
+
+    size_t len = 0;
+    for (size_t i = 0; i < path.count; ++i) {
+        len += strlen(path.elems[i]);
+    }
+
+    size_t seps_count = path.count - 1;
+    const size_t sep_len = strlen(PATH_SEP);
+
+    char *result = malloc(len + seps_count * sep_len + 1);
+    if (result == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+
+    len = 0;
+    for (size_t i = 0; i < path.count; ++i) {
+        size_t n = strlen(path.elems[i]);
+        memcpy(result + len, path.elems[i], n);
+        len += n;
+
+        if (i + 1 < path.count) {
+            memcpy(result + len, PATH_SEP, sep_len);
+            len += sep_len;
+        }
+    }
+    result[len] = '\0';
+
+    nobuild__mkdirs(result);
+    free(result);
+}
+
+void path_mkdirs_parent(Cstr path)
+{
+    size_t len = strlen(path);
+    while (len > 0 && !nobuild__is_path_sep(path[len - 1])) {
+        len -= 1;
+    }
+
+    if (len == 0) {
+        // The parent is the current directory
+        return;
+    }
+
+    char *parent = malloc(len + 1);
+    if (parent == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+    memcpy(parent, path, len);
+    parent[len] = '\0';
+
+    nobuild__mkdirs(parent);
+    free(parent);
+}
+
+// Stats of the paths looked at by `path_needs_rebuild()` for the rest of the
+// run, so a header included by every object of the project is stat'ed once
+static Cstr_Map nobuild__stat_cache = {0};
+static Nobuild__Mutex nobuild__stat_cache_lock = NOBUILD__MUTEX_INIT;
+
+// Like `nobuild__stat()` but goes through the cache. Directories get the
+// modification time of the most recently modified file inside of them,
+// same as `path_is_newer()`.
+static Nobuild__Stat nobuild__stat_cached(Cstr path)
+{
+    // Key by the normalized path, so `./src/a.c` and `src/a.c` share the entry
+    path = path_normalize(path);
+
+    nobuild__mutex_lock(&nobuild__stat_cache_lock);
+    Nobuild__Stat *cached = cstr_map_get(&nobuild__stat_cache, path);
+    if (cached != NULL) {
+        Nobuild__Stat st = *cached;
+        nobuild__mutex_unlock(&nobuild__stat_cache_lock);
+        return st;
+    }
+    nobuild__mutex_unlock(&nobuild__stat_cache_lock);
+
+    Nobuild__Stat st;
+    nobuild__stat(path, &st);
+    if (st.is_dir) {
+        st.mtime = -1;
+        FOREACH_FILE_IN_DIR(file, path, {
+            if (strcmp(file, ".") == 0 || strcmp(file, "..") == 0) {
+                continue;
+            }
+
+            Nobuild__Stat child = nobuild__stat_cached(PATH(path, file));
+            st.mtime = child.mtime > st.mtime ? child.mtime : st.mtime;
+        });
+    }
+
+    nobuild__mutex_lock(&nobuild__stat_cache_lock);
+    Cstr_Map_Entry *entry = cstr_map_find(&nobuild__stat_cache, path);
+    if (entry != NULL) {
+        *(Nobuild__Stat *) entry->value = st;
+    } else {
+        Nobuild__Stat *value = malloc(sizeof *value);
+        if (value == NULL) {
+            PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+        }
+        *value = st;
+        cstr_map_put(&nobuild__stat_cache, path, value);
+    }
+    nobuild__mutex_unlock(&nobuild__stat_cache_lock);
+
+    return st;
+}
+
+// Forget the cached stat of `path`, it is about to change
+static void nobuild__stat_cache_evict(Cstr path)
+{
+    path = path_normalize(path);
+
+    nobuild__mutex_lock(&nobuild__stat_cache_lock);
+    free(cstr_map_remove(&nobuild__stat_cache, path));
+    nobuild__mutex_unlock(&nobuild__stat_cache_lock);
+}
+
+void path_stat_cache_clear(void)
+{
+    nobuild__mutex_lock(&nobuild__stat_cache_lock);
+    for (size_t i = 0; i < nobuild__stat_cache.capacity; ++i) {
+        if (nobuild__stat_cache.entries[i].hash != 0) {
+            free(nobuild__stat_cache.entries[i].value);
+        }
+    }
+    cstr_map_clear(&nobuild__stat_cache);
+    nobuild__mutex_unlock(&nobuild__stat_cache_lock);
+}
+
+#ifdef NOBUILD_IO_URING
+// Stat every path of `outputs` and `inputs` missing from the cache in a single
+// batch, so a rebuild check over thousands of inputs costs a handful of
+// io_uring submissions instead of one syscall per file. Directories are left
+// to `nobuild__stat_cached()`, which walks them.
+static void nobuild__stat_cache_prefetch(Cstr_Array outputs, Cstr_Array inputs)
+{
+    Fd_Batch batch = {0};
+    nobuild__mutex_lock(&nobuild__stat_cache_lock);
+    for (size_t i = 0; i < outputs.count + inputs.count; ++i) {
+        Cstr path = path_normalize(i < outputs.count ? outputs.elems[i] : inputs.elems[i - outputs.count]);
+        if (cstr_map_get(&nobuild__stat_cache, path) == NULL) {
+            fd_batch_stat(&batch, path);
+        }
+    }
+    nobuild__mutex_unlock(&nobuild__stat_cache_lock);
+
+    fd_batch_submit(&batch);
+
+    nobuild__mutex_lock(&nobuild__stat_cache_lock);
+    for (size_t i = 0; i < batch.count; ++i) {
+        Fd_Batch_Op *op = &batch.elems[i];
+        if (op->is_dir || (op->error != 0 && op->error != ENOENT && op->error != ENOTDIR)) {
+            continue;
+        }
+        if (cstr_map_get(&nobuild__stat_cache, op->path) != NULL) {
+            continue;
+        }
+
+        Nobuild__Stat *value = malloc(sizeof *value);
+        if (value == NULL) {
+            PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+        }
+        value->exists = op->error == 0;
+        value->is_dir = 0;
+        value->size = op->error == 0 ? op->file_size : 0;
+        value->mtime = op->error == 0 ? op->mtime : 0;
+        cstr_map_put(&nobuild__stat_cache, op->path, value);
+    }
+    nobuild__mutex_unlock(&nobuild__stat_cache_lock);
+
+    ARRAY_FREE(&batch);
+}
+#endif // NOBUILD_IO_URING
+
+int path_needs_rebuild(Cstr_Array outputs, Cstr_Array inputs)
+{
+    long long oldest_output = 0;
+    int rebuild = outputs.count == 0;
+
+#ifdef NOBUILD_IO_URING
+    nobuild__stat_cache_prefetch(outputs, inputs);
+#endif
+
+    for (size_t i = 0; i < outputs.count && !rebuild; ++i) {
+        Nobuild__Stat st = nobuild__stat_cached(outputs.elems[i]);
+        if (!st.exists) {
+            rebuild = 1;
+        } else if (i == 0 || st.mtime < oldest_output) {
+            oldest_output = st.mtime;
+        }
+    }
+
+    for (size_t i = 0; i < inputs.count && !rebuild; ++i) {
+        Nobuild__Stat st = nobuild__stat_cached(inputs.elems[i]);
+        if (!st.exists) {
+            WARN("File %s does not exist", inputs.elems[i]);
+            continue;
+        }
+
+        rebuild = nobuild__restat_mtime(inputs.elems[i], st.mtime) > oldest_output;
+    }
+
+    if (rebuild) {
+        // The caller is going to regenerate the outputs, so their stats are stale now
+        for (size_t i = 0; i < outputs.count; ++i) {
+            nobuild__stat_cache_evict(outputs.elems[i]);
+        }
+    }
+
+    return rebuild;
+}
+
+typedef struct {
+    // Modification time of the file when it was hashed
+    long long mtime;
+    // Modification time of the last restat that saw different contents
+    long long changed_mtime;
+    unsigned long long hash;
+} Nobuild__Restat;
+
+// Contents of `NOBUILD_RESTAT_LOG`, keyed by normalized path, loaded on first use
+static Cstr_Map nobuild__restat_log = {0};
+static int nobuild__restat_log_loaded = 0;
+static Nobuild__Mutex nobuild__restat_lock = NOBUILD__MUTEX_INIT;
+
+// One line per output: `<mtime> <changed_mtime> <hash> <path>`
+static void nobuild__restat_log_load(void)
+{
+    nobuild__restat_log_loaded = 1;
+    if (!PATH_EXISTS(NOBUILD_RESTAT_LOG)) {
+        return;
+    }
+
+    char *log = read_entire_file(NOBUILD_RESTAT_LOG, NULL);
+    if (log == NULL) {
+        return;
+    }
+
+    char *line = log;
+    while (*line != '\0') {
+        char *end = strchr(line, '\n');
+        if (end == NULL) {
+            break;
+        }
+        *end = '\0';
+
+        Nobuild__Restat entry;
+        int path_start = 0;
+        if (sscanf(line, "%lld %lld %llx %n", &entry.mtime, &entry.changed_mtime, &entry.hash, &path_start) == 3
+                && path_start > 0 && line[path_start] != '\0') {
+            Nobuild__Restat *value = malloc(sizeof(*value));
+            if (value == NULL) {
+                PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+            }
+            *value = entry;
+            free(cstr_map_put(&nobuild__restat_log, path_normalize(line + path_start), value));
+        }
+        line = end + 1;
+    }
+
+    free(log);
+}
+
+static void nobuild__restat_log_save(void)
+{
+    String_Builder sb = {0};
+    for (size_t i = 0; i < nobuild__restat_log.capacity; ++i) {
+        const Cstr_Map_Entry *e = &nobuild__restat_log.entries[i];
+        if (e->hash != 0) {
+            const Nobuild__Restat *entry = e->value;
+            sb_appendf(&sb, "%lld %lld %llx %s\n", entry->mtime, entry->changed_mtime, entry->hash, e->key);
+        }
+    }
+
+    path_write_if_changed(NOBUILD_RESTAT_LOG, sb.elems, sb.count);
+    ARRAY_FREE(&sb);
+}
+
+// The modification time dependents should see for `path`: the time its
+// contents last changed, if `path_restat()` knows the file as it is now
+static long long nobuild__restat_mtime(Cstr path, long long mtime)
+{
+    path = path_normalize(path);
+
+    nobuild__mutex_lock(&nobuild__restat_lock);
+    if (!nobuild__restat_log_loaded) {
+        nobuild__restat_log_load();
+    }
+    const Nobuild__Restat *entry = cstr_map_get(&nobuild__restat_log, path);
+    if (entry != NULL && entry->mtime == mtime) {
+        mtime = entry->changed_mtime;
+    }
+    nobuild__mutex_unlock(&nobuild__restat_lock);
+
+    return mtime;
+}
+
+void path_restat(Cstr_Array outputs)
+{
+    nobuild__mutex_lock(&nobuild__restat_lock);
+    if (!nobuild__restat_log_loaded) {
+        nobuild__restat_log_load();
+    }
+
+    for (size_t i = 0; i < outputs.count; ++i) {
+        Cstr path = path_normalize(outputs.elems[i]);
+        nobuild__stat_cache_evict(path);
+
+        Nobuild__Stat st;
+        File_Map contents = {0};
+        if (!nobuild__stat(path, &st) || st.is_dir || (contents = file_map(path)).data == NULL) {
+            WARN("Could not restat %s, it is not a file", path);
+            free(cstr_map_remove(&nobuild__restat_log, path));
+            continue;
+        }
+        const unsigned long long hash = cstr_hash_n(contents.data, contents.size);
+        file_unmap(&contents);
+
+        Nobuild__Restat *entry = cstr_map_get(&nobuild__restat_log, path);
+        if (entry == NULL) {
+            entry = malloc(sizeof(*entry));
+            if (entry == NULL) {
+                PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+            }
+            entry->hash = ~hash;
+            cstr_map_put(&nobuild__restat_log, path, entry);
+        }
+
+        if (entry->hash != hash) {
+            entry->hash = hash;
+            entry->changed_mtime = st.mtime;
+        }
+        entry->mtime = st.mtime;
+    }
+
+    nobuild__restat_log_save();
+    nobuild__mutex_unlock(&nobuild__restat_lock);
+}
+
+typedef struct {
+    long long mtime;
+    unsigned long long size;
+    unsigned long long hash;
+    // `#include` targets of the file, interned and prefixed with `"` or `<`
+    const Cstr_Array *directives;
+} Nobuild__Include_File;
+
+// Directives of every file scanned so far, by path and by content hash, so a
+// file is only scanned again when its contents change and copies of the same
+// file are scanned once. Loaded from `NOBUILD_INCLUDE_LOG` on first use.
+static Cstr_Map nobuild__include_files = {0};
+static Cstr_Map nobuild__include_contents = {0};
+static int nobuild__include_log_loaded = 0;
+// Size of `NOBUILD_INCLUDE_LOG`, where the records of `nobuild__include_pending` go
+static unsigned long long nobuild__include_log_size = 0;
+static String_Builder nobuild__include_pending = {0};
+static Nobuild__Mutex nobuild__include_lock = NOBUILD__MUTEX_INIT;
+
+// Appends the record of `path` to `sb`: `<mtime> <size> <hash> <count> <path>`
+// followed by `count` lines with one directive each
+static void nobuild__include_record(String_Builder *sb, Cstr path, const Nobuild__Include_File *file)
+{
+    sb_appendf(sb, "%lld %llu %llx %zu %s\n", file->mtime, file->size, file->hash, file->directives->count, path);
+    for (size_t i = 0; i < file->directives->count; ++i) {
+        sb_append_cstr(sb, file->directives->elems[i]);
+        ARRAY_APPEND(sb, '\n');
+    }
+}
+
+// Records `file` as the entry of `path`, sharing the directives of files with
+// the same contents. Takes ownership of `directives`, which may be NULL when
+// the contents are already known.
+static const Cstr_Array *nobuild__include_put(Cstr path, Nobuild__Include_File file, Cstr_Array *directives)
+{
+    char key[2 * sizeof(unsigned long long) + 1];
+    snprintf(key, sizeof(key), "%016llx", file.hash);
+
+    const Cstr_Array *shared = cstr_map_get(&nobuild__include_contents, key);
+    if (shared == NULL) {
+        cstr_map_put(&nobuild__include_contents, cstr_intern(key), directives);
+        shared = directives;
+    } else if (directives != NULL) {
+        ARRAY_FREE(directives);
+        free(directives);
+    }
+
+    Nobuild__Include_File *entry = cstr_map_get(&nobuild__include_files, path);
+    if (entry == NULL) {
+        entry = malloc(sizeof(*entry));
+        if (entry == NULL) {
+            PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+        }
+        cstr_map_put(&nobuild__include_files, path, entry);
+    }
+    *entry = file;
+    entry->directives = shared;
+    return shared;
+}
+
+// Records are only ever appended, later ones replace earlier ones of the
+// same path. The log is rewritten without the replaced records once they
+// outnumber the others.
+static void nobuild__include_log_load(void)
+{
+    nobuild__include_log_loaded = 1;
+    if (!PATH_EXISTS(NOBUILD_INCLUDE_LOG)) {
+        return;
+    }
+
+    size_t size = 0;
+    char *log = read_entire_file(NOBUILD_INCLUDE_LOG, &size);
+    if (log == NULL) {
+        return;
+    }
+
+    size_t records = 0;
+    char *line = log;
+    char *end;
+    while ((end = strchr(line, '\n')) != NULL) {
+        *end = '\0';
+
+        Nobuild__Include_File file = {0};
+        size_t count = 0;
+        int path_start = 0;
+        if (sscanf(line, "%lld %llu %llx %zu %n", &file.mtime, &file.size, &file.hash, &count, &path_start) != 4
+                || path_start <= 0 || line[path_start] == '\0') {
+            break;
+        }
+        Cstr path = path_normalize(line + path_start);
+
+        Cstr_Array *directives = malloc(sizeof(*directives));
+        if (directives == NULL) {
+            PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+        }
+        memset(directives, 0, sizeof(*directives));
+        line = end + 1;
+        while (directives->count < count && (end = strchr(line, '\n')) != NULL) {
+            ARRAY_APPEND(directives, cstr_intern_n(line, (size_t) (end - line)));
+            line = end + 1;
+        }
+
+        // A record cut short by an interrupted run ends the log
+        if (directives->count < count) {
+            ARRAY_FREE(directives);
+            free(directives);
+            break;
+        }
+        nobuild__include_put(path, file, directives);
+        records += 1;
+    }
+    const int truncated = line != log + size;
+    free(log);
+
+    if (records > 2 * nobuild__include_files.count || truncated) {
+        String_Builder sb = {0};
+        for (size_t i = 0; i < nobuild__include_files.capacity; ++i) {
+            const Cstr_Map_Entry *e = &nobuild__include_files.entries[i];
+            if (e->hash != 0) {
+                nobuild__include_record(&sb, e->key, e->value);
+            }
+        }
+        path_write_if_changed(NOBUILD_INCLUDE_LOG, sb.elems, sb.count);
+        nobuild__include_log_size = sb.count;
+        ARRAY_FREE(&sb);
+    } else {
+        nobuild__include_log_size = size;
+    }
+}
+
+// Appends the records of the files scanned since the last call to the log
+static void nobuild__include_log_flush(void)
+{
+    nobuild__mutex_lock(&nobuild__include_lock);
+    if (nobuild__include_pending.count > 0) {
+        Fd fd = fd_open_for_update(NOBUILD_INCLUDE_LOG);
+        if (fd_pwrite_all(fd, nobuild__include_pending.elems, nobuild__include_pending.count, nobuild__include_log_size)) {
+            nobuild__include_log_size += nobuild__include_pending.count;
+        } else {
+            ERRO("Could not write %s", NOBUILD_INCLUDE_LOG);
+        }
+        fd_close(fd);
+        nobuild__include_pending.count = 0;
+    }
+    nobuild__mutex_unlock(&nobuild__include_lock);
+}
+
+static int nobuild__is_blank(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+// Finds the `#include` lines of `data`. Jumps from `#` to `#` with memchr(),
+// which is vectorized by the C library, and only looks closer at the ones that
+// start a line. Comments and conditionals are not interpreted, so the result
+// is a superset of what the compiler would include.
+static Cstr_Array *nobuild__scan_directives(const char *data, size_t size)
+{
+    Cstr_Array *directives = malloc(sizeof(*directives));
+    if (directives == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+    memset(directives, 0, sizeof(*directives));
+
+    const char *const end = data + size;
+    const char *hash = data;
+    while ((hash = memchr(hash, '#', (size_t) (end - hash))) != NULL) {
+        const char *line = hash;
+        while (line > data && nobuild__is_blank(line[-1])) {
+            line -= 1;
+        }
+
+        const char *p = hash + 1;
+        hash = p;
+        if (line > data && line[-1] != '\n') {
+            continue;
+        }
+
+        while (p < end && nobuild__is_blank(*p)) {
+            p += 1;
+        }
+        if ((size_t) (end - p) < 7 || memcmp(p, "include", 7) != 0) {
+            continue;
+        }
+        p += 7;
+        while (p < end && nobuild__is_blank(*p)) {
+            p += 1;
+        }
+        if (p == end || (*p != '"' && *p != '<')) {
+            continue;
+        }
+
+        const char close = *p == '"' ? '"' : '>';
+        const char *name = p + 1;
+        const char *name_end = name;
+        while (name_end < end && *name_end != close && *name_end != '\n') {
+            name_end += 1;
+        }
+        if (name_end == end || *name_end != close || name_end == name) {
+            continue;
+        }
+
+        // Keep the opening character, it tells where to look for the file
+        ARRAY_APPEND(directives, cstr_intern_n(p, (size_t) (name_end - p)));
+        hash = name_end;
+    }
+
+    return directives;
+}
+
+static const Cstr_Array *nobuild__include_directives(Cstr path)
+{
+    Nobuild__Stat st = nobuild__stat_cached(path);
+    if (!st.exists || st.is_dir) {
+        return NULL;
+    }
+
+    nobuild__mutex_lock(&nobuild__include_lock);
+    if (!nobuild__include_log_loaded) {
+        nobuild__include_log_load();
+    }
+    Nobuild__Include_File *cached = cstr_map_get(&nobuild__include_files, path);
+    if (cached != NULL && cached->mtime == st.mtime && cached->size == st.size) {
+        const Cstr_Array *directives = cached->directives;
+        nobuild__mutex_unlock(&nobuild__include_lock);
+        return directives;
+    }
+    nobuild__mutex_unlock(&nobuild__include_lock);
+
+    File_Map contents = file_map(path);
+    if (contents.data == NULL) {
+        return NULL;
+    }
+
+    Nobuild__Include_File file = {
+        .mtime = st.mtime,
+        .size = st.size,
+        .hash = (unsigned long long) cstr_hash_n(contents.data, contents.size),
+    };
+    char key[2 * sizeof(unsigned long long) + 1];
+    snprintf(key, sizeof(key), "%016llx", file.hash);
+
+    nobuild__mutex_lock(&nobuild__include_lock);
+    const int known = cstr_map_get(&nobuild__include_contents, key) != NULL;
+    nobuild__mutex_unlock(&nobuild__include_lock);
+    Cstr_Array *scanned = known ? NULL : nobuild__scan_directives(contents.data, contents.size);
+    file_unmap(&contents);
+
+    nobuild__mutex_lock(&nobuild__include_lock);
+    const Cstr_Array *directives = nobuild__include_put(path, file, scanned);
+    nobuild__include_record(&nobuild__include_pending, path, cstr_map_get(&nobuild__include_files, path));
+    nobuild__mutex_unlock(&nobuild__include_lock);
+
+    return directives;
+}
+
+// Normalized `dir/name` if it is a file, NULL otherwise
+static Cstr nobuild__include_candidate(String_Builder *sb, String_View dir, const char *name)
+{
+    sb->count = 0;
+    if (dir.count > 0) {
+        sb_append_sv(sb, dir);
+        sb_append_cstr(sb, PATH_SEP);
+    }
+    sb_append_cstr(sb, name);
+    ARRAY_APPEND(sb, '\0');
+
+    Cstr candidate = path_normalize(sb->elems);
+    Nobuild__Stat st = nobuild__stat_cached(candidate);
+    return st.exists && !st.is_dir ? candidate : NULL;
+}
+
+Cstr_Array path_scan_includes(Cstr path, Cstr_Array include_dirs)
+{
+    // Accept the include directories as compiler flags too
+    String_View *dirs = malloc(sizeof(*dirs) * (include_dirs.count + 1));
+    if (dirs == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+    for (size_t i = 0; i < include_dirs.count; ++i) {
+        Cstr dir = include_dirs.elems[i];
+        dirs[i] = sv_from_cstr(strncmp(dir, "-I", 2) == 0 ? dir + 2 : dir);
+    }
+
+    Cstr_Array headers = cstr_array_make(NULL);
+    Cstr_Set seen = {0};
+    String_Builder sb = {0};
+
+    // `headers` doubles as the work list, `next` is the first one not scanned yet
+    Cstr current = path_normalize(path);
+    cstr_set_add(&seen, current);
+    for (size_t next = 0; current != NULL; current = next < headers.count ? headers.elems[next++] : NULL) {
+        const Cstr_Array *directives = nobuild__include_directives(current);
+        for (size_t i = 0; directives != NULL && i < directives->count; ++i) {
+            const char *name = directives->elems[i] + 1;
+            Cstr found = NULL;
+            if (directives->elems[i][0] == '"') {
+                found = nobuild__include_candidate(&sb, path_dirname_sv(current), name);
+            }
+            for (size_t j = 0; found == NULL && j < include_dirs.count; ++j) {
+                found = nobuild__include_candidate(&sb, dirs[j], name);
+            }
+
+            // System headers are not in `include_dirs`, leave them out
+            if (found != NULL && cstr_set_add(&seen, found)) {
+                headers = cstr_array_append(headers, found);
+            }
+        }
+    }
+
+    ARRAY_FREE(&sb);
+    cstr_set_free(&seen);
+    free(dirs);
+    nobuild__include_log_flush();
+    return headers;
+}
+
+void path_rename(Cstr old_path, Cstr new_path)
+{
+    nobuild__dir_cache_clear();
+    path_stat_cache_clear();
+    path_realpath_cache_clear();
+
+#ifndef _WIN32
+    if (rename(old_path, new_path) < 0) {
+        PANIC("could not rename %s to %s: %s", old_path, new_path,
+              nobuild__strerror(errno));
+    }
+#else
+    if (!MoveFileEx(old_path, new_path, MOVEFILE_REPLACE_EXISTING)) {
+        PANIC("could not rename %s to %s: %s", old_path, new_path,
+              nobuild__GetLastErrorAsString());
+    }
+#endif // _WIN32
+}
+
+#ifndef _WIN32
+// Copy the whole contents of `src` into the freshly truncated `dst` using the
+// fastest mechanism available. Returns 0 on success, -1 on error.
+int nobuild__copy_fd(Fd src, Fd dst, size_t size)
+{
+#ifdef __linux__
+    // On copy-on-write filesystems (btrfs, xfs, ...) the extents can be shared outright
+    if (ioctl(dst, FICLONE, src) == 0) {
+        return 0;
+    }
+#endif // __linux__
+
+    errno = 0;
+    const size_t copied = fd_sendfile(dst, src, 0);
+    if (copied < size) {
+        // The source shrank or the copy stopped early without saying why
+        if (errno == 0) {
+            errno = EIO;
+        }
+        return -1;
+    }
+    return 0;
+}
+#endif // _WIN32
+
+// Returns 0 if the copy failed, after logging why
+int nobuild__copy_file(Cstr old_path, Cstr new_path)
+{
+    int ok = 1;
+    nobuild__stat_cache_evict(new_path);
+
+#ifndef _WIN32
+    Fd f1 = fd_open_for_read(old_path);
+
+    struct stat statbuf = {0};
+    if (fstat(f1, &statbuf) < 0) {
+        PANIC("Could not stat %s: %s", old_path, nobuild__strerror(errno));
+    }
+
+    const mode_t mode = statbuf.st_mode & 07777;
+    Fd f2 = open(new_path, O_WRONLY | O_CREAT | O_TRUNC, mode);
+    if (f2 < 0 && errno == EACCES) {
+        // A previous copy of a read-only file, replace it
+        nobuild__unlink(new_path);
+        f2 = open(new_path, O_WRONLY | O_CREAT | O_TRUNC, mode);
+    }
+
+    if (f2 < 0) {
+        PANIC("Could not open file %s: %s", new_path, nobuild__strerror(errno));
+    }
+
+    if (nobuild__copy_fd(f1, f2, (size_t) statbuf.st_size) < 0) {
+        ERRO("Could not copy %s to %s: %s", old_path, new_path, nobuild__strerror(errno));
+        ok = 0;
+    } else {
+        // Keep the permissions and timestamps of the original so the copy
+        // does not look newer than its inputs to `path_is_newer()`
+        if (chmod(new_path, mode) < 0) {
+            WARN("Could not set mode of %s: %s", new_path, nobuild__strerror(errno));
+        }
+
+#if defined(UTIME_NOW)
+#	ifdef __APPLE__
+        struct timespec times[2] = { statbuf.st_atimespec, statbuf.st_mtimespec };
+#	else
+        struct timespec times[2] = { statbuf.st_atim, statbuf.st_mtim };
+#	endif
+        if (futimens(f2, times) < 0) {
+#else
+        // No nanosecond timestamps without POSIX.1-2008
+        struct utimbuf times = { statbuf.st_atime, statbuf.st_mtime };
+        if (utime(new_path, &times) < 0) {
+#endif
+            WARN("Could not set timestamps of %s: %s", new_path, nobuild__strerror(errno));
+        }
+    }
+
+    fd_close(f1);
+    fd_close(f2);
+#else
+    // CopyFile keeps the attributes and the last write time of the original
+    if (!CopyFile(old_path, new_path, FALSE)) {
+        ERRO("Could not copy %s to %s: %s", old_path, new_path, nobuild__GetLastErrorAsString());
+        ok = 0;
+    }
+#endif // _WIN32
+
+    return ok;
+}
+
+void path_copy(Cstr old_path, Cstr new_path) {
+    if (IS_DIR(old_path)) {
+        path_mkdirs(cstr_array_make(new_path, NULL));
+        FOREACH_FILE_IN_DIR(file, old_path, {
+            if (strcmp(file, ".") == 0 || strcmp(file, "..") == 0) {
+                continue;
+            }
+
+            path_copy(PATH(old_path, file), PATH(new_path, file));
+        });
+    } else {
+        nobuild__copy_file(old_path, new_path);
+    }
+}
+
+// Returns 1 if the file at `path` holds exactly `size` bytes of `data`
+static int nobuild__file_equals(Cstr path, const void *data, size_t size)
+{
+    Nobuild__Stat st;
+    if (!nobuild__stat(path, &st) || st.is_dir || st.size != size) {
+        return 0;
+    }
+
+    File_Map map = file_map(path);
+    const int equal = map.data != NULL && map.size == size && memcmp(map.data, data, size) == 0;
+    if (map.data != NULL) {
+        file_unmap(&map);
+    }
+    return equal;
+}
+
+// Moves `temp_path` over `path`, the rest of the tree stays as it was
+static void nobuild__replace_file(Cstr temp_path, Cstr path)
+{
+    nobuild__stat_cache_evict(path);
+    nobuild__realpath_cache_evict(path);
+
+#ifndef _WIN32
+    if (rename(temp_path, path) < 0) {
+        PANIC("could not rename %s to %s: %s", temp_path, path,
+              nobuild__strerror(errno));
+    }
+#else
+    if (!MoveFileEx(temp_path, path, MOVEFILE_REPLACE_EXISTING)) {
+        PANIC("could not rename %s to %s: %s", temp_path, path,
+              nobuild__GetLastErrorAsString());
+    }
+#endif // _WIN32
+}
+
+Output_File output_file_open(Cstr path)
+{
+    Cstr temp_path = CONCAT(path, ".tmp");
+    Output_File file = {
+        .writer = fdw_make(fd_open_for_write(temp_path), 0),
+        .path = path,
+        .temp_path = temp_path,
+    };
+    return file;
+}
+
+int output_file_close(Output_File *file)
+{
+    const int ok = fdw_flush(&file->writer);
+    fdw_close(&file->writer);
+    if (!ok) {
+        ERRO("Could not write %s, leaving it as it was", file->path);
+        nobuild__unlink(file->temp_path);
+        return 0;
+    }
+
+    // Only read the old contents when the sizes match
+    int changed = 1;
+    Nobuild__Stat old_st, new_st;
+    if (nobuild__stat(file->path, &old_st) && nobuild__stat(file->temp_path, &new_st)
+            && !old_st.is_dir && old_st.size == new_st.size) {
+        File_Map contents = file_map(file->temp_path);
+        if (contents.data != NULL) {
+            changed = !nobuild__file_equals(file->path, contents.data, contents.size);
+            file_unmap(&contents);
+        }
+    }
+
+    if (changed) {
+        nobuild__replace_file(file->temp_path, file->path);
+    } else {
+        nobuild__unlink(file->temp_path);
+    }
+    return changed;
+}
+
+int path_write_if_changed(Cstr path, const void *data, size_t size)
+{
+    if (nobuild__file_equals(path, data, size)) {
+        return 0;
+    }
+
+    Cstr temp_path = CONCAT(path, ".tmp");
+    Fd fd = fd_open_for_write(temp_path);
+    const int ok = fd_write_all(fd, data, size);
+    fd_close(fd);
+    if (!ok) {
+        ERRO("Could not write %s, leaving it as it was", path);
+        nobuild__unlink(temp_path);
+        return 0;
+    }
+
+    nobuild__replace_file(temp_path, path);
+    return 1;
+}
+
+size_t nobuild__cpu_count(void)
+{
+#ifndef _WIN32
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (size_t) count : 1;
+#else
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (size_t) info.dwNumberOfProcessors : 1;
+#endif // _WIN32
+}
+
+typedef struct {
+    size_t next;
+    size_t count;
+    void (*task)(size_t index, void *ctx);
+    void *ctx;
+#ifndef NOBUILD_NO_THREADS
+#	ifndef _WIN32
+    pthread_mutex_t lock;
+#	else
+    CRITICAL_SECTION lock;
+#	endif
+#endif
+} Nobuild__Parallel_For;
+
+#ifndef NOBUILD_NO_THREADS
+#	ifndef _WIN32
+static void *nobuild__parallel_for_worker(void *arg)
+#	else
+static DWORD WINAPI nobuild__parallel_for_worker(LPVOID arg)
+#	endif
+{
+    Nobuild__Parallel_For *pf = arg;
+    for (;;) {
+#	ifndef _WIN32
+        pthread_mutex_lock(&pf->lock);
+        size_t index = pf->next++;
+        pthread_mutex_unlock(&pf->lock);
+#	else
+        EnterCriticalSection(&pf->lock);
+        size_t index = pf->next++;
+        LeaveCriticalSection(&pf->lock);
+#	endif
+
+        if (index >= pf->count) {
+            break;
+        }
+
+        pf->task(index, pf->ctx);
+    }
+
+    return 0;
+}
+#endif // NOBUILD_NO_THREADS
+
+// Run `task(index, ctx)` for every index in [0, count) on up to `jobs` threads.
+// `jobs == 0` means one thread per CPU. Define `NOBUILD_NO_THREADS` to always
+// run the tasks serially on the calling thread.
+void nobuild__parallel_for(size_t count, size_t jobs, void (*task)(size_t index, void *ctx), void *ctx)
+{
+    if (jobs == 0) {
+        jobs = nobuild__cpu_count();
+    }
+
+    if (jobs > count) {
+        jobs = count;
+    }
+
+#ifndef NOBUILD_NO_THREADS
+    if (jobs > 1) {
+        Nobuild__Parallel_For pf = {
+            .count = count,
+            .task = task,
+            .ctx = ctx,
+        };
+
+#	ifndef _WIN32
+        pthread_t *threads = malloc(sizeof *threads * jobs);
+        if (threads == NULL) {
+            PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+        }
+        pthread_mutex_init(&pf.lock, NULL);
+
+        // The calling thread is a worker as well
+        size_t started = 0;
+        for (; started < jobs - 1; ++started) {
+            if (pthread_create(&threads[started], NULL, nobuild__parallel_for_worker, &pf) != 0) {
+                break;
+            }
+        }
+        nobuild__parallel_for_worker(&pf);
+
+        for (size_t i = 0; i < started; ++i) {
+            pthread_join(threads[i], NULL);
+        }
+        pthread_mutex_destroy(&pf.lock);
+#	else
+        HANDLE *threads = malloc(sizeof *threads * jobs);
+        if (threads == NULL) {
+            PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+        }
+        InitializeCriticalSection(&pf.lock);
+
+        // The calling thread is a worker as well
+        size_t started = 0;
+        for (; started < jobs - 1; ++started) {
+            threads[started] = CreateThread(NULL, 0, nobuild__parallel_for_worker, &pf, 0, NULL);
+            if (threads[started] == NULL) {
+                break;
+            }
+        }
+        nobuild__parallel_for_worker(&pf);
+
+        for (size_t i = 0; i < started; ++i) {
+            WaitForSingleObject(threads[i], INFINITE);
+            CloseHandle(threads[i]);
+        }
+        DeleteCriticalSection(&pf.lock);
+#	endif // _WIN32
+
+        free(threads);
+        return;
+    }
+#endif // NOBUILD_NO_THREADS
+
+    for (size_t i = 0; i < count; ++i) {
+        task(i, ctx);
+    }
+}
+
+int nobuild__same_contents(Cstr path1, Cstr path2)
+{
+    const size_t buffer_size = 64 * 1024;
+    unsigned char *buffer1 = malloc(buffer_size * 2);
+    if (buffer1 == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+    unsigned char *buffer2 = buffer1 + buffer_size;
+
+    Fd f1 = fd_open_for_read(path1);
+    Fd f2 = fd_open_for_read(path2);
+
+    int same = 1;
+    while (same) {
+        size_t bytes1 = fd_read(f1, buffer1, buffer_size);
+        size_t bytes2 = 0;
+        while (bytes2 < bytes1) {
+            size_t bytes = fd_read(f2, buffer2 + bytes2, bytes1 - bytes2);
+            if (bytes == 0) {
+                break;
+            }
+            bytes2 += bytes;
+        }
+
+        if (bytes1 != bytes2 || memcmp(buffer1, buffer2, bytes1) != 0) {
+            same = 0;
+        }
+
+        if (bytes1 == 0) {
+            break;
+        }
+    }
+
+    fd_close(f1);
+    fd_close(f2);
+    free(buffer1);
+    return same;
+}
+
+typedef struct {
+    Cstr src_path;
+    Cstr dst_path;
+    int copied;
+    int failed;
+    int deleted;
+    unsigned long long bytes;
+} Nobuild__Sync_Job;
+
+typedef struct {
+    Nobuild__Sync_Job *elems;
+    size_t count;
+    size_t capacity;
+    Sync_Options options;
+} Nobuild__Sync;
+
+static void nobuild__sync_file(size_t index, void *ctx)
+{
+    Nobuild__Sync *sync = ctx;
+    Nobuild__Sync_Job *job = &sync->elems[index];
+
+    Nobuild__Stat src_st, dst_st;
+    nobuild__stat(job->src_path, &src_st);
+    nobuild__stat(job->dst_path, &dst_st);
+    job->bytes = src_st.size;
+
+    if (dst_st.exists && !dst_st.is_dir && dst_st.size == src_st.size) {
+        int same = sync->options.compare_contents
+                   ? nobuild__same_contents(job->src_path, job->dst_path)
+                   : dst_st.mtime == src_st.mtime;
+        if (same) {
+            return;
+        }
+    }
+
+    if (dst_st.is_dir) {
+        path_rm(job->dst_path);
+        job->deleted = 1;
+    }
+
+    if (nobuild__copy_file(job->src_path, job->dst_path)) {
+        job->copied = 1;
+    } else {
+        job->failed = 1;
+    }
+}
+
+static void nobuild__sync_push(Nobuild__Sync *sync, Cstr src_path, Cstr dst_path)
+{
+    Nobuild__Sync_Job job = {
+        .src_path = src_path,
+        .dst_path = dst_path,
+    };
+    ARRAY_APPEND(sync, job);
+}
+
+static void nobuild__sync_dir(Nobuild__Sync *sync, Cstr src_path, Cstr dst_path, Sync_Stats *stats)
+{
+    Nobuild__Stat dst_st;
+    nobuild__stat(dst_path, &dst_st);
+    if (dst_st.exists && !dst_st.is_dir) {
+        path_rm(dst_path);
+        stats->files_deleted += 1;
+        dst_st.exists = 0;
+    }
+
+    if (!dst_st.exists) {
+        if (nobuild__mkdir(dst_path, 0755) < 0) {
+            PANIC("could not create directory %s: %s", dst_path, nobuild__strerror(errno));
+        }
+    } else if (sync->options.delete_extraneous) {
+        FOREACH_FILE_IN_DIR(file, dst_path, {
+            if (strcmp(file, ".") == 0 || strcmp(file, "..") == 0) {
+                continue;
+            }
+
+            if (!PATH_EXISTS(PATH(src_path, file))) {
+                path_rm(PATH(dst_path, file));
+                stats->files_deleted += 1;
+            }
+        });
+    }
+
+    FOREACH_FILE_IN_DIR(file, src_path, {
+        if (strcmp(file, ".") == 0 || strcmp(file, "..") == 0) {
+            continue;
+        }
+
+        Cstr src_child = PATH(src_path, file);
+        Cstr dst_child = PATH(dst_path, file);
+        if (IS_DIR(src_child)) {
+            nobuild__sync_dir(sync, src_child, dst_child, stats);
+            continue;
+        }
+
+        nobuild__sync_push(sync, src_child, dst_child);
+    });
+}
+
+Sync_Stats path_sync(Cstr src_path, Cstr dst_path, Sync_Options options)
+{
+    Sync_Stats stats = {0};
+    Nobuild__Sync sync = { .options = options };
+
+    if (IS_DIR(src_path)) {
+        // Only the root may need missing parents, `nobuild__sync_dir()` creates the rest
+        Cstr parent = path_dirname(dst_path);
+        if (!PATH_EXISTS(parent)) {
+            path_mkdirs(cstr_array_make(parent, NULL));
+        }
+        nobuild__sync_dir(&sync, src_path, dst_path, &stats);
+    } else {
+        nobuild__sync_push(&sync, src_path, dst_path);
+    }
+
+    nobuild__parallel_for(sync.count, options.jobs, nobuild__sync_file, &sync);
+
+    for (size_t i = 0; i < sync.count; ++i) {
+        Nobuild__Sync_Job *job = &sync.elems[i];
+        if (job->copied) {
+            stats.files_copied += 1;
+            stats.bytes_copied += job->bytes;
+        } else if (job->failed) {
+            stats.files_failed += 1;
+        } else {
+            stats.files_skipped += 1;
+            stats.bytes_skipped += job->bytes;
+        }
+
+        if (job->deleted) {
+            stats.files_deleted += 1;
+        }
+    }
+
+    free(sync.elems);
+    return stats;
+}
+
+#if !defined(_WIN32) && defined(AT_REMOVEDIR)
+typedef struct {
+    int dirfd;
+    Cstr path;
+    Cstr_Array names;
+} Nobuild__Rm_Subtrees;
+
+static void nobuild__rm_dir_at(int dirfd, Cstr parent, Cstr name, int parallel);
+
+static void nobuild__rm_subtree(size_t index, void *ctx)
+{
+    Nobuild__Rm_Subtrees *subtrees = ctx;
+    nobuild__rm_dir_at(subtrees->dirfd, subtrees->path, subtrees->names.elems[index], 0);
+}
+
+// Remove the directory `name` relative to `dirfd` together with its contents.
+// Entries are removed with `unlinkat()` relative to the directory fd and `d_type`
+// avoids a stat per entry. `parent` is only used for error messages. With `parallel`
+// set the subdirectories are removed on a pool of worker threads.
+static void nobuild__rm_dir_at(int dirfd, Cstr parent, Cstr name, int parallel)
+{
+    int fd = openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            errno = 0;
+            return;
+        }
+
+        PANIC("Could not open directory %s: %s", PATH(parent, name), nobuild__strerror(errno));
+    }
+
+    DIR *dir = fdopendir(fd);
+    if (dir == NULL) {
+        PANIC("Could not open directory %s: %s", PATH(parent, name), nobuild__strerror(errno));
+    }
+
+    Cstr path = NULL;
+    Nobuild__Rm_Subtrees subtrees = { .dirfd = fd };
+
+    errno = 0;
+    struct dirent *dp = NULL;
+    while ((dp = readdir(dir))) {
+        const char *file = dp->d_name;
+        if (strcmp(file, ".") == 0 || strcmp(file, "..") == 0) {
+            continue;
+        }
+
+        int is_dir = 0;
+#ifdef DT_DIR
+        if (dp->d_type == DT_DIR) {
+            is_dir = 1;
+        } else
+#endif
+        if (unlinkat(fd, file, 0) < 0) {
+            // Either `d_type` is not supported by the filesystem or the entry is a directory
+            if (errno == EISDIR || errno == EPERM) {
+                is_dir = 1;
+            } else if (errno != ENOENT) {
+                PANIC("Could not remove file %s: %s", PATH(parent, name, file), nobuild__strerror(errno));
+            }
+        }
+
+        if (is_dir) {
+            if (path == NULL) {
+                path = PATH(parent, name);
+            }
+
+            if (parallel) {
+                size_t len = strlen(file);
+                char *copy = malloc(len + 1);
+                if (copy == NULL) {
+                    PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+                }
+                memcpy(copy, file, len + 1);
+                subtrees.names = cstr_array_append(subtrees.names, copy);
+            } else {
+                nobuild__rm_dir_at(fd, path, file, 0);
+            }
+        }
+        errno = 0;
+    }
+
+    if (errno > 0) {
+        PANIC("Could not read directory %s: %s", PATH(parent, name), nobuild__strerror(errno));
+    }
+
+    if (subtrees.names.count == 1) {
+        // Keep descending until the tree branches out
+        nobuild__rm_dir_at(fd, path, subtrees.names.elems[0], 1);
+    } else if (subtrees.names.count > 1) {
+        subtrees.path = path;
+        nobuild__parallel_for(subtrees.names.count, 0, nobuild__rm_subtree, &subtrees);
+    }
+
+    for (size_t i = 0; i < subtrees.names.count; ++i) {
+        free((char *) subtrees.names.elems[i]);
+    }
+    free(subtrees.names.elems);
+    closedir(dir);
+
+    if (unlinkat(dirfd, name, AT_REMOVEDIR) < 0 && errno != ENOENT) {
+        PANIC("Could not remove directory %s: %s", PATH(parent, name), nobuild__strerror(errno));
+    }
+    errno = 0;
+}
+#endif // !_WIN32 && AT_REMOVEDIR
+
+void path_rm(Cstr path)
+{
+    nobuild__stat_cache_evict(path);
+
+#if !defined(_WIN32) && defined(AT_REMOVEDIR)
+    // Don't stat up front, the unlink fails for directories anyway
+    if (nobuild__unlink(path) == 0) {
+        return;
+    }
+
+    if (errno == ENOENT) {
+        errno = 0;
+        WARN("File %s does not exist", path);
+    } else if (errno == EISDIR || errno == EPERM) {
+        errno = 0;
+        nobuild__dir_cache_clear();
+        path_stat_cache_clear();
+        nobuild__rm_dir_at(AT_FDCWD, ".", path, 1);
+    } else {
+        PANIC("Could not remove file %s: %s", path, nobuild__strerror(errno));
+    }
+#else
+    if (IS_DIR(path)) {
+        nobuild__dir_cache_clear();
+        path_stat_cache_clear();
+        FOREACH_FILE_IN_DIR(file, path, {
+            if (strcmp(file, ".") != 0 && strcmp(file, "..") != 0)
+            {
+                path_rm(PATH(path, file));
+            }
+        });
+
+        if (nobuild__rmdir(path) < 0) {
+            if (errno == ENOENT) {
+                errno = 0;
+                WARN("Directory %s does not exist", path);
+            } else {
+                PANIC("Could not remove directory %s: %s", path, nobuild__strerror(errno));
+            }
+        }
+    } else {
+        if (nobuild__unlink(path) < 0) {
+            if (errno == ENOENT) {
+                errno = 0;
+                WARN("File %s does not exist", path);
+            } else {
+                PANIC("Could not remove file %s: %s", path, nobuild__strerror(errno));
+            }
+        }
+    }
+#endif // !_WIN32 && AT_REMOVEDIR
+}
+
+#ifndef NOBUILD_NO_THREADS
+#	ifndef _WIN32
+static pthread_t *nobuild__rm_background_threads = NULL;
+#	else
+static HANDLE *nobuild__rm_background_threads = NULL;
+#	endif
+static size_t nobuild__rm_background_count = 0;
+static Nobuild__Mutex nobuild__rm_background_lock = NOBUILD__MUTEX_INIT;
+
+#	ifndef _WIN32
+static void *nobuild__rm_background_worker(void *arg)
+#	else
+static DWORD WINAPI nobuild__rm_background_worker(LPVOID arg)
+#	endif
+{
+    path_rm(arg);
+    free(arg);
+    return 0;
+}
+#endif // NOBUILD_NO_THREADS
+
+void path_rm_wait(void)
+{
+#ifndef NOBUILD_NO_THREADS
+    nobuild__mutex_lock(&nobuild__rm_background_lock);
+    for (size_t i = 0; i < nobuild__rm_background_count; ++i) {
+#	ifndef _WIN32
+        pthread_join(nobuild__rm_background_threads[i], NULL);
+#	else
+        WaitForSingleObject(nobuild__rm_background_threads[i], INFINITE);
+        CloseHandle(nobuild__rm_background_threads[i]);
+#	endif // _WIN32
+    }
+    nobuild__rm_background_count = 0;
+    nobuild__mutex_unlock(&nobuild__rm_background_lock);
+#endif // NOBUILD_NO_THREADS
+}
+
+void path_rm_background(Cstr path)
+{
+#ifndef NOBUILD_NO_THREADS
+    static size_t counter = 0;
+
+    if (!PATH_EXISTS(path)) {
+        WARN("File %s does not exist", path);
+        return;
+    }
+
+    // Strip trailing separators so the trash ends up next to `path` and not inside of it
+    size_t len = strlen(path);
+    while (len > 1 && path[len - 1] == *PATH_SEP) {
+        len -= 1;
+    }
+
+    const size_t trash_size = len + 64;
+    char *trash = malloc(trash_size);
+    if (trash == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+
+    // `PANIC` exits and the atexit handler `path_rm_wait()` takes the lock,
+    // so nothing that can panic runs while it is held
+    nobuild__mutex_lock(&nobuild__rm_background_lock);
+    const size_t id = counter++;
+    nobuild__mutex_unlock(&nobuild__rm_background_lock);
+
+#	ifndef _WIN32
+    snprintf(trash, trash_size, "%.*s.nobuild-trash-%ld-%zu", (int) len, path, (long) getpid(), id);
+#	else
+    snprintf(trash, trash_size, "%.*s.nobuild-trash-%lu-%zu", (int) len, path, GetCurrentProcessId(), id);
+#	endif
+
+    // Renaming is atomic, so `path` is free to be recreated right away
+    path_rename(path, trash);
+
+    int started = 0;
+    nobuild__mutex_lock(&nobuild__rm_background_lock);
+    static int registered = 0;
+    if (!registered) {
+        atexit(path_rm_wait);
+        registered = 1;
+    }
+
+    void *threads = realloc(nobuild__rm_background_threads,
+                            sizeof *nobuild__rm_background_threads * (nobuild__rm_background_count + 1));
+    if (threads != NULL) {
+        nobuild__rm_background_threads = threads;
+#	ifndef _WIN32
+        started = pthread_create(&nobuild__rm_background_threads[nobuild__rm_background_count], NULL,
+                                 nobuild__rm_background_worker, trash) == 0;
+#	else
+        HANDLE thread = CreateThread(NULL, 0, nobuild__rm_background_worker, trash, 0, NULL);
+        nobuild__rm_background_threads[nobuild__rm_background_count] = thread;
+        started = thread != NULL;
+#	endif // _WIN32
+        if (started) {
+            nobuild__rm_background_count += 1;
+        }
+    }
+    nobuild__mutex_unlock(&nobuild__rm_background_lock);
+
+    if (threads == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+
+    if (!started) {
+        path_rm(trash);
+        free(trash);
+    }
+#else
+    path_rm(path);
+#endif // NOBUILD_NO_THREADS
+}
+
+#include <ctype.h>
+
+char *shift_args(int *argc, char ***argv)
+{
+    assert(*argc > 0);
+    char *result = **argv;
+    *argc -= 1;
+    *argv += 1;
+    return result;
+}
+
+// Writes the bytes of `data` as rows of `0x.., ` with a lookup table instead
+// of a printf per byte, straight into the spare capacity of `out`
+static int nobuild__write_hex_rows(Fd_Writer *out, const unsigned char *data, size_t size)
+{
+    static const char digits[] = "0123456789abcdef";
+    // A tab, 16 times `0xNN, ` and a newline
+    enum { ROW_BYTES = 16, ROW_MAX = 1 + ROW_BYTES * 6 + 1 };
+
+    for (size_t i = 0; i < size; i += ROW_BYTES) {
+        if (out->capacity - out->count < ROW_MAX && !fdw_flush(out)) {
+            return 0;
+        }
+
+        const size_t row_end = size - i < ROW_BYTES ? size : i + ROW_BYTES;
+        char *row = out->buffer + out->count;
+        *row++ = '\t';
+        for (size_t j = i; j < row_end; ++j) {
+            row[0] = '0';
+            row[1] = 'x';
+            row[2] = digits[data[j] >> 4];
+            row[3] = digits[data[j] & 0xf];
+            row[4] = ',';
+            row[5] = ' ';
+            row += 6;
+        }
+        *row++ = '\n';
+        out->count = (size_t) (row - out->buffer);
+    }
+
+    return 1;
+}
+
+void file_to_c_array(Cstr path, Cstr out_path, Cstr array_type, Cstr array_name, int null_term) {
+    File_Map input = file_map(path);
+    if (input.data == NULL) {
+        return;
+    }
+
+    // Leave `out_path` alone when the input did not change, so its dependents are not rebuilt
+    Output_File file = output_file_open(out_path);
+    Fd_Writer *out = &file.writer;
+    fdw_printf(out, "%s %s[] = {\n", array_type, array_name);
+    int ok = nobuild__write_hex_rows(out, (const unsigned char *) input.data, input.size);
+    if (null_term) {
+        fdw_write_cstr(out, "\t0x00 /* Terminate with null */\n");
+    }
+    fdw_write_cstr(out, "};\n");
+    fdw_printf(out, "unsigned long %s_len = %lu;\n", array_name, (unsigned long) input.size + (null_term ? 1 : 0));
+    if (ok) {
+        output_file_close(&file);
+    } else {
+        ERRO("Could not write file %s: %s", out_path, strerror(errno));
+        fdw_close(out);
+        path_rm(file.temp_path);
+    }
+
+    file_unmap(&input);
+}
+
+// Writes `cstr` as the body of a C string literal
+static void nobuild__write_escaped(Fd_Writer *out, Cstr cstr)
+{
+    for (; *cstr != '\0'; ++cstr) {
+        if (*cstr == '\\' || *cstr == '"') {
+            fdw_write(out, "\\", 1);
+        }
+        fdw_write(out, cstr, 1);
+    }
+}
+
+// `path` relative to the directory `dir`, so that the generated files keep
+// working when the tree is moved. Paths with no common root, like on two
+// Windows drives, stay absolute.
+static Cstr nobuild__path_relative_to(Cstr dir, Cstr path)
+{
+    Cstr from = path_realpath(dir);
+    Cstr to = path_realpath(path);
+
+    size_t common = 0;
+    size_t i = 0;
+    for (; from[i] != '\0' && from[i] == to[i]; ++i) {
+        if (nobuild__is_path_sep(from[i])) {
+            common = i + 1;
+        }
+    }
+    if (from[i] == '\0' && nobuild__is_path_sep(to[i])) {
+        common = i + 1;
+    }
+    if (common == 0) {
+        return to;
+    }
+
+    String_Builder sb = {0};
+    for (Cstr c = from + common; *c != '\0'; ++c) {
+        if (c == from + common || (nobuild__is_path_sep(c[-1]) && !nobuild__is_path_sep(*c))) {
+            sb_append_cstr(&sb, ".." PATH_SEP);
+        }
+    }
+    sb_append_cstr(&sb, to + common);
+    return sb_to_cstr(&sb);
+}
+
+void file_to_c_embed(Cstr path, Cstr out_path, Cstr array_type, Cstr array_name, int null_term) {
+    if (!path_is_file(path)) {
+        ERRO("File %s does not exist", path);
+        return;
+    }
+
+    // `#embed` looks quoted paths up next to the including file first
+    Output_File file = output_file_open(out_path);
+    Cstr relative_path = nobuild__path_relative_to(path_dirname(out_path), path);
+    Fd_Writer *out = &file.writer;
+    fdw_printf(out, "%s %s[] = {\n#embed \"", array_type, array_name);
+    nobuild__write_escaped(out, relative_path);
+    fdw_write_cstr(out, null_term ? "\" suffix(, 0x00) if_empty(0x00)\n" : "\"\n");
+    fdw_write_cstr(out, "};\n");
+    fdw_printf(out, "unsigned long %s_len = sizeof(%s);\n", array_name, array_name);
+    output_file_close(&file);
+}
+
+void file_to_c_incbin(Cstr path, Cstr out_path, Cstr array_type, Cstr array_name, int null_term) {
+    Nobuild__Stat st;
+    if (!nobuild__stat(path, &st) || st.is_dir) {
+        ERRO("Could not find the file %s", path);
+        return;
+    }
+
+    // Mach-O prefixes C symbols with an underscore and has no `.pushsection`
+    Output_File file = output_file_open(out_path);
+    Cstr relative_path = nobuild__path_relative_to(path_dirname(out_path), path);
+    Fd_Writer *out = &file.writer;
+    fdw_write_cstr(out,
+        "#ifdef __APPLE__\n"
+        "#\tdefine NOBUILD_INCBIN_SYMBOL \"_\"\n"
+        "#\tdefine NOBUILD_INCBIN_BEGIN \".const_data\\n\"\n"
+        "#\tdefine NOBUILD_INCBIN_END \".text\\n\"\n"
+        "#else\n"
+        "#\tdefine NOBUILD_INCBIN_SYMBOL \"\"\n"
+        "#\tdefine NOBUILD_INCBIN_BEGIN \".pushsection .rodata\\n\"\n"
+        "#\tdefine NOBUILD_INCBIN_END \".popsection\\n\"\n"
+        "#endif\n"
+        "\n"
+        "__asm__(\n"
+        "    NOBUILD_INCBIN_BEGIN\n");
+    fdw_printf(out,
+        "    \".globl \" NOBUILD_INCBIN_SYMBOL \"%s\\n\"\n"
+        "    \".balign 16\\n\"\n"
+        "    NOBUILD_INCBIN_SYMBOL \"%s:\\n\"\n"
+        "    \".incbin \\\"",
+        array_name, array_name);
+    // Escaped once for the assembler string and once more for the C literal holding it
+    for (Cstr c = relative_path; *c != '\0'; ++c) {
+        if (*c == '\\' || *c == '"') {
+            fdw_write_cstr(out, "\\\\\\");
+        }
+        fdw_write(out, c, 1);
+    }
+    fdw_write_cstr(out, "\\\"\\n\"\n");
+    if (null_term) {
+        fdw_write_cstr(out, "    \".byte 0\\n\"\n");
+    }
+    fdw_write_cstr(out, "    NOBUILD_INCBIN_END\n);\n\n");
+    fdw_printf(out, "extern const %s %s[];\n", array_type, array_name);
+    fdw_printf(out, "unsigned long %s_len = %llu;\n", array_name, st.size + (null_term ? 1 : 0));
+    output_file_close(&file);
+}
+
+void pack_add(Pack_Assets *assets, Cstr name, Cstr path)
+{
+    Pack_Asset asset = {
+        .name = name,
+        .path = path,
+    };
+    ARRAY_APPEND(assets, asset);
+}
+
+static unsigned long long nobuild__pack_align(unsigned long long offset)
+{
+    return (offset + NOBUILD_PACK_ALIGN - 1) / NOBUILD_PACK_ALIGN * NOBUILD_PACK_ALIGN;
+}
+
+Pack pack_from_memory(const void *data, size_t size)
+{
+    Pack pack = {0};
+    const Pack_Header *header = data;
+    if (size < sizeof(*header) || memcmp(header->magic, NOBUILD_PACK_MAGIC, sizeof(header->magic)) != 0) {
+        ERRO("%s", "Resource pack has no pack header");
+        return pack;
+    }
+
+    const unsigned long long index_size = header->count * sizeof(Pack_Entry);
+    if (header->names_offset < sizeof(*header) || header->names_offset > header->index_offset
+            || header->index_offset % sizeof(unsigned long long) != 0
+            || header->count > size / sizeof(Pack_Entry) || header->index_offset > size - index_size) {
+        ERRO("%s", "Resource pack index is out of bounds");
+        return pack;
+    }
+
+    // Check every entry once, so lookups can trust the offsets
+    const Pack_Entry *index = (const Pack_Entry *) ((const char *) data + header->index_offset);
+    const char *names = (const char *) data + header->names_offset;
+    const unsigned long long names_size = header->index_offset - header->names_offset;
+    for (unsigned long long i = 0; i < header->count; ++i) {
+        const Pack_Entry *entry = &index[i];
+        if (entry->name_offset >= names_size
+                || memchr(names + entry->name_offset, '\0', (size_t) (names_size - entry->name_offset)) == NULL) {
+            ERRO("Resource pack entry %llu has its name out of bounds", i);
+            return pack;
+        }
+        if (entry->offset < sizeof(*header) || entry->offset > size || entry->size > size - entry->offset) {
+            ERRO("Resource pack entry %s is out of bounds", names + entry->name_offset);
+            return pack;
+        }
+    }
+
+    pack.header = header;
+    pack.index = index;
+    pack.names = names;
+    return pack;
+}
+
+Pack pack_open(Cstr path)
+{
+    File_Map map = file_map(path);
+    if (map.data == NULL) {
+        Pack pack = {0};
+        return pack;
+    }
+
+    Pack pack = pack_from_memory(map.data, map.size);
+    if (pack.header == NULL) {
+        ERRO("%s is not a resource pack", path);
+        file_unmap(&map);
+        return pack;
+    }
+
+    pack.map = map;
+    return pack;
+}
+
+static const Pack_Entry *nobuild__pack_lookup(const Pack *pack, Cstr name)
+{
+    if (pack->header == NULL) {
+        return NULL;
+    }
+
+    size_t begin = 0;
+    size_t end = (size_t) pack->header->count;
+    while (begin < end) {
+        const size_t middle = begin + (end - begin) / 2;
+        const int order = strcmp(name, pack->names + pack->index[middle].name_offset);
+        if (order == 0) {
+            return &pack->index[middle];
+        }
+
+        if (order < 0) {
+            end = middle;
+        } else {
+            begin = middle + 1;
+        }
+    }
+
+    return NULL;
+}
+
+String_View pack_find(const Pack *pack, Cstr name)
+{
+    const Pack_Entry *entry = nobuild__pack_lookup(pack, name);
+    if (entry == NULL) {
+        return sv_from_parts(NULL, 0);
+    }
+
+    return sv_from_parts((const char *) pack->header + entry->offset, (size_t) entry->size);
+}
+
+void pack_close(Pack *pack)
+{
+    if (pack->map.data != NULL) {
+        file_unmap(&pack->map);
+    }
+    memset(pack, 0, sizeof(*pack));
+}
+
+typedef struct {
+    Pack_Asset asset;
+    Pack_Entry entry;
+    // The contents are already in the previous archive at `entry.offset`
+    int reused;
+} Nobuild__Pack_Item;
+
+static int nobuild__pack_item_compare(const void *a, const void *b)
+{
+    return strcmp(((const Nobuild__Pack_Item *) a)->asset.name, ((const Nobuild__Pack_Item *) b)->asset.name);
+}
+
+int pack_write(Cstr pack_path, Pack_Assets assets)
+{
+    Nobuild__Pack_Item *items = calloc(assets.count + 1, sizeof(*items));
+    if (items == NULL) {
+        PANIC("Could not allocate memory: %s", strerror(errno));
+    }
+    for (size_t i = 0; i < assets.count; ++i) {
+        items[i].asset = assets.elems[i];
+    }
+    qsort(items, assets.count, sizeof(*items), nobuild__pack_item_compare);
+
+    int ok = 1;
+    Fd_Batch batch = {0};
+    for (size_t i = 0; i < assets.count; ++i) {
+        if (i > 0 && strcmp(items[i - 1].asset.name, items[i].asset.name) == 0) {
+            ERRO("Asset %s is in %s more than once", items[i].asset.name, pack_path);
+            ok = 0;
+        }
+        fd_batch_stat(&batch, items[i].asset.path);
+    }
+    fd_batch_submit(&batch);
+    for (size_t i = 0; i < assets.count; ++i) {
+        if (batch.elems[i].error != 0) {
+            ERRO("Could not stat %s: %s", items[i].asset.path, strerror(batch.elems[i].error));
+            ok = 0;
+        }
+        items[i].entry.size = batch.elems[i].file_size;
+        items[i].entry.mtime = batch.elems[i].mtime;
+    }
+    ARRAY_FREE(&batch);
+    if (!ok) {
+        free(items);
+        return 0;
+    }
+
+    Pack old = {0};
+    if (path_exists(pack_path)) {
+        old = pack_open(pack_path);
+    }
+
+    // Hash the assets that changed on disk, and keep the data of the ones
+    // whose contents are still the same as in the previous archive
+    size_t changed = 0;
+    unsigned long long live_bytes = 0;
+    unsigned long long reused_bytes = 0;
+    for (size_t i = 0; i < assets.count && ok; ++i) {
+        Pack_Entry *entry = &items[i].entry;
+        const Pack_Entry *old_entry = nobuild__pack_lookup(&old, items[i].asset.name);
+        if (old_entry != NULL && old_entry->size == entry->size && old_entry->mtime == entry->mtime) {
+            entry->hash = old_entry->hash;
+        } else {
+            File_Map source = file_map(items[i].asset.path);
+            if (source.data == NULL) {
+                ok = 0;
+                break;
+            }
+            entry->hash = cstr_hash_n(source.data, source.size);
+            file_unmap(&source);
+        }
+
+        live_bytes += entry->size;
+        if (old_entry != NULL && old_entry->size == entry->size && old_entry->hash == entry->hash) {
+            items[i].reused = 1;
+            entry->offset = old_entry->offset;
+            reused_bytes += entry->size;
+        } else {
+            changed += 1;
+        }
+    }
+
+    if (!ok || (old.header != NULL && changed == 0 && old.header->count == assets.count)) {
+        pack_close(&old);
+        free(items);
+        return ok;
+    }
+
+    // New data goes after the end of the previous archive, so it stays valid
+    // until the header is rewritten last. Start over once more than half of
+    // the archive is dead space.
+    const unsigned long long dead_bytes = old.header != NULL ? old.map.size - sizeof(Pack_Header) - reused_bytes : 0;
+    const int compact = old.header == NULL || dead_bytes > live_bytes;
+    unsigned long long data_end = compact ? sizeof(Pack_Header) : old.map.size;
+
+    String_Builder names = {0};
+    Pack_Entry *index = malloc(sizeof(*index) * (assets.count + 1));
+    if (index == NULL) {
+        PANIC("Could not allocate memory: %s", strerror(errno));
+    }
+
+    // Only compaction copies data out of the previous archive, and it writes a new file
+    if (!compact) {
+        pack_close(&old);
+    }
+    Cstr out_path = compact ? CONCAT(pack_path, ".tmp") : pack_path;
+    Fd out = compact ? fd_open_for_write(out_path) : fd_open_for_update(out_path);
+    for (size_t i = 0; i < assets.count && ok; ++i) {
+        Pack_Entry *entry = &items[i].entry;
+        if (items[i].reused && !compact) {
+            index[i] = *entry;
+            continue;
+        }
+
+        const unsigned long long offset = nobuild__pack_align(data_end);
+        if (items[i].reused) {
+            ok = fd_pwrite_all(out, old.map.data + entry->offset, (size_t) entry->size, offset);
+        } else {
+            File_Map source = file_map(items[i].asset.path);
+            ok = source.data != NULL && fd_pwrite_all(out, source.data, source.size, offset);
+            if (source.data != NULL) {
+                entry->size = source.size;
+                file_unmap(&source);
+            }
+        }
+        entry->offset = offset;
+        data_end = offset + entry->size;
+        index[i] = *entry;
+    }
+
+    for (size_t i = 0; i < assets.count; ++i) {
+        index[i].name_offset = names.count;
+        sb_append_buf(&names, items[i].asset.name, strlen(items[i].asset.name) + 1);
+    }
+
+    Pack_Header header = {0};
+    memcpy(header.magic, NOBUILD_PACK_MAGIC, sizeof(header.magic));
+    header.count = assets.count;
+    header.names_offset = data_end;
+    header.index_offset = nobuild__pack_align(data_end + names.count);
+    const size_t index_size = sizeof(*index) * assets.count;
+
+    ok = ok
+        && fd_pwrite_all(out, names.elems, names.count, header.names_offset)
+        && fd_pwrite_all(out, index, index_size, header.index_offset)
+        && fd_truncate(out, header.index_offset + index_size)
+        && fd_pwrite_all(out, &header, sizeof(header), 0);
+    fd_close(out);
+    pack_close(&old);
+
+    if (ok && compact) {
+        path_rename(out_path, pack_path);
+    }
+    if (ok) {
+        INFO("Packed %zu changed of %zu assets into %s", changed, assets.count, pack_path);
+    } else {
+        ERRO("Could not write resource pack %s", pack_path);
+    }
+
+    ARRAY_FREE(&names);
+    free(index);
+    free(items);
+    return ok;
+}
+
+// Prerequisites of the first target of a Makefile depfile, interned. Lines
+// of other targets, like the module rules GCC adds, are skipped.
+static Cstr_Array nobuild__depfile_parse(const char *text)
+{
+    Cstr_Array result = cstr_array_make(NULL);
+    Cstr_Array words = cstr_array_make(NULL);
+    String_Builder word = {0};
+    Cstr first_target = NULL;
+
+    for (const char *c = text;; ++c) {
+        const int line_end = *c == '\0' || *c == '\n';
+        if (*c == '\\' && (c[1] == ' ' || c[1] == '#')) {
+            ARRAY_APPEND(&word, *++c);
+            continue;
+        }
+        if (*c == '$' && c[1] == '$') {
+            ARRAY_APPEND(&word, *++c);
+            continue;
+        }
+        const int continued = *c == '\\' && (c[1] == '\n' || (c[1] == '\r' && c[2] == '\n'));
+        if (!line_end && !continued && *c != ' ' && *c != '\t' && *c != '\r') {
+            ARRAY_APPEND(&word, *c);
+            continue;
+        }
+        if (continued) {
+            c += c[1] == '\r' ? 2 : 1;
+        }
+
+        if (word.count > 0) {
+            words = cstr_array_append(words, cstr_intern_n(word.elems, word.count));
+            word.count = 0;
+        }
+        if (!line_end) {
+            continue;
+        }
+
+        // `target [target...]: prerequisites...`
+        size_t colon = 0;
+        while (colon < words.count && !ENDS_WITH(words.elems[colon], ":")) {
+            colon += 1;
+        }
+        if (colon < words.count) {
+            Cstr target = cstr_intern_n(words.elems[0], strlen(words.elems[0]) - (colon == 0));
+            if (first_target == NULL) {
+                first_target = target;
+            }
+            for (size_t i = colon + 1; target == first_target && i < words.count; ++i) {
+                result = cstr_array_append(result, words.elems[i]);
+            }
+        }
+        words.count = 0;
+
+        if (*c == '\0') {
+            break;
+        }
+    }
+
+    ARRAY_FREE(&word);
+    ARRAY_FREE(&words);
+    return result;
+}
+
+// Reads the rule of a P1689 document into `deps`
+static int nobuild__module_parse(Module_Scanner scanner, const char *json, Module_Deps *deps)
+{
+    cJSON *root = cJSON_Parse(json);
+    const cJSON *rules = cJSON_GetObjectItemCaseSensitive(root, "rules");
+    const cJSON *rule = cJSON_IsArray(rules) ? cJSON_GetArrayItem(rules, 0) : NULL;
+    if (rule == NULL) {
+        cJSON_Delete(root);
+        return 0;
+    }
+
+    deps->provides = NULL;
+    deps->bmi = NULL;
+    deps->is_interface = 0;
+    deps->requires = cstr_array_make(NULL);
+    deps->required_bmis = cstr_array_make(NULL);
+
+    const cJSON *primary_output = cJSON_GetObjectItemCaseSensitive(rule, "primary-output");
+    if (cJSON_IsString(primary_output)) {
+        deps->object = cstr_intern(primary_output->valuestring);
+    }
+
+    const cJSON *item;
+    const cJSON *provides = cJSON_GetObjectItemCaseSensitive(rule, "provides");
+    cJSON_ArrayForEach(item, provides) {
+        const cJSON *name = cJSON_GetObjectItemCaseSensitive(item, "logical-name");
+        if (cJSON_IsString(name)) {
+            const cJSON *bmi = cJSON_GetObjectItemCaseSensitive(item, "compiled-module-path");
+            const cJSON *is_interface = cJSON_GetObjectItemCaseSensitive(item, "is-interface");
+            deps->provides = cstr_intern(name->valuestring);
+            deps->bmi = cJSON_IsString(bmi) ? cstr_intern(bmi->valuestring) : NULL;
+            // P1689 defaults to an interface when the scanner leaves it out
+            deps->is_interface = !cJSON_IsFalse(is_interface);
+        }
+    }
+
+    const cJSON *requires = cJSON_GetObjectItemCaseSensitive(rule, "requires");
+    cJSON_ArrayForEach(item, requires) {
+        const cJSON *name = cJSON_GetObjectItemCaseSensitive(item, "logical-name");
+        if (cJSON_IsString(name)) {
+            const cJSON *bmi = cJSON_GetObjectItemCaseSensitive(item, "compiled-module-path");
+            deps->requires = cstr_array_append(deps->requires, cstr_intern(name->valuestring));
+            deps->required_bmis = cstr_array_append(deps->required_bmis,
+                                                    cJSON_IsString(bmi) ? cstr_intern(bmi->valuestring) : NULL);
+        }
+    }
+    cJSON_Delete(root);
+
+    if (deps->provides != NULL && deps->bmi == NULL) {
+        // Partitions are named `module:partition`, which is no file name on Windows
+        String_Builder sb = {0};
+        sb_append_cstr(&sb, deps->provides);
+        for (size_t i = 0; i < sb.count; ++i) {
+            sb.elems[i] = sb.elems[i] == ':' ? '-' : sb.elems[i];
+        }
+        sb_append_cstr(&sb, scanner == MODULE_SCANNER_GCC ? ".gcm" : ".pcm");
+        ARRAY_APPEND(&sb, '\0');
+        Cstr dir = deps->object != NULL ? path_dirname(deps->object) : ".";
+        deps->bmi = path_normalize(PATH(dir, sb.elems));
+        ARRAY_FREE(&sb);
+    }
+    return 1;
+}
+
+int module_scan(Module_Scanner scanner, Cmd compile, Cstr source, Cstr object, Module_Deps *deps)
+{
+    memset(deps, 0, sizeof(*deps));
+    deps->source = source;
+    deps->object = object;
+
+    File_Map contents = file_map(source);
+    if (contents.data == NULL) {
+        return 0;
+    }
+
+    // The cache entry of a source is valid as long as the source and the
+    // flags it is scanned with are the same, and the headers in the depfile
+    // of the scan are older than the depfile
+    char key[2 * sizeof(unsigned long long) + 2];
+    const unsigned long long hash = (unsigned long long) cstr_hash_n(contents.data, contents.size)
+        ^ (unsigned long long) cstr_hash(cmd_show(compile)) * 31 ^ scanner;
+    snprintf(key, sizeof(key), "%016llx\n", hash);
+    file_unmap(&contents);
+
+    char name[2 * sizeof(unsigned long long) + 5];
+    snprintf(name, sizeof(name), "%016llx.ddi", (unsigned long long) cstr_hash(JOIN("\n", source, object)));
+    path_mkdirs(cstr_array_make(NOBUILD_MODULE_CACHE_DIR, NULL));
+    Cstr cache_path = PATH(NOBUILD_MODULE_CACHE_DIR, name);
+    Cstr depfile = CONCAT(cache_path, ".d");
+
+    char *cached = path_exists(cache_path) ? read_entire_file(cache_path, NULL) : NULL;
+    char *headers = cached != NULL && path_exists(depfile) ? read_entire_file(depfile, NULL) : NULL;
+    if (cached != NULL && headers != NULL && strncmp(cached, key, strlen(key)) == 0) {
+        Cstr_Array inputs = nobuild__depfile_parse(headers);
+        const int fresh = !path_needs_rebuild(cstr_array_make(depfile, NULL), inputs);
+        ARRAY_FREE(&inputs);
+        if (fresh && nobuild__module_parse(scanner, cached + strlen(key), deps)) {
+            free(headers);
+            free(cached);
+            return 1;
+        }
+    }
+    free(headers);
+    free(cached);
+
+    Cstr json_path = CONCAT(cache_path, ".json");
+    Cmd cmd = {0};
+    switch (scanner) {
+    case MODULE_SCANNER_CLANG: {
+        CMD_APPEND(&cmd, NOBUILD_CLANG_SCAN_DEPS, "-format=p1689", "--");
+        cmd_extend(&cmd, compile.line);
+        CMD_APPEND(&cmd, "-c", source, "-o", object, "-MD", "-MF", depfile, "-MT", object);
+        INFO("CMD: %s", cmd_show(cmd));
+        Fd json = fd_open_for_write(json_path);
+        pid_wait(cmd_run_async(cmd, NULL, &json));
+        fd_close(json);
+    }
+    break;
+
+    case MODULE_SCANNER_GCC: {
+        Cstr preprocessed = CONCAT(cache_path, ".i");
+        cmd_extend(&cmd, compile.line);
+        CMD_APPEND(&cmd, "-E", "-x", "c++", source, "-fmodules-ts", "-fdeps-format=p1689r5",
+                   CONCAT("-fdeps-file=", json_path), CONCAT("-fdeps-target=", object),
+                   "-MD", "-MF", depfile, "-MT", object, "-o", preprocessed);
+        INFO("CMD: %s", cmd_show(cmd));
+        cmd_run_sync(cmd);
+        path_rm(preprocessed);
+    }
+    break;
+
+    default:
+        PANIC("Unknown module scanner %d", (int) scanner);
+    }
+    ARRAY_FREE(&cmd.line);
+
+    size_t json_size = 0;
+    char *json = read_entire_file(json_path, &json_size);
+    path_rm(json_path);
+    if (json == NULL || !nobuild__module_parse(scanner, json, deps)) {
+        ERRO("Could not read the P1689 dependencies of %s", source);
+        free(json);
+        return 0;
+    }
+
+    String_Builder sb = {0};
+    sb_append_cstr(&sb, key);
+    sb_append_buf(&sb, json, json_size);
+    path_write_if_changed(cache_path, sb.elems, sb.count);
+    ARRAY_FREE(&sb);
+    free(json);
+    return 1;
+}
+
+static int nobuild__module_deps_compare(const void *a, const void *b)
+{
+    const size_t level_a = ((const Module_Deps *) a)->level;
+    const size_t level_b = ((const Module_Deps *) b)->level;
+    return level_a < level_b ? -1 : level_a > level_b;
+}
+
+int module_sort(Module_Deps *deps, size_t count)
+{
+    Cstr_Map providers = {0};
+    for (size_t i = 0; i < count; ++i) {
+        deps[i].level = 0;
+        if (deps[i].provides != NULL) {
+            if (cstr_map_put(&providers, deps[i].provides, &deps[i]) != NULL) {
+                ERRO("Module %s is provided by more than one source", deps[i].provides);
+            }
+        }
+    }
+
+    // Raise the level of every source above the levels of the modules it
+    // imports until nothing changes. A cycle keeps raising levels forever,
+    // so give up once a level reaches the number of sources.
+    int ok = 1;
+    for (int changed = 1; changed && ok;) {
+        changed = 0;
+        for (size_t i = 0; i < count && ok; ++i) {
+            for (size_t j = 0; j < deps[i].requires.count; ++j) {
+                const Module_Deps *provider = cstr_map_get(&providers, deps[i].requires.elems[j]);
+                if (provider != NULL && provider->level >= deps[i].level) {
+                    deps[i].level = provider->level + 1;
+                    changed = 1;
+                }
+            }
+
+            if (deps[i].level >= count) {
+                ERRO("Module imports of %s form a cycle", deps[i].source);
+                ok = 0;
+            }
+        }
+    }
+    cstr_map_free(&providers);
+
+    if (ok) {
+        // The providers map points into `deps`, so only sort once it is gone
+        qsort(deps, count, sizeof(*deps), nobuild__module_deps_compare);
+    }
+    return ok;
+}
+
+typedef struct {
+    const Module_Deps **elems;
+    size_t count;
+    size_t capacity;
+} Nobuild__Module_Units;
+
+void module_flags(Module_Scanner scanner, Cmd *cmd, const Module_Deps *deps, size_t count, size_t index)
+{
+    const Module_Deps *unit = &deps[index];
+
+    Cstr_Map providers = {0};
+    for (size_t i = 0; i < count; ++i) {
+        if (deps[i].provides != NULL) {
+            cstr_map_put(&providers, deps[i].provides, (void *) &deps[i]);
+        }
+    }
+
+    // Name and BMI of the provided module and of every module it imports,
+    // directly or not: loading the BMI of an import also loads the BMIs of
+    // its own imports, so the compiler has to find all of them
+    Cstr_Array modules = cstr_array_make(NULL);
+    Cstr_Set seen = {0};
+    if (unit->provides != NULL) {
+        modules = cstr_array_append(modules, unit->provides);
+        modules = cstr_array_append(modules, unit->bmi);
+        cstr_set_add(&seen, unit->provides);
+    }
+    Nobuild__Module_Units pending = {0};
+    ARRAY_APPEND(&pending, unit);
+    for (size_t p = 0; p < pending.count; ++p) {
+        const Module_Deps *importer = pending.elems[p];
+        for (size_t i = 0; i < importer->requires.count; ++i) {
+            Cstr name = importer->requires.elems[i];
+            if (!cstr_set_add(&seen, name)) {
+                continue;
+            }
+
+            const Module_Deps *provider = cstr_map_get(&providers, name);
+            Cstr bmi = i < importer->required_bmis.count ? importer->required_bmis.elems[i] : NULL;
+            if (provider != NULL) {
+                bmi = provider->bmi;
+                ARRAY_APPEND(&pending, provider);
+            }
+            if (bmi != NULL) {
+                modules = cstr_array_append(modules, name);
+                modules = cstr_array_append(modules, bmi);
+            }
+        }
+    }
+    ARRAY_FREE(&pending);
+    cstr_set_free(&seen);
+    cstr_map_free(&providers);
+
+    switch (scanner) {
+    case MODULE_SCANNER_CLANG:
+        for (size_t i = 0; i < modules.count; i += 2) {
+            if (i == 0 && unit->provides != NULL) {
+                CMD_APPEND(cmd, CONCAT("-fmodule-output=", modules.elems[1]));
+            } else {
+                CMD_APPEND(cmd, CONCAT("-fmodule-file=", modules.elems[i], "=", modules.elems[i + 1]));
+            }
+        }
+        break;
+
+    case MODULE_SCANNER_GCC: {
+        // One `<name> <bmi>` line per module, the provided one is written there too
+        String_Builder sb = {0};
+        for (size_t i = 0; i < modules.count; i += 2) {
+            sb_appendf(&sb, "%s %s\n", modules.elems[i], modules.elems[i + 1]);
+        }
+        char name[2 * sizeof(unsigned long long) + 8];
+        snprintf(name, sizeof(name), "%016llx.modmap", (unsigned long long) cstr_hash(JOIN("\n", unit->source, unit->object)));
+        path_mkdirs(cstr_array_make(NOBUILD_MODULE_CACHE_DIR, NULL));
+        Cstr mapper = PATH(NOBUILD_MODULE_CACHE_DIR, name);
+        path_write_if_changed(mapper, sb.elems, sb.count);
+        ARRAY_FREE(&sb);
+        CMD_APPEND(cmd, "-fmodules-ts", CONCAT("-fmodule-mapper=", mapper));
+    }
+    break;
+
+    default:
+        PANIC("Unknown module scanner %d", (int) scanner);
+    }
+
+    ARRAY_FREE(&modules);
+}
+
+typedef struct {
+    Cstr path;
+    unsigned long long size;
+} Nobuild__Unity_Source;
+
+static int nobuild__is_cxx_source(Cstr path)
+{
+    return ENDS_WITH(path, ".cpp") || ENDS_WITH(path, ".cc") || ENDS_WITH(path, ".cxx") || ENDS_WITH(path, ".C");
+}
+
+// C sources first, so C and C++ never share a batch, then by path
+static int nobuild__unity_source_compare(const void *a, const void *b)
+{
+    Cstr path_a = ((const Nobuild__Unity_Source *) a)->path;
+    Cstr path_b = ((const Nobuild__Unity_Source *) b)->path;
+    const int cxx_a = nobuild__is_cxx_source(path_a);
+    const int cxx_b = nobuild__is_cxx_source(path_b);
+    return cxx_a != cxx_b ? cxx_a - cxx_b : strcmp(path_a, path_b);
+}
+
+// Whether `file` is named like the unity files of `name`: `<name>_<hash>.c` or `.cpp`
+static int nobuild__is_unity_file(Cstr file, Cstr name)
+{
+    const size_t name_len = strlen(name);
+    if (strncmp(file, name, name_len) != 0 || file[name_len] != '_') {
+        return 0;
+    }
+
+    Cstr hash = file + name_len + 1;
+    for (size_t i = 0; i < 16; ++i) {
+        if (!isxdigit((unsigned char) hash[i])) {
+            return 0;
+        }
+    }
+    return strcmp(hash + 16, ".c") == 0 || strcmp(hash + 16, ".cpp") == 0;
+}
+
+// Writes the unity file of `sources[0..count)`, returns its path and adds its name to `written`
+static Cstr nobuild__unity_write(Unity_Options options, const Nobuild__Unity_Source *sources, size_t count, Cstr_Set *written)
+{
+    // Named after the first source, so the name stays as long as the batch starts there
+    char hash[17];
+    snprintf(hash, sizeof(hash), "%016llx", (unsigned long long) cstr_hash(sources[0].path));
+    Cstr name = CONCAT(options.name, "_", hash, nobuild__is_cxx_source(sources[0].path) ? ".cpp" : ".c");
+    cstr_set_add(written, cstr_intern(name));
+    Cstr unity_path = PATH(options.out_dir, name);
+
+    String_Builder sb = {0};
+    sb_append_cstr(&sb, "// Generated by nobuild, do not edit\n");
+    for (size_t i = 0; i < count; ++i) {
+        sb_append_cstr(&sb, "#include \"");
+        for (Cstr c = path_realpath(sources[i].path); *c != '\0'; ++c) {
+            if (*c == '\\' || *c == '"') {
+                ARRAY_APPEND(&sb, '\\');
+            }
+            ARRAY_APPEND(&sb, *c);
+        }
+        sb_append_cstr(&sb, "\"\n");
+    }
+    path_write_if_changed(unity_path, sb.elems, sb.count);
+    ARRAY_FREE(&sb);
+
+    return unity_path;
+}
+
+Cstr_Array unity_build(Cstr_Array sources, Unity_Options options)
+{
+    if (options.name == NULL) {
+        options.name = "unity";
+    }
+
+    Cstr_Set excluded = {0};
+    for (size_t i = 0; i < options.excluded.count; ++i) {
+        cstr_set_add(&excluded, path_normalize(options.excluded.elems[i]));
+    }
+
+    Fd_Batch batch = {0};
+    Cstr_Array compiled_alone = cstr_array_make(NULL);
+    for (size_t i = 0; i < sources.count; ++i) {
+        if (cstr_set_contains(&excluded, path_normalize(sources.elems[i]))) {
+            compiled_alone = cstr_array_append(compiled_alone, sources.elems[i]);
+        } else {
+            fd_batch_stat(&batch, sources.elems[i]);
+        }
+    }
+    cstr_set_free(&excluded);
+    fd_batch_submit(&batch);
+
+    const size_t count = batch.count;
+    Nobuild__Unity_Source *batched = malloc(sizeof(*batched) * (count + 1));
+    if (batched == NULL) {
+        PANIC("Could not allocate memory: %s", strerror(errno));
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (batch.elems[i].error != 0) {
+            WARN("Could not stat %s: %s", batch.elems[i].path, strerror(batch.elems[i].error));
+        }
+        batched[i].path = batch.elems[i].path;
+        batched[i].size = batch.elems[i].file_size;
+    }
+    ARRAY_FREE(&batch);
+    qsort(batched, count, sizeof(*batched), nobuild__unity_source_compare);
+
+    size_t max_sources = options.max_sources;
+    if (max_sources == 0 && options.max_bytes == 0) {
+        max_sources = NOBUILD_UNITY_SIZE;
+    }
+
+    // A batch ends after a source whose path hashes to a multiple of
+    // `spacing`, about every `spacing` sources, so where batches end does not
+    // depend on the other sources. It also ends early when it is full. The
+    // spacing only depends on the options, as the sizes of the sources change.
+    size_t limit = max_sources;
+    if (options.max_bytes > 0) {
+        const size_t by_bytes = (size_t) (options.max_bytes / NOBUILD_UNITY_SOURCE_BYTES);
+        limit = limit == 0 || by_bytes < limit ? by_bytes : limit;
+    }
+    const size_t spacing = limit / 2 > 0 ? limit / 2 : 1;
+
+    path_mkdirs(cstr_array_make(options.out_dir, NULL));
+    Cstr_Array result = cstr_array_make(NULL);
+    Cstr_Set written = {0};
+    size_t begin = 0;
+    unsigned long long bytes = 0;
+    for (size_t i = 0; i < count; ++i) {
+        bytes += batched[i].size;
+
+        int end = i + 1 == count || cstr_hash(batched[i].path) % spacing == 0;
+        if (!end) {
+            const Nobuild__Unity_Source *next = &batched[i + 1];
+            end = nobuild__is_cxx_source(next->path) != nobuild__is_cxx_source(batched[i].path)
+                || (max_sources > 0 && i + 1 - begin >= max_sources)
+                || (options.max_bytes > 0 && bytes + next->size > options.max_bytes);
+        }
+
+        if (end) {
+            Cstr unity_path = nobuild__unity_write(options, &batched[begin], i + 1 - begin, &written);
+            result = cstr_array_append(result, unity_path);
+            begin = i + 1;
+            bytes = 0;
+        }
+    }
+    free(batched);
+
+    // Remove the unity files of batches that are gone, so globbing the
+    // directory does not compile their sources twice
+    Cstr_Array stale = cstr_array_make(NULL);
+    FOREACH_FILE_IN_DIR(file, options.out_dir, {
+        if (nobuild__is_unity_file(file, options.name) && !cstr_set_contains(&written, file)) {
+            stale = cstr_array_append(stale, PATH(options.out_dir, file));
+        }
+    });
+    for (size_t i = 0; i < stale.count; ++i) {
+        path_rm(stale.elems[i]);
+    }
+    cstr_set_free(&written);
+
+    return cstr_array_concat(result, compiled_alone);
+}
+
+static int nobuild__is_cxx_pch(Cmd compile, Cstr header)
+{
+    Cstr compiler = compile.line.count > 0 ? path_basename(compile.line.elems[0]) : "";
+    return ENDS_WITH(compiler, "++") || ENDS_WITH(compiler, "++.exe")
+        || ENDS_WITH(header, ".hpp") || ENDS_WITH(header, ".hh") || ENDS_WITH(header, ".hxx") || ENDS_WITH(header, ".H");
+}
+
+Pch pch_build(Pch_Compiler compiler, Cmd compile, Cstr header)
+{
+    Pch pch = {0};
+    pch.compiler = compiler;
+
+    Cstr header_path = path_realpath(header);
+    if (!path_exists(header_path)) {
+        ERRO("Could not find the header %s to precompile", header);
+        return pch;
+    }
+
+    char key[2 * sizeof(unsigned long long) + 1];
+    snprintf(key, sizeof(key), "%016llx", (unsigned long long) cstr_hash(JOIN("\n", cmd_show(compile), header_path)) ^ compiler);
+    Cstr pch_dir = PATH(NOBUILD_PCH_DIR, key);
+    path_mkdirs(cstr_array_make(pch_dir, NULL));
+
+    Cstr source = header_path;
+    switch (compiler) {
+    case PCH_COMPILER_GCC: {
+        // GCC falls back to the file `-include` names when the `.gch` does
+        // not match the compile, so that file includes the header
+        pch.include = PATH(pch_dir, path_basename(header_path));
+        pch.path = CONCAT(pch.include, ".gch");
+        String_Builder sb = {0};
+        sb_append_cstr(&sb, "// Generated by nobuild, do not edit\n#include \"");
+        for (Cstr c = header_path; *c != '\0'; ++c) {
+            if (*c == '\\' || *c == '"') {
+                ARRAY_APPEND(&sb, '\\');
+            }
+            ARRAY_APPEND(&sb, *c);
+        }
+        sb_append_cstr(&sb, "\"\n");
+        path_write_if_changed(pch.include, sb.elems, sb.count);
+        ARRAY_FREE(&sb);
+        source = pch.include;
+    }
+    break;
+
+    case PCH_COMPILER_CLANG:
+        pch.path = PATH(pch_dir, CONCAT(path_basename(header_path), ".pch"));
+        break;
+
+    default:
+        PANIC("Unknown PCH compiler %d", (int) compiler);
+    }
+
+    Cstr_Array include_dirs = cstr_array_make(NULL);
+    for (size_t i = 0; i < compile.line.count; ++i) {
+        Cstr arg = compile.line.elems[i];
+        if (strcmp(arg, "-I") == 0 && i + 1 < compile.line.count) {
+            include_dirs = cstr_array_append(include_dirs, compile.line.elems[++i]);
+        } else if (STARTS_WITH(arg, "-I")) {
+            include_dirs = cstr_array_append(include_dirs, arg);
+        }
+    }
+    Cstr_Array inputs = cstr_array_append(path_scan_includes(header_path, include_dirs), header_path);
+    ARRAY_FREE(&include_dirs);
+
+    if (path_needs_rebuild(cstr_array_make(pch.path, NULL), inputs)) {
+        Cmd cmd = {0};
+        cmd_extend(&cmd, compile.line);
+        CMD_APPEND(&cmd, "-x", nobuild__is_cxx_pch(compile, header) ? "c++-header" : "c-header", source, "-o", pch.path);
+        INFO("CMD: %s", cmd_show(cmd));
+        cmd_run_sync(cmd);
+        ARRAY_FREE(&cmd.line);
+    }
+    ARRAY_FREE(&inputs);
+
+    return pch;
+}
+
+void pch_use(Cmd *cmd, Pch pch)
+{
+    if (pch.path == NULL) {
+        return;
+    }
+
+    switch (pch.compiler) {
+    case PCH_COMPILER_GCC:
+        CMD_APPEND(cmd, "-include", pch.include, "-Winvalid-pch");
+        break;
+
+    case PCH_COMPILER_CLANG:
+        CMD_APPEND(cmd, "-include-pch", pch.path);
+        break;
+
+    default:
+        PANIC("Unknown PCH compiler %d", (int) pch.compiler);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+  Copyright (c) 2009-2017 Dave Gamble and cJSON contributors
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in
+  all copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+  THE SOFTWARE.
+*/
+
+/* cJSON */
+/* JSON parser in C. */
+
+/* disable warnings about old C89 functions in MSVC */
+#if !defined(_CRT_SECURE_NO_DEPRECATE) && defined(_MSC_VER)
+#define _CRT_SECURE_NO_DEPRECATE
+#endif
+
+#ifdef __GNUC__
+#pragma GCC visibility push(default)
+#endif
+#if defined(_MSC_VER)
+#pragma warning (push)
+/* disable warning about single line comments in system headers */
+#pragma warning (disable : 4001)
+#endif
+
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <ctype.h>
+#include <float.h>
+
+#ifdef ENABLE_LOCALES
+#include <locale.h>
+#endif
+
+#if defined(_MSC_VER)
+#pragma warning (pop)
+#endif
+#ifdef __GNUC__
+#pragma GCC visibility pop
+#endif
+
+
+/* define our own boolean type */
+#ifdef true
+#undef true
+#endif
+#define true ((cJSON_bool)1)
+
+#ifdef false
+#undef false
+#endif
+#define false ((cJSON_bool)0)
+
+/* define isnan and isinf for ANSI C, if in C99 or above, isnan and isinf has been defined in math.h */
+#ifndef isinf
+#define isinf(d) (isnan((d - d)) && !isnan(d))
+#endif
+#ifndef isnan
+#define isnan(d) (d != d)
+#endif
+
+#ifndef NAN
+#ifdef _WIN32
+#define NAN sqrt(-1.0)
+#else
+#define NAN 0.0/0.0
+#endif
+#endif
+
+typedef struct {
+    const unsigned char *json;
+    size_t position;
+} error;
+static error global_error = { NULL, 0 };
+
+CJSON_PUBLIC(const char *) cJSON_GetErrorPtr(void)
+{
+    return (const char*) (global_error.json + global_error.position);
+}
+
+CJSON_PUBLIC(char *) cJSON_GetStringValue(const cJSON * const item)
+{
+    if (!cJSON_IsString(item))
+    {
+        return NULL;
+    }
+
+    return item->valuestring;
+}
+
+CJSON_PUBLIC(double) cJSON_GetNumberValue(const cJSON * const item)
+{
+    if (!cJSON_IsNumber(item))
+    {
+        return (double) NAN;
+    }
+
+    return item->valuedouble;
+}
+
+/* This is a safeguard to prevent copy-pasters from using incompatible C and header files */
+#if (CJSON_VERSION_MAJOR != 1) || (CJSON_VERSION_MINOR != 7) || (CJSON_VERSION_PATCH != 16)
+    #error cJSON.h and cJSON.c have different versions. Make sure that both have the same.
+#endif
+
+CJSON_PUBLIC(const char*) cJSON_Version(void)
+{
+    static char version[15];
+    sprintf(version, "%i.%i.%i", CJSON_VERSION_MAJOR, CJSON_VERSION_MINOR, CJSON_VERSION_PATCH);
+
+    return version;
+}
+
+/* Case insensitive string comparison, doesn't consider two NULL pointers equal though */
+static int case_insensitive_strcmp(const unsigned char *string1, const unsigned char *string2)
+{
+    if ((string1 == NULL) || (string2 == NULL))
+    {
+        return 1;
+    }
+
+    if (string1 == string2)
+    {
+        return 0;
+    }
+
+    for(; tolower(*string1) == tolower(*string2); (void)string1++, string2++)
+    {
+        if (*string1 == '\0')
+        {
+            return 0;
+        }
+    }
+
+    return tolower(*string1) - tolower(*string2);
+}
+
+typedef struct internal_hooks
+{
+    void *(CJSON_CDECL *allocate)(size_t size);
+    void (CJSON_CDECL *deallocate)(void *pointer);
+    void *(CJSON_CDECL *reallocate)(void *pointer, size_t size);
+} internal_hooks;
+
+#if defined(_MSC_VER)
+/* work around MSVC error C2322: '...' address of dllimport '...' is not static */
+static void * CJSON_CDECL internal_malloc(size_t size)
+{
+    return malloc(size);
+}
+static void CJSON_CDECL internal_free(void *pointer)
+{
+    free(pointer);
+}
+static void * CJSON_CDECL internal_realloc(void *pointer, size_t size)
+{
+    return realloc(pointer, size);
+}
+#else
+#define internal_malloc malloc
+#define internal_free free
+#define internal_realloc realloc
+#endif
+
+/* strlen of character literals resolved at compile time */
+#define static_strlen(string_literal) (sizeof(string_literal) - sizeof(""))
+
+static internal_hooks global_hooks = { internal_malloc, internal_free, internal_realloc };
+
+static unsigned char* cJSON_strdup(const unsigned char* string, const internal_hooks * const hooks)
+{
+    size_t length = 0;
+    unsigned char *copy = NULL;
+
+    if (string == NULL)
+    {
+        return NULL;
+    }
+
+    length = strlen((const char*)string) + sizeof("");
+    copy = (unsigned char*)hooks->allocate(length);
+    if (copy == NULL)
+    {
+        return NULL;
+    }
+    memcpy(copy, string, length);
+
+    return copy;
+}
+
+CJSON_PUBLIC(void) cJSON_InitHooks(cJSON_Hooks* hooks)
+{
+    if (hooks == NULL)
+    {
+        /* Reset hooks */
+        global_hooks.allocate = malloc;
+        global_hooks.deallocate = free;
+        global_hooks.reallocate = realloc;
+        return;
+    }
+
+    global_hooks.allocate = malloc;
+    if (hooks->malloc_fn != NULL)
+    {
+        global_hooks.allocate = hooks->malloc_fn;
+    }
+
+    global_hooks.deallocate = free;
+    if (hooks->free_fn != NULL)
+    {
+        global_hooks.deallocate = hooks->free_fn;
+    }
+
+    /* use realloc only if both free and malloc are used */
+    global_hooks.reallocate = NULL;
+    if ((global_hooks.allocate == malloc) && (global_hooks.deallocate == free))
+    {
+        global_hooks.reallocate = realloc;
+    }
+}
+
+/* Internal constructor. */
+static cJSON *cJSON_New_Item(const internal_hooks * const hooks)
+{
+    cJSON* node = (cJSON*)hooks->allocate(sizeof(cJSON));
+    if (node)
+    {
+        memset(node, '\0', sizeof(cJSON));
+    }
+
+    return node;
+}
+
+/* Delete a cJSON structure. */
+CJSON_PUBLIC(void) cJSON_Delete(cJSON *item)
+{
+    cJSON *next = NULL;
+    while (item != NULL)
+    {
+        next = item->next;
+        if (!(item->type & cJSON_IsReference) && (item->child != NULL))
+        {
+            cJSON_Delete(item->child);
+        }
+        if (!(item->type & cJSON_IsReference) && (item->valuestring != NULL))
+        {
+            global_hooks.deallocate(item->valuestring);
+        }
+        if (!(item->type & cJSON_StringIsConst) && (item->string != NULL))
+        {
+            global_hooks.deallocate(item->string);
+        }
+        global_hooks.deallocate(item);
+        item = next;
+    }
+}
+
+/* get the decimal point character of the current locale */
+static unsigned char get_decimal_point(void)
+{
+#ifdef ENABLE_LOCALES
+    struct lconv *lconv = localeconv();
+    return (unsigned char) lconv->decimal_point[0];
+#else
+    return '.';
+#endif
+}
+
+typedef struct
+{
+    const unsigned char *content;
+    size_t length;
+    size_t offset;
+    size_t depth; /* How deeply nested (in arrays/objects) is the input at the current offset. */
+    internal_hooks hooks;
+} parse_buffer;
+
+/* check if the given size is left to read in a given parse buffer (starting with 1) */
+#define can_read(buffer, size) ((buffer != NULL) && (((buffer)->offset + size) <= (buffer)->length))
+/* check if the buffer can be accessed at the given index (starting with 0) */
+#define can_access_at_index(buffer, index) ((buffer != NULL) && (((buffer)->offset + index) < (buffer)->length))
+#define cannot_access_at_index(buffer, index) (!can_access_at_index(buffer, index))
+/* get a pointer to the buffer at the position */
+#define buffer_at_offset(buffer) ((buffer)->content + (buffer)->offset)
+
+/* Parse the input text to generate a number, and populate the result into item. */
+static cJSON_bool parse_number(cJSON * const item, parse_buffer * const input_buffer)
+{
+    double number = 0;
+    unsigned char *after_end = NULL;
+    unsigned char number_c_string[64];
+    unsigned char decimal_point = get_decimal_point();
+    size_t i = 0;
+
+    if ((input_buffer == NULL) || (input_buffer->content == NULL))
+    {
+        return false;
+    }
+
+    /* copy the number into a temporary buffer and replace '.' with the decimal point
+     * of the current locale (for strtod)
+     * This also takes care of '\0' not necessarily being available for marking the end of the input */
+    for (i = 0; (i < (sizeof(number_c_string) - 1)) && can_access_at_index(input_buffer, i); i++)
+    {
+        switch (buffer_at_offset(input_buffer)[i])
+        {
+            case '0':
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+            case '5':
+            case '6':
+            case '7':
+            case '8':
+            case '9':
+            case '+':
+            case '-':
+            case 'e':
+            case 'E':
+                number_c_string[i] = buffer_at_offset(input_buffer)[i];
+                break;
+
+            case '.':
+                number_c_string[i] = decimal_point;
+                break;
+
+            default:
+                goto loop_end;
+        }
+    }
+loop_end:
+    number_c_string[i] = '\0';
+
+    number = strtod((const char*)number_c_string, (char**)&after_end);
+    if (number_c_string == after_end)
+    {
+        return false; /* parse_error */
+    }
+
+    item->valuedouble = number;
+
+    /* use saturation in case of overflow */
+    if (number >= INT_MAX)
+    {
+        item->valueint = INT_MAX;
+    }
+    else if (number <= (double)INT_MIN)
+    {
+        item->valueint = INT_MIN;
+    }
+    else
+    {
+        item->valueint = (int)number;
+    }
+
+    item->type = cJSON_Number;
+
+    input_buffer->offset += (size_t)(after_end - number_c_string);
+    return true;
+}
+
+/* don't ask me, but the original cJSON_SetNumberValue returns an integer or double */
+CJSON_PUBLIC(double) cJSON_SetNumberHelper(cJSON *object, double number)
+{
+    if (number >= INT_MAX)
+    {
+        object->valueint = INT_MAX;
+    }
+    else if (number <= (double)INT_MIN)
+    {
+        object->valueint = INT_MIN;
+    }
+    else
+    {
+        object->valueint = (int)number;
+    }
+
+    return object->valuedouble = number;
+}
+
+CJSON_PUBLIC(char*) cJSON_SetValuestring(cJSON *object, const char *valuestring)
+{
+    char *copy = NULL;
+    /* if object's type is not cJSON_String or is cJSON_IsReference, it should not set valuestring */
+    if (!(object->type & cJSON_String) || (object->type & cJSON_IsReference))
+    {
+        return NULL;
+    }
+    if (strlen(valuestring) <= strlen(object->valuestring))
+    {
+        strcpy(object->valuestring, valuestring);
+        return object->valuestring;
+    }
+    copy = (char*) cJSON_strdup((const unsigned char*)valuestring, &global_hooks);
+    if (copy == NULL)
+    {
+        return NULL;
+    }
+    if (object->valuestring != NULL)
+    {
+        cJSON_free(object->valuestring);
+    }
+    object->valuestring = copy;
+
+    return copy;
+}
+
+typedef struct
+{
+    unsigned char *buffer;
+    size_t length;
+    size_t offset;
+    size_t depth; /* current nesting depth (for formatted printing) */
+    cJSON_bool noalloc;
+    cJSON_bool format; /* is this print a formatted print */
+    internal_hooks hooks;
+} printbuffer;
+
+/* realloc printbuffer if necessary to have at least "needed" bytes more */
+static unsigned char* ensure(printbuffer * const p, size_t needed)
+{
+    unsigned char *newbuffer = NULL;
+    size_t newsize = 0;
+
+    if ((p == NULL) || (p->buffer == NULL))
+    {
+        return NULL;
+    }
+
+    if ((p->length > 0) && (p->offset >= p->length))
+    {
+        /* make sure that offset is valid */
+        return NULL;
+    }
+
+    if (needed > INT_MAX)
+    {
+        /* sizes bigger than INT_MAX are currently not supported */
+        return NULL;
+    }
+
+    needed += p->offset + 1;
+    if (needed <= p->length)
+    {
+        return p->buffer + p->offset;
+    }
+
+    if (p->noalloc) {
+        return NULL;
+    }
+
+    /* calculate new buffer size */
+    if (needed > (INT_MAX / 2))
+    {
+        /* overflow of int, use INT_MAX if possible */
+        if (needed <= INT_MAX)
+        {
+            newsize = INT_MAX;
+        }
+        else
+        {
+            return NULL;
+        }
+    }
+    else
+    {
+        newsize = needed * 2;
+    }
+
+    if (p->hooks.reallocate != NULL)
+    {
+        /* reallocate with realloc if available */
+        newbuffer = (unsigned char*)p->hooks.reallocate(p->buffer, newsize);
+        if (newbuffer == NULL)
+        {
+            p->hooks.deallocate(p->buffer);
+            p->length = 0;
+            p->buffer = NULL;
+
+            return NULL;
+        }
+    }
+    else
+    {
+        /* otherwise reallocate manually */
+        newbuffer = (unsigned char*)p->hooks.allocate(newsize);
+        if (!newbuffer)
+        {
+            p->hooks.deallocate(p->buffer);
+            p->length = 0;
+            p->buffer = NULL;
+
+            return NULL;
+        }
+
+        memcpy(newbuffer, p->buffer, p->offset + 1);
+        p->hooks.deallocate(p->buffer);
+    }
+    p->length = newsize;
+    p->buffer = newbuffer;
+
+    return newbuffer + p->offset;
+}
+
+/* calculate the new length of the string in a printbuffer and update the offset */
+static void update_offset(printbuffer * const buffer)
+{
+    const unsigned char *buffer_pointer = NULL;
+    if ((buffer == NULL) || (buffer->buffer == NULL))
+    {
+        return;
+    }
+    buffer_pointer = buffer->buffer + buffer->offset;
+
+    buffer->offset += strlen((const char*)buffer_pointer);
+}
+
+/* securely comparison of floating-point variables */
+static cJSON_bool compare_double(double a, double b)
+{
+    double maxVal = fabs(a) > fabs(b) ? fabs(a) : fabs(b);
+    return (fabs(a - b) <= maxVal * DBL_EPSILON);
+}
+
+/* Render the number nicely from the given item into a string. */
+static cJSON_bool print_number(const cJSON * const item, printbuffer * const output_buffer)
+{
+    unsigned char *output_pointer = NULL;
+    double d = item->valuedouble;
+    int length = 0;
+    size_t i = 0;
+    unsigned char number_buffer[26] = {0}; /* temporary buffer to print the number into */
+    unsigned char decimal_point = get_decimal_point();
+    double test = 0.0;
+
+    if (output_buffer == NULL)
+    {
+        return false;
+    }
+
+    /* This checks for NaN and Infinity */
+    if (isnan(d) || isinf(d))
+    {
+        length = sprintf((char*)number_buffer, "null");
+    }
+	else if(d == (double)item->valueint)
+	{
+		length = sprintf((char*)number_buffer, "%d", item->valueint);
+	}
+    else
+    {
+        /* Try 15 decimal places of precision to avoid nonsignificant nonzero digits */
+        length = sprintf((char*)number_buffer, "%1.15g", d);
+
+        /* Check whether the original double can be recovered */
+        if ((sscanf((char*)number_buffer, "%lg", &test) != 1) || !compare_double((double)test, d))
+        {
+            /* If not, print with 17 decimal places of precision */
+            length = sprintf((char*)number_buffer, "%1.17g", d);
+        }
+    }
+
+    /* sprintf failed or buffer overrun occurred */
+    if ((length < 0) || (length > (int)(sizeof(number_buffer) - 1)))
+    {
+        return false;
+    }
+
+    /* reserve appropriate space in the output */
+    output_pointer = ensure(output_buffer, (size_t)length + sizeof(""));
+    if (output_pointer == NULL)
+    {
+        return false;
+    }
+
+    /* copy the printed number to the output and replace locale
+     * dependent decimal point with '.' */
+    for (i = 0; i < ((size_t)length); i++)
+    {
+        if (number_buffer[i] == decimal_point)
+        {
+            output_pointer[i] = '.';
+            continue;
+        }
+
+        output_pointer[i] = number_buffer[i];
+    }
+    output_pointer[i] = '\0';
+
+    output_buffer->offset += (size_t)length;
+
+    return true;
+}
+
+/* parse 4 digit hexadecimal number */
+static unsigned parse_hex4(const unsigned char * const input)
+{
+    unsigned int h = 0;
+    size_t i = 0;
+
+    for (i = 0; i < 4; i++)
+    {
+        /* parse digit */
+        if ((input[i] >= '0') && (input[i] <= '9'))
+        {
+            h += (unsigned int) input[i] - '0';
+        }
+        else if ((input[i] >= 'A') && (input[i] <= 'F'))
+        {
+            h += (unsigned int) 10 + input[i] - 'A';
+        }
+        else if ((input[i] >= 'a') && (input[i] <= 'f'))
+        {
+            h += (unsigned int) 10 + input[i] - 'a';
+        }
+        else /* invalid */
+        {
+            return 0;
+        }
+
+        if (i < 3)
+        {
+            /* shift left to make place for the next nibble */
+            h = h << 4;
+        }
+    }
+
+    return h;
+}
+
+/* converts a UTF-16 literal to UTF-8
+ * A literal can be one or two sequences of the form \uXXXX */
+static unsigned char utf16_literal_to_utf8(const unsigned char * const input_pointer, const unsigned char * const input_end, unsigned char **output_pointer)
+{
+    long unsigned int codepoint = 0;
+    unsigned int first_code = 0;
+    const unsigned char *first_sequence = input_pointer;
+    unsigned char utf8_length = 0;
+    unsigned char utf8_position = 0;
+    unsigned char sequence_length = 0;
+    unsigned char first_byte_mark = 0;
+
+    if ((input_end - first_sequence) < 6)
+    {
+        /* input ends unexpectedly */
+        goto fail;
+    }
+
+    /* get the first utf16 sequence */
+    first_code = parse_hex4(first_sequence + 2);
+
+    /* check that the code is valid */
+    if (((first_code >= 0xDC00) && (first_code <= 0xDFFF)))
+    {
+        goto fail;
+    }
+
+    /* UTF16 surrogate pair */
+    if ((first_code >= 0xD800) && (first_code <= 0xDBFF))
+    {
+        const unsigned char *second_sequence = first_sequence + 6;
+        unsigned int second_code = 0;
+        sequence_length = 12; /* \uXXXX\uXXXX */
+
+        if ((input_end - second_sequence) < 6)
+        {
+            /* input ends unexpectedly */
+            goto fail;
+        }
+
+        if ((second_sequence[0] != '\\') || (second_sequence[1] != 'u'))
+        {
+            /* missing second half of the surrogate pair */
+            goto fail;
+        }
+
+        /* get the second utf16 sequence */
+        second_code = parse_hex4(second_sequence + 2);
+        /* check that the code is valid */
+        if ((second_code < 0xDC00) || (second_code > 0xDFFF))
+        {
+            /* invalid second half of the surrogate pair */
+            goto fail;
+        }
+
+
+        /* calculate the unicode codepoint from the surrogate pair */
+        codepoint = 0x10000 + (((first_code & 0x3FF) << 10) | (second_code & 0x3FF));
+    }
+    else
+    {
+        sequence_length = 6; /* \uXXXX */
+        codepoint = first_code;
+    }
+
+    /* encode as UTF-8
+     * takes at maximum 4 bytes to encode:
+     * 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx */
+    if (codepoint < 0x80)
+    {
+        /* normal ascii, encoding 0xxxxxxx */
+        utf8_length = 1;
+    }
+    else if (codepoint < 0x800)
+    {
+        /* two bytes, encoding 110xxxxx 10xxxxxx */
+        utf8_length = 2;
+        first_byte_mark = 0xC0; /* 11000000 */
+    }
+    else if (codepoint < 0x10000)
+    {
+        /* three bytes, encoding 1110xxxx 10xxxxxx 10xxxxxx */
+        utf8_length = 3;
+        first_byte_mark = 0xE0; /* 11100000 */
+    }
+    else if (codepoint <= 0x10FFFF)
+    {
+        /* four bytes, encoding 1110xxxx 10xxxxxx 10xxxxxx 10xxxxxx */
+        utf8_length = 4;
+        first_byte_mark = 0xF0; /* 11110000 */
+    }
+    else
+    {
+        /* invalid unicode codepoint */
+        goto fail;
+    }
+
+    /* encode as utf8 */
+    for (utf8_position = (unsigned char)(utf8_length - 1); utf8_position > 0; utf8_position--)
+    {
+        /* 10xxxxxx */
+        (*output_pointer)[utf8_position] = (unsigned char)((codepoint | 0x80) & 0xBF);
+        codepoint >>= 6;
+    }
+    /* encode first byte */
+    if (utf8_length > 1)
+    {
+        (*output_pointer)[0] = (unsigned char)((codepoint | first_byte_mark) & 0xFF);
+    }
+    else
+    {
+        (*output_pointer)[0] = (unsigned char)(codepoint & 0x7F);
+    }
+
+    *output_pointer += utf8_length;
+
+    return sequence_length;
+
+fail:
+    return 0;
+}
+
+/* Parse the input text into an unescaped cinput, and populate item. */
+static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_buffer)
+{
+    const unsigned char *input_pointer = buffer_at_offset(input_buffer) + 1;
+    const unsigned char *input_end = buffer_at_offset(input_buffer) + 1;
+    unsigned char *output_pointer = NULL;
+    unsigned char *output = NULL;
+
+    /* not a string */
+    if (buffer_at_offset(input_buffer)[0] != '\"')
+    {
+        goto fail;
+    }
+
+    {
+        /* calculate approximate size of the output (overestimate) */
+        size_t allocation_length = 0;
+        size_t skipped_bytes = 0;
+        while (((size_t)(input_end - input_buffer->content) < input_buffer->length) && (*input_end != '\"'))
+        {
+            /* is escape sequence */
+            if (input_end[0] == '\\')
+            {
+                if ((size_t)(input_end + 1 - input_buffer->content) >= input_buffer->length)
+                {
+                    /* prevent buffer overflow when last input character is a backslash */
+                    goto fail;
+                }
+                skipped_bytes++;
+                input_end++;
+            }
+            input_end++;
+        }
+        if (((size_t)(input_end - input_buffer->content) >= input_buffer->length) || (*input_end != '\"'))
+        {
+            goto fail; /* string ended unexpectedly */
+        }
+
+        /* This is at most how much we need for the output */
+        allocation_length = (size_t) (input_end - buffer_at_offset(input_buffer)) - skipped_bytes;
+        output = (unsigned char*)input_buffer->hooks.allocate(allocation_length + sizeof(""));
+        if (output == NULL)
+        {
+            goto fail; /* allocation failure */
+        }
+    }
+
+    output_pointer = output;
+    /* loop through the string literal */
+    while (input_pointer < input_end)
+    {
+        if (*input_pointer != '\\')
+        {
+            *output_pointer++ = *input_pointer++;
+        }
+        /* escape sequence */
+        else
+        {
+            unsigned char sequence_length = 2;
+            if ((input_end - input_pointer) < 1)
+            {
+                goto fail;
+            }
+
+            switch (input_pointer[1])
+            {
+                case 'b':
+                    *output_pointer++ = '\b';
+                    break;
+                case 'f':
+                    *output_pointer++ = '\f';
+                    break;
+                case 'n':
+                    *output_pointer++ = '\n';
+                    break;
+                case 'r':
+                    *output_pointer++ = '\r';
+                    break;
+                case 't':
+                    *output_pointer++ = '\t';
+                    break;
+                case '\"':
+                case '\\':
+                case '/':
+                    *output_pointer++ = input_pointer[1];
+                    break;
+
+                /* UTF-16 literal */
+                case 'u':
+                    sequence_length = utf16_literal_to_utf8(input_pointer, input_end, &output_pointer);
+                    if (sequence_length == 0)
+                    {
+                        /* failed to convert UTF16-literal to UTF-8 */
+                        goto fail;
+                    }
+                    break;
+
+                default:
+                    goto fail;
+            }
+            input_pointer += sequence_length;
+        }
+    }
+
+    /* zero terminate the output */
+    *output_pointer = '\0';
+
+    item->type = cJSON_String;
+    item->valuestring = (char*)output;
+
+    input_buffer->offset = (size_t) (input_end - input_buffer->content);
+    input_buffer->offset++;
+
+    return true;
+
+fail:
+    if (output != NULL)
+    {
+        input_buffer->hooks.deallocate(output);
+    }
+
+    if (input_pointer != NULL)
+    {
+        input_buffer->offset = (size_t)(input_pointer - input_buffer->content);
+    }
+
+    return false;
+}
+
+/* Render the cstring provided to an escaped version that can be printed. */
+static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffer * const output_buffer)
+{
+    const unsigned char *input_pointer = NULL;
+    unsigned char *output = NULL;
+    unsigned char *output_pointer = NULL;
+    size_t output_length = 0;
+    /* numbers of additional characters needed for escaping */
+    size_t escape_characters = 0;
+
+    if (output_buffer == NULL)
+    {
+        return false;
+    }
+
+    /* empty string */
+    if (input == NULL)
+    {
+        output = ensure(output_buffer, sizeof("\"\""));
+        if (output == NULL)
+        {
+            return false;
+        }
+        strcpy((char*)output, "\"\"");
+
+        return true;
+    }
+
+    /* set "flag" to 1 if something needs to be escaped */
+    for (input_pointer = input; *input_pointer; input_pointer++)
+    {
+        switch (*input_pointer)
+        {
+            case '\"':
+            case '\\':
+            case '\b':
+            case '\f':
+            case '\n':
+            case '\r':
+            case '\t':
+                /* one character escape sequence */
+                escape_characters++;
+                break;
+            default:
+                if (*input_pointer < 32)
+                {
+                    /* UTF-16 escape sequence uXXXX */
+                    escape_characters += 5;
+                }
+                break;
+        }
+    }
+    output_length = (size_t)(input_pointer - input) + escape_characters;
+
+    output = ensure(output_buffer, output_length + sizeof("\"\""));
+    if (output == NULL)
+    {
+        return false;
+    }
+
+    /* no characters have to be escaped */
+    if (escape_characters == 0)
+    {
+        output[0] = '\"';
+        memcpy(output + 1, input, output_length);
+        output[output_length + 1] = '\"';
+        output[output_length + 2] = '\0';
+
+        return true;
+    }
+
+    output[0] = '\"';
+    output_pointer = output + 1;
+    /* copy the string */
+    for (input_pointer = input; *input_pointer != '\0'; (void)input_pointer++, output_pointer++)
+    {
+        if ((*input_pointer > 31) && (*input_pointer != '\"') && (*input_pointer != '\\'))
+        {
+            /* normal character, copy */
+            *output_pointer = *input_pointer;
+        }
+        else
+        {
+            /* character needs to be escaped */
+            *output_pointer++ = '\\';
+            switch (*input_pointer)
+            {
+                case '\\':
+                    *output_pointer = '\\';
+                    break;
+                case '\"':
+                    *output_pointer = '\"';
+                    break;
+                case '\b':
+                    *output_pointer = 'b';
+                    break;
+                case '\f':
+                    *output_pointer = 'f';
+                    break;
+                case '\n':
+                    *output_pointer = 'n';
+                    break;
+                case '\r':
+                    *output_pointer = 'r';
+                    break;
+                case '\t':
+                    *output_pointer = 't';
+                    break;
+                default:
+                    /* escape and print as unicode codepoint */
+                    sprintf((char*)output_pointer, "u%04x", *input_pointer);
+                    output_pointer += 4;
+                    break;
+            }
+        }
+    }
+    output[output_length + 1] = '\"';
+    output[output_length + 2] = '\0';
+
+    return true;
+}
+
+/* Invoke print_string_ptr (which is useful) on an item. */
+static cJSON_bool print_string(const cJSON * const item, printbuffer * const p)
+{
+    return print_string_ptr((unsigned char*)item->valuestring, p);
+}
+
+/* Predeclare these prototypes. */
+static cJSON_bool parse_value(cJSON * const item, parse_buffer * const input_buffer);
+static cJSON_bool print_value(const cJSON * const item, printbuffer * const output_buffer);
+static cJSON_bool parse_array(cJSON * const item, parse_buffer * const input_buffer);
+static cJSON_bool print_array(const cJSON * const item, printbuffer * const output_buffer);
+static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_buffer);
+static cJSON_bool print_object(const cJSON * const item, printbuffer * const output_buffer);
+
+/* Utility to jump whitespace and cr/lf */
+static parse_buffer *buffer_skip_whitespace(parse_buffer * const buffer)
+{
+    if ((buffer == NULL) || (buffer->content == NULL))
+    {
+        return NULL;
+    }
+
+    if (cannot_access_at_index(buffer, 0))
+    {
+        return buffer;
+    }
+
+    while (can_access_at_index(buffer, 0) && (buffer_at_offset(buffer)[0] <= 32))
+    {
+       buffer->offset++;
+    }
+
+    if (buffer->offset == buffer->length)
+    {
+        buffer->offset--;
+    }
+
+    return buffer;
+}
+
+/* skip the UTF-8 BOM (byte order mark) if it is at the beginning of a buffer */
+static parse_buffer *skip_utf8_bom(parse_buffer * const buffer)
+{
+    if ((buffer == NULL) || (buffer->content == NULL) || (buffer->offset != 0))
+    {
+        return NULL;
+    }
+
+    if (can_access_at_index(buffer, 4) && (strncmp((const char*)buffer_at_offset(buffer), "\xEF\xBB\xBF", 3) == 0))
+    {
+        buffer->offset += 3;
+    }
+
+    return buffer;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated)
+{
+    size_t buffer_length;
+
+    if (NULL == value)
+    {
+        return NULL;
+    }
+
+    /* Adding null character size due to require_null_terminated. */
+    buffer_length = strlen(value) + sizeof("");
+
+    return cJSON_ParseWithLengthOpts(value, buffer_length, return_parse_end, require_null_terminated);
+}
+
+/* Parse an object - create a new root, and populate. */
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated)
+{
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 } };
+    cJSON *item = NULL;
+
+    /* reset error position */
+    global_error.json = NULL;
+    global_error.position = 0;
+
+    if (value == NULL || 0 == buffer_length)
+    {
+        goto fail;
+    }
+
+    buffer.content = (const unsigned char*)value;
+    buffer.length = buffer_length;
+    buffer.offset = 0;
+    buffer.hooks = global_hooks;
+
+    item = cJSON_New_Item(&global_hooks);
+    if (item == NULL) /* memory fail */
+    {
+        goto fail;
+    }
+
+    if (!parse_value(item, buffer_skip_whitespace(skip_utf8_bom(&buffer))))
+    {
+        /* parse failure. ep is set. */
+        goto fail;
+    }
+
+    /* if we require null-terminated JSON without appended garbage, skip and then check for a null terminator */
+    if (require_null_terminated)
+    {
+        buffer_skip_whitespace(&buffer);
+        if ((buffer.offset >= buffer.length) || buffer_at_offset(&buffer)[0] != '\0')
+        {
+            goto fail;
+        }
+    }
+    if (return_parse_end)
+    {
+        *return_parse_end = (const char*)buffer_at_offset(&buffer);
+    }
+
+    return item;
+
+fail:
+    if (item != NULL)
+    {
+        cJSON_Delete(item);
+    }
+
+    if (value != NULL)
+    {
+        error local_error;
+        local_error.json = (const unsigned char*)value;
+        local_error.position = 0;
+
+        if (buffer.offset < buffer.length)
+        {
+            local_error.position = buffer.offset;
+        }
+        else if (buffer.length > 0)
+        {
+            local_error.position = buffer.length - 1;
+        }
+
+        if (return_parse_end != NULL)
+        {
+            *return_parse_end = (const char*)local_error.json + local_error.position;
+        }
+
+        global_error = local_error;
+    }
+
+    return NULL;
+}
+
+/* Default options for cJSON_Parse */
+CJSON_PUBLIC(cJSON *) cJSON_Parse(const char *value)
+{
+    return cJSON_ParseWithOpts(value, 0, 0);
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithLength(const char *value, size_t buffer_length)
+{
+    return cJSON_ParseWithLengthOpts(value, buffer_length, 0, 0);
+}
+
+#define cjson_min(a, b) (((a) < (b)) ? (a) : (b))
+
+static unsigned char *print(const cJSON * const item, cJSON_bool format, const internal_hooks * const hooks)
+{
+    static const size_t default_buffer_size = 256;
+    printbuffer buffer[1];
+    unsigned char *printed = NULL;
+
+    memset(buffer, 0, sizeof(buffer));
+
+    /* create buffer */
+    buffer->buffer = (unsigned char*) hooks->allocate(default_buffer_size);
+    buffer->length = default_buffer_size;
+    buffer->format = format;
+    buffer->hooks = *hooks;
+    if (buffer->buffer == NULL)
+    {
+        goto fail;
+    }
+
+    /* print the value */
+    if (!print_value(item, buffer))
+    {
+        goto fail;
+    }
+    update_offset(buffer);
+
+    /* check if reallocate is available */
+    if (hooks->reallocate != NULL)
+    {
+        printed = (unsigned char*) hooks->reallocate(buffer->buffer, buffer->offset + 1);
+        if (printed == NULL) {
+            goto fail;
+        }
+        buffer->buffer = NULL;
+    }
+    else /* otherwise copy the JSON over to a new buffer */
+    {
+        printed = (unsigned char*) hooks->allocate(buffer->offset + 1);
+        if (printed == NULL)
+        {
+            goto fail;
+        }
+        memcpy(printed, buffer->buffer, cjson_min(buffer->length, buffer->offset + 1));
+        printed[buffer->offset] = '\0'; /* just to be sure */
+
+        /* free the buffer */
+        hooks->deallocate(buffer->buffer);
+    }
+
+    return printed;
+
+fail:
+    if (buffer->buffer != NULL)
+    {
+        hooks->deallocate(buffer->buffer);
+    }
+
+    if (printed != NULL)
+    {
+        hooks->deallocate(printed);
+    }
+
+    return NULL;
+}
+
+/* Render a cJSON item/entity/structure to text. */
+CJSON_PUBLIC(char *) cJSON_Print(const cJSON *item)
+{
+    return (char*)print(item, true, &global_hooks);
+}
+
+CJSON_PUBLIC(char *) cJSON_PrintUnformatted(const cJSON *item)
+{
+    return (char*)print(item, false, &global_hooks);
+}
+
+CJSON_PUBLIC(char *) cJSON_PrintBuffered(const cJSON *item, int prebuffer, cJSON_bool fmt)
+{
+    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+
+    if (prebuffer < 0)
+    {
+        return NULL;
+    }
+
+    p.buffer = (unsigned char*)global_hooks.allocate((size_t)prebuffer);
+    if (!p.buffer)
+    {
+        return NULL;
+    }
+
+    p.length = (size_t)prebuffer;
+    p.offset = 0;
+    p.noalloc = false;
+    p.format = fmt;
+    p.hooks = global_hooks;
+
+    if (!print_value(item, &p))
+    {
+        global_hooks.deallocate(p.buffer);
+        return NULL;
+    }
+
+    return (char*)p.buffer;
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buffer, const int length, const cJSON_bool format)
+{
+    printbuffer p = { 0, 0, 0, 0, 0, 0, { 0, 0, 0 } };
+
+    if ((length < 0) || (buffer == NULL))
+    {
+        return false;
+    }
+
+    p.buffer = (unsigned char*)buffer;
+    p.length = (size_t)length;
+    p.offset = 0;
+    p.noalloc = true;
+    p.format = format;
+    p.hooks = global_hooks;
+
+    return print_value(item, &p);
+}
+
+/* Parser core - when encountering text, process appropriately. */
+static cJSON_bool parse_value(cJSON * const item, parse_buffer * const input_buffer)
+{
+    if ((input_buffer == NULL) || (input_buffer->content == NULL))
+    {
+        return false; /* no input */
+    }
+
+    /* parse the different types of values */
+    /* null */
+    if (can_read(input_buffer, 4) && (strncmp((const char*)buffer_at_offset(input_buffer), "null", 4) == 0))
+    {
+        item->type = cJSON_NULL;
+        input_buffer->offset += 4;
+        return true;
+    }
+    /* false */
+    if (can_read(input_buffer, 5) && (strncmp((const char*)buffer_at_offset(input_buffer), "false", 5) == 0))
+    {
+        item->type = cJSON_False;
+        input_buffer->offset += 5;
+        return true;
+    }
+    /* true */
+    if (can_read(input_buffer, 4) && (strncmp((const char*)buffer_at_offset(input_buffer), "true", 4) == 0))
+    {
+        item->type = cJSON_True;
+        item->valueint = 1;
+        input_buffer->offset += 4;
+        return true;
+    }
+    /* string */
+    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '\"'))
+    {
+        return parse_string(item, input_buffer);
+    }
+    /* number */
+    if (can_access_at_index(input_buffer, 0) && ((buffer_at_offset(input_buffer)[0] == '-') || ((buffer_at_offset(input_buffer)[0] >= '0') && (buffer_at_offset(input_buffer)[0] <= '9'))))
+    {
+        return parse_number(item, input_buffer);
+    }
+    /* array */
+    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '['))
+    {
+        return parse_array(item, input_buffer);
+    }
+    /* object */
+    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '{'))
+    {
+        return parse_object(item, input_buffer);
+    }
+
+    return false;
+}
+
+/* Render a value to text. */
+static cJSON_bool print_value(const cJSON * const item, printbuffer * const output_buffer)
+{
+    unsigned char *output = NULL;
+
+    if ((item == NULL) || (output_buffer == NULL))
+    {
+        return false;
+    }
+
+    switch ((item->type) & 0xFF)
+    {
+        case cJSON_NULL:
+            output = ensure(output_buffer, 5);
+            if (output == NULL)
+            {
+                return false;
+            }
+            strcpy((char*)output, "null");
+            return true;
+
+        case cJSON_False:
+            output = ensure(output_buffer, 6);
+            if (output == NULL)
+            {
+                return false;
+            }
+            strcpy((char*)output, "false");
+            return true;
+
+        case cJSON_True:
+            output = ensure(output_buffer, 5);
+            if (output == NULL)
+            {
+                return false;
+            }
+            strcpy((char*)output, "true");
+            return true;
+
+        case cJSON_Number:
+            return print_number(item, output_buffer);
+
+        case cJSON_Raw:
+        {
+            size_t raw_length = 0;
+            if (item->valuestring == NULL)
+            {
+                return false;
+            }
+
+            raw_length = strlen(item->valuestring) + sizeof("");
+            output = ensure(output_buffer, raw_length);
+            if (output == NULL)
+            {
+                return false;
+            }
+            memcpy(output, item->valuestring, raw_length);
+            return true;
+        }
+
+        case cJSON_String:
+            return print_string(item, output_buffer);
+
+        case cJSON_Array:
+            return print_array(item, output_buffer);
+
+        case cJSON_Object:
+            return print_object(item, output_buffer);
+
+        default:
+            return false;
+    }
+}
+
+/* Build an array from input text. */
+static cJSON_bool parse_array(cJSON * const item, parse_buffer * const input_buffer)
+{
+    cJSON *head = NULL; /* head of the linked list */
+    cJSON *current_item = NULL;
+
+    if (input_buffer->depth >= CJSON_NESTING_LIMIT)
+    {
+        return false; /* to deeply nested */
+    }
+    input_buffer->depth++;
+
+    if (buffer_at_offset(input_buffer)[0] != '[')
+    {
+        /* not an array */
+        goto fail;
+    }
+
+    input_buffer->offset++;
+    buffer_skip_whitespace(input_buffer);
+    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ']'))
+    {
+        /* empty array */
+        goto success;
+    }
+
+    /* check if we skipped to the end of the buffer */
+    if (cannot_access_at_index(input_buffer, 0))
+    {
+        input_buffer->offset--;
+        goto fail;
+    }
+
+    /* step back to character in front of the first element */
+    input_buffer->offset--;
+    /* loop through the comma separated array elements */
+    do
+    {
+        /* allocate next item */
+        cJSON *new_item = cJSON_New_Item(&(input_buffer->hooks));
+        if (new_item == NULL)
+        {
+            goto fail; /* allocation failure */
+        }
+
+        /* attach next item to list */
+        if (head == NULL)
+        {
+            /* start the linked list */
+            current_item = head = new_item;
+        }
+        else
+        {
+            /* add to the end and advance */
+            current_item->next = new_item;
+            new_item->prev = current_item;
+            current_item = new_item;
+        }
+
+        /* parse next value */
+        input_buffer->offset++;
+        buffer_skip_whitespace(input_buffer);
+        if (!parse_value(current_item, input_buffer))
+        {
+            goto fail; /* failed to parse value */
+        }
+        buffer_skip_whitespace(input_buffer);
+    }
+    while (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ','));
+
+    if (cannot_access_at_index(input_buffer, 0) || buffer_at_offset(input_buffer)[0] != ']')
+    {
+        goto fail; /* expected end of array */
+    }
+
+success:
+    input_buffer->depth--;
+
+    if (head != NULL) {
+        head->prev = current_item;
+    }
+
+    item->type = cJSON_Array;
+    item->child = head;
+
+    input_buffer->offset++;
+
+    return true;
+
+fail:
+    if (head != NULL)
+    {
+        cJSON_Delete(head);
+    }
+
+    return false;
+}
+
+/* Render an array to text */
+static cJSON_bool print_array(const cJSON * const item, printbuffer * const output_buffer)
+{
+    unsigned char *output_pointer = NULL;
+    size_t length = 0;
+    cJSON *current_element = item->child;
+
+    if (output_buffer == NULL)
+    {
+        return false;
+    }
+
+    /* Compose the output array. */
+    /* opening square bracket */
+    output_pointer = ensure(output_buffer, 1);
+    if (output_pointer == NULL)
+    {
+        return false;
+    }
+
+    *output_pointer = '[';
+    output_buffer->offset++;
+    output_buffer->depth++;
+
+    while (current_element != NULL)
+    {
+        if (!print_value(current_element, output_buffer))
+        {
+            return false;
+        }
+        update_offset(output_buffer);
+        if (current_element->next)
+        {
+            length = (size_t) (output_buffer->format ? 2 : 1);
+            output_pointer = ensure(output_buffer, length + 1);
+            if (output_pointer == NULL)
+            {
+                return false;
+            }
+            *output_pointer++ = ',';
+            if(output_buffer->format)
+            {
+                *output_pointer++ = ' ';
+            }
+            *output_pointer = '\0';
+            output_buffer->offset += length;
+        }
+        current_element = current_element->next;
+    }
+
+    output_pointer = ensure(output_buffer, 2);
+    if (output_pointer == NULL)
+    {
+        return false;
+    }
+    *output_pointer++ = ']';
+    *output_pointer = '\0';
+    output_buffer->depth--;
+
+    return true;
+}
+
+/* Build an object from the text. */
+static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_buffer)
+{
+    cJSON *head = NULL; /* linked list head */
+    cJSON *current_item = NULL;
+
+    if (input_buffer->depth >= CJSON_NESTING_LIMIT)
+    {
+        return false; /* to deeply nested */
+    }
+    input_buffer->depth++;
+
+    if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != '{'))
+    {
+        goto fail; /* not an object */
+    }
+
+    input_buffer->offset++;
+    buffer_skip_whitespace(input_buffer);
+    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == '}'))
+    {
+        goto success; /* empty object */
+    }
+
+    /* check if we skipped to the end of the buffer */
+    if (cannot_access_at_index(input_buffer, 0))
+    {
+        input_buffer->offset--;
+        goto fail;
+    }
+
+    /* step back to character in front of the first element */
+    input_buffer->offset--;
+    /* loop through the comma separated array elements */
+    do
+    {
+        /* allocate next item */
+        cJSON *new_item = cJSON_New_Item(&(input_buffer->hooks));
+        if (new_item == NULL)
+        {
+            goto fail; /* allocation failure */
+        }
+
+        /* attach next item to list */
+        if (head == NULL)
+        {
+            /* start the linked list */
+            current_item = head = new_item;
+        }
+        else
+        {
+            /* add to the end and advance */
+            current_item->next = new_item;
+            new_item->prev = current_item;
+            current_item = new_item;
+        }
+
+        /* parse the name of the child */
+        input_buffer->offset++;
+        buffer_skip_whitespace(input_buffer);
+        if (!parse_string(current_item, input_buffer))
+        {
+            goto fail; /* failed to parse name */
+        }
+        buffer_skip_whitespace(input_buffer);
+
+        /* swap valuestring and string, because we parsed the name */
+        current_item->string = current_item->valuestring;
+        current_item->valuestring = NULL;
+
+        if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != ':'))
+        {
+            goto fail; /* invalid object */
+        }
+
+        /* parse the value */
+        input_buffer->offset++;
+        buffer_skip_whitespace(input_buffer);
+        if (!parse_value(current_item, input_buffer))
+        {
+            goto fail; /* failed to parse value */
+        }
+        buffer_skip_whitespace(input_buffer);
+    }
+    while (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ','));
+
+    if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != '}'))
+    {
+        goto fail; /* expected end of object */
+    }
+
+success:
+    input_buffer->depth--;
+
+    if (head != NULL) {
+        head->prev = current_item;
+    }
+
+    item->type = cJSON_Object;
+    item->child = head;
+
+    input_buffer->offset++;
+    return true;
+
+fail:
+    if (head != NULL)
+    {
+        cJSON_Delete(head);
+    }
+
+    return false;
+}
+
+/* Render an object to text. */
+static cJSON_bool print_object(const cJSON * const item, printbuffer * const output_buffer)
+{
+    unsigned char *output_pointer = NULL;
+    size_t length = 0;
+    cJSON *current_item = item->child;
+
+    if (output_buffer == NULL)
+    {
+        return false;
+    }
+
+    /* Compose the output: */
+    length = (size_t) (output_buffer->format ? 2 : 1); /* fmt: {\n */
+    output_pointer = ensure(output_buffer, length + 1);
+    if (output_pointer == NULL)
+    {
+        return false;
+    }
+
+    *output_pointer++ = '{';
+    output_buffer->depth++;
+    if (output_buffer->format)
+    {
+        *output_pointer++ = '\n';
+    }
+    output_buffer->offset += length;
+
+    while (current_item)
+    {
+        if (output_buffer->format)
+        {
+            size_t i;
+            output_pointer = ensure(output_buffer, output_buffer->depth);
+            if (output_pointer == NULL)
+            {
+                return false;
+            }
+            for (i = 0; i < output_buffer->depth; i++)
+            {
+                *output_pointer++ = '\t';
+            }
+            output_buffer->offset += output_buffer->depth;
+        }
+
+        /* print key */
+        if (!print_string_ptr((unsigned char*)current_item->string, output_buffer))
+        {
+            return false;
+        }
+        update_offset(output_buffer);
+
+        length = (size_t) (output_buffer->format ? 2 : 1);
+        output_pointer = ensure(output_buffer, length);
+        if (output_pointer == NULL)
+        {
+            return false;
+        }
+        *output_pointer++ = ':';
+        if (output_buffer->format)
+        {
+            *output_pointer++ = '\t';
+        }
+        output_buffer->offset += length;
+
+        /* print value */
+        if (!print_value(current_item, output_buffer))
+        {
+            return false;
+        }
+        update_offset(output_buffer);
+
+        /* print comma if not last */
+        length = ((size_t)(output_buffer->format ? 1 : 0) + (size_t)(current_item->next ? 1 : 0));
+        output_pointer = ensure(output_buffer, length + 1);
+        if (output_pointer == NULL)
+        {
+            return false;
+        }
+        if (current_item->next)
+        {
+            *output_pointer++ = ',';
+        }
+
+        if (output_buffer->format)
+        {
+            *output_pointer++ = '\n';
+        }
+        *output_pointer = '\0';
+        output_buffer->offset += length;
+
+        current_item = current_item->next;
+    }
+
+    output_pointer = ensure(output_buffer, output_buffer->format ? (output_buffer->depth + 1) : 2);
+    if (output_pointer == NULL)
+    {
+        return false;
+    }
+    if (output_buffer->format)
+    {
+        size_t i;
+        for (i = 0; i < (output_buffer->depth - 1); i++)
+        {
+            *output_pointer++ = '\t';
+        }
+    }
+    *output_pointer++ = '}';
+    *output_pointer = '\0';
+    output_buffer->depth--;
+
+    return true;
+}
+
+/* Get Array size/item / object item. */
+CJSON_PUBLIC(int) cJSON_GetArraySize(const cJSON *array)
+{
+    cJSON *child = NULL;
+    size_t size = 0;
+
+    if (array == NULL)
+    {
+        return 0;
+    }
+
+    child = array->child;
+
+    while(child != NULL)
+    {
+        size++;
+        child = child->next;
+    }
+
+    /* FIXME: Can overflow here. Cannot be fixed without breaking the API */
+
+    return (int)size;
+}
+
+static cJSON* get_array_item(const cJSON *array, size_t index)
+{
+    cJSON *current_child = NULL;
+
+    if (array == NULL)
+    {
+        return NULL;
+    }
+
+    current_child = array->child;
+    while ((current_child != NULL) && (index > 0))
+    {
+        index--;
+        current_child = current_child->next;
+    }
+
+    return current_child;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_GetArrayItem(const cJSON *array, int index)
+{
+    if (index < 0)
+    {
+        return NULL;
+    }
+
+    return get_array_item(array, (size_t)index);
+}
+
+static cJSON *get_object_item(const cJSON * const object, const char * const name, const cJSON_bool case_sensitive)
+{
+    cJSON *current_element = NULL;
+
+    if ((object == NULL) || (name == NULL))
+    {
+        return NULL;
+    }
+
+    current_element = object->child;
+    if (case_sensitive)
+    {
+        while ((current_element != NULL) && (current_element->string != NULL) && (strcmp(name, current_element->string) != 0))
+        {
+            current_element = current_element->next;
+        }
+    }
+    else
+    {
+        while ((current_element != NULL) && (case_insensitive_strcmp((const unsigned char*)name, (const unsigned char*)(current_element->string)) != 0))
+        {
+            current_element = current_element->next;
+        }
+    }
+
+    if ((current_element == NULL) || (current_element->string == NULL)) {
+        return NULL;
+    }
+
+    return current_element;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_GetObjectItem(const cJSON * const object, const char * const string)
+{
+    return get_object_item(object, string, false);
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_GetObjectItemCaseSensitive(const cJSON * const object, const char * const string)
+{
+    return get_object_item(object, string, true);
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_HasObjectItem(const cJSON *object, const char *string)
+{
+    return cJSON_GetObjectItem(object, string) ? 1 : 0;
+}
+
+/* Utility for array list handling. */
+static void suffix_object(cJSON *prev, cJSON *item)
+{
+    prev->next = item;
+    item->prev = prev;
+}
+
+/* Utility for handling references. */
+static cJSON *create_reference(const cJSON *item, const internal_hooks * const hooks)
+{
+    cJSON *reference = NULL;
+    if (item == NULL)
+    {
+        return NULL;
+    }
+
+    reference = cJSON_New_Item(hooks);
+    if (reference == NULL)
+    {
+        return NULL;
+    }
+
+    memcpy(reference, item, sizeof(cJSON));
+    reference->string = NULL;
+    reference->type |= cJSON_IsReference;
+    reference->next = reference->prev = NULL;
+    return reference;
+}
+
+static cJSON_bool add_item_to_array(cJSON *array, cJSON *item)
+{
+    cJSON *child = NULL;
+
+    if ((item == NULL) || (array == NULL) || (array == item))
+    {
+        return false;
+    }
+
+    child = array->child;
+    /*
+     * To find the last item in array quickly, we use prev in array
+     */
+    if (child == NULL)
+    {
+        /* list is empty, start new one */
+        array->child = item;
+        item->prev = item;
+        item->next = NULL;
+    }
+    else
+    {
+        /* append to the end */
+        if (child->prev)
+        {
+            suffix_object(child->prev, item);
+            array->child->prev = item;
+        }
+    }
+
+    return true;
+}
+
+/* Add item to array/object. */
+CJSON_PUBLIC(cJSON_bool) cJSON_AddItemToArray(cJSON *array, cJSON *item)
+{
+    return add_item_to_array(array, item);
+}
+
+#if defined(__clang__) || (defined(__GNUC__)  && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ > 5))))
+    #pragma GCC diagnostic push
+#endif
+#ifdef __GNUC__
+#pragma GCC diagnostic ignored "-Wcast-qual"
+#endif
+/* helper function to cast away const */
+static void* cast_away_const(const void* string)
+{
+    return (void*)string;
+}
+#if defined(__clang__) || (defined(__GNUC__)  && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ > 5))))
+    #pragma GCC diagnostic pop
+#endif
+
+
+static cJSON_bool add_item_to_object(cJSON * const object, const char * const string, cJSON * const item, const internal_hooks * const hooks, const cJSON_bool constant_key)
+{
+    char *new_key = NULL;
+    int new_type = cJSON_Invalid;
+
+    if ((object == NULL) || (string == NULL) || (item == NULL) || (object == item))
+    {
+        return false;
+    }
+
+    if (constant_key)
+    {
+        new_key = (char*)cast_away_const(string);
+        new_type = item->type | cJSON_StringIsConst;
+    }
+    else
+    {
+        new_key = (char*)cJSON_strdup((const unsigned char*)string, hooks);
+        if (new_key == NULL)
+        {
+            return false;
+        }
+
+        new_type = item->type & ~cJSON_StringIsConst;
+    }
+
+    if (!(item->type & cJSON_StringIsConst) && (item->string != NULL))
+    {
+        hooks->deallocate(item->string);
+    }
+
+    item->string = new_key;
+    item->type = new_type;
+
+    return add_item_to_array(object, item);
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_AddItemToObject(cJSON *object, const char *string, cJSON *item)
+{
+    return add_item_to_object(object, string, item, &global_hooks, false);
+}
+
+/* Add an item to an object with constant string as key */
+CJSON_PUBLIC(cJSON_bool) cJSON_AddItemToObjectCS(cJSON *object, const char *string, cJSON *item)
+{
+    return add_item_to_object(object, string, item, &global_hooks, true);
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_AddItemReferenceToArray(cJSON *array, cJSON *item)
+{
+    if (array == NULL)
+    {
+        return false;
+    }
+
+    return add_item_to_array(array, create_reference(item, &global_hooks));
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_AddItemReferenceToObject(cJSON *object, const char *string, cJSON *item)
+{
+    if ((object == NULL) || (string == NULL))
+    {
+        return false;
+    }
+
+    return add_item_to_object(object, string, create_reference(item, &global_hooks), &global_hooks, false);
+}
+
+CJSON_PUBLIC(cJSON*) cJSON_AddNullToObject(cJSON * const object, const char * const name)
+{
+    cJSON *null = cJSON_CreateNull();
+    if (add_item_to_object(object, name, null, &global_hooks, false))
+    {
+        return null;
+    }
+
+    cJSON_Delete(null);
+    return NULL;
+}
+
+CJSON_PUBLIC(cJSON*) cJSON_AddTrueToObject(cJSON * const object, const char * const name)
+{
+    cJSON *true_item = cJSON_CreateTrue();
+    if (add_item_to_object(object, name, true_item, &global_hooks, false))
+    {
+        return true_item;
+    }
+
+    cJSON_Delete(true_item);
+    return NULL;
+}
+
+CJSON_PUBLIC(cJSON*) cJSON_AddFalseToObject(cJSON * const object, const char * const name)
+{
+    cJSON *false_item = cJSON_CreateFalse();
+    if (add_item_to_object(object, name, false_item, &global_hooks, false))
+    {
+        return false_item;
+    }
+
+    cJSON_Delete(false_item);
+    return NULL;
+}
+
+CJSON_PUBLIC(cJSON*) cJSON_AddBoolToObject(cJSON * const object, const char * const name, const cJSON_bool boolean)
+{
+    cJSON *bool_item = cJSON_CreateBool(boolean);
+    if (add_item_to_object(object, name, bool_item, &global_hooks, false))
+    {
+        return bool_item;
+    }
+
+    cJSON_Delete(bool_item);
+    return NULL;
+}
+
+CJSON_PUBLIC(cJSON*) cJSON_AddNumberToObject(cJSON * const object, const char * const name, const double number)
+{
+    cJSON *number_item = cJSON_CreateNumber(number);
+    if (add_item_to_object(object, name, number_item, &global_hooks, false))
+    {
+        return number_item;
+    }
+
+    cJSON_Delete(number_item);
+    return NULL;
+}
+
+CJSON_PUBLIC(cJSON*) cJSON_AddStringToObject(cJSON * const object, const char * const name, const char * const string)
+{
+    cJSON *string_item = cJSON_CreateString(string);
+    if (add_item_to_object(object, name, string_item, &global_hooks, false))
+    {
+        return string_item;
+    }
+
+    cJSON_Delete(string_item);
+    return NULL;
+}
+
+CJSON_PUBLIC(cJSON*) cJSON_AddRawToObject(cJSON * const object, const char * const name, const char * const raw)
+{
+    cJSON *raw_item = cJSON_CreateRaw(raw);
+    if (add_item_to_object(object, name, raw_item, &global_hooks, false))
+    {
+        return raw_item;
+    }
+
+    cJSON_Delete(raw_item);
+    return NULL;
+}
+
+CJSON_PUBLIC(cJSON*) cJSON_AddObjectToObject(cJSON * const object, const char * const name)
+{
+    cJSON *object_item = cJSON_CreateObject();
+    if (add_item_to_object(object, name, object_item, &global_hooks, false))
+    {
+        return object_item;
+    }
+
+    cJSON_Delete(object_item);
+    return NULL;
+}
+
+CJSON_PUBLIC(cJSON*) cJSON_AddArrayToObject(cJSON * const object, const char * const name)
+{
+    cJSON *array = cJSON_CreateArray();
+    if (add_item_to_object(object, name, array, &global_hooks, false))
+    {
+        return array;
+    }
+
+    cJSON_Delete(array);
+    return NULL;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_DetachItemViaPointer(cJSON *parent, cJSON * const item)
+{
+    if ((parent == NULL) || (item == NULL))
+    {
+        return NULL;
+    }
+
+    if (item != parent->child)
+    {
+        /* not the first element */
+        item->prev->next = item->next;
+    }
+    if (item->next != NULL)
+    {
+        /* not the last element */
+        item->next->prev = item->prev;
+    }
+
+    if (item == parent->child)
+    {
+        /* first element */
+        parent->child = item->next;
+    }
+    else if (item->next == NULL)
+    {
+        /* last element */
+        parent->child->prev = item->prev;
+    }
+
+    /* make sure the detached item doesn't point anywhere anymore */
+    item->prev = NULL;
+    item->next = NULL;
+
+    return item;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_DetachItemFromArray(cJSON *array, int which)
+{
+    if (which < 0)
+    {
+        return NULL;
+    }
+
+    return cJSON_DetachItemViaPointer(array, get_array_item(array, (size_t)which));
+}
+
+CJSON_PUBLIC(void) cJSON_DeleteItemFromArray(cJSON *array, int which)
+{
+    cJSON_Delete(cJSON_DetachItemFromArray(array, which));
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_DetachItemFromObject(cJSON *object, const char *string)
+{
+    cJSON *to_detach = cJSON_GetObjectItem(object, string);
+
+    return cJSON_DetachItemViaPointer(object, to_detach);
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_DetachItemFromObjectCaseSensitive(cJSON *object, const char *string)
+{
+    cJSON *to_detach = cJSON_GetObjectItemCaseSensitive(object, string);
+
+    return cJSON_DetachItemViaPointer(object, to_detach);
+}
+
+CJSON_PUBLIC(void) cJSON_DeleteItemFromObject(cJSON *object, const char *string)
+{
+    cJSON_Delete(cJSON_DetachItemFromObject(object, string));
+}
+
+CJSON_PUBLIC(void) cJSON_DeleteItemFromObjectCaseSensitive(cJSON *object, const char *string)
+{
+    cJSON_Delete(cJSON_DetachItemFromObjectCaseSensitive(object, string));
+}
+
+/* Replace array/object items with new ones. */
+CJSON_PUBLIC(cJSON_bool) cJSON_InsertItemInArray(cJSON *array, int which, cJSON *newitem)
+{
+    cJSON *after_inserted = NULL;
+
+    if (which < 0)
+    {
+        return false;
+    }
+
+    after_inserted = get_array_item(array, (size_t)which);
+    if (after_inserted == NULL)
+    {
+        return add_item_to_array(array, newitem);
+    }
+
+    newitem->next = after_inserted;
+    newitem->prev = after_inserted->prev;
+    after_inserted->prev = newitem;
+    if (after_inserted == array->child)
+    {
+        array->child = newitem;
+    }
+    else
+    {
+        newitem->prev->next = newitem;
+    }
+    return true;
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemViaPointer(cJSON * const parent, cJSON * const item, cJSON * replacement)
+{
+    if ((parent == NULL) || (parent->child == NULL) || (replacement == NULL) || (item == NULL))
+    {
+        return false;
+    }
+
+    if (replacement == item)
+    {
+        return true;
+    }
+
+    replacement->next = item->next;
+    replacement->prev = item->prev;
+
+    if (replacement->next != NULL)
+    {
+        replacement->next->prev = replacement;
+    }
+    if (parent->child == item)
+    {
+        if (parent->child->prev == parent->child)
+        {
+            replacement->prev = replacement;
+        }
+        parent->child = replacement;
+    }
+    else
+    {   /*
+         * To find the last item in array quickly, we use prev in array.
+         * We can't modify the last item's next pointer where this item was the parent's child
+         */
+        if (replacement->prev != NULL)
+        {
+            replacement->prev->next = replacement;
+        }
+        if (replacement->next == NULL)
+        {
+            parent->child->prev = replacement;
+        }
+    }
+
+    item->next = NULL;
+    item->prev = NULL;
+    cJSON_Delete(item);
+
+    return true;
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemInArray(cJSON *array, int which, cJSON *newitem)
+{
+    if (which < 0)
+    {
+        return false;
+    }
+
+    return cJSON_ReplaceItemViaPointer(array, get_array_item(array, (size_t)which), newitem);
+}
+
+static cJSON_bool replace_item_in_object(cJSON *object, const char *string, cJSON *replacement, cJSON_bool case_sensitive)
+{
+    if ((replacement == NULL) || (string == NULL))
+    {
+        return false;
+    }
 
-fail:
-    if (dir) {
-        free(dir);
+    /* replace the name in the replacement */
+    if (!(replacement->type & cJSON_StringIsConst) && (replacement->string != NULL))
+    {
+        cJSON_free(replacement->string);
+    }
+    replacement->string = (char*)cJSON_strdup((const unsigned char*)string, &global_hooks);
+    if (replacement->string == NULL)
+    {
+        return false;
     }
 
-    return NULL;
+    replacement->type &= ~cJSON_StringIsConst;
+
+    return cJSON_ReplaceItemViaPointer(object, get_object_item(object, string, case_sensitive), replacement);
 }
 
-struct dirent *readdir(DIR *dirp)
+CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemInObject(cJSON *object, const char *string, cJSON *newitem)
 {
-    assert(dirp);
+    return replace_item_in_object(object, string, newitem, false);
+}
 
-    if (dirp->dirent == NULL) {
-        dirp->dirent = (struct dirent*)calloc(1, sizeof(struct dirent));
-    } else {
-        if(!FindNextFile(dirp->hFind, &dirp->data)) {
-            if (GetLastError() != ERROR_NO_MORE_FILES) {
-                // TODO: readdir should set errno accordingly on FindNextFile fail
-                // https://docs.microsoft.com/en-us/windows/win32/api/errhandlingapi/nf-errhandlingapi-getlasterror
-                errno = ENOSYS;
-            }
+CJSON_PUBLIC(cJSON_bool) cJSON_ReplaceItemInObjectCaseSensitive(cJSON *object, const char *string, cJSON *newitem)
+{
+    return replace_item_in_object(object, string, newitem, true);
+}
 
-            return NULL;
-        }
+/* Create basic types: */
+CJSON_PUBLIC(cJSON *) cJSON_CreateNull(void)
+{
+    cJSON *item = cJSON_New_Item(&global_hooks);
+    if(item)
+    {
+        item->type = cJSON_NULL;
     }
 
-    memset(dirp->dirent->d_name, 0, sizeof(dirp->dirent->d_name));
+    return item;
+}
 
-    strncpy(
-        dirp->dirent->d_name,
-        dirp->data.cFileName,
-        sizeof(dirp->dirent->d_name) - 1);
+CJSON_PUBLIC(cJSON *) cJSON_CreateTrue(void)
+{
+    cJSON *item = cJSON_New_Item(&global_hooks);
+    if(item)
+    {
+        item->type = cJSON_True;
+    }
 
-    return dirp->dirent;
+    return item;
 }
 
-int closedir(DIR *dirp)
+CJSON_PUBLIC(cJSON *) cJSON_CreateFalse(void)
 {
-    assert(dirp);
-
-    if(!FindClose(dirp->hFind)) {
-        // TODO: closedir should set errno accordingly on FindClose fail
-        // https://docs.microsoft.com/en-us/windows/win32/api/errhandlingapi/nf-errhandlingapi-getlasterror
-        errno = ENOSYS;
-        return -1;
+    cJSON *item = cJSON_New_Item(&global_hooks);
+    if(item)
+    {
+        item->type = cJSON_False;
     }
 
-    if (dirp->dirent) {
-        free(dirp->dirent);
+    return item;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_CreateBool(cJSON_bool boolean)
+{
+    cJSON *item = cJSON_New_Item(&global_hooks);
+    if(item)
+    {
+        item->type = boolean ? cJSON_True : cJSON_False;
     }
-    free(dirp);
 
-    return 0;
+    return item;
 }
 
-#endif // _WIN32
-
-// Multiple modules could define this function, so add a guard around it to prevent redefinition
-#ifndef NOBUILD__STRERROR
-#define NOBUILD__STRERROR
-Cstr nobuild__strerror(int errnum)
+CJSON_PUBLIC(cJSON *) cJSON_CreateNumber(double num)
 {
-#ifndef _WIN32
-    return strerror(errnum);
-#else
-    static char buffer[1024];
-    strerror_s(buffer, 1024, errnum);
-    return buffer;
-#endif
+    cJSON *item = cJSON_New_Item(&global_hooks);
+    if(item)
+    {
+        item->type = cJSON_Number;
+        item->valuedouble = num;
+
+        /* use saturation in case of overflow */
+        if (num >= INT_MAX)
+        {
+            item->valueint = INT_MAX;
+        }
+        else if (num <= (double)INT_MIN)
+        {
+            item->valueint = INT_MIN;
+        }
+        else
+        {
+            item->valueint = (int)num;
+        }
+    }
+
+    return item;
 }
-#endif // NOBUILD__STRERROR
 
-// Multiple modules could define this function, so add a guard around it to prevent redefinition
-#if defined(_WIN32) && !defined(NOBUILD__GETLASTERROR)
-#define NOBUILD__GETLASTERROR
-LPSTR nobuild__GetLastErrorAsString(void)
+CJSON_PUBLIC(cJSON *) cJSON_CreateString(const char *string)
 {
-    // https://stackoverflow.com/q/1387064/21582981
-    DWORD errorMessageId = GetLastError();
-    assert(errorMessageId != 0);
+    cJSON *item = cJSON_New_Item(&global_hooks);
+    if(item)
+    {
+        item->type = cJSON_String;
+        item->valuestring = (char*)cJSON_strdup((const unsigned char*)string, &global_hooks);
+        if(!item->valuestring)
+        {
+            cJSON_Delete(item);
+            return NULL;
+        }
+    }
 
-    LPSTR messageBuffer = NULL;
+    return item;
+}
 
-    FormatMessage(
-        FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, // DWORD   dwFlags,
-        NULL, // LPCVOID lpSource,
-        errorMessageId, // DWORD   dwMessageId,
-        MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT), // DWORD   dwLanguageId,
-        (LPSTR) &messageBuffer, // LPTSTR  lpBuffer,
-        0, // DWORD   nSize,
-        NULL // va_list *Arguments
-    );
+CJSON_PUBLIC(cJSON *) cJSON_CreateStringReference(const char *string)
+{
+    cJSON *item = cJSON_New_Item(&global_hooks);
+    if (item != NULL)
+    {
+        item->type = cJSON_String | cJSON_IsReference;
+        item->valuestring = (char*)cast_away_const(string);
+    }
 
-    return messageBuffer;
+    return item;
 }
-#endif // NOBUILD__GETLASTERROR
 
-int nobuild__mkdir(const char *pathname, unsigned int mode)
+CJSON_PUBLIC(cJSON *) cJSON_CreateObjectReference(const cJSON *child)
 {
-#ifndef _WIN32
-    return mkdir(pathname, mode);
-#else
-    _Pragma("unused(mode)");
-    return _mkdir(pathname);
-#endif
+    cJSON *item = cJSON_New_Item(&global_hooks);
+    if (item != NULL) {
+        item->type = cJSON_Object | cJSON_IsReference;
+        item->child = (cJSON*)cast_away_const(child);
+    }
+
+    return item;
 }
 
-int nobuild__rmdir(const char *pathname)
-{
-#ifndef _WIN32
-    return rmdir(pathname);
-#else
-    return _rmdir(pathname);
-#endif
+CJSON_PUBLIC(cJSON *) cJSON_CreateArrayReference(const cJSON *child) {
+    cJSON *item = cJSON_New_Item(&global_hooks);
+    if (item != NULL) {
+        item->type = cJSON_Array | cJSON_IsReference;
+        item->child = (cJSON*)cast_away_const(child);
+    }
+
+    return item;
 }
 
-int nobuild__unlink(const char *pathname)
+CJSON_PUBLIC(cJSON *) cJSON_CreateRaw(const char *raw)
 {
-#ifndef _WIN32
-    return unlink(pathname);
-#else
-    return _unlink(pathname);
-#endif
+    cJSON *item = cJSON_New_Item(&global_hooks);
+    if(item)
+    {
+        item->type = cJSON_Raw;
+        item->valuestring = (char*)cJSON_strdup((const unsigned char*)raw, &global_hooks);
+        if(!item->valuestring)
+        {
+            cJSON_Delete(item);
+            return NULL;
+        }
+    }
+
+    return item;
 }
 
-Cstr path_no_ext(Cstr path)
+CJSON_PUBLIC(cJSON *) cJSON_CreateArray(void)
 {
-    size_t n = strlen(path);
-    while (n > 0 && path[n - 1] != '.') {
-        n -= 1;
+    cJSON *item = cJSON_New_Item(&global_hooks);
+    if(item)
+    {
+        item->type=cJSON_Array;
     }
 
-    if (n > 0) {
-        char *result = malloc(n);
-        memcpy(result, path, n);
-        result[n - 1] = '\0';
+    return item;
+}
 
-        return result;
-    } else {
-        return path;
+CJSON_PUBLIC(cJSON *) cJSON_CreateObject(void)
+{
+    cJSON *item = cJSON_New_Item(&global_hooks);
+    if (item)
+    {
+        item->type = cJSON_Object;
     }
+
+    return item;
 }
 
-Cstr path_dirname(Cstr path)
+/* Create Arrays: */
+CJSON_PUBLIC(cJSON *) cJSON_CreateIntArray(const int *numbers, int count)
 {
-    char path_sep = *PATH_SEP;
-    size_t prefix_len = 0;
+    size_t i = 0;
+    cJSON *n = NULL;
+    cJSON *p = NULL;
+    cJSON *a = NULL;
 
-    // Get length of directory prefix
-    for (size_t i = 1; i < strlen(path); ++i) {
-        if (path[i] != path_sep && path[i-1] == path_sep) {
-            prefix_len = i;
-        }
+    if ((count < 0) || (numbers == NULL))
+    {
+        return NULL;
     }
 
-    if (prefix_len == 0) {
-        return *path == path_sep ? PATH_SEP : ".";
-    }
+    a = cJSON_CreateArray();
 
-    // Strip trailing slashes
-    while (prefix_len > 1 && path[prefix_len-1] == path_sep) {
-        --prefix_len;
+    for(i = 0; a && (i < (size_t)count); i++)
+    {
+        n = cJSON_CreateNumber(numbers[i]);
+        if (!n)
+        {
+            cJSON_Delete(a);
+            return NULL;
+        }
+        if(!i)
+        {
+            a->child = n;
+        }
+        else
+        {
+            suffix_object(p, n);
+        }
+        p = n;
     }
 
-    // copy prefix
-    size_t len = prefix_len;
-    char* dirname = malloc(len+1);
-    if (dirname == NULL) {
-        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    if (a && a->child) {
+        a->child->prev = n;
     }
 
-    return dirname[len] = '\0', memcpy(dirname, path, len);
+    return a;
 }
 
-Cstr path_basename(Cstr path)
+CJSON_PUBLIC(cJSON *) cJSON_CreateFloatArray(const float *numbers, int count)
 {
-    char path_sep = *PATH_SEP;
-    Cstr last_sep = strrchr(path, path_sep);
-    if (last_sep == NULL) {
-        return path;
+    size_t i = 0;
+    cJSON *n = NULL;
+    cJSON *p = NULL;
+    cJSON *a = NULL;
+
+    if ((count < 0) || (numbers == NULL))
+    {
+        return NULL;
     }
 
-    // Last character is not a separator
-    if (*(last_sep + 1) != '\0') {
-        size_t len = strlen(last_sep + 1);
-        char* basename = malloc(len + 1);
-        if (basename == NULL) {
-            PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
-        }
+    a = cJSON_CreateArray();
 
-        return basename[len] = '\0', memcpy(basename, last_sep + 1, len);
+    for(i = 0; a && (i < (size_t)count); i++)
+    {
+        n = cJSON_CreateNumber((double)numbers[i]);
+        if(!n)
+        {
+            cJSON_Delete(a);
+            return NULL;
+        }
+        if(!i)
+        {
+            a->child = n;
+        }
+        else
+        {
+            suffix_object(p, n);
+        }
+        p = n;
     }
 
-    // Skip consecutive seprators
-    while (last_sep > path && *(last_sep - 1) == path_sep) {
-        --last_sep;
+    if (a && a->child) {
+        a->child->prev = n;
     }
 
-    if (last_sep == path) {
-        return PATH_SEP;
+    return a;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_CreateDoubleArray(const double *numbers, int count)
+{
+    size_t i = 0;
+    cJSON *n = NULL;
+    cJSON *p = NULL;
+    cJSON *a = NULL;
+
+    if ((count < 0) || (numbers == NULL))
+    {
+        return NULL;
     }
 
-    // Find the start of the basename
-    Cstr start = last_sep;
-    while (start > path && *(start - 1) != path_sep) {
-        --start;
+    a = cJSON_CreateArray();
+
+    for(i = 0; a && (i < (size_t)count); i++)
+    {
+        n = cJSON_CreateNumber(numbers[i]);
+        if(!n)
+        {
+            cJSON_Delete(a);
+            return NULL;
+        }
+        if(!i)
+        {
+            a->child = n;
+        }
+        else
+        {
+            suffix_object(p, n);
+        }
+        p = n;
     }
-    assert(last_sep >= start && "last_sep must never be less than start");
 
-    size_t len = (size_t)(last_sep - start);
-    char *basename = malloc(len + 1);
-    if (basename == NULL) {
-        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    if (a && a->child) {
+        a->child->prev = n;
     }
 
-    return basename[len] = '\0', memcpy(basename, start, len);
+    return a;
 }
 
-int path_is_dir(Cstr path)
+CJSON_PUBLIC(cJSON *) cJSON_CreateStringArray(const char *const *strings, int count)
 {
-#ifndef _WIN32
-    struct stat statbuf = {0};
-    if (stat(path, &statbuf) < 0) {
-        if (errno == ENOENT) {
-            errno = 0;
-            return 0;
-        }
+    size_t i = 0;
+    cJSON *n = NULL;
+    cJSON *p = NULL;
+    cJSON *a = NULL;
 
-        PANIC("could not retrieve information about file %s: %s",
-              path, nobuild__strerror(errno));
+    if ((count < 0) || (strings == NULL))
+    {
+        return NULL;
     }
 
-    return S_ISDIR(statbuf.st_mode);
-#else
-    DWORD dwAttrib = GetFileAttributes(path);
+    a = cJSON_CreateArray();
 
-    return (dwAttrib != INVALID_FILE_ATTRIBUTES &&
-            (dwAttrib & FILE_ATTRIBUTE_DIRECTORY));
-#endif // _WIN32
+    for (i = 0; a && (i < (size_t)count); i++)
+    {
+        n = cJSON_CreateString(strings[i]);
+        if(!n)
+        {
+            cJSON_Delete(a);
+            return NULL;
+        }
+        if(!i)
+        {
+            a->child = n;
+        }
+        else
+        {
+            suffix_object(p,n);
+        }
+        p = n;
+    }
+
+    if (a && a->child) {
+        a->child->prev = n;
+    }
+
+    return a;
 }
 
-int path_is_file(Cstr path)
+/* Duplication */
+CJSON_PUBLIC(cJSON *) cJSON_Duplicate(const cJSON *item, cJSON_bool recurse)
 {
-#ifndef _WIN32
-    struct stat statbuf = {0};
-    if (stat(path, &statbuf) < 0) {
-        if (errno == ENOENT) {
-            errno = 0;
-            return 0;
-        }
+    cJSON *newitem = NULL;
+    cJSON *child = NULL;
+    cJSON *next = NULL;
+    cJSON *newchild = NULL;
 
-        PANIC("Could not retrieve information about file %s: %s",
-              path, nobuild__strerror(errno));
+    /* Bail on bad ptr */
+    if (!item)
+    {
+        goto fail;
+    }
+    /* Create new item */
+    newitem = cJSON_New_Item(&global_hooks);
+    if (!newitem)
+    {
+        goto fail;
+    }
+    /* Copy over all vars */
+    newitem->type = item->type & (~cJSON_IsReference);
+    newitem->valueint = item->valueint;
+    newitem->valuedouble = item->valuedouble;
+    if (item->valuestring)
+    {
+        newitem->valuestring = (char*)cJSON_strdup((unsigned char*)item->valuestring, &global_hooks);
+        if (!newitem->valuestring)
+        {
+            goto fail;
+        }
+    }
+    if (item->string)
+    {
+        newitem->string = (item->type&cJSON_StringIsConst) ? item->string : (char*)cJSON_strdup((unsigned char*)item->string, &global_hooks);
+        if (!newitem->string)
+        {
+            goto fail;
+        }
+    }
+    /* If non-recursive, then we're done! */
+    if (!recurse)
+    {
+        return newitem;
+    }
+    /* Walk the ->next chain for the child. */
+    child = item->child;
+    while (child != NULL)
+    {
+        newchild = cJSON_Duplicate(child, true); /* Duplicate (with recurse) each item in the ->next chain */
+        if (!newchild)
+        {
+            goto fail;
+        }
+        if (next != NULL)
+        {
+            /* If newitem->child already set, then crosswire ->prev and ->next and move on */
+            next->next = newchild;
+            newchild->prev = next;
+            next = newchild;
+        }
+        else
+        {
+            /* Set newitem->child and move to it */
+            newitem->child = newchild;
+            next = newchild;
+        }
+        child = child->next;
+    }
+    if (newitem && newitem->child)
+    {
+        newitem->child->prev = newchild;
     }
 
-    return S_ISREG(statbuf.st_mode);
-#else
-    DWORD dwAttrib = GetFileAttributes(path);
-    return (dwAttrib != INVALID_FILE_ATTRIBUTES &&
-            !(dwAttrib & FILE_ATTRIBUTE_DIRECTORY));
-#endif // _WIN32
+    return newitem;
+
+fail:
+    if (newitem != NULL)
+    {
+        cJSON_Delete(newitem);
+    }
+
+    return NULL;
 }
 
-int path_exists(Cstr path)
+static void skip_oneline_comment(char **input)
 {
-#ifndef _WIN32
-    struct stat statbuf = {0};
-    if (stat(path, &statbuf) < 0) {
-        if (errno == ENOENT) {
-            errno = 0;
-            return 0;
-        }
+    *input += static_strlen("//");
 
-        PANIC("could not retrieve information about file %s: %s",
-              path, nobuild__strerror(errno));
+    for (; (*input)[0] != '\0'; ++(*input))
+    {
+        if ((*input)[0] == '\n') {
+            *input += static_strlen("\n");
+            return;
+        }
     }
-
-    return 1;
-#else
-    DWORD dwAttrib = GetFileAttributes(path);
-    return (dwAttrib != INVALID_FILE_ATTRIBUTES);
-#endif
 }
 
-int is_path1_modified_after_path2(Cstr path1, Cstr path2)
+static void skip_multiline_comment(char **input)
 {
-    WARN("This function is deprecated. Use `path_is_newer()` instead.");
-    return path_is_newer(path1, path2);
+    *input += static_strlen("/*");
+
+    for (; (*input)[0] != '\0'; ++(*input))
+    {
+        if (((*input)[0] == '*') && ((*input)[1] == '/'))
+        {
+            *input += static_strlen("*/");
+            return;
+        }
+    }
 }
 
-long long nobuild__get_modification_time(Cstr path) {
-    if (IS_DIR(path)) {
-        long long mod_time = -1;
-        FOREACH_FILE_IN_DIR(file, path, {
-            if (strcmp(file, ".") == 0 || strcmp(file, "..") == 0) {
-                continue;
-            }
+static void minify_string(char **input, char **output) {
+    (*output)[0] = (*input)[0];
+    *input += static_strlen("\"");
+    *output += static_strlen("\"");
 
-            long long path_mod_time = nobuild__get_modification_time(PATH(path, file));
-            mod_time = path_mod_time > mod_time ? path_mod_time : mod_time;
-        });
-        return mod_time;
-    } else {
-#ifndef _WIN32
-        struct stat statbuf = {0};
 
-        if (stat(path, &statbuf) < 0) {
-            PANIC("Could not stat %s: %s\n", path, nobuild__strerror(errno));
-        }
-        return (long long) statbuf.st_mtime;
-#else
-        FILETIME path_time;
-        Fd path_fd = fd_open_for_read(path);
-        if (!GetFileTime(path_fd, NULL, NULL, &path_time)) {
-            PANIC("could not get time of %s: %s", path, nobuild__GetLastErrorAsString());
+    for (; (*input)[0] != '\0'; (void)++(*input), ++(*output)) {
+        (*output)[0] = (*input)[0];
+
+        if ((*input)[0] == '\"') {
+            (*output)[0] = '\"';
+            *input += static_strlen("\"");
+            *output += static_strlen("\"");
+            return;
+        } else if (((*input)[0] == '\\') && ((*input)[1] == '\"')) {
+            (*output)[1] = (*input)[1];
+            *input += static_strlen("\"");
+            *output += static_strlen("\"");
         }
-        fd_close(path_fd);
-        return ((long long) path_time.dwHighDateTime) << 32 | path_time.dwLowDateTime;
-#endif
     }
 }
 
-int path_is_newer(Cstr path1, Cstr path2)
+CJSON_PUBLIC(void) cJSON_Minify(char *json)
 {
-    // Warn the user that the path is missing
-    if (!PATH_EXISTS(path1)) {
-        WARN("File %s does not exist", path2);
-        return 0;
+    char *into = json;
+
+    if (json == NULL)
+    {
+        return;
     }
 
-    if (!PATH_EXISTS(path2)) {
-        return 1;
+    while (json[0] != '\0')
+    {
+        switch (json[0])
+        {
+            case ' ':
+            case '\t':
+            case '\r':
+            case '\n':
+                json++;
+                break;
+
+            case '/':
+                if (json[1] == '/')
+                {
+                    skip_oneline_comment(&json);
+                }
+                else if (json[1] == '*')
+                {
+                    skip_multiline_comment(&json);
+                } else {
+                    json++;
+                }
+                break;
+
+            case '\"':
+                minify_string(&json, (char**)&into);
+                break;
+
+            default:
+                into[0] = json[0];
+                json++;
+                into++;
+        }
     }
 
-    return nobuild__get_modification_time(path1) > nobuild__get_modification_time(path2);
+    /* and null-terminate. */
+    *into = '\0';
 }
 
-void path_mkdirs(Cstr_Array path)
+CJSON_PUBLIC(cJSON_bool) cJSON_IsInvalid(const cJSON * const item)
 {
-    if (path.count == 0) {
-        return;
+    if (item == NULL)
+    {
+        return false;
     }
 
-    size_t len = 0;
-    for (size_t i = 0; i < path.count; ++i) {
-        len += strlen(path.elems[i]);
+    return (item->type & 0xFF) == cJSON_Invalid;
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_IsFalse(const cJSON * const item)
+{
+    if (item == NULL)
+    {
+        return false;
     }
 
-    size_t seps_count = path.count - 1;
-    const size_t sep_len = strlen(PATH_SEP);
+    return (item->type & 0xFF) == cJSON_False;
+}
 
-    char *result = malloc(len + seps_count * sep_len + 1);
+CJSON_PUBLIC(cJSON_bool) cJSON_IsTrue(const cJSON * const item)
+{
+    if (item == NULL)
+    {
+        return false;
+    }
 
-    len = 0;
-    for (size_t i = 0; i < path.count; ++i) {
-        size_t n = strlen(path.elems[i]);
-        memcpy(result + len, path.elems[i], n);
-        len += n;
+    return (item->type & 0xff) == cJSON_True;
+}
 
-        if (seps_count > 0) {
-            memcpy(result + len, PATH_SEP, sep_len);
-            len += sep_len;
-            seps_count -= 1;
-        }
 
-        result[len] = '\0';
+CJSON_PUBLIC(cJSON_bool) cJSON_IsBool(const cJSON * const item)
+{
+    if (item == NULL)
+    {
+        return false;
+    }
 
-        if (nobuild__mkdir(result, 0755) < 0) {
-            if (errno == EEXIST) {
-                errno = 0;
-                WARN("directory %s already exists", result);
-            } else {
-                PANIC("could not create directory %s: %s", result, nobuild__strerror(errno));
-            }
-        }
+    return (item->type & (cJSON_True | cJSON_False)) != 0;
+}
+CJSON_PUBLIC(cJSON_bool) cJSON_IsNull(const cJSON * const item)
+{
+    if (item == NULL)
+    {
+        return false;
     }
+
+    return (item->type & 0xFF) == cJSON_NULL;
 }
 
-void path_rename(Cstr old_path, Cstr new_path)
+CJSON_PUBLIC(cJSON_bool) cJSON_IsNumber(const cJSON * const item)
 {
-#ifndef _WIN32
-    if (rename(old_path, new_path) < 0) {
-        PANIC("could not rename %s to %s: %s", old_path, new_path,
-              nobuild__strerror(errno));
-    }
-#else
-    if (!MoveFileEx(old_path, new_path, MOVEFILE_REPLACE_EXISTING)) {
-        PANIC("could not rename %s to %s: %s", old_path, new_path,
-              nobuild__GetLastErrorAsString());
+    if (item == NULL)
+    {
+        return false;
     }
-#endif // _WIN32
+
+    return (item->type & 0xFF) == cJSON_Number;
 }
 
-void path_copy(Cstr old_path, Cstr new_path) {
-    if (IS_DIR(old_path)) {
-        path_mkdirs(cstr_array_make(new_path, NULL));
-        FOREACH_FILE_IN_DIR(file, old_path, {
-            if (strcmp(file, ".") == 0 || strcmp(file, "..") == 0) {
-                continue;
-            }
+CJSON_PUBLIC(cJSON_bool) cJSON_IsString(const cJSON * const item)
+{
+    if (item == NULL)
+    {
+        return false;
+    }
 
-            path_copy(PATH(old_path, file), PATH(new_path, file));
-        });
-    } else {
-        Fd f1 = fd_open_for_read(old_path);
-        Fd f2 = fd_open_for_write(new_path);
+    return (item->type & 0xFF) == cJSON_String;
+}
 
-        unsigned char buffer[4096];
-        while (1) {
-#ifndef _WIN32
-            ssize_t bytes = read(f1, buffer, sizeof buffer);
-            if (bytes == -1) {
-                ERRO("Could not copy %s to %s due to read error: %s", old_path, new_path, nobuild__strerror(errno));
-                break;
-            }
+CJSON_PUBLIC(cJSON_bool) cJSON_IsArray(const cJSON * const item)
+{
+    if (item == NULL)
+    {
+        return false;
+    }
 
-            if (bytes == 0) {
-                break;
-            }
+    return (item->type & 0xFF) == cJSON_Array;
+}
 
-            bytes = write(f2, buffer, (size_t)bytes);
-            if (bytes == -1) {
-                ERRO("Could not copy %s to %s due to write error: %s", old_path, new_path, nobuild__strerror(errno));
-                break;
-            }
+CJSON_PUBLIC(cJSON_bool) cJSON_IsObject(const cJSON * const item)
+{
+    if (item == NULL)
+    {
+        return false;
+    }
 
-            if (bytes == 0) {
-                break;
-            }
-#else
-            DWORD bytes;
-            if (!ReadFile(f1, buffer, sizeof buffer, &bytes, NULL)) {
-                ERRO("Could not copy %s to %s due to read error: %s", old_path, new_path, nobuild__GetLastErrorAsString());
-                break;
+    return (item->type & 0xFF) == cJSON_Object;
+}
 
-            }
+CJSON_PUBLIC(cJSON_bool) cJSON_IsRaw(const cJSON * const item)
+{
+    if (item == NULL)
+    {
+        return false;
+    }
 
-            if (bytes == 0) {
-                break;
-            }
+    return (item->type & 0xFF) == cJSON_Raw;
+}
 
-            if (!WriteFile(f2, buffer, bytes, &bytes, NULL)) {
-                ERRO("Could not copy %s to %s due to write error: %s", old_path, new_path, nobuild__GetLastErrorAsString());
-                break;
-            }
+CJSON_PUBLIC(cJSON_bool) cJSON_Compare(const cJSON * const a, const cJSON * const b, const cJSON_bool case_sensitive)
+{
+    if ((a == NULL) || (b == NULL) || ((a->type & 0xFF) != (b->type & 0xFF)))
+    {
+        return false;
+    }
 
-            if (bytes == 0) {
-                break;
-            }
-#endif
-        }
+    /* check if type is valid */
+    switch (a->type & 0xFF)
+    {
+        case cJSON_False:
+        case cJSON_True:
+        case cJSON_NULL:
+        case cJSON_Number:
+        case cJSON_String:
+        case cJSON_Raw:
+        case cJSON_Array:
+        case cJSON_Object:
+            break;
 
-        fd_close(f1);
-        fd_close(f2);
+        default:
+            return false;
     }
-}
 
-void path_rm(Cstr path)
-{
-    if (IS_DIR(path)) {
-        FOREACH_FILE_IN_DIR(file, path, {
-            if (strcmp(file, ".") != 0 && strcmp(file, "..") != 0)
+    /* identical objects are equal */
+    if (a == b)
+    {
+        return true;
+    }
+
+    switch (a->type & 0xFF)
+    {
+        /* in these cases and equal type is enough */
+        case cJSON_False:
+        case cJSON_True:
+        case cJSON_NULL:
+            return true;
+
+        case cJSON_Number:
+            if (compare_double(a->valuedouble, b->valuedouble))
             {
-                path_rm(PATH(path, file));
+                return true;
             }
-        });
+            return false;
 
-        if (nobuild__rmdir(path) < 0) {
-            if (errno == ENOENT) {
-                errno = 0;
-                WARN("Directory %s does not exist", path);
-            } else {
-                PANIC("Could not remove directory %s: %s", path, nobuild__strerror(errno));
+        case cJSON_String:
+        case cJSON_Raw:
+            if ((a->valuestring == NULL) || (b->valuestring == NULL))
+            {
+                return false;
             }
-        }
-    } else {
-        if (nobuild__unlink(path) < 0) {
-            if (errno == ENOENT) {
-                errno = 0;
-                WARN("File %s does not exist", path);
-            } else {
-                PANIC("Could not remove file %s: %s", path, nobuild__strerror(errno));
+            if (strcmp(a->valuestring, b->valuestring) == 0)
+            {
+                return true;
             }
-        }
-    }
-}
 
+            return false;
 
-char *shift_args(int *argc, char ***argv)
-{
-    assert(*argc > 0);
-    char *result = **argv;
-    *argc -= 1;
-    *argv += 1;
-    return result;
-}
+        case cJSON_Array:
+        {
+            cJSON *a_element = a->child;
+            cJSON *b_element = b->child;
 
-void file_to_c_array(Cstr path, Cstr out_path, Cstr array_type, Cstr array_name, int null_term) {
-    Fd file = fd_open_for_read(path);
-    Fd output_file = fd_open_for_write(out_path);
-    fd_printf(output_file, "%s %s[] = {\n", array_type, array_name);
+            for (; (a_element != NULL) && (b_element != NULL);)
+            {
+                if (!cJSON_Compare(a_element, b_element, case_sensitive))
+                {
+                    return false;
+                }
 
-    unsigned char buffer[4096];
-    unsigned long total_bytes_read = 0;
-    do {
-#ifndef _WIN32
-        ssize_t bytes = read(file, buffer, sizeof(buffer));
-        if (bytes == -1) {
-            ERRO("Could not read file %s: %s", path, strerror(errno));
-            fd_close(file);
-            fd_close(output_file);
-            break;
-        }
+                a_element = a_element->next;
+                b_element = b_element->next;
+            }
 
-        if (bytes == 0) {
-            break;
-        }
-#else
-        DWORD bytes;
-        if (!ReadFile(file, buffer, sizeof buffer, &bytes, NULL)) {
-            ERRO("Could not read file %s: %s", path, nobuild__GetLastErrorAsString());
-            break;
-        }
-#endif
-        int bytes_read = (int) bytes;
+            /* one of the arrays is longer than the other */
+            if (a_element != b_element) {
+                return false;
+            }
 
-        if (bytes_read == 0) {
-            break;
+            return true;
         }
 
-        for (int i = 0; i < bytes_read; i+=16) {
-            fd_printf(output_file, "\t");
-            for (int j = i; j < i+16; j++) {
-                if (j >= bytes_read) {
-                    break;
+        case cJSON_Object:
+        {
+            cJSON *a_element = NULL;
+            cJSON *b_element = NULL;
+            cJSON_ArrayForEach(a_element, a)
+            {
+                /* TODO This has O(n^2) runtime, which is horrible! */
+                b_element = get_object_item(b, a_element->string, case_sensitive);
+                if (b_element == NULL)
+                {
+                    return false;
+                }
+
+                if (!cJSON_Compare(a_element, b_element, case_sensitive))
+                {
+                    return false;
+                }
+            }
+
+            /* doing this twice, once on a and b to prevent true comparison if a subset of b
+             * TODO: Do this the proper way, this is just a fix for now */
+            cJSON_ArrayForEach(b_element, b)
+            {
+                a_element = get_object_item(a, b_element->string, case_sensitive);
+                if (a_element == NULL)
+                {
+                    return false;
+                }
+
+                if (!cJSON_Compare(b_element, a_element, case_sensitive))
+                {
+                    return false;
                 }
-                fd_printf(output_file, "0x%02x, ", buffer[j]);
             }
-            fd_printf(output_file, "\n");
+
+            return true;
         }
-        total_bytes_read += (unsigned long) bytes_read;
-    } while (1);
 
-    if (null_term) {
-        fd_printf(output_file, "\t0x00 /* Terminate with null */\n");
-        total_bytes_read++;
+        default:
+            return false;
     }
-    fd_printf(output_file, "};\n");
-    fd_printf(output_file, "unsigned long %s_len = %lu;\n", array_name, total_bytes_read);
+}
 
-    fd_close(file);
-    fd_close(output_file);
+CJSON_PUBLIC(void *) cJSON_malloc(size_t size)
+{
+    return global_hooks.allocate(size);
+}
+
+CJSON_PUBLIC(void) cJSON_free(void *object)
+{
+    global_hooks.deallocate(object);
 }
 
 #endif // NOBUILD_IMPLEMENTATION
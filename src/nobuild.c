@@ -7,8 +7,11 @@
 #include "nobuild_io.h"
 #include "nobuild_cmd.h"
 #include "nobuild_path.h"
+#include "cJSON.h"
 
+#include <ctype.h>
 #include <errno.h>
+#include <string.h>
 
 char *shift_args(int *argc, char ***argv)
 {
@@ -19,59 +22,1060 @@ char *shift_args(int *argc, char ***argv)
     return result;
 }
 
+// Writes the bytes of `data` as rows of `0x.., ` with a lookup table instead
+// of a printf per byte, straight into the spare capacity of `out`
+static int nobuild__write_hex_rows(Fd_Writer *out, const unsigned char *data, size_t size)
+{
+    static const char digits[] = "0123456789abcdef";
+    // A tab, 16 times `0xNN, ` and a newline
+    enum { ROW_BYTES = 16, ROW_MAX = 1 + ROW_BYTES * 6 + 1 };
+
+    for (size_t i = 0; i < size; i += ROW_BYTES) {
+        if (out->capacity - out->count < ROW_MAX && !fdw_flush(out)) {
+            return 0;
+        }
+
+        const size_t row_end = size - i < ROW_BYTES ? size : i + ROW_BYTES;
+        char *row = out->buffer + out->count;
+        *row++ = '\t';
+        for (size_t j = i; j < row_end; ++j) {
+            row[0] = '0';
+            row[1] = 'x';
+            row[2] = digits[data[j] >> 4];
+            row[3] = digits[data[j] & 0xf];
+            row[4] = ',';
+            row[5] = ' ';
+            row += 6;
+        }
+        *row++ = '\n';
+        out->count = (size_t) (row - out->buffer);
+    }
+
+    return 1;
+}
+
 void file_to_c_array(Cstr path, Cstr out_path, Cstr array_type, Cstr array_name, int null_term) {
-    Fd file = fd_open_for_read(path);
-    Fd output_file = fd_open_for_write(out_path);
-    fd_printf(output_file, "%s %s[] = {\n", array_type, array_name);
-
-    unsigned char buffer[4096];
-    unsigned long total_bytes_read = 0;
-    do {
-#ifndef _WIN32
-        ssize_t bytes = read(file, buffer, sizeof(buffer));
-        if (bytes == -1) {
-            ERRO("Could not read file %s: %s", path, strerror(errno));
-            fd_close(file);
-            fd_close(output_file);
-            break;
+    File_Map input = file_map(path);
+    if (input.data == NULL) {
+        return;
+    }
+
+    // Leave `out_path` alone when the input did not change, so its dependents are not rebuilt
+    Output_File file = output_file_open(out_path);
+    Fd_Writer *out = &file.writer;
+    fdw_printf(out, "%s %s[] = {\n", array_type, array_name);
+    int ok = nobuild__write_hex_rows(out, (const unsigned char *) input.data, input.size);
+    if (null_term) {
+        fdw_write_cstr(out, "\t0x00 /* Terminate with null */\n");
+    }
+    fdw_write_cstr(out, "};\n");
+    fdw_printf(out, "unsigned long %s_len = %lu;\n", array_name, (unsigned long) input.size + (null_term ? 1 : 0));
+    if (ok) {
+        output_file_close(&file);
+    } else {
+        ERRO("Could not write file %s: %s", out_path, strerror(errno));
+        fdw_close(out);
+        path_rm(file.temp_path);
+    }
+
+    file_unmap(&input);
+}
+
+// Writes `cstr` as the body of a C string literal
+static void nobuild__write_escaped(Fd_Writer *out, Cstr cstr)
+{
+    for (; *cstr != '\0'; ++cstr) {
+        if (*cstr == '\\' || *cstr == '"') {
+            fdw_write(out, "\\", 1);
         }
+        fdw_write(out, cstr, 1);
+    }
+}
 
-        if (bytes == 0) {
-            break;
+// `path` relative to the directory `dir`, so that the generated files keep
+// working when the tree is moved. Paths with no common root, like on two
+// Windows drives, stay absolute.
+static Cstr nobuild__path_relative_to(Cstr dir, Cstr path)
+{
+    Cstr from = path_realpath(dir);
+    Cstr to = path_realpath(path);
+
+    size_t common = 0;
+    size_t i = 0;
+    for (; from[i] != '\0' && from[i] == to[i]; ++i) {
+        if (nobuild__is_path_sep(from[i])) {
+            common = i + 1;
         }
-#else
-        DWORD bytes;
-        if (!ReadFile(file, buffer, sizeof buffer, &bytes, NULL)) {
-            ERRO("Could not read file %s: %s", path, nobuild__GetLastErrorAsString());
-            break;
+    }
+    if (from[i] == '\0' && nobuild__is_path_sep(to[i])) {
+        common = i + 1;
+    }
+    if (common == 0) {
+        return to;
+    }
+
+    String_Builder sb = {0};
+    for (Cstr c = from + common; *c != '\0'; ++c) {
+        if (c == from + common || (nobuild__is_path_sep(c[-1]) && !nobuild__is_path_sep(*c))) {
+            sb_append_cstr(&sb, ".." PATH_SEP);
         }
-#endif
-        int bytes_read = (int) bytes;
+    }
+    sb_append_cstr(&sb, to + common);
+    return sb_to_cstr(&sb);
+}
+
+void file_to_c_embed(Cstr path, Cstr out_path, Cstr array_type, Cstr array_name, int null_term) {
+    if (!path_is_file(path)) {
+        ERRO("File %s does not exist", path);
+        return;
+    }
+
+    // `#embed` looks quoted paths up next to the including file first
+    Output_File file = output_file_open(out_path);
+    Cstr relative_path = nobuild__path_relative_to(path_dirname(out_path), path);
+    Fd_Writer *out = &file.writer;
+    fdw_printf(out, "%s %s[] = {\n#embed \"", array_type, array_name);
+    nobuild__write_escaped(out, relative_path);
+    fdw_write_cstr(out, null_term ? "\" suffix(, 0x00) if_empty(0x00)\n" : "\"\n");
+    fdw_write_cstr(out, "};\n");
+    fdw_printf(out, "unsigned long %s_len = sizeof(%s);\n", array_name, array_name);
+    output_file_close(&file);
+}
+
+void file_to_c_incbin(Cstr path, Cstr out_path, Cstr array_type, Cstr array_name, int null_term) {
+    Nobuild__Stat st;
+    if (!nobuild__stat(path, &st) || st.is_dir) {
+        ERRO("Could not find the file %s", path);
+        return;
+    }
+
+    // Mach-O prefixes C symbols with an underscore and has no `.pushsection`
+    Output_File file = output_file_open(out_path);
+    Cstr relative_path = nobuild__path_relative_to(path_dirname(out_path), path);
+    Fd_Writer *out = &file.writer;
+    fdw_write_cstr(out,
+        "#ifdef __APPLE__\n"
+        "#\tdefine NOBUILD_INCBIN_SYMBOL \"_\"\n"
+        "#\tdefine NOBUILD_INCBIN_BEGIN \".const_data\\n\"\n"
+        "#\tdefine NOBUILD_INCBIN_END \".text\\n\"\n"
+        "#else\n"
+        "#\tdefine NOBUILD_INCBIN_SYMBOL \"\"\n"
+        "#\tdefine NOBUILD_INCBIN_BEGIN \".pushsection .rodata\\n\"\n"
+        "#\tdefine NOBUILD_INCBIN_END \".popsection\\n\"\n"
+        "#endif\n"
+        "\n"
+        "__asm__(\n"
+        "    NOBUILD_INCBIN_BEGIN\n");
+    fdw_printf(out,
+        "    \".globl \" NOBUILD_INCBIN_SYMBOL \"%s\\n\"\n"
+        "    \".balign 16\\n\"\n"
+        "    NOBUILD_INCBIN_SYMBOL \"%s:\\n\"\n"
+        "    \".incbin \\\"",
+        array_name, array_name);
+    // Escaped once for the assembler string and once more for the C literal holding it
+    for (Cstr c = relative_path; *c != '\0'; ++c) {
+        if (*c == '\\' || *c == '"') {
+            fdw_write_cstr(out, "\\\\\\");
+        }
+        fdw_write(out, c, 1);
+    }
+    fdw_write_cstr(out, "\\\"\\n\"\n");
+    if (null_term) {
+        fdw_write_cstr(out, "    \".byte 0\\n\"\n");
+    }
+    fdw_write_cstr(out, "    NOBUILD_INCBIN_END\n);\n\n");
+    fdw_printf(out, "extern const %s %s[];\n", array_type, array_name);
+    fdw_printf(out, "unsigned long %s_len = %llu;\n", array_name, st.size + (null_term ? 1 : 0));
+    output_file_close(&file);
+}
+
+void pack_add(Pack_Assets *assets, Cstr name, Cstr path)
+{
+    Pack_Asset asset = {
+        .name = name,
+        .path = path,
+    };
+    ARRAY_APPEND(assets, asset);
+}
+
+static unsigned long long nobuild__pack_align(unsigned long long offset)
+{
+    return (offset + NOBUILD_PACK_ALIGN - 1) / NOBUILD_PACK_ALIGN * NOBUILD_PACK_ALIGN;
+}
+
+Pack pack_from_memory(const void *data, size_t size)
+{
+    Pack pack = {0};
+    const Pack_Header *header = data;
+    if (size < sizeof(*header) || memcmp(header->magic, NOBUILD_PACK_MAGIC, sizeof(header->magic)) != 0) {
+        ERRO("%s", "Resource pack has no pack header");
+        return pack;
+    }
+
+    const unsigned long long index_size = header->count * sizeof(Pack_Entry);
+    if (header->names_offset < sizeof(*header) || header->names_offset > header->index_offset
+            || header->index_offset % sizeof(unsigned long long) != 0
+            || header->count > size / sizeof(Pack_Entry) || header->index_offset > size - index_size) {
+        ERRO("%s", "Resource pack index is out of bounds");
+        return pack;
+    }
+
+    // Check every entry once, so lookups can trust the offsets
+    const Pack_Entry *index = (const Pack_Entry *) ((const char *) data + header->index_offset);
+    const char *names = (const char *) data + header->names_offset;
+    const unsigned long long names_size = header->index_offset - header->names_offset;
+    for (unsigned long long i = 0; i < header->count; ++i) {
+        const Pack_Entry *entry = &index[i];
+        if (entry->name_offset >= names_size
+                || memchr(names + entry->name_offset, '\0', (size_t) (names_size - entry->name_offset)) == NULL) {
+            ERRO("Resource pack entry %llu has its name out of bounds", i);
+            return pack;
+        }
+        if (entry->offset < sizeof(*header) || entry->offset > size || entry->size > size - entry->offset) {
+            ERRO("Resource pack entry %s is out of bounds", names + entry->name_offset);
+            return pack;
+        }
+    }
+
+    pack.header = header;
+    pack.index = index;
+    pack.names = names;
+    return pack;
+}
+
+Pack pack_open(Cstr path)
+{
+    File_Map map = file_map(path);
+    if (map.data == NULL) {
+        Pack pack = {0};
+        return pack;
+    }
+
+    Pack pack = pack_from_memory(map.data, map.size);
+    if (pack.header == NULL) {
+        ERRO("%s is not a resource pack", path);
+        file_unmap(&map);
+        return pack;
+    }
+
+    pack.map = map;
+    return pack;
+}
+
+static const Pack_Entry *nobuild__pack_lookup(const Pack *pack, Cstr name)
+{
+    if (pack->header == NULL) {
+        return NULL;
+    }
+
+    size_t begin = 0;
+    size_t end = (size_t) pack->header->count;
+    while (begin < end) {
+        const size_t middle = begin + (end - begin) / 2;
+        const int order = strcmp(name, pack->names + pack->index[middle].name_offset);
+        if (order == 0) {
+            return &pack->index[middle];
+        }
+
+        if (order < 0) {
+            end = middle;
+        } else {
+            begin = middle + 1;
+        }
+    }
 
-        if (bytes_read == 0) {
+    return NULL;
+}
+
+String_View pack_find(const Pack *pack, Cstr name)
+{
+    const Pack_Entry *entry = nobuild__pack_lookup(pack, name);
+    if (entry == NULL) {
+        return sv_from_parts(NULL, 0);
+    }
+
+    return sv_from_parts((const char *) pack->header + entry->offset, (size_t) entry->size);
+}
+
+void pack_close(Pack *pack)
+{
+    if (pack->map.data != NULL) {
+        file_unmap(&pack->map);
+    }
+    memset(pack, 0, sizeof(*pack));
+}
+
+typedef struct {
+    Pack_Asset asset;
+    Pack_Entry entry;
+    // The contents are already in the previous archive at `entry.offset`
+    int reused;
+} Nobuild__Pack_Item;
+
+static int nobuild__pack_item_compare(const void *a, const void *b)
+{
+    return strcmp(((const Nobuild__Pack_Item *) a)->asset.name, ((const Nobuild__Pack_Item *) b)->asset.name);
+}
+
+int pack_write(Cstr pack_path, Pack_Assets assets)
+{
+    Nobuild__Pack_Item *items = calloc(assets.count + 1, sizeof(*items));
+    if (items == NULL) {
+        PANIC("Could not allocate memory: %s", strerror(errno));
+    }
+    for (size_t i = 0; i < assets.count; ++i) {
+        items[i].asset = assets.elems[i];
+    }
+    qsort(items, assets.count, sizeof(*items), nobuild__pack_item_compare);
+
+    int ok = 1;
+    Fd_Batch batch = {0};
+    for (size_t i = 0; i < assets.count; ++i) {
+        if (i > 0 && strcmp(items[i - 1].asset.name, items[i].asset.name) == 0) {
+            ERRO("Asset %s is in %s more than once", items[i].asset.name, pack_path);
+            ok = 0;
+        }
+        fd_batch_stat(&batch, items[i].asset.path);
+    }
+    fd_batch_submit(&batch);
+    for (size_t i = 0; i < assets.count; ++i) {
+        if (batch.elems[i].error != 0) {
+            ERRO("Could not stat %s: %s", items[i].asset.path, strerror(batch.elems[i].error));
+            ok = 0;
+        }
+        items[i].entry.size = batch.elems[i].file_size;
+        items[i].entry.mtime = batch.elems[i].mtime;
+    }
+    ARRAY_FREE(&batch);
+    if (!ok) {
+        free(items);
+        return 0;
+    }
+
+    Pack old = {0};
+    if (path_exists(pack_path)) {
+        old = pack_open(pack_path);
+    }
+
+    // Hash the assets that changed on disk, and keep the data of the ones
+    // whose contents are still the same as in the previous archive
+    size_t changed = 0;
+    unsigned long long live_bytes = 0;
+    unsigned long long reused_bytes = 0;
+    for (size_t i = 0; i < assets.count && ok; ++i) {
+        Pack_Entry *entry = &items[i].entry;
+        const Pack_Entry *old_entry = nobuild__pack_lookup(&old, items[i].asset.name);
+        if (old_entry != NULL && old_entry->size == entry->size && old_entry->mtime == entry->mtime) {
+            entry->hash = old_entry->hash;
+        } else {
+            File_Map source = file_map(items[i].asset.path);
+            if (source.data == NULL) {
+                ok = 0;
+                break;
+            }
+            entry->hash = cstr_hash_n(source.data, source.size);
+            file_unmap(&source);
+        }
+
+        live_bytes += entry->size;
+        if (old_entry != NULL && old_entry->size == entry->size && old_entry->hash == entry->hash) {
+            items[i].reused = 1;
+            entry->offset = old_entry->offset;
+            reused_bytes += entry->size;
+        } else {
+            changed += 1;
+        }
+    }
+
+    if (!ok || (old.header != NULL && changed == 0 && old.header->count == assets.count)) {
+        pack_close(&old);
+        free(items);
+        return ok;
+    }
+
+    // New data goes after the end of the previous archive, so it stays valid
+    // until the header is rewritten last. Start over once more than half of
+    // the archive is dead space.
+    const unsigned long long dead_bytes = old.header != NULL ? old.map.size - sizeof(Pack_Header) - reused_bytes : 0;
+    const int compact = old.header == NULL || dead_bytes > live_bytes;
+    unsigned long long data_end = compact ? sizeof(Pack_Header) : old.map.size;
+
+    String_Builder names = {0};
+    Pack_Entry *index = malloc(sizeof(*index) * (assets.count + 1));
+    if (index == NULL) {
+        PANIC("Could not allocate memory: %s", strerror(errno));
+    }
+
+    // Only compaction copies data out of the previous archive, and it writes a new file
+    if (!compact) {
+        pack_close(&old);
+    }
+    Cstr out_path = compact ? CONCAT(pack_path, ".tmp") : pack_path;
+    Fd out = compact ? fd_open_for_write(out_path) : fd_open_for_update(out_path);
+    for (size_t i = 0; i < assets.count && ok; ++i) {
+        Pack_Entry *entry = &items[i].entry;
+        if (items[i].reused && !compact) {
+            index[i] = *entry;
+            continue;
+        }
+
+        const unsigned long long offset = nobuild__pack_align(data_end);
+        if (items[i].reused) {
+            ok = fd_pwrite_all(out, old.map.data + entry->offset, (size_t) entry->size, offset);
+        } else {
+            File_Map source = file_map(items[i].asset.path);
+            ok = source.data != NULL && fd_pwrite_all(out, source.data, source.size, offset);
+            if (source.data != NULL) {
+                entry->size = source.size;
+                file_unmap(&source);
+            }
+        }
+        entry->offset = offset;
+        data_end = offset + entry->size;
+        index[i] = *entry;
+    }
+
+    for (size_t i = 0; i < assets.count; ++i) {
+        index[i].name_offset = names.count;
+        sb_append_buf(&names, items[i].asset.name, strlen(items[i].asset.name) + 1);
+    }
+
+    Pack_Header header = {0};
+    memcpy(header.magic, NOBUILD_PACK_MAGIC, sizeof(header.magic));
+    header.count = assets.count;
+    header.names_offset = data_end;
+    header.index_offset = nobuild__pack_align(data_end + names.count);
+    const size_t index_size = sizeof(*index) * assets.count;
+
+    ok = ok
+        && fd_pwrite_all(out, names.elems, names.count, header.names_offset)
+        && fd_pwrite_all(out, index, index_size, header.index_offset)
+        && fd_truncate(out, header.index_offset + index_size)
+        && fd_pwrite_all(out, &header, sizeof(header), 0);
+    fd_close(out);
+    pack_close(&old);
+
+    if (ok && compact) {
+        path_rename(out_path, pack_path);
+    }
+    if (ok) {
+        INFO("Packed %zu changed of %zu assets into %s", changed, assets.count, pack_path);
+    } else {
+        ERRO("Could not write resource pack %s", pack_path);
+    }
+
+    ARRAY_FREE(&names);
+    free(index);
+    free(items);
+    return ok;
+}
+
+// Prerequisites of the first target of a Makefile depfile, interned. Lines
+// of other targets, like the module rules GCC adds, are skipped.
+static Cstr_Array nobuild__depfile_parse(const char *text)
+{
+    Cstr_Array result = cstr_array_make(NULL);
+    Cstr_Array words = cstr_array_make(NULL);
+    String_Builder word = {0};
+    Cstr first_target = NULL;
+
+    for (const char *c = text;; ++c) {
+        const int line_end = *c == '\0' || *c == '\n';
+        if (*c == '\\' && (c[1] == ' ' || c[1] == '#')) {
+            ARRAY_APPEND(&word, *++c);
+            continue;
+        }
+        if (*c == '$' && c[1] == '$') {
+            ARRAY_APPEND(&word, *++c);
+            continue;
+        }
+        const int continued = *c == '\\' && (c[1] == '\n' || (c[1] == '\r' && c[2] == '\n'));
+        if (!line_end && !continued && *c != ' ' && *c != '\t' && *c != '\r') {
+            ARRAY_APPEND(&word, *c);
+            continue;
+        }
+        if (continued) {
+            c += c[1] == '\r' ? 2 : 1;
+        }
+
+        if (word.count > 0) {
+            words = cstr_array_append(words, cstr_intern_n(word.elems, word.count));
+            word.count = 0;
+        }
+        if (!line_end) {
+            continue;
+        }
+
+        // `target [target...]: prerequisites...`
+        size_t colon = 0;
+        while (colon < words.count && !ENDS_WITH(words.elems[colon], ":")) {
+            colon += 1;
+        }
+        if (colon < words.count) {
+            Cstr target = cstr_intern_n(words.elems[0], strlen(words.elems[0]) - (colon == 0));
+            if (first_target == NULL) {
+                first_target = target;
+            }
+            for (size_t i = colon + 1; target == first_target && i < words.count; ++i) {
+                result = cstr_array_append(result, words.elems[i]);
+            }
+        }
+        words.count = 0;
+
+        if (*c == '\0') {
             break;
         }
+    }
 
-        for (int i = 0; i < bytes_read; i+=16) {
-            fd_printf(output_file, "\t");
-            for (int j = i; j < i+16; j++) {
-                if (j >= bytes_read) {
-                    break;
+    ARRAY_FREE(&word);
+    ARRAY_FREE(&words);
+    return result;
+}
+
+// Reads the rule of a P1689 document into `deps`
+static int nobuild__module_parse(Module_Scanner scanner, const char *json, Module_Deps *deps)
+{
+    cJSON *root = cJSON_Parse(json);
+    const cJSON *rules = cJSON_GetObjectItemCaseSensitive(root, "rules");
+    const cJSON *rule = cJSON_IsArray(rules) ? cJSON_GetArrayItem(rules, 0) : NULL;
+    if (rule == NULL) {
+        cJSON_Delete(root);
+        return 0;
+    }
+
+    deps->provides = NULL;
+    deps->bmi = NULL;
+    deps->is_interface = 0;
+    deps->requires = cstr_array_make(NULL);
+    deps->required_bmis = cstr_array_make(NULL);
+
+    const cJSON *primary_output = cJSON_GetObjectItemCaseSensitive(rule, "primary-output");
+    if (cJSON_IsString(primary_output)) {
+        deps->object = cstr_intern(primary_output->valuestring);
+    }
+
+    const cJSON *item;
+    const cJSON *provides = cJSON_GetObjectItemCaseSensitive(rule, "provides");
+    cJSON_ArrayForEach(item, provides) {
+        const cJSON *name = cJSON_GetObjectItemCaseSensitive(item, "logical-name");
+        if (cJSON_IsString(name)) {
+            const cJSON *bmi = cJSON_GetObjectItemCaseSensitive(item, "compiled-module-path");
+            const cJSON *is_interface = cJSON_GetObjectItemCaseSensitive(item, "is-interface");
+            deps->provides = cstr_intern(name->valuestring);
+            deps->bmi = cJSON_IsString(bmi) ? cstr_intern(bmi->valuestring) : NULL;
+            // P1689 defaults to an interface when the scanner leaves it out
+            deps->is_interface = !cJSON_IsFalse(is_interface);
+        }
+    }
+
+    const cJSON *requires = cJSON_GetObjectItemCaseSensitive(rule, "requires");
+    cJSON_ArrayForEach(item, requires) {
+        const cJSON *name = cJSON_GetObjectItemCaseSensitive(item, "logical-name");
+        if (cJSON_IsString(name)) {
+            const cJSON *bmi = cJSON_GetObjectItemCaseSensitive(item, "compiled-module-path");
+            deps->requires = cstr_array_append(deps->requires, cstr_intern(name->valuestring));
+            deps->required_bmis = cstr_array_append(deps->required_bmis,
+                                                    cJSON_IsString(bmi) ? cstr_intern(bmi->valuestring) : NULL);
+        }
+    }
+    cJSON_Delete(root);
+
+    if (deps->provides != NULL && deps->bmi == NULL) {
+        // Partitions are named `module:partition`, which is no file name on Windows
+        String_Builder sb = {0};
+        sb_append_cstr(&sb, deps->provides);
+        for (size_t i = 0; i < sb.count; ++i) {
+            sb.elems[i] = sb.elems[i] == ':' ? '-' : sb.elems[i];
+        }
+        sb_append_cstr(&sb, scanner == MODULE_SCANNER_GCC ? ".gcm" : ".pcm");
+        ARRAY_APPEND(&sb, '\0');
+        Cstr dir = deps->object != NULL ? path_dirname(deps->object) : ".";
+        deps->bmi = path_normalize(PATH(dir, sb.elems));
+        ARRAY_FREE(&sb);
+    }
+    return 1;
+}
+
+int module_scan(Module_Scanner scanner, Cmd compile, Cstr source, Cstr object, Module_Deps *deps)
+{
+    memset(deps, 0, sizeof(*deps));
+    deps->source = source;
+    deps->object = object;
+
+    File_Map contents = file_map(source);
+    if (contents.data == NULL) {
+        return 0;
+    }
+
+    // The cache entry of a source is valid as long as the source and the
+    // flags it is scanned with are the same, and the headers in the depfile
+    // of the scan are older than the depfile
+    char key[2 * sizeof(unsigned long long) + 2];
+    const unsigned long long hash = (unsigned long long) cstr_hash_n(contents.data, contents.size)
+        ^ (unsigned long long) cstr_hash(cmd_show(compile)) * 31 ^ scanner;
+    snprintf(key, sizeof(key), "%016llx\n", hash);
+    file_unmap(&contents);
+
+    char name[2 * sizeof(unsigned long long) + 5];
+    snprintf(name, sizeof(name), "%016llx.ddi", (unsigned long long) cstr_hash(JOIN("\n", source, object)));
+    path_mkdirs(cstr_array_make(NOBUILD_MODULE_CACHE_DIR, NULL));
+    Cstr cache_path = PATH(NOBUILD_MODULE_CACHE_DIR, name);
+    Cstr depfile = CONCAT(cache_path, ".d");
+
+    char *cached = path_exists(cache_path) ? read_entire_file(cache_path, NULL) : NULL;
+    char *headers = cached != NULL && path_exists(depfile) ? read_entire_file(depfile, NULL) : NULL;
+    if (cached != NULL && headers != NULL && strncmp(cached, key, strlen(key)) == 0) {
+        Cstr_Array inputs = nobuild__depfile_parse(headers);
+        const int fresh = !path_needs_rebuild(cstr_array_make(depfile, NULL), inputs);
+        ARRAY_FREE(&inputs);
+        if (fresh && nobuild__module_parse(scanner, cached + strlen(key), deps)) {
+            free(headers);
+            free(cached);
+            return 1;
+        }
+    }
+    free(headers);
+    free(cached);
+
+    Cstr json_path = CONCAT(cache_path, ".json");
+    Cmd cmd = {0};
+    switch (scanner) {
+    case MODULE_SCANNER_CLANG: {
+        CMD_APPEND(&cmd, NOBUILD_CLANG_SCAN_DEPS, "-format=p1689", "--");
+        cmd_extend(&cmd, compile.line);
+        CMD_APPEND(&cmd, "-c", source, "-o", object, "-MD", "-MF", depfile, "-MT", object);
+        INFO("CMD: %s", cmd_show(cmd));
+        Fd json = fd_open_for_write(json_path);
+        pid_wait(cmd_run_async(cmd, NULL, &json));
+        fd_close(json);
+    }
+    break;
+
+    case MODULE_SCANNER_GCC: {
+        Cstr preprocessed = CONCAT(cache_path, ".i");
+        cmd_extend(&cmd, compile.line);
+        CMD_APPEND(&cmd, "-E", "-x", "c++", source, "-fmodules-ts", "-fdeps-format=p1689r5",
+                   CONCAT("-fdeps-file=", json_path), CONCAT("-fdeps-target=", object),
+                   "-MD", "-MF", depfile, "-MT", object, "-o", preprocessed);
+        INFO("CMD: %s", cmd_show(cmd));
+        cmd_run_sync(cmd);
+        path_rm(preprocessed);
+    }
+    break;
+
+    default:
+        PANIC("Unknown module scanner %d", (int) scanner);
+    }
+    ARRAY_FREE(&cmd.line);
+
+    size_t json_size = 0;
+    char *json = read_entire_file(json_path, &json_size);
+    path_rm(json_path);
+    if (json == NULL || !nobuild__module_parse(scanner, json, deps)) {
+        ERRO("Could not read the P1689 dependencies of %s", source);
+        free(json);
+        return 0;
+    }
+
+    String_Builder sb = {0};
+    sb_append_cstr(&sb, key);
+    sb_append_buf(&sb, json, json_size);
+    path_write_if_changed(cache_path, sb.elems, sb.count);
+    ARRAY_FREE(&sb);
+    free(json);
+    return 1;
+}
+
+static int nobuild__module_deps_compare(const void *a, const void *b)
+{
+    const size_t level_a = ((const Module_Deps *) a)->level;
+    const size_t level_b = ((const Module_Deps *) b)->level;
+    return level_a < level_b ? -1 : level_a > level_b;
+}
+
+int module_sort(Module_Deps *deps, size_t count)
+{
+    Cstr_Map providers = {0};
+    for (size_t i = 0; i < count; ++i) {
+        deps[i].level = 0;
+        if (deps[i].provides != NULL) {
+            if (cstr_map_put(&providers, deps[i].provides, &deps[i]) != NULL) {
+                ERRO("Module %s is provided by more than one source", deps[i].provides);
+            }
+        }
+    }
+
+    // Raise the level of every source above the levels of the modules it
+    // imports until nothing changes. A cycle keeps raising levels forever,
+    // so give up once a level reaches the number of sources.
+    int ok = 1;
+    for (int changed = 1; changed && ok;) {
+        changed = 0;
+        for (size_t i = 0; i < count && ok; ++i) {
+            for (size_t j = 0; j < deps[i].requires.count; ++j) {
+                const Module_Deps *provider = cstr_map_get(&providers, deps[i].requires.elems[j]);
+                if (provider != NULL && provider->level >= deps[i].level) {
+                    deps[i].level = provider->level + 1;
+                    changed = 1;
                 }
-                fd_printf(output_file, "0x%02x, ", buffer[j]);
             }
-            fd_printf(output_file, "\n");
+
+            if (deps[i].level >= count) {
+                ERRO("Module imports of %s form a cycle", deps[i].source);
+                ok = 0;
+            }
         }
-        total_bytes_read += (unsigned long) bytes_read;
-    } while (1);
+    }
+    cstr_map_free(&providers);
 
-    if (null_term) {
-        fd_printf(output_file, "\t0x00 /* Terminate with null */\n");
-        total_bytes_read++;
+    if (ok) {
+        // The providers map points into `deps`, so only sort once it is gone
+        qsort(deps, count, sizeof(*deps), nobuild__module_deps_compare);
+    }
+    return ok;
+}
+
+typedef struct {
+    const Module_Deps **elems;
+    size_t count;
+    size_t capacity;
+} Nobuild__Module_Units;
+
+void module_flags(Module_Scanner scanner, Cmd *cmd, const Module_Deps *deps, size_t count, size_t index)
+{
+    const Module_Deps *unit = &deps[index];
+
+    Cstr_Map providers = {0};
+    for (size_t i = 0; i < count; ++i) {
+        if (deps[i].provides != NULL) {
+            cstr_map_put(&providers, deps[i].provides, (void *) &deps[i]);
+        }
+    }
+
+    // Name and BMI of the provided module and of every module it imports,
+    // directly or not: loading the BMI of an import also loads the BMIs of
+    // its own imports, so the compiler has to find all of them
+    Cstr_Array modules = cstr_array_make(NULL);
+    Cstr_Set seen = {0};
+    if (unit->provides != NULL) {
+        modules = cstr_array_append(modules, unit->provides);
+        modules = cstr_array_append(modules, unit->bmi);
+        cstr_set_add(&seen, unit->provides);
+    }
+    Nobuild__Module_Units pending = {0};
+    ARRAY_APPEND(&pending, unit);
+    for (size_t p = 0; p < pending.count; ++p) {
+        const Module_Deps *importer = pending.elems[p];
+        for (size_t i = 0; i < importer->requires.count; ++i) {
+            Cstr name = importer->requires.elems[i];
+            if (!cstr_set_add(&seen, name)) {
+                continue;
+            }
+
+            const Module_Deps *provider = cstr_map_get(&providers, name);
+            Cstr bmi = i < importer->required_bmis.count ? importer->required_bmis.elems[i] : NULL;
+            if (provider != NULL) {
+                bmi = provider->bmi;
+                ARRAY_APPEND(&pending, provider);
+            }
+            if (bmi != NULL) {
+                modules = cstr_array_append(modules, name);
+                modules = cstr_array_append(modules, bmi);
+            }
+        }
+    }
+    ARRAY_FREE(&pending);
+    cstr_set_free(&seen);
+    cstr_map_free(&providers);
+
+    switch (scanner) {
+    case MODULE_SCANNER_CLANG:
+        for (size_t i = 0; i < modules.count; i += 2) {
+            if (i == 0 && unit->provides != NULL) {
+                CMD_APPEND(cmd, CONCAT("-fmodule-output=", modules.elems[1]));
+            } else {
+                CMD_APPEND(cmd, CONCAT("-fmodule-file=", modules.elems[i], "=", modules.elems[i + 1]));
+            }
+        }
+        break;
+
+    case MODULE_SCANNER_GCC: {
+        // One `<name> <bmi>` line per module, the provided one is written there too
+        String_Builder sb = {0};
+        for (size_t i = 0; i < modules.count; i += 2) {
+            sb_appendf(&sb, "%s %s\n", modules.elems[i], modules.elems[i + 1]);
+        }
+        char name[2 * sizeof(unsigned long long) + 8];
+        snprintf(name, sizeof(name), "%016llx.modmap", (unsigned long long) cstr_hash(JOIN("\n", unit->source, unit->object)));
+        path_mkdirs(cstr_array_make(NOBUILD_MODULE_CACHE_DIR, NULL));
+        Cstr mapper = PATH(NOBUILD_MODULE_CACHE_DIR, name);
+        path_write_if_changed(mapper, sb.elems, sb.count);
+        ARRAY_FREE(&sb);
+        CMD_APPEND(cmd, "-fmodules-ts", CONCAT("-fmodule-mapper=", mapper));
+    }
+    break;
+
+    default:
+        PANIC("Unknown module scanner %d", (int) scanner);
+    }
+
+    ARRAY_FREE(&modules);
+}
+
+typedef struct {
+    Cstr path;
+    unsigned long long size;
+} Nobuild__Unity_Source;
+
+static int nobuild__is_cxx_source(Cstr path)
+{
+    return ENDS_WITH(path, ".cpp") || ENDS_WITH(path, ".cc") || ENDS_WITH(path, ".cxx") || ENDS_WITH(path, ".C");
+}
+
+// C sources first, so C and C++ never share a batch, then by path
+static int nobuild__unity_source_compare(const void *a, const void *b)
+{
+    Cstr path_a = ((const Nobuild__Unity_Source *) a)->path;
+    Cstr path_b = ((const Nobuild__Unity_Source *) b)->path;
+    const int cxx_a = nobuild__is_cxx_source(path_a);
+    const int cxx_b = nobuild__is_cxx_source(path_b);
+    return cxx_a != cxx_b ? cxx_a - cxx_b : strcmp(path_a, path_b);
+}
+
+// Whether `file` is named like the unity files of `name`: `<name>_<hash>.c` or `.cpp`
+static int nobuild__is_unity_file(Cstr file, Cstr name)
+{
+    const size_t name_len = strlen(name);
+    if (strncmp(file, name, name_len) != 0 || file[name_len] != '_') {
+        return 0;
+    }
+
+    Cstr hash = file + name_len + 1;
+    for (size_t i = 0; i < 16; ++i) {
+        if (!isxdigit((unsigned char) hash[i])) {
+            return 0;
+        }
+    }
+    return strcmp(hash + 16, ".c") == 0 || strcmp(hash + 16, ".cpp") == 0;
+}
+
+// Writes the unity file of `sources[0..count)`, returns its path and adds its name to `written`
+static Cstr nobuild__unity_write(Unity_Options options, const Nobuild__Unity_Source *sources, size_t count, Cstr_Set *written)
+{
+    // Named after the first source, so the name stays as long as the batch starts there
+    char hash[17];
+    snprintf(hash, sizeof(hash), "%016llx", (unsigned long long) cstr_hash(sources[0].path));
+    Cstr name = CONCAT(options.name, "_", hash, nobuild__is_cxx_source(sources[0].path) ? ".cpp" : ".c");
+    cstr_set_add(written, cstr_intern(name));
+    Cstr unity_path = PATH(options.out_dir, name);
+
+    String_Builder sb = {0};
+    sb_append_cstr(&sb, "// Generated by nobuild, do not edit\n");
+    for (size_t i = 0; i < count; ++i) {
+        sb_append_cstr(&sb, "#include \"");
+        for (Cstr c = path_realpath(sources[i].path); *c != '\0'; ++c) {
+            if (*c == '\\' || *c == '"') {
+                ARRAY_APPEND(&sb, '\\');
+            }
+            ARRAY_APPEND(&sb, *c);
+        }
+        sb_append_cstr(&sb, "\"\n");
+    }
+    path_write_if_changed(unity_path, sb.elems, sb.count);
+    ARRAY_FREE(&sb);
+
+    return unity_path;
+}
+
+Cstr_Array unity_build(Cstr_Array sources, Unity_Options options)
+{
+    if (options.name == NULL) {
+        options.name = "unity";
+    }
+
+    Cstr_Set excluded = {0};
+    for (size_t i = 0; i < options.excluded.count; ++i) {
+        cstr_set_add(&excluded, path_normalize(options.excluded.elems[i]));
+    }
+
+    Fd_Batch batch = {0};
+    Cstr_Array compiled_alone = cstr_array_make(NULL);
+    for (size_t i = 0; i < sources.count; ++i) {
+        if (cstr_set_contains(&excluded, path_normalize(sources.elems[i]))) {
+            compiled_alone = cstr_array_append(compiled_alone, sources.elems[i]);
+        } else {
+            fd_batch_stat(&batch, sources.elems[i]);
+        }
+    }
+    cstr_set_free(&excluded);
+    fd_batch_submit(&batch);
+
+    const size_t count = batch.count;
+    Nobuild__Unity_Source *batched = malloc(sizeof(*batched) * (count + 1));
+    if (batched == NULL) {
+        PANIC("Could not allocate memory: %s", strerror(errno));
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (batch.elems[i].error != 0) {
+            WARN("Could not stat %s: %s", batch.elems[i].path, strerror(batch.elems[i].error));
+        }
+        batched[i].path = batch.elems[i].path;
+        batched[i].size = batch.elems[i].file_size;
+    }
+    ARRAY_FREE(&batch);
+    qsort(batched, count, sizeof(*batched), nobuild__unity_source_compare);
+
+    size_t max_sources = options.max_sources;
+    if (max_sources == 0 && options.max_bytes == 0) {
+        max_sources = NOBUILD_UNITY_SIZE;
+    }
+
+    // A batch ends after a source whose path hashes to a multiple of
+    // `spacing`, about every `spacing` sources, so where batches end does not
+    // depend on the other sources. It also ends early when it is full. The
+    // spacing only depends on the options, as the sizes of the sources change.
+    size_t limit = max_sources;
+    if (options.max_bytes > 0) {
+        const size_t by_bytes = (size_t) (options.max_bytes / NOBUILD_UNITY_SOURCE_BYTES);
+        limit = limit == 0 || by_bytes < limit ? by_bytes : limit;
+    }
+    const size_t spacing = limit / 2 > 0 ? limit / 2 : 1;
+
+    path_mkdirs(cstr_array_make(options.out_dir, NULL));
+    Cstr_Array result = cstr_array_make(NULL);
+    Cstr_Set written = {0};
+    size_t begin = 0;
+    unsigned long long bytes = 0;
+    for (size_t i = 0; i < count; ++i) {
+        bytes += batched[i].size;
+
+        int end = i + 1 == count || cstr_hash(batched[i].path) % spacing == 0;
+        if (!end) {
+            const Nobuild__Unity_Source *next = &batched[i + 1];
+            end = nobuild__is_cxx_source(next->path) != nobuild__is_cxx_source(batched[i].path)
+                || (max_sources > 0 && i + 1 - begin >= max_sources)
+                || (options.max_bytes > 0 && bytes + next->size > options.max_bytes);
+        }
+
+        if (end) {
+            Cstr unity_path = nobuild__unity_write(options, &batched[begin], i + 1 - begin, &written);
+            result = cstr_array_append(result, unity_path);
+            begin = i + 1;
+            bytes = 0;
+        }
+    }
+    free(batched);
+
+    // Remove the unity files of batches that are gone, so globbing the
+    // directory does not compile their sources twice
+    Cstr_Array stale = cstr_array_make(NULL);
+    FOREACH_FILE_IN_DIR(file, options.out_dir, {
+        if (nobuild__is_unity_file(file, options.name) && !cstr_set_contains(&written, file)) {
+            stale = cstr_array_append(stale, PATH(options.out_dir, file));
+        }
+    });
+    for (size_t i = 0; i < stale.count; ++i) {
+        path_rm(stale.elems[i]);
     }
-    fd_printf(output_file, "};\n");
-    fd_printf(output_file, "unsigned long %s_len = %lu;\n", array_name, total_bytes_read);
+    cstr_set_free(&written);
 
-    fd_close(file);
-    fd_close(output_file);
+    return cstr_array_concat(result, compiled_alone);
+}
+
+static int nobuild__is_cxx_pch(Cmd compile, Cstr header)
+{
+    Cstr compiler = compile.line.count > 0 ? path_basename(compile.line.elems[0]) : "";
+    return ENDS_WITH(compiler, "++") || ENDS_WITH(compiler, "++.exe")
+        || ENDS_WITH(header, ".hpp") || ENDS_WITH(header, ".hh") || ENDS_WITH(header, ".hxx") || ENDS_WITH(header, ".H");
+}
+
+Pch pch_build(Pch_Compiler compiler, Cmd compile, Cstr header)
+{
+    Pch pch = {0};
+    pch.compiler = compiler;
+
+    Cstr header_path = path_realpath(header);
+    if (!path_exists(header_path)) {
+        ERRO("Could not find the header %s to precompile", header);
+        return pch;
+    }
+
+    char key[2 * sizeof(unsigned long long) + 1];
+    snprintf(key, sizeof(key), "%016llx", (unsigned long long) cstr_hash(JOIN("\n", cmd_show(compile), header_path)) ^ compiler);
+    Cstr pch_dir = PATH(NOBUILD_PCH_DIR, key);
+    path_mkdirs(cstr_array_make(pch_dir, NULL));
+
+    Cstr source = header_path;
+    switch (compiler) {
+    case PCH_COMPILER_GCC: {
+        // GCC falls back to the file `-include` names when the `.gch` does
+        // not match the compile, so that file includes the header
+        pch.include = PATH(pch_dir, path_basename(header_path));
+        pch.path = CONCAT(pch.include, ".gch");
+        String_Builder sb = {0};
+        sb_append_cstr(&sb, "// Generated by nobuild, do not edit\n#include \"");
+        for (Cstr c = header_path; *c != '\0'; ++c) {
+            if (*c == '\\' || *c == '"') {
+                ARRAY_APPEND(&sb, '\\');
+            }
+            ARRAY_APPEND(&sb, *c);
+        }
+        sb_append_cstr(&sb, "\"\n");
+        path_write_if_changed(pch.include, sb.elems, sb.count);
+        ARRAY_FREE(&sb);
+        source = pch.include;
+    }
+    break;
+
+    case PCH_COMPILER_CLANG:
+        pch.path = PATH(pch_dir, CONCAT(path_basename(header_path), ".pch"));
+        break;
+
+    default:
+        PANIC("Unknown PCH compiler %d", (int) compiler);
+    }
+
+    Cstr_Array include_dirs = cstr_array_make(NULL);
+    for (size_t i = 0; i < compile.line.count; ++i) {
+        Cstr arg = compile.line.elems[i];
+        if (strcmp(arg, "-I") == 0 && i + 1 < compile.line.count) {
+            include_dirs = cstr_array_append(include_dirs, compile.line.elems[++i]);
+        } else if (STARTS_WITH(arg, "-I")) {
+            include_dirs = cstr_array_append(include_dirs, arg);
+        }
+    }
+    Cstr_Array inputs = cstr_array_append(path_scan_includes(header_path, include_dirs), header_path);
+    ARRAY_FREE(&include_dirs);
+
+    if (path_needs_rebuild(cstr_array_make(pch.path, NULL), inputs)) {
+        Cmd cmd = {0};
+        cmd_extend(&cmd, compile.line);
+        CMD_APPEND(&cmd, "-x", nobuild__is_cxx_pch(compile, header) ? "c++-header" : "c-header", source, "-o", pch.path);
+        INFO("CMD: %s", cmd_show(cmd));
+        cmd_run_sync(cmd);
+        ARRAY_FREE(&cmd.line);
+    }
+    ARRAY_FREE(&inputs);
+
+    return pch;
+}
+
+void pch_use(Cmd *cmd, Pch pch)
+{
+    if (pch.path == NULL) {
+        return;
+    }
+
+    switch (pch.compiler) {
+    case PCH_COMPILER_GCC:
+        CMD_APPEND(cmd, "-include", pch.include, "-Winvalid-pch");
+        break;
+
+    case PCH_COMPILER_CLANG:
+        CMD_APPEND(cmd, "-include-pch", pch.path);
+        break;
+
+    default:
+        PANIC("Unknown PCH compiler %d", (int) pch.compiler);
+    }
 }
@@ -71,5 +71,250 @@
 
 char *shift_args(int *argc, char ***argv);
 
+// Embed the file at `path` into `array_name`, with its size in `<array_name>_len`.
+// `file_to_c_array()` writes the bytes out as an initializer, which works with
+// any compiler but gets slow to compile for large files. `file_to_c_embed()`
+// writes a C23 `#embed` directive instead and `file_to_c_incbin()` an
+// assembler `.incbin` stub for GCC and Clang, both of which compile in no
+// time. The last two refer to `path` relative to the directory of `out_path`:
+// `#embed` finds it from there, the `.incbin` stub needs that directory on
+// the assembler include path, like `-Wa,-I<dir>`, and records its size at
+// generation time.
 void file_to_c_array(Cstr path, Cstr out_path, Cstr array_type,  Cstr array_name, int null_term);
-#define FILE_TO_C_ARRAY(path, out_path, array_name) file_to_c_array(path, out_path, "unsigned char", array_name, 1)
\ No newline at end of file
+void file_to_c_embed(Cstr path, Cstr out_path, Cstr array_type, Cstr array_name, int null_term);
+void file_to_c_incbin(Cstr path, Cstr out_path, Cstr array_type, Cstr array_name, int null_term);
+#define FILE_TO_C_ARRAY(path, out_path, array_name) file_to_c_array(path, out_path, "unsigned char", array_name, 1)
+#define FILE_TO_C_EMBED(path, out_path, array_name) file_to_c_embed(path, out_path, "unsigned char", array_name, 1)
+#define FILE_TO_C_INCBIN(path, out_path, array_name) file_to_c_incbin(path, out_path, "unsigned char", array_name, 1)
+
+// Resource packs bundle many assets into one archive, so they are embedded
+// once instead of once per file:
+//
+//   Pack_Assets assets = {0};
+//   pack_add(&assets, "shaders/blit.frag", "assets/blit.frag");
+//   pack_add(&assets, "fonts/mono.ttf", "assets/mono.ttf");
+//   pack_write("build/assets.pack", assets);
+//   PACK_TO_C("build/assets.pack", "build/assets.c", "assets");
+//
+// `pack_write()` only writes the assets whose contents changed since the last
+// run, and leaves the archive alone when none did. At runtime:
+//
+//   Pack pack = pack_open("assets.pack");   // or pack_from_memory(assets, assets_len)
+//   String_View font = pack_find(&pack, "fonts/mono.ttf");
+//
+// The archive is a header, the asset data aligned to `NOBUILD_PACK_ALIGN`, the
+// names and an index sorted by name. Integers are 64 bits in the byte order of
+// the machine that wrote it.
+#ifndef NOBUILD_PACK_ALIGN
+#define NOBUILD_PACK_ALIGN 16
+#endif
+
+#define NOBUILD_PACK_MAGIC "NBPACK\0\1"
+
+typedef struct {
+    char magic[8];
+    unsigned long long count;
+    // End of the asset data
+    unsigned long long names_offset;
+    unsigned long long index_offset;
+} Pack_Header;
+
+typedef struct {
+    unsigned long long name_offset;
+    unsigned long long offset;
+    unsigned long long size;
+    unsigned long long hash;
+    // Modification time of the source, so unchanged assets are not hashed again
+    long long mtime;
+} Pack_Entry;
+
+typedef struct {
+    Cstr name;
+    Cstr path;
+} Pack_Asset;
+
+typedef struct {
+    Pack_Asset *elems;
+    size_t count;
+    size_t capacity;
+} Pack_Assets;
+
+void pack_add(Pack_Assets *assets, Cstr name, Cstr path);
+// Returns 0 on error
+int pack_write(Cstr pack_path, Pack_Assets assets);
+// Embeds the archive through `file_to_c_incbin()`, which keeps it aligned
+#define PACK_TO_C(pack_path, out_path, array_name) file_to_c_incbin(pack_path, out_path, "unsigned char", array_name, 0)
+
+typedef struct {
+    File_Map map;
+    const Pack_Header *header;
+    const Pack_Entry *index;
+    const char *names;
+} Pack;
+
+// `header` is NULL if the archive could not be read, or if any of its entries lies outside of it
+Pack pack_open(Cstr path);
+Pack pack_from_memory(const void *data, size_t size);
+// `data` is NULL if there is no asset called `name`
+String_View pack_find(const Pack *pack, Cstr name);
+void pack_close(Pack *pack);
+
+// C++20 modules: the order in which sources must be compiled is only known
+// after asking the compiler which modules each source provides and imports,
+// in the P1689 format.
+//
+//   Cmd cxx = {0};
+//   CMD_APPEND(&cxx, "clang++", "-std=c++20");
+//   Module_Deps deps[2];
+//   module_scan(MODULE_SCANNER_CLANG, cxx, "src/math.cppm", "build/math.o", &deps[0]);
+//   module_scan(MODULE_SCANNER_CLANG, cxx, "src/main.cpp", "build/main.o", &deps[1]);
+//   module_sort(deps, 2);
+//
+//   // Compile level 0, then level 1, ... The sources of one level can be compiled in parallel.
+//   for (size_t i = 0; i < 2; ++i) {
+//       Cmd cmd = {0};
+//       cmd_extend(&cmd, cxx.line);
+//       module_flags(MODULE_SCANNER_CLANG, &cmd, deps, 2, i);
+//       CMD_APPEND(&cmd, "-c", deps[i].source, "-o", deps[i].object);
+//       cmd_run_sync(cmd);
+//   }
+//
+// `compile` is the compiler with the flags of the compile, without the source
+// and the output. Scan results are cached in `NOBUILD_MODULE_CACHE_DIR` along
+// with the depfile of the scan, and only computed again when the source,
+// `compile` or one of the headers the source includes changes.
+#ifndef NOBUILD_MODULE_CACHE_DIR
+#define NOBUILD_MODULE_CACHE_DIR ".nobuild_modules"
+#endif
+
+#ifndef NOBUILD_CLANG_SCAN_DEPS
+#define NOBUILD_CLANG_SCAN_DEPS "clang-scan-deps"
+#endif
+
+typedef enum {
+    // clang-scan-deps -format=p1689
+    MODULE_SCANNER_CLANG,
+    // g++ -fdeps-format=p1689r5
+    MODULE_SCANNER_GCC,
+} Module_Scanner;
+
+typedef struct {
+    Cstr source;
+    Cstr object;
+    // Name of the module the source provides, NULL if it is not a module unit
+    // that other sources can import
+    Cstr provides;
+    // Where the compile of the source writes the BMI of `provides`: the path
+    // the scanner gives, or `<name>.pcm` (`.gcm` for GCC) next to the object
+    Cstr bmi;
+    // 0 for the implementation partitions, which a module cannot export
+    int is_interface;
+    // Names of the modules the source imports
+    Cstr_Array requires;
+    // BMI of each of `requires` if the scanner knows it, NULL otherwise. The
+    // BMIs of modules provided by the other scanned sources take precedence.
+    Cstr_Array required_bmis;
+    // Set by `module_sort()`, a source only imports modules of lower levels
+    size_t level;
+} Module_Deps;
+
+// Returns 0 if the scanner output could not be understood
+int module_scan(Module_Scanner scanner, Cmd compile, Cstr source, Cstr object, Module_Deps *deps);
+// Orders `deps` by level. Imports of modules that none of `deps` provide, like
+// `std`, are left to the compiler. Returns 0 if the imports form a cycle.
+int module_sort(Module_Deps *deps, size_t count);
+// Appends the flags that make the compile of `deps[index]` write the BMI of
+// the module it provides and find the BMIs of the modules it imports,
+// including the ones imported by those modules:
+// `-fmodule-output=` and `-fmodule-file=<name>=<bmi>` for Clang, a
+// `-fmodule-mapper=` file in `NOBUILD_MODULE_CACHE_DIR` for GCC
+void module_flags(Module_Scanner scanner, Cmd *cmd, const Module_Deps *deps, size_t count, size_t index);
+
+// Unity builds: compile many sources as one translation unit, so the headers
+// they share are parsed once per batch instead of once per source.
+//
+//   Unity_Options options = {
+//       .out_dir = "build/unity",
+//       .name = "game",
+//       .max_sources = 16,
+//       .excluded = cstr_array_make("src/uses_static_globals.c", NULL),
+//   };
+//   Cstr_Array to_compile = unity_build(sources, options);
+//
+// Each batch becomes `<out_dir>/<name>_<hash>.c` (`.cpp` for C++ sources),
+// which only `#include`s its sources. A batch ends after a source whose path
+// hashes to a multiple of a spacing that only depends on the options, or
+// when it is full, so adding, removing or editing a source usually only
+// changes the batch it is in and the next one. The spacing is half of the
+// limit, so batches hold about half of it and are rarely cut by it.
+//
+// Unity files are written with `path_write_if_changed()`, and the files of
+// the same `name` in `out_dir` whose batches no longer exist are removed, so
+// targets that share `out_dir` need different names.
+#ifndef NOBUILD_UNITY_SIZE
+#define NOBUILD_UNITY_SIZE 8
+#endif
+
+// Typical size of a source, turns `max_bytes` into a number of sources to space batches by
+#ifndef NOBUILD_UNITY_SOURCE_BYTES
+#define NOBUILD_UNITY_SOURCE_BYTES 16384
+#endif
+
+typedef struct {
+    // Directory of the unity files, created if needed
+    Cstr out_dir;
+    // Prefix of the unity files, "unity" if NULL
+    Cstr name;
+    // At most that many sources per batch. `NOBUILD_UNITY_SIZE` when neither
+    // this nor `max_bytes` is set.
+    size_t max_sources;
+    // At most that many bytes of sources per batch, unless a single source is bigger
+    unsigned long long max_bytes;
+    // Sources that must be compiled on their own
+    Cstr_Array excluded;
+} Unity_Options;
+
+// Returns the unity files followed by the excluded sources, which together
+// are what needs to be compiled
+Cstr_Array unity_build(Cstr_Array sources, Unity_Options options);
+
+// Precompiled headers: a heavy header shared by many sources is parsed once
+// per compiler and flags instead of once per compile.
+//
+//   Cmd cc = {0};
+//   CMD_APPEND(&cc, "cc", "-O2", "-Iinclude");
+//   Pch pch = pch_build(PCH_COMPILER_GCC, cc, "include/common.h");
+//
+//   Cmd cmd = {0};
+//   cmd_extend(&cmd, cc.line);
+//   pch_use(&cmd, pch);
+//   CMD_APPEND(&cmd, "-c", "src/main.c", "-o", "build/main.o");
+//
+// `compile` is the compiler with the flags of the compiles, without the
+// source and the output, as a PCH only loads with the flags it was built
+// with. Each PCH is stored in `NOBUILD_PCH_DIR` under a hash of the compiler,
+// `compile` and the header, so different flags get different PCHs, and it is
+// only built again when the header or the headers it includes change, found
+// with `path_scan_includes()` and the `-I` flags of `compile`.
+#ifndef NOBUILD_PCH_DIR
+#define NOBUILD_PCH_DIR ".nobuild_pch"
+#endif
+
+typedef enum {
+    // `<header>.gch` next to a stub that includes the header, used with `-include`
+    PCH_COMPILER_GCC,
+    // `<header>.pch`, used with `-include-pch`
+    PCH_COMPILER_CLANG,
+} Pch_Compiler;
+
+typedef struct {
+    Pch_Compiler compiler;
+    // The `.gch` or `.pch` file, NULL if it could not be built
+    Cstr path;
+    // What `-include` names for GCC, which looks for `<include>.gch` first
+    Cstr include;
+} Pch;
+
+Pch pch_build(Pch_Compiler compiler, Cmd compile, Cstr header);
+// Appends the flags that make the compile use `pch`, nothing if it was not built
+void pch_use(Cmd *cmd, Pch pch);
@@ -53,6 +53,31 @@ LPSTR nobuild__GetLastErrorAsString(void)
 }
 #endif // NOBUILD__GETLASTERROR
 
+void cmd_append(Cmd *cmd, ...)
+{
+    va_list args;
+    va_start(args, cmd);
+    for (Cstr arg = va_arg(args, Cstr);
+            arg != NULL;
+            arg = va_arg(args, Cstr)) {
+        // Keep a spare slot so `cmd_run_async()` can terminate argv in place
+        ARRAY_RESERVE(&cmd->line, cmd->line.count + 2);
+        cmd->line.elems[cmd->line.count++] = arg;
+    }
+    va_end(args);
+}
+
+void cmd_extend(Cmd *cmd, Cstr_Array args)
+{
+    ARRAY_RESERVE(&cmd->line, cmd->line.count + args.count + 1);
+    ARRAY_APPEND_MANY(&cmd->line, args.elems, args.count);
+}
+
+void cmd_reset(Cmd *cmd)
+{
+    cmd->line.count = 0;
+}
+
 Cstr cmd_show(Cmd cmd)
 {
     // TODO(#31): cmd_show does not render the command line properly
@@ -72,12 +97,17 @@ Pid cmd_run_async(Cmd cmd, Fd *fdin, Fd *fdout)
     }
 
     if (cpid == 0) {
-        Cstr_Array args = {
-            .count = cmd.line.count
-        };
-        args.elems = malloc(sizeof(Cstr) * args.count+1);
-        memcpy(args.elems, cmd.line.elems, args.count * sizeof(Cstr));
-        args.elems[args.count++] = NULL;
+        // The child owns a copy of the parent memory, so argv can be terminated
+        // in place when the array has room for it
+        Cstr_Array args = cmd.line;
+        if (args.capacity <= args.count) {
+            args.elems = malloc(sizeof(Cstr) * (args.count + 1));
+            if (args.elems == NULL) {
+                PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+            }
+            memcpy(args.elems, cmd.line.elems, args.count * sizeof(Cstr));
+        }
+        args.elems[args.count] = NULL;
 
         if (fdin) {
             if (dup2(*fdin, STDIN_FILENO) < 0) {
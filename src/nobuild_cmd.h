@@ -17,6 +17,25 @@ typedef struct {
     Cstr_Array line;
 } Cmd;
 
+// Builds a command in place, reusing the storage of `cmd->line` across
+// commands. For many commands that share their flags, build the shared part
+// once as a template and extend a reset command with it:
+//
+//   Cmd cc = {0};
+//   CMD_APPEND(&cc, "cc", "-Wall", "-O2", "-c");
+//
+//   Cmd cmd = {0};
+//   for (size_t i = 0; i < sources.count; ++i) {
+//       cmd_reset(&cmd);
+//       cmd_extend(&cmd, cc.line);
+//       CMD_APPEND(&cmd, "-o", objects.elems[i], sources.elems[i]);
+//       cmd_run_sync(cmd);
+//   }
+void cmd_append(Cmd *cmd, ...);
+#define CMD_APPEND(cmd, ...) cmd_append(cmd, __VA_ARGS__, NULL)
+void cmd_extend(Cmd *cmd, Cstr_Array args);
+void cmd_reset(Cmd *cmd);
+
 Cstr cmd_show(Cmd cmd);
 Pid cmd_run_async(Cmd cmd, Fd *fdin, Fd *fdout);
 void cmd_run_sync(Cmd cmd);
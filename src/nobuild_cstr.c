@@ -2,6 +2,7 @@
 #include "nobuild_log.h"
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
 #include <errno.h>
@@ -21,6 +22,30 @@ Cstr nobuild__strerror(int errnum)
 }
 #endif // NOBUILD__STRERROR
 
+// Multiple modules could define these, so add a guard around them to prevent redefinition
+#ifndef NOBUILD__MUTEX
+#define NOBUILD__MUTEX
+#ifdef NOBUILD_NO_THREADS
+typedef int Nobuild__Mutex;
+#	define NOBUILD__MUTEX_INIT 0
+#	define nobuild__mutex_lock(mutex) ((void) (mutex))
+#	define nobuild__mutex_unlock(mutex) ((void) (mutex))
+#elif !defined(_WIN32)
+#	include <pthread.h>
+typedef pthread_mutex_t Nobuild__Mutex;
+#	define NOBUILD__MUTEX_INIT PTHREAD_MUTEX_INITIALIZER
+#	define nobuild__mutex_lock(mutex) pthread_mutex_lock(mutex)
+#	define nobuild__mutex_unlock(mutex) pthread_mutex_unlock(mutex)
+#else
+#	define WIN32_MEAN_AND_LEAN
+#	include <windows.h>
+typedef SRWLOCK Nobuild__Mutex;
+#	define NOBUILD__MUTEX_INIT SRWLOCK_INIT
+#	define nobuild__mutex_lock(mutex) AcquireSRWLockExclusive(mutex)
+#	define nobuild__mutex_unlock(mutex) ReleaseSRWLockExclusive(mutex)
+#endif
+#endif // NOBUILD__MUTEX
+
 int cstr_ends_with(Cstr cstr, Cstr postfix)
 {
     const size_t cstr_len = strlen(cstr);
@@ -36,6 +61,62 @@ int cstr_starts_with(Cstr cstr, Cstr prefix)
     return prefix_len <= cstr_len && strncmp(cstr, prefix, prefix_len) == 0;
 }
 
+String_View sv_from_parts(const char *data, size_t count)
+{
+    String_View sv = {
+        .data = data,
+        .count = count,
+    };
+    return sv;
+}
+
+String_View sv_from_cstr(Cstr cstr)
+{
+    return sv_from_parts(cstr, strlen(cstr));
+}
+
+int sv_eq(String_View a, String_View b)
+{
+    return a.count == b.count && (a.count == 0 || memcmp(a.data, b.data, a.count) == 0);
+}
+
+int sv_eq_cstr(String_View sv, Cstr cstr)
+{
+    return sv_eq(sv, sv_from_cstr(cstr));
+}
+
+Cstr sv_to_cstr(String_View sv)
+{
+#ifdef NOBUILD_INTERN_CSTRS
+    return cstr_intern_n(sv.data, sv.count);
+#else
+    char *result = malloc(sv.count + 1);
+    if (result == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+
+    memcpy(result, sv.data, sv.count);
+    result[sv.count] = '\0';
+    return result;
+#endif
+}
+
+void *nobuild__array_grow(void *elems, size_t elem_size, size_t *capacity, size_t expected_capacity)
+{
+    size_t new_capacity = *capacity > 0 ? *capacity : ARRAY_INIT_CAPACITY;
+    while (new_capacity < expected_capacity) {
+        new_capacity *= 2;
+    }
+
+    elems = realloc(elems, elem_size * new_capacity);
+    if (elems == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+
+    *capacity = new_capacity;
+    return elems;
+}
+
 Cstr_Array cstr_array_make(Cstr first, ...)
 {
     Cstr_Array result = {0};
@@ -54,10 +135,7 @@ Cstr_Array cstr_array_make(Cstr first, ...)
     }
     va_end(args);
 
-    result.elems = malloc(sizeof *result.elems * result.count);
-    if (result.elems == NULL) {
-        PANIC("could not allocate memory: %s", nobuild__strerror(errno));
-    }
+    ARRAY_RESERVE(&result, result.count);
 
     result.count = 0;
     result.elems[result.count++] = first;
@@ -75,16 +153,7 @@ Cstr_Array cstr_array_make(Cstr first, ...)
 
 Cstr_Array cstr_array_append(Cstr_Array cstrs, Cstr cstr)
 {
-    if (cstrs.capacity < 1) {
-        cstrs.elems = realloc(cstrs.elems, sizeof *cstrs.elems * (cstrs.count + 10));
-        cstrs.capacity += 10;
-        if (cstrs.elems == NULL) {
-            PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
-        }
-    }
-
-    cstrs.elems[cstrs.count++] = cstr;
-    cstrs.capacity--;
+    ARRAY_APPEND(&cstrs, cstr);
     return cstrs;
 }
 
@@ -96,28 +165,15 @@ Cstr_Array cstr_array_remove(Cstr_Array cstrs, Cstr cstr)
     }
 
     if (cstr == NULL) {
-        cstrs.elems[--cstrs.count];
-        cstrs.capacity++;
+        cstrs.count--;
         return cstrs;
     }
 
-    // Find the index of the element to be removed
-    const size_t cstr_len = strlen(cstr);
     for (size_t i = 0; i < cstrs.count; i++) {
-        const size_t elem_len = strlen(cstrs.elems[i]);
-        if (elem_len != cstr_len || strcmp(cstrs.elems[i], cstr) != 0) {
-            continue;
+        if (strcmp(cstrs.elems[i], cstr) == 0) {
+            ARRAY_REMOVE(&cstrs, i);
+            return cstrs;
         }
-
-        // Shift elements left if found the cstr
-        for (size_t j = i; j < cstrs.count - 1; j++) {
-            cstrs.elems[j] = cstrs.elems[j + 1];
-        }
-        cstrs.count--;
-        cstrs.capacity++;
-
-        // TODO: Might want to realloc array if capacity is too high
-        return cstrs;
     }
 
     // The string was not found
@@ -126,17 +182,7 @@ Cstr_Array cstr_array_remove(Cstr_Array cstrs, Cstr cstr)
 
 Cstr_Array cstr_array_concat(Cstr_Array cstrs_a, Cstr_Array cstrs_b)
 {
-    if (cstrs_a.capacity < cstrs_b.count) {
-        cstrs_a.elems = realloc(cstrs_a.elems, sizeof *cstrs_a.elems * (cstrs_a.count + cstrs_b.count));
-        cstrs_a.capacity += cstrs_b.count;
-        if (cstrs_a.elems == NULL) {
-            PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
-        }
-    }
-
-    memcpy(cstrs_a.elems + cstrs_a.count, cstrs_b.elems, sizeof *cstrs_a.elems * cstrs_b.count);
-    cstrs_a.count += cstrs_b.count;
-    cstrs_a.capacity -= cstrs_b.count;
+    ARRAY_APPEND_MANY(&cstrs_a, cstrs_b.elems, cstrs_b.count);
     return cstrs_a;
 }
 
@@ -151,114 +197,432 @@ int cstr_array_contains(Cstr_Array cstrs, Cstr cstr) {
 
 Cstr_Array cstr_array_from_cstr(Cstr cstr, Cstr delim)
 {
-    size_t len = strlen(cstr);
-    size_t d_len = strlen(delim);
-    size_t substr_count = 1;
-    for (size_t i = 0; i < len; ++i) {
-        if ((len - i) < d_len) {
-            break;
-        }
+    const size_t len = strlen(cstr);
+    const size_t d_len = strlen(delim);
+
+    // Copy the input once and cut it in place, so the substrings are views
+    // into the same buffer terminated where the delimiters were
+    char *buffer = malloc(len + 1);
+    if (buffer == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+    memcpy(buffer, cstr, len + 1);
 
-        size_t delim_found = 0;
-        for (size_t j = 0; j < d_len; ++j) {
-            if (cstr[i+j] != delim[j]) {
-                delim_found = 0;
+    Cstr_Array result = {0};
+    char *substr = buffer;
+    char *const end = buffer + len;
+
+    // TODO: differentiate between delim == null and delim == "" and delim not found
+    //       Split the string into an array of strings, where each string is a single character
+    if (d_len > 0) {
+        char *p = buffer;
+        while ((size_t) (end - p) >= d_len) {
+            // memchr() is vectorized by the C library, let it find the candidates
+            p = memchr(p, delim[0], (size_t) (end - p) - d_len + 1);
+            if (p == NULL) {
                 break;
             }
-            delim_found = 1;
+
+            if (memcmp(p + 1, delim + 1, d_len - 1) != 0) {
+                p += 1;
+                continue;
+            }
+
+            *p = '\0';
+            ARRAY_APPEND(&result, substr);
+            p += d_len;
+            substr = p;
         }
+    }
+
+    ARRAY_APPEND(&result, substr);
+    return result;
+}
+
+Cstr cstr_array_join(Cstr sep, Cstr_Array cstrs)
+{
+    if (cstrs.count == 0) {
+        return "";
+    }
+
+    const size_t sep_len = strlen(sep);
+    size_t len = 0;
+    for (size_t i = 0; i < cstrs.count; ++i) {
+        len += strlen(cstrs.elems[i]);
+    }
 
-        if (delim_found) {
-            substr_count++;
-            i += d_len - 1;
+    String_Builder sb = {0};
+    ARRAY_RESERVE(&sb, (cstrs.count - 1) * sep_len + len + 1);
+    for (size_t i = 0; i < cstrs.count; ++i) {
+        if (i > 0) {
+            sb_append_buf(&sb, sep, sep_len);
         }
+        sb_append_cstr(&sb, cstrs.elems[i]);
     }
 
-    // if dlen == 0 or was never found
-    if (substr_count == 1) {
-        // TODO: differentiate between delim == null and delim == "" and delim not found
-        //       Split the string into an array of strings, where each string is a single character
-        return cstr_array_make(cstr);
+    return sb_to_cstr(&sb);
+}
+
+size_t cstr_hash_n(const char *data, size_t len)
+{
+    // Mix 8 bytes at a time and finish with the murmur3 finalizer
+    const unsigned long long k = 0x9E3779B97F4A7C15ULL;
+    unsigned long long hash = (unsigned long long) len * k;
+
+    while (len >= 8) {
+        unsigned long long word;
+        memcpy(&word, data, 8);
+        hash = ((hash << 5) | (hash >> 59)) ^ word;
+        hash *= k;
+        data += 8;
+        len -= 8;
     }
 
-    Cstr_Array ret = { .count = substr_count };
-    ret.elems = malloc(sizeof(Cstr) * ret.count);
-    if (ret.elems == NULL) {
-        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    if (len > 0) {
+        unsigned long long word = 0;
+        memcpy(&word, data, len);
+        hash = ((hash << 5) | (hash >> 59)) ^ word;
+        hash *= k;
     }
 
-    size_t substr_start = 0;
-    size_t substr_index = 0;
-    for (size_t i = 0; i < len; ++i) {
-        if ((len - i) < d_len) {
-            break;
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+
+    // A zero hash marks an empty slot in `Cstr_Set` and `Cstr_Map`
+    return (size_t) hash != 0 ? (size_t) hash : 1;
+}
+
+size_t cstr_hash(Cstr cstr)
+{
+    return cstr_hash_n(cstr, strlen(cstr));
+}
+
+// Both `Cstr_Set_Entry` and `Cstr_Map_Entry` start with the hash and the key,
+// so the probing is shared through the entry size
+static size_t nobuild__hash_table_probe(const void *entries, size_t entry_size, size_t capacity,
+                                        size_t hash, Cstr key)
+{
+    const size_t mask = capacity - 1;
+    size_t i = hash & mask;
+    for (;;) {
+        const Cstr_Set_Entry *entry = (const Cstr_Set_Entry *) ((const char *) entries + i * entry_size);
+        // Interned keys compare equal by pointer
+        if (entry->hash == 0 || (entry->hash == hash && (entry->key == key || strcmp(entry->key, key) == 0))) {
+            return i;
         }
+        i = (i + 1) & mask;
+    }
+}
 
-        size_t delim_found = 0;
-        for (size_t j = 0; j < d_len; ++j) {
-            if (cstr[i+j] != delim[j]) {
-                delim_found = 0;
-                break;
+static void *nobuild__hash_table_grow(void *entries, size_t entry_size, size_t *capacity)
+{
+    size_t old_capacity = *capacity;
+    size_t new_capacity = old_capacity == 0 ? 16 : old_capacity * 2;
+    char *new_entries = calloc(new_capacity, entry_size);
+    if (new_entries == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+
+    for (size_t i = 0; i < old_capacity; ++i) {
+        const Cstr_Set_Entry *entry = (const Cstr_Set_Entry *) ((const char *) entries + i * entry_size);
+        if (entry->hash != 0) {
+            size_t j = entry->hash & (new_capacity - 1);
+            while (((Cstr_Set_Entry *) (new_entries + j * entry_size))->hash != 0) {
+                j = (j + 1) & (new_capacity - 1);
             }
-            delim_found = 1;
+            memcpy(new_entries + j * entry_size, entry, entry_size);
         }
+    }
 
-        if (!delim_found) {
-            continue;
-        }
+    free(entries);
+    *capacity = new_capacity;
+    return new_entries;
+}
 
-        size_t substr_len = i - substr_start;
-        char *substr = calloc(substr_len + 1, sizeof(unsigned char));
-        if (substr == NULL) {
-            PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+// Remove the entry at `i` and shift the rest of its probe sequence back, so no tombstones are needed
+static void nobuild__hash_table_erase(void *entries, size_t entry_size, size_t capacity, size_t i)
+{
+    const size_t mask = capacity - 1;
+    char *base = entries;
+    ((Cstr_Set_Entry *) (base + i * entry_size))->hash = 0;
+
+    for (size_t j = (i + 1) & mask; ((Cstr_Set_Entry *) (base + j * entry_size))->hash != 0; j = (j + 1) & mask) {
+        size_t home = ((Cstr_Set_Entry *) (base + j * entry_size))->hash & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            memcpy(base + i * entry_size, base + j * entry_size, entry_size);
+            ((Cstr_Set_Entry *) (base + j * entry_size))->hash = 0;
+            i = j;
         }
+    }
+}
 
-        ret.elems[substr_index++] = memcpy(substr, (cstr+substr_start), substr_len * sizeof(unsigned char));
-        i += d_len - 1;
-        substr_start = i + 1;
+int cstr_set_contains(const Cstr_Set *set, Cstr cstr)
+{
+    if (set->count == 0) {
+        return 0;
     }
 
-    // Add the last substring
-    size_t substr_len = len - substr_start;
-    char *substr = malloc(substr_len * sizeof(unsigned char));
-    if (substr == NULL) {
-        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    size_t i = nobuild__hash_table_probe(set->entries, sizeof *set->entries, set->capacity, cstr_hash(cstr), cstr);
+    return set->entries[i].hash != 0;
+}
+
+int cstr_set_add(Cstr_Set *set, Cstr cstr)
+{
+    // Keep the load factor under 3/4
+    if ((set->count + 1) * 4 > set->capacity * 3) {
+        set->entries = nobuild__hash_table_grow(set->entries, sizeof *set->entries, &set->capacity);
+    }
+
+    size_t hash = cstr_hash(cstr);
+    size_t i = nobuild__hash_table_probe(set->entries, sizeof *set->entries, set->capacity, hash, cstr);
+    if (set->entries[i].hash != 0) {
+        return 0;
     }
 
-    ret.elems[substr_index++] = memcpy(substr, (cstr+substr_start), substr_len * sizeof(unsigned char));
-    return ret;
+    set->entries[i].hash = hash;
+    set->entries[i].key = cstr;
+    set->count += 1;
+    return 1;
 }
 
-Cstr cstr_array_join(Cstr sep, Cstr_Array cstrs)
+int cstr_set_remove(Cstr_Set *set, Cstr cstr)
 {
-    if (cstrs.count == 0) {
-        return "";
+    if (set->count == 0) {
+        return 0;
     }
 
-    const size_t sep_len = strlen(sep);
-    size_t len = 0;
-    for (size_t i = 0; i < cstrs.count; ++i) {
-        len += strlen(cstrs.elems[i]);
+    size_t i = nobuild__hash_table_probe(set->entries, sizeof *set->entries, set->capacity, cstr_hash(cstr), cstr);
+    if (set->entries[i].hash == 0) {
+        return 0;
     }
 
-    const size_t result_len = (cstrs.count - 1) * sep_len + len + 1;
-    char *result = malloc(sizeof(char) * result_len);
-    if (result == NULL) {
-        PANIC("could not allocate memory: %s", nobuild__strerror(errno));
+    nobuild__hash_table_erase(set->entries, sizeof *set->entries, set->capacity, i);
+    set->count -= 1;
+    return 1;
+}
+
+void cstr_set_clear(Cstr_Set *set)
+{
+    if (set->entries != NULL) {
+        memset(set->entries, 0, sizeof *set->entries * set->capacity);
     }
+    set->count = 0;
+}
 
-    len = 0;
-    for (size_t i = 0; i < cstrs.count; ++i) {
-        if (i > 0) {
-            memcpy(result + len, sep, sep_len);
-            len += sep_len;
+void cstr_set_free(Cstr_Set *set)
+{
+    free(set->entries);
+    set->entries = NULL;
+    set->count = 0;
+    set->capacity = 0;
+}
+
+Cstr_Map_Entry *cstr_map_find(const Cstr_Map *map, Cstr key)
+{
+    if (map->count == 0) {
+        return NULL;
+    }
+
+    size_t i = nobuild__hash_table_probe(map->entries, sizeof *map->entries, map->capacity, cstr_hash(key), key);
+    return map->entries[i].hash != 0 ? &map->entries[i] : NULL;
+}
+
+void *cstr_map_get(const Cstr_Map *map, Cstr key)
+{
+    Cstr_Map_Entry *entry = cstr_map_find(map, key);
+    return entry != NULL ? entry->value : NULL;
+}
+
+void *cstr_map_put(Cstr_Map *map, Cstr key, void *value)
+{
+    if ((map->count + 1) * 4 > map->capacity * 3) {
+        map->entries = nobuild__hash_table_grow(map->entries, sizeof *map->entries, &map->capacity);
+    }
+
+    size_t hash = cstr_hash(key);
+    size_t i = nobuild__hash_table_probe(map->entries, sizeof *map->entries, map->capacity, hash, key);
+    Cstr_Map_Entry *entry = &map->entries[i];
+    if (entry->hash != 0) {
+        void *previous = entry->value;
+        entry->value = value;
+        return previous;
+    }
+
+    entry->hash = hash;
+    entry->key = key;
+    entry->value = value;
+    map->count += 1;
+    return NULL;
+}
+
+void *cstr_map_remove(Cstr_Map *map, Cstr key)
+{
+    if (map->count == 0) {
+        return NULL;
+    }
+
+    size_t i = nobuild__hash_table_probe(map->entries, sizeof *map->entries, map->capacity, cstr_hash(key), key);
+    if (map->entries[i].hash == 0) {
+        return NULL;
+    }
+
+    void *value = map->entries[i].value;
+    nobuild__hash_table_erase(map->entries, sizeof *map->entries, map->capacity, i);
+    map->count -= 1;
+    return value;
+}
+
+void cstr_map_clear(Cstr_Map *map)
+{
+    if (map->entries != NULL) {
+        memset(map->entries, 0, sizeof *map->entries * map->capacity);
+    }
+    map->count = 0;
+}
+
+void cstr_map_free(Cstr_Map *map)
+{
+    free(map->entries);
+    map->entries = NULL;
+    map->count = 0;
+    map->capacity = 0;
+}
+
+#ifndef NOBUILD_INTERN_BLOCK_SIZE
+#	define NOBUILD_INTERN_BLOCK_SIZE (64 * 1024)
+#endif
+
+// The interned strings are packed into big blocks that are never freed
+static Cstr_Set nobuild__interned = {0};
+static char *nobuild__intern_block = NULL;
+static size_t nobuild__intern_block_left = 0;
+static Nobuild__Mutex nobuild__intern_lock = NOBUILD__MUTEX_INIT;
+
+static Cstr nobuild__intern_store(const char *data, size_t len)
+{
+    char *result = NULL;
+    if (len + 1 > NOBUILD_INTERN_BLOCK_SIZE / 4) {
+        // Big strings get their own allocation, so they don't waste the rest of a block
+        result = malloc(len + 1);
+    } else {
+        if (len + 1 > nobuild__intern_block_left) {
+            nobuild__intern_block = malloc(NOBUILD_INTERN_BLOCK_SIZE);
+            nobuild__intern_block_left = NOBUILD_INTERN_BLOCK_SIZE;
         }
+        result = nobuild__intern_block;
+        nobuild__intern_block += len + 1;
+        nobuild__intern_block_left -= len + 1;
+    }
 
-        size_t elem_len = strlen(cstrs.elems[i]);
-        memcpy(result + len, cstrs.elems[i], elem_len);
-        len += elem_len;
+    if (result == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
     }
+
+    memcpy(result, data, len);
     result[len] = '\0';
+    return result;
+}
+
+Cstr cstr_intern_n(const char *data, size_t len)
+{
+    const size_t hash = cstr_hash_n(data, len);
+
+    nobuild__mutex_lock(&nobuild__intern_lock);
+    if ((nobuild__interned.count + 1) * 4 > nobuild__interned.capacity * 3) {
+        nobuild__interned.entries = nobuild__hash_table_grow(nobuild__interned.entries,
+                                    sizeof *nobuild__interned.entries,
+                                    &nobuild__interned.capacity);
+    }
+
+    const size_t mask = nobuild__interned.capacity - 1;
+    size_t i = hash & mask;
+    for (;;) {
+        Cstr_Set_Entry *entry = &nobuild__interned.entries[i];
+        if (entry->hash == 0) {
+            entry->hash = hash;
+            entry->key = nobuild__intern_store(data, len);
+            nobuild__interned.count += 1;
+            break;
+        }
+
+        if (entry->hash == hash && strncmp(entry->key, data, len) == 0 && entry->key[len] == '\0') {
+            break;
+        }
 
+        i = (i + 1) & mask;
+    }
+
+    Cstr result = nobuild__interned.entries[i].key;
+    nobuild__mutex_unlock(&nobuild__intern_lock);
     return result;
-}
\ No newline at end of file
+}
+
+Cstr cstr_intern(Cstr cstr)
+{
+    return cstr_intern_n(cstr, strlen(cstr));
+}
+
+Cstr nobuild__cstr_result(char *cstr, size_t len)
+{
+#ifdef NOBUILD_INTERN_CSTRS
+    Cstr interned = cstr_intern_n(cstr, len);
+    free(cstr);
+    return interned;
+#else
+    (void) len;
+    return cstr;
+#endif
+}
+
+void sb_append_buf(String_Builder *sb, const char *buf, size_t size)
+{
+    ARRAY_APPEND_MANY(sb, buf, size);
+}
+
+void sb_append_cstr(String_Builder *sb, Cstr cstr)
+{
+    sb_append_buf(sb, cstr, strlen(cstr));
+}
+
+void sb_append_sv(String_Builder *sb, String_View sv)
+{
+    sb_append_buf(sb, sv.data, sv.count);
+}
+
+int sb_appendf(String_Builder *sb, const char *fmt, ...)
+{
+    // Format straight into the spare capacity, and only when it does not fit
+    // grow the builder and format a second time
+    const size_t spare = sb->capacity - sb->count;
+
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(sb->elems == NULL ? NULL : sb->elems + sb->count, spare, fmt, args);
+    va_end(args);
+    if (len < 0) {
+        return len;
+    }
+
+    if ((size_t) len >= spare) {
+        ARRAY_RESERVE(sb, sb->count + (size_t) len + 1);
+        va_start(args, fmt);
+        vsnprintf(sb->elems + sb->count, (size_t) len + 1, fmt, args);
+        va_end(args);
+    }
+
+    sb->count += (size_t) len;
+    return len;
+}
+
+Cstr sb_to_cstr(String_Builder *sb)
+{
+    ARRAY_APPEND(sb, '\0');
+    Cstr result = nobuild__cstr_result(sb->elems, sb->count - 1);
+    sb->elems = NULL;
+    sb->count = 0;
+    sb->capacity = 0;
+    return result;
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 
 #ifndef NOBUILD__DEPRECATED
 #	if defined(__GNUC__) || (defined(__clang__) && !defined(_MSC_VER))
@@ -10,6 +12,15 @@
 #	endif
 #endif
 
+#ifndef NOBUILD_PRINTF_FORMAT
+#	if defined(__GNUC__) || defined(__clang__)
+#		// https://gcc.gnu.org/onlinedocs/gcc-4.7.2/gcc/Function-Attributes.html
+#		define NOBUILD_PRINTF_FORMAT(STRING_INDEX, FIRST_TO_CHECK) __attribute__ ((format (printf, STRING_INDEX, FIRST_TO_CHECK)))
+#	else
+#		define NOBUILD_PRINTF_FORMAT(STRING_INDEX, FIRST_TO_CHECK)
+#	endif
+#endif
+
 typedef const char * Cstr;
 
 int cstr_ends_with(Cstr cstr, Cstr postfix);
@@ -18,12 +29,96 @@ int cstr_ends_with(Cstr cstr, Cstr postfix);
 int cstr_starts_with(Cstr cstr, Cstr prefix);
 #define STARTS_WITH(cstr, prefix) cstr_starts_with(cstr, prefix)
 
+// Generic dynamic arrays. Any struct with `elems`, `count` and `capacity`
+// fields works with these macros, where `capacity` is the number of allocated
+// elements. They take a pointer to the array and modify it in place, growing
+// the storage geometrically so appending n elements costs O(n) overall.
+//
+//   typedef struct { int *elems; size_t count; size_t capacity; } Ints;
+//   Ints ints = {0};
+//   ARRAY_APPEND(&ints, 69);
+//   ARRAY_FREE(&ints);
+#ifndef ARRAY_INIT_CAPACITY
+#define ARRAY_INIT_CAPACITY 16
+#endif
+
+void *nobuild__array_grow(void *elems, size_t elem_size, size_t *capacity, size_t expected_capacity);
+
+#define ARRAY_RESERVE(array, expected_capacity)                         \
+    do {                                                                \
+        if ((expected_capacity) > (array)->capacity) {                  \
+            (array)->elems = nobuild__array_grow(                       \
+                (array)->elems, sizeof *(array)->elems,                 \
+                &(array)->capacity, (expected_capacity));               \
+        }                                                               \
+    } while (0)
+
+#define ARRAY_APPEND(array, elem)                                       \
+    do {                                                                \
+        ARRAY_RESERVE(array, (array)->count + 1);                       \
+        (array)->elems[(array)->count++] = (elem);                      \
+    } while (0)
+
+#define ARRAY_APPEND_MANY(array, new_elems, new_count)                  \
+    do {                                                                \
+        ARRAY_RESERVE(array, (array)->count + (new_count));             \
+        memcpy((array)->elems + (array)->count, (new_elems),            \
+               sizeof *(array)->elems * (new_count));                   \
+        (array)->count += (new_count);                                  \
+    } while (0)
+
+// Removes the element at `index` by moving the last element into its place.
+// O(1), but does not keep the order of the elements.
+#define ARRAY_SWAP_REMOVE(array, index)                                 \
+    do {                                                                \
+        (array)->elems[(index)] = (array)->elems[--(array)->count];     \
+    } while (0)
+
+// Removes the element at `index` and shifts the following ones left.
+#define ARRAY_REMOVE(array, index)                                      \
+    do {                                                                \
+        size_t nobuild__index = (index);                                \
+        memmove((array)->elems + nobuild__index,                        \
+                (array)->elems + nobuild__index + 1,                    \
+                sizeof *(array)->elems                                  \
+                * ((array)->count - nobuild__index - 1));               \
+        (array)->count--;                                               \
+    } while (0)
+
+#define ARRAY_FREE(array)                                               \
+    do {                                                                \
+        free((array)->elems);                                           \
+        (array)->elems = NULL;                                          \
+        (array)->count = 0;                                             \
+        (array)->capacity = 0;                                          \
+    } while (0)
+
 typedef struct {
     Cstr *elems;
     size_t count;
     size_t capacity;
 } Cstr_Array;
 
+// Non-owning view into a string that is not necessarily null terminated.
+// Print it with `printf(SV_FMT, SV_ARG(sv))`.
+typedef struct {
+    const char *data;
+    size_t count;
+} String_View;
+
+#define SV_FMT "%.*s"
+#define SV_ARG(sv) (int) (sv).count, (sv).data
+#define SV_STATIC(cstr_lit) { (cstr_lit), sizeof(cstr_lit) - 1 }
+
+String_View sv_from_parts(const char *data, size_t count);
+String_View sv_from_cstr(Cstr cstr);
+int sv_eq(String_View a, String_View b);
+int sv_eq_cstr(String_View sv, Cstr cstr);
+
+// Copies the view into a new null terminated string, interned with
+// `NOBUILD_INTERN_CSTRS`
+Cstr sv_to_cstr(String_View sv);
+
 Cstr_Array cstr_array_make(Cstr first, ...);
 #define CSTR_ARRAY_MAKE(first, ...) cstr_array_make(first, ##__VA_ARGS__, NULL)
 
@@ -35,9 +130,97 @@ Cstr_Array cstr_array_concat(Cstr_Array cstrs_a, Cstr_Array cstrs_b);
 
 int cstr_array_contains(Cstr_Array cstrs, Cstr cstr);
 
+// Splits `cstr` on every occurrence of `delim`. The substrings all point into
+// one copy of `cstr` that starts at `elems[0]`, so freeing `elems[0]` and
+// `elems` releases the whole result.
 Cstr_Array cstr_array_from_cstr(Cstr cstr, Cstr delim);
 #define SPLIT(cstr, delim) cstr_array_from_cstr(cstr, delim)
 
 Cstr cstr_array_join(Cstr sep, Cstr_Array cstrs);
 #define JOIN(sep, ...) cstr_array_join(sep, cstr_array_make(__VA_ARGS__, NULL))
-#define CONCAT(...) JOIN("", __VA_ARGS__)
\ No newline at end of file
+#define CONCAT(...) JOIN("", __VA_ARGS__)
+
+size_t cstr_hash(Cstr cstr);
+size_t cstr_hash_n(const char *data, size_t len);
+
+typedef struct {
+    size_t hash;
+    Cstr key;
+} Cstr_Set_Entry;
+
+// Open addressing hash set of strings. The keys are not copied, so they must
+// outlive the set. A zero initialized set is empty and ready to use.
+typedef struct {
+    Cstr_Set_Entry *entries;
+    size_t count;
+    size_t capacity;
+} Cstr_Set;
+
+int cstr_set_contains(const Cstr_Set *set, Cstr cstr);
+// Returns 1 if `cstr` was added, 0 if it was already in the set
+int cstr_set_add(Cstr_Set *set, Cstr cstr);
+// Returns 1 if `cstr` was removed, 0 if it was not in the set
+int cstr_set_remove(Cstr_Set *set, Cstr cstr);
+void cstr_set_clear(Cstr_Set *set);
+void cstr_set_free(Cstr_Set *set);
+
+typedef struct {
+    size_t hash;
+    Cstr key;
+    void *value;
+} Cstr_Map_Entry;
+
+// Open addressing hash map from strings to pointers. Same ownership rules as `Cstr_Set`.
+typedef struct {
+    Cstr_Map_Entry *entries;
+    size_t count;
+    size_t capacity;
+} Cstr_Map;
+
+// Returns the entry of `key` or NULL if there is none. The entry stays valid until the map is modified.
+Cstr_Map_Entry *cstr_map_find(const Cstr_Map *map, Cstr key);
+// Returns the value of `key` or NULL if there is none
+void *cstr_map_get(const Cstr_Map *map, Cstr key);
+// Returns the previous value of `key` or NULL if there was none
+void *cstr_map_put(Cstr_Map *map, Cstr key, void *value);
+// Returns the removed value of `key` or NULL if there was none
+void *cstr_map_remove(Cstr_Map *map, Cstr key);
+void cstr_map_clear(Cstr_Map *map);
+void cstr_map_free(Cstr_Map *map);
+
+// Returns the one copy of `cstr` shared by the whole process, so interned
+// strings can be compared by pointer. The copies live until the process exits.
+//
+// Define `NOBUILD_INTERN_CSTRS` before including nobuild to have the string
+// helpers (`JOIN`, `CONCAT`, `PATH`, `NOEXT`, `DIRNAME`, `BASENAME`, ...)
+// return interned strings as well.
+Cstr cstr_intern(Cstr cstr);
+Cstr cstr_intern_n(const char *data, size_t len);
+#define INTERN(cstr) cstr_intern(cstr)
+
+// Used by the string helpers to hand out their results: `cstr` must be allocated
+// with malloc() and is swapped for its interned copy with `NOBUILD_INTERN_CSTRS`
+Cstr nobuild__cstr_result(char *cstr, size_t len);
+
+// Growable string buffer, a dynamic array of chars that works with the
+// `ARRAY_*` macros. `elems` is not null terminated until `sb_to_cstr()`.
+// A zero initialized builder is empty and ready to use.
+//
+//   String_Builder sb = {0};
+//   sb_append_cstr(&sb, "cc");
+//   sb_appendf(&sb, " -O%d", 2);
+//   Cstr line = sb_to_cstr(&sb);
+typedef struct {
+    char *elems;
+    size_t count;
+    size_t capacity;
+} String_Builder;
+
+void sb_append_buf(String_Builder *sb, const char *buf, size_t size);
+void sb_append_cstr(String_Builder *sb, Cstr cstr);
+void sb_append_sv(String_Builder *sb, String_View sv);
+int sb_appendf(String_Builder *sb, const char *fmt, ...) NOBUILD_PRINTF_FORMAT(2, 3);
+
+// Null terminates the builder and hands its buffer over as a `Cstr`, leaving
+// the builder empty. Use `ARRAY_FREE()` instead to discard the contents.
+Cstr sb_to_cstr(String_Builder *sb);
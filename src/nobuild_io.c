@@ -5,16 +5,38 @@
 #ifndef _WIN32
 #	include <sys/wait.h>
 #	include <sys/stat.h>
+#	include <sys/mman.h>
+#	include <sys/uio.h>
 #	include <unistd.h>
 #	include <fcntl.h>
+#	ifdef __linux__
+#		include <sys/sendfile.h>
+#		include <sys/syscall.h>
+#		ifndef SPLICE_F_MOVE
+#			define SPLICE_F_MOVE 1
+#		endif
+
+#		ifdef NOBUILD_IO_URING
+#			include <linux/io_uring.h>
+#			include <linux/stat.h>
+#			define NOBUILD__IO_URING
+#		endif
+
+// Avoid requiring the user to define `_DEFAULT_SOURCE`
+long syscall(long number, ...);
+#	endif
 
 // Avoid requiring the user to define `_POSIX_C_SOURCE` as `200809L`
 char *strsignal(int sig);
-#else
-#	include <assert.h>
+ssize_t pread(int fd, void *buf, size_t count, off_t offset);
+ssize_t pwrite(int fd, const void *buf, size_t count, off_t offset);
+int ftruncate(int fd, off_t length);
 #endif
 
+#include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
 #include <errno.h>
@@ -135,10 +157,46 @@ Fd fd_open_for_write(const char *path)
 #endif // _WIN32
 }
 
+Fd fd_open_for_update(const char *path)
+{
+#ifndef _WIN32
+    Fd result = open(path,
+                     O_RDWR | O_CREAT,
+                     S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (result < 0) {
+        PANIC("Could not open file %s: %s", path, strerror(errno));
+    }
+    return result;
+#else
+    SECURITY_ATTRIBUTES saAttr = {0};
+    saAttr.nLength = sizeof(SECURITY_ATTRIBUTES);
+    saAttr.bInheritHandle = TRUE;
+
+    Fd result = CreateFile(
+                    path,
+                    GENERIC_READ | GENERIC_WRITE,
+                    0,
+                    &saAttr,
+                    OPEN_ALWAYS,           // Same as `O_CREAT` without `O_TRUNC`
+                    FILE_ATTRIBUTE_NORMAL,
+                    NULL
+                );
+
+    if (result == INVALID_HANDLE_VALUE) {
+        PANIC("Could not open file %s: %s", path, nobuild__GetLastErrorAsString());
+    }
+
+    return result;
+#endif // _WIN32
+}
+
 size_t fd_read(Fd fd, void *buf, unsigned long count)
 {
 #ifndef _WIN32
-    ssize_t bytes = read(fd, buf, count);
+    ssize_t bytes;
+    do {
+        bytes = read(fd, buf, count);
+    } while (bytes == -1 && errno == EINTR);
     if (bytes == -1) {
         ERRO("Read error: %s", strerror(errno));
         return 0;
@@ -157,7 +215,10 @@ size_t fd_read(Fd fd, void *buf, unsigned long count)
 size_t fd_write(Fd fd, void *buf, unsigned long count)
 {
 #ifndef _WIN32
-    ssize_t bytes = read(fd, buf, (size_t) count);
+    ssize_t bytes;
+    do {
+        bytes = write(fd, buf, (size_t) count);
+    } while (bytes == -1 && errno == EINTR);
     if (bytes == -1) {
         ERRO("Write error: %s", strerror(errno));
         return 0;
@@ -173,46 +234,958 @@ size_t fd_write(Fd fd, void *buf, unsigned long count)
     return (size_t) bytes;
 }
 
+int fd_write_all(Fd fd, const void *buf, size_t count)
+{
+    const char *bytes = buf;
+    while (count > 0) {
+        size_t written = fd_write(fd, (void *) bytes, (unsigned long) count);
+        if (written == 0) {
+            return 0;
+        }
+        bytes += written;
+        count -= written;
+    }
+    return 1;
+}
+
+int fd_pwrite_all(Fd fd, const void *buf, size_t count, unsigned long long offset)
+{
+    const char *bytes = buf;
+    while (count > 0) {
+#ifndef _WIN32
+        ssize_t written = pwrite(fd, bytes, count, (off_t) offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ERRO("Write error: %s", strerror(errno));
+            return 0;
+        }
+#else
+        OVERLAPPED overlapped = {0};
+        overlapped.Offset = (DWORD) offset;
+        overlapped.OffsetHigh = (DWORD) (offset >> 32);
+        DWORD written;
+        if (!WriteFile(fd, bytes, count > 0x7fffffff ? 0x7fffffff : (DWORD) count, &written, &overlapped)) {
+            ERRO("Write error: %s", nobuild__GetLastErrorAsString());
+            return 0;
+        }
+#endif // _WIN32
+        bytes += written;
+        count -= (size_t) written;
+        offset += (unsigned long long) written;
+    }
+    return 1;
+}
+
+int fd_truncate(Fd fd, unsigned long long size)
+{
+#ifndef _WIN32
+    if (ftruncate(fd, (off_t) size) < 0) {
+        ERRO("Could not truncate file: %s", strerror(errno));
+        return 0;
+    }
+#else
+    LARGE_INTEGER position;
+    position.QuadPart = (LONGLONG) size;
+    if (!SetFilePointerEx(fd, position, NULL, FILE_BEGIN) || !SetEndOfFile(fd)) {
+        ERRO("Could not truncate file: %s", nobuild__GetLastErrorAsString());
+        return 0;
+    }
+#endif // _WIN32
+    return 1;
+}
+
+int fd_writev(Fd fd, const Fd_Iovec *iov, int count)
+{
+#ifndef _WIN32
+    while (count > 0) {
+        // Linux and the BSDs accept at most 1024 buffers per call
+        ssize_t bytes = writev(fd, iov, count < 1024 ? count : 1024);
+        if (bytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ERRO("Write error: %s", strerror(errno));
+            return 0;
+        }
+
+        // Skip the buffers that were written completely
+        while (count > 0 && (size_t) bytes >= iov->iov_len) {
+            bytes -= (ssize_t) iov->iov_len;
+            iov += 1;
+            count -= 1;
+        }
+
+        // Finish the buffer that was written partially
+        if (count > 0 && bytes > 0) {
+            if (!fd_write_all(fd, (char *) iov->iov_base + bytes, iov->iov_len - (size_t) bytes)) {
+                return 0;
+            }
+            iov += 1;
+            count -= 1;
+        }
+    }
+#else
+    for (int i = 0; i < count; ++i) {
+        if (!fd_write_all(fd, iov[i].iov_base, iov[i].iov_len)) {
+            return 0;
+        }
+    }
+#endif
+    return 1;
+}
+
+size_t fd_readv(Fd fd, const Fd_Iovec *iov, int count)
+{
+#ifndef _WIN32
+    ssize_t bytes;
+    do {
+        bytes = readv(fd, iov, count < 1024 ? count : 1024);
+    } while (bytes == -1 && errno == EINTR);
+    if (bytes == -1) {
+        ERRO("Read error: %s", strerror(errno));
+        return 0;
+    }
+    return (size_t) bytes;
+#else
+    size_t total = 0;
+    for (int i = 0; i < count; ++i) {
+        size_t bytes = fd_read(fd, iov[i].iov_base, (unsigned long) iov[i].iov_len);
+        total += bytes;
+        if (bytes < iov[i].iov_len) {
+            break;
+        }
+    }
+    return total;
+#endif
+}
+
+// The largest transfer asked of the kernel at once, which also makes a
+// `count` of 0 (until the end of the file) fit the syscalls
+#define NOBUILD__TRANSFER_CHUNK ((size_t) 1 << 30)
+
+// Copies through user space, the fallback of `fd_sendfile()` and `fd_splice()`
+static size_t nobuild__fd_copy(Fd dst, Fd src, size_t count)
+{
+    char *buffer = malloc(NOBUILD_COPY_BUFFER_SIZE);
+    if (buffer == NULL) {
+        PANIC("Could not allocate memory: %s", strerror(errno));
+    }
+
+    size_t copied = 0;
+    while (count == 0 || copied < count) {
+        size_t want = NOBUILD_COPY_BUFFER_SIZE;
+        if (count > 0 && count - copied < want) {
+            want = count - copied;
+        }
+
+        size_t bytes = fd_read(src, buffer, (unsigned long) want);
+        if (bytes == 0 || !fd_write_all(dst, buffer, bytes)) {
+            break;
+        }
+        copied += bytes;
+    }
+
+    free(buffer);
+    return copied;
+}
+
+size_t fd_sendfile(Fd dst, Fd src, size_t count)
+{
+    size_t copied = 0;
+
+#ifdef __linux__
+    // copy_file_range() works between regular files and can share extents or
+    // copy on the server for NFS/SMB. It fails between filesystems on older
+    // kernels, then sendfile(), which takes any destination, continues.
+#ifdef SYS_copy_file_range
+    while (count == 0 || copied < count) {
+        size_t want = count == 0 || count - copied > NOBUILD__TRANSFER_CHUNK ? NOBUILD__TRANSFER_CHUNK : count - copied;
+        long bytes = syscall(SYS_copy_file_range, src, NULL, dst, NULL, want, 0);
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes <= 0) {
+            break;
+        }
+        copied += (size_t) bytes;
+    }
+#endif // SYS_copy_file_range
+
+    while (count == 0 || copied < count) {
+        size_t want = count == 0 || count - copied > NOBUILD__TRANSFER_CHUNK ? NOBUILD__TRANSFER_CHUNK : count - copied;
+        ssize_t bytes = sendfile(dst, src, NULL, want);
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes <= 0) {
+            break;
+        }
+        copied += (size_t) bytes;
+    }
+    errno = 0;
+#endif // __linux__
+
+    // Some files (procfs, sysfs) report 0 bytes to the calls above without
+    // being empty, so let read() have the last word on the end of the file
+    if (count == 0 || copied < count) {
+        copied += nobuild__fd_copy(dst, src, count == 0 ? 0 : count - copied);
+    }
+    return copied;
+}
+
+size_t fd_splice(Fd dst, Fd src, size_t count)
+{
+    size_t copied = 0;
+
+#if defined(__linux__) && defined(SYS_splice)
+    // Only works when one of the ends is a pipe, fails right away otherwise
+    while (count == 0 || copied < count) {
+        size_t want = count == 0 || count - copied > NOBUILD__TRANSFER_CHUNK ? NOBUILD__TRANSFER_CHUNK : count - copied;
+        long bytes = syscall(SYS_splice, src, NULL, dst, NULL, want, SPLICE_F_MOVE);
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes == 0) {
+            return copied;
+        }
+        if (bytes < 0) {
+            break;
+        }
+        copied += (size_t) bytes;
+    }
+    errno = 0;
+
+    if (count > 0 && copied == count) {
+        return copied;
+    }
+#endif
+
+    return copied + fd_sendfile(dst, src, count == 0 ? 0 : count - copied);
+}
+
 int fd_printf(Fd fd, const char *fmt, ...) {
-    va_list args;
+    // Format into a stack buffer and only format a second time into a heap
+    // buffer when the output does not fit
+    char stack_buffer[1024];
+    char *buffer = stack_buffer;
 
+    va_list args;
     va_start(args, fmt);
-    int len = vsnprintf(NULL, 0, fmt, args);
+    int len = vsnprintf(buffer, sizeof(stack_buffer), fmt, args);
     va_end(args);
     if (len < 0) {
         return len;
     }
 
-    // MSVC does not support variable length arrays
+    if ((size_t) len >= sizeof(stack_buffer)) {
+        buffer = malloc(sizeof *buffer * ((size_t) len + 1));
+        if (buffer == NULL) {
+            PANIC("Could not allocate memory: %s", strerror(errno));
+        }
+
+        va_start(args, fmt);
+        len = vsnprintf(buffer, (size_t) len + 1, fmt, args);
+        va_end(args);
+    }
+
+    if (len >= 0) {
+        fd_write_all(fd, buffer, (size_t) len);
+    }
+
+    if (buffer != stack_buffer) {
+        free(buffer);
+    }
+
+    return len;
+}
+
+int fd_write_sb(Fd fd, const String_Builder *sb)
+{
+    return fd_write_all(fd, sb->elems, sb->count);
+}
+
+void fd_close(Fd fd)
+{
+#ifndef _WIN32
+    close(fd);
+#else
+    CloseHandle(fd);
+#endif // _WIN32
+}
+
+// Reads the rest of `fd` into one null terminated allocation. `file_size` is
+// the size of a regular file, which is read in exactly that many bytes, or 0
+// when it is unknown and the buffer has to grow.
+static char *nobuild__read_fd(Fd fd, size_t file_size, size_t *size)
+{
+    size_t capacity = file_size > 0 ? file_size + 1 : 4096;
+    char *data = malloc(capacity);
+    if (data == NULL) {
+        PANIC("Could not allocate memory: %s", strerror(errno));
+    }
+
+    size_t count = 0;
+    while (file_size == 0 || count < file_size) {
+        if (count + 1 == capacity) {
+            capacity *= 2;
+            data = realloc(data, capacity);
+            if (data == NULL) {
+                PANIC("Could not allocate memory: %s", strerror(errno));
+            }
+        }
+
+        size_t bytes = fd_read(fd, data + count, (unsigned long) (capacity - count - 1));
+        if (bytes == 0) {
+            break;
+        }
+        count += bytes;
+    }
+
+    data[count] = '\0';
+    if (size != NULL) {
+        *size = count;
+    }
+    return data;
+}
+
+// Opens `path` for reading and gets the size of the file, 0 if it is not a
+// regular file. Unlike `fd_open_for_read()` it reports errors instead of panicking.
+static int nobuild__open_sized(Cstr path, Fd *fd, size_t *file_size)
+{
 #ifndef _WIN32
-     char buffer[len + 1];
+    *fd = open(path, O_RDONLY);
+    if (*fd < 0) {
+        ERRO("Could not open file %s: %s", path, strerror(errno));
+        return 0;
+    }
+
+    struct stat statbuf;
+    *file_size = fstat(*fd, &statbuf) == 0 && S_ISREG(statbuf.st_mode) ? (size_t) statbuf.st_size : 0;
 #else
-     char *buffer = malloc(sizeof *buffer * (len + 1));
+    *fd = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (*fd == INVALID_HANDLE_VALUE) {
+        ERRO("Could not open file %s: %s", path, nobuild__GetLastErrorAsString());
+        return 0;
+    }
+
+    LARGE_INTEGER size;
+    *file_size = GetFileType(*fd) == FILE_TYPE_DISK && GetFileSizeEx(*fd, &size) ? (size_t) size.QuadPart : 0;
 #endif
+    return 1;
+}
 
-    va_start(args, fmt);
-    int result = vsnprintf(buffer, (size_t)(len + 1), fmt, args);
-    va_end(args);
-    if (result < 0) {
-        return result;
+char *read_entire_file(Cstr path, size_t *size)
+{
+    Fd fd;
+    size_t file_size;
+    if (!nobuild__open_sized(path, &fd, &file_size)) {
+        return NULL;
     }
 
-    fd_write(fd, buffer, (unsigned long) result);
+    char *data = nobuild__read_fd(fd, file_size, size);
+    fd_close(fd);
+    return data;
+}
 
-#ifdef _WIN32
-    free(buffer);
+File_Map file_map(Cstr path)
+{
+    File_Map map = {0};
+
+    Fd fd;
+    size_t file_size;
+    if (!nobuild__open_sized(path, &fd, &file_size)) {
+        return map;
+    }
+
+    if (file_size >= NOBUILD_MAP_THRESHOLD) {
+#ifndef _WIN32
+        void *data = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+#if defined(MADV_SEQUENTIAL) && defined(MADV_WILLNEED)
+            // The scanners read the file front to back, so ask for aggressive
+            // read-ahead and start paging it in right away
+            madvise(data, file_size, MADV_SEQUENTIAL);
+            madvise(data, file_size, MADV_WILLNEED);
 #endif
+            map.data = data;
+        }
+#else
+        HANDLE mapping = CreateFileMapping(fd, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping != NULL) {
+            // The view keeps the mapping alive
+            map.data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+#endif
+        if (map.data != NULL) {
+            map.size = file_size;
+            map.is_mapped = 1;
+            fd_close(fd);
+            return map;
+        }
+    }
 
-    return result;
+    map.data = nobuild__read_fd(fd, file_size, &map.size);
+    fd_close(fd);
+    return map;
 }
 
-void fd_close(Fd fd)
+void file_unmap(File_Map *map)
 {
+    if (map->is_mapped) {
 #ifndef _WIN32
-    close(fd);
+        munmap((void *) map->data, map->size);
 #else
-    CloseHandle(fd);
+        UnmapViewOfFile(map->data);
+#endif
+    } else {
+        free((void *) map->data);
+    }
+
+    map->data = NULL;
+    map->size = 0;
+    map->is_mapped = 0;
+}
+
+Fd_Writer fdw_make(Fd fd, size_t buffer_size)
+{
+    Fd_Writer writer = {
+        .fd = fd,
+        .capacity = buffer_size > 0 ? buffer_size : NOBUILD_FD_BUFFER_SIZE,
+    };
+    writer.buffer = malloc(writer.capacity);
+    if (writer.buffer == NULL) {
+        PANIC("Could not allocate memory: %s", strerror(errno));
+    }
+    return writer;
+}
+
+int fdw_flush(Fd_Writer *writer)
+{
+    int ok = fd_write_all(writer->fd, writer->buffer, writer->count);
+    writer->count = 0;
+    return ok;
+}
+
+int fdw_write(Fd_Writer *writer, const void *buf, size_t count)
+{
+    if (writer->count + count > writer->capacity) {
+        if (!fdw_flush(writer)) {
+            return 0;
+        }
+        if (count >= writer->capacity) {
+            return fd_write_all(writer->fd, buf, count);
+        }
+    }
+
+    memcpy(writer->buffer + writer->count, buf, count);
+    writer->count += count;
+    return 1;
+}
+
+int fdw_write_cstr(Fd_Writer *writer, Cstr cstr)
+{
+    return fdw_write(writer, cstr, strlen(cstr));
+}
+
+int fdw_printf(Fd_Writer *writer, const char *fmt, ...)
+{
+    // Format straight into the buffer, flush and try again if it did not fit
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        const size_t spare = writer->capacity - writer->count;
+
+        va_list args;
+        va_start(args, fmt);
+        int len = vsnprintf(writer->buffer + writer->count, spare, fmt, args);
+        va_end(args);
+        if (len < 0) {
+            return 0;
+        }
+
+        if ((size_t) len < spare) {
+            writer->count += (size_t) len;
+            return 1;
+        }
+
+        if (attempt == 0 && (size_t) len < writer->capacity) {
+            if (!fdw_flush(writer)) {
+                return 0;
+            }
+            continue;
+        }
+
+        // Bigger than the whole buffer, format it on the heap
+        char *buffer = malloc((size_t) len + 1);
+        if (buffer == NULL) {
+            PANIC("Could not allocate memory: %s", strerror(errno));
+        }
+        va_start(args, fmt);
+        vsnprintf(buffer, (size_t) len + 1, fmt, args);
+        va_end(args);
+
+        int ok = fdw_write(writer, buffer, (size_t) len);
+        free(buffer);
+        return ok;
+    }
+
+    return 0;
+}
+
+void fdw_close(Fd_Writer *writer)
+{
+    fdw_flush(writer);
+    fd_close(writer->fd);
+    free(writer->buffer);
+    writer->buffer = NULL;
+    writer->capacity = 0;
+}
+
+Fd_Reader fdr_make(Fd fd, size_t buffer_size)
+{
+    Fd_Reader reader = {
+        .fd = fd,
+        .capacity = buffer_size > 0 ? buffer_size : NOBUILD_FD_BUFFER_SIZE,
+    };
+    reader.buffer = malloc(reader.capacity);
+    if (reader.buffer == NULL) {
+        PANIC("Could not allocate memory: %s", strerror(errno));
+    }
+    return reader;
+}
+
+// Moves the unread bytes to the front of the buffer and reads more after
+// them. Returns the number of bytes read, 0 at the end of the file.
+static size_t nobuild__fdr_fill(Fd_Reader *reader)
+{
+    if (reader->begin > 0) {
+        memmove(reader->buffer, reader->buffer + reader->begin, reader->end - reader->begin);
+        reader->end -= reader->begin;
+        reader->begin = 0;
+    }
+
+    if (reader->end == reader->capacity) {
+        reader->capacity *= 2;
+        reader->buffer = realloc(reader->buffer, reader->capacity);
+        if (reader->buffer == NULL) {
+            PANIC("Could not allocate memory: %s", strerror(errno));
+        }
+    }
+
+    size_t bytes = fd_read(reader->fd, reader->buffer + reader->end, (unsigned long) (reader->capacity - reader->end));
+    reader->end += bytes;
+    return bytes;
+}
+
+size_t fdr_read(Fd_Reader *reader, void *buf, size_t count)
+{
+    if (reader->begin == reader->end) {
+        reader->begin = reader->end = 0;
+        // Large reads skip the buffer
+        if (count >= reader->capacity) {
+            return fd_read(reader->fd, buf, (unsigned long) count);
+        }
+        nobuild__fdr_fill(reader);
+    }
+
+    size_t available = reader->end - reader->begin;
+    if (count > available) {
+        count = available;
+    }
+    memcpy(buf, reader->buffer + reader->begin, count);
+    reader->begin += count;
+    return count;
+}
+
+int fdr_read_line(Fd_Reader *reader, String_View *line)
+{
+    size_t scanned = reader->begin;
+    for (;;) {
+        char *newline = memchr(reader->buffer + scanned, '\n', reader->end - scanned);
+        if (newline != NULL) {
+            size_t end = (size_t) (newline - reader->buffer);
+            *line = sv_from_parts(reader->buffer + reader->begin, end - reader->begin);
+            reader->begin = end + 1;
+            break;
+        }
+
+        scanned = reader->end - reader->begin;
+        if (nobuild__fdr_fill(reader) == 0) {
+            if (reader->begin == reader->end) {
+                return 0;
+            }
+
+            // Last line without a line ending
+            *line = sv_from_parts(reader->buffer + reader->begin, reader->end - reader->begin);
+            reader->begin = reader->end;
+            break;
+        }
+    }
+
+    if (line->count > 0 && line->data[line->count - 1] == '\r') {
+        line->count -= 1;
+    }
+    return 1;
+}
+
+void fdr_close(Fd_Reader *reader)
+{
+    fd_close(reader->fd);
+    free(reader->buffer);
+    reader->buffer = NULL;
+    reader->capacity = 0;
+}
+
+void fd_batch_stat(Fd_Batch *batch, Cstr path)
+{
+    Fd_Batch_Op op = {
+        .kind = FD_BATCH_STAT,
+        .path = path,
+    };
+    ARRAY_APPEND(batch, op);
+}
+
+void fd_batch_open(Fd_Batch *batch, Cstr path)
+{
+    Fd_Batch_Op op = {
+        .kind = FD_BATCH_OPEN,
+        .path = path,
+    };
+    ARRAY_APPEND(batch, op);
+}
+
+void fd_batch_read(Fd_Batch *batch, Fd fd, void *buf, size_t size, unsigned long long offset)
+{
+    Fd_Batch_Op op = {
+        .kind = FD_BATCH_READ,
+        .fd = fd,
+        .buf = buf,
+        .size = size,
+        .offset = offset,
+    };
+    ARRAY_APPEND(batch, op);
+}
+
+// Runs `op` with the regular blocking syscalls
+static void nobuild__fd_batch_run(Fd_Batch_Op *op)
+{
+    op->error = 0;
+
+    switch (op->kind) {
+    case FD_BATCH_STAT: {
+#ifndef _WIN32
+        struct stat statbuf;
+        if (stat(op->path, &statbuf) < 0) {
+            op->error = errno;
+            break;
+        }
+
+        op->is_dir = S_ISDIR(statbuf.st_mode);
+        op->file_size = (unsigned long long) statbuf.st_size;
+#if defined(UTIME_NOW)
+#	ifdef __APPLE__
+        op->mtime = (long long) statbuf.st_mtimespec.tv_sec * 1000000000LL + statbuf.st_mtimespec.tv_nsec;
+#	else
+        op->mtime = (long long) statbuf.st_mtim.tv_sec * 1000000000LL + statbuf.st_mtim.tv_nsec;
+#	endif
+#else
+        op->mtime = (long long) statbuf.st_mtime * 1000000000LL;
+#endif
+#else
+        WIN32_FILE_ATTRIBUTE_DATA data;
+        if (!GetFileAttributesEx(op->path, GetFileExInfoStandard, &data)) {
+            DWORD error = GetLastError();
+            op->error = error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND ? ENOENT : EIO;
+            break;
+        }
+
+        op->is_dir = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        op->file_size = ((unsigned long long) data.nFileSizeHigh) << 32 | data.nFileSizeLow;
+        op->mtime = ((long long) data.ftLastWriteTime.dwHighDateTime) << 32 | data.ftLastWriteTime.dwLowDateTime;
+#endif // _WIN32
+    }
+    break;
+
+    case FD_BATCH_OPEN: {
+#ifndef _WIN32
+        op->fd = open(op->path, O_RDONLY);
+        if (op->fd < 0) {
+            op->error = errno;
+        }
+#else
+        op->fd = CreateFile(op->path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (op->fd == INVALID_HANDLE_VALUE) {
+            DWORD error = GetLastError();
+            op->error = error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND ? ENOENT : EIO;
+        }
 #endif // _WIN32
+    }
+    break;
+
+    case FD_BATCH_READ: {
+#ifndef _WIN32
+        ssize_t bytes;
+        do {
+            bytes = pread(op->fd, op->buf, op->size, (off_t) op->offset);
+        } while (bytes < 0 && errno == EINTR);
+        if (bytes < 0) {
+            op->error = errno;
+            break;
+        }
+        op->bytes = (size_t) bytes;
+#else
+        OVERLAPPED overlapped = {0};
+        overlapped.Offset = (DWORD) op->offset;
+        overlapped.OffsetHigh = (DWORD) (op->offset >> 32);
+        DWORD bytes;
+        if (!ReadFile(op->fd, op->buf, (DWORD) op->size, &bytes, &overlapped) && GetLastError() != ERROR_HANDLE_EOF) {
+            op->error = EIO;
+            break;
+        }
+        op->bytes = (size_t) bytes;
+#endif // _WIN32
+    }
+    break;
+
+    default:
+        assert(0 && "unreachable");
+    }
+}
+
+#ifdef NOBUILD__IO_URING
+#ifndef AT_FDCWD
+#	define AT_FDCWD -100
+#endif
+
+typedef struct {
+    int fd;
+    unsigned entries;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+} Nobuild__Uring;
+
+static int nobuild__uring_init(Nobuild__Uring *ring, unsigned entries)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(*ring));
+
+    ring->fd = (int) syscall(SYS_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        return 0;
+    }
+
+    ring->entries = params.sq_entries;
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size) {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+        ring->cq_ring_size = 0;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, IORING_OFF_SQ_RING);
+    ring->cq_ring = ring->cq_ring_size == 0
+        ? ring->sq_ring
+        : mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, IORING_OFF_CQ_RING);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, IORING_OFF_SQES);
+    if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        if (ring->sq_ring != MAP_FAILED) {
+            munmap(ring->sq_ring, ring->sq_ring_size);
+        }
+        if (ring->cq_ring_size != 0 && ring->cq_ring != MAP_FAILED) {
+            munmap(ring->cq_ring, ring->cq_ring_size);
+        }
+        if (ring->sqes != MAP_FAILED) {
+            munmap(ring->sqes, ring->sqes_size);
+        }
+        close(ring->fd);
+        return 0;
+    }
+
+    char *sq = ring->sq_ring;
+    ring->sq_tail = (unsigned *) (sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *) (sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *) (sq + params.sq_off.array);
+
+    char *cq = ring->cq_ring;
+    ring->cq_head = (unsigned *) (cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *) (cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *) (cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+
+    return 1;
+}
+
+static void nobuild__uring_free(Nobuild__Uring *ring)
+{
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring_size != 0) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+}
+
+static void nobuild__uring_prep(struct io_uring_sqe *sqe, Fd_Batch_Op *op, struct statx *statxbuf)
+{
+    memset(sqe, 0, sizeof(*sqe));
+    switch (op->kind) {
+    case FD_BATCH_STAT:
+        sqe->opcode = IORING_OP_STATX;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (unsigned long long) (uintptr_t) op->path;
+        sqe->len = STATX_TYPE | STATX_SIZE | STATX_MTIME;
+        sqe->off = (unsigned long long) (uintptr_t) statxbuf;
+        break;
+
+    case FD_BATCH_OPEN:
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (unsigned long long) (uintptr_t) op->path;
+        sqe->open_flags = O_RDONLY;
+        break;
+
+    case FD_BATCH_READ:
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = op->fd;
+        sqe->addr = (unsigned long long) (uintptr_t) op->buf;
+        sqe->len = op->size > 0x7ffff000 ? 0x7ffff000 : (unsigned) op->size;
+        sqe->off = op->offset;
+        break;
+
+    default:
+        assert(0 && "unreachable");
+    }
+}
+
+static void nobuild__uring_complete(Fd_Batch_Op *op, int res, const struct statx *statxbuf)
+{
+    if (res == -EINVAL || res == -EOPNOTSUPP) {
+        // The kernel predates this opcode (io_uring got STATX, OPENAT and READ in 5.6)
+        nobuild__fd_batch_run(op);
+        return;
+    }
+
+    op->error = res < 0 ? -res : 0;
+    if (res < 0) {
+        return;
+    }
+
+    switch (op->kind) {
+    case FD_BATCH_STAT:
+        op->is_dir = S_ISDIR(statxbuf->stx_mode);
+        op->file_size = statxbuf->stx_size;
+        op->mtime = (long long) statxbuf->stx_mtime.tv_sec * 1000000000LL + statxbuf->stx_mtime.tv_nsec;
+        break;
+    case FD_BATCH_OPEN:
+        op->fd = res;
+        break;
+    case FD_BATCH_READ:
+        op->bytes = (size_t) res;
+        break;
+    default:
+        assert(0 && "unreachable");
+    }
+}
+
+// Returns 0 if io_uring is not available, the caller then runs the batch itself
+static int nobuild__fd_batch_submit_uring(Fd_Batch *batch)
+{
+    Nobuild__Uring ring;
+    if (!nobuild__uring_init(&ring, NOBUILD_IO_URING_ENTRIES)) {
+        return 0;
+    }
+
+    // Every operation in flight owns a slot, which holds its statx buffer and
+    // goes back to the free list when the operation completes
+    const unsigned slots = ring.entries;
+    struct statx *statxbufs = malloc(sizeof(*statxbufs) * slots);
+    size_t *slot_op = malloc(sizeof(*slot_op) * slots);
+    unsigned *free_slots = malloc(sizeof(*free_slots) * slots);
+    if (statxbufs == NULL || slot_op == NULL || free_slots == NULL) {
+        PANIC("Could not allocate memory: %s", strerror(errno));
+    }
+    for (unsigned i = 0; i < slots; ++i) {
+        free_slots[i] = slots - 1 - i;
+    }
+
+    unsigned free_count = slots;
+    unsigned to_submit = 0;
+    size_t next = 0;
+    size_t done = 0;
+    while (done < batch->count) {
+        unsigned tail = *ring.sq_tail;
+        while (next < batch->count && free_count > 0) {
+            unsigned slot = free_slots[--free_count];
+            unsigned index = tail & *ring.sq_mask;
+            nobuild__uring_prep(&ring.sqes[index], &batch->elems[next], &statxbufs[slot]);
+            ring.sqes[index].user_data = slot;
+            ring.sq_array[index] = index;
+            slot_op[slot] = next;
+            tail += 1;
+            to_submit += 1;
+            next += 1;
+        }
+        __atomic_store_n(ring.sq_tail, tail, __ATOMIC_RELEASE);
+
+        long submitted = syscall(SYS_io_uring_enter, ring.fd, to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (submitted < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                continue;
+            }
+            PANIC("Could not submit to io_uring: %s", strerror(errno));
+        }
+        to_submit -= (unsigned) submitted;
+
+        unsigned head = *ring.cq_head;
+        unsigned cq_tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        while (head != cq_tail) {
+            struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+            unsigned slot = (unsigned) cqe->user_data;
+            nobuild__uring_complete(&batch->elems[slot_op[slot]], cqe->res, &statxbufs[slot]);
+            free_slots[free_count++] = slot;
+            head += 1;
+            done += 1;
+        }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    free(free_slots);
+    free(slot_op);
+    free(statxbufs);
+    nobuild__uring_free(&ring);
+    return 1;
+}
+#endif // NOBUILD__IO_URING
+
+void fd_batch_submit(Fd_Batch *batch)
+{
+#ifdef NOBUILD__IO_URING
+    // Setting up a ring costs a few syscalls of its own
+    if (batch->count >= 16 && nobuild__fd_batch_submit_uring(batch)) {
+        return;
+    }
+#endif
+
+    for (size_t i = 0; i < batch->count; ++i) {
+        nobuild__fd_batch_run(&batch->elems[i]);
+    }
 }
 
 void pid_wait(Pid pid)
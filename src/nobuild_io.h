@@ -1,14 +1,22 @@
 #pragma once
 
+#include "nobuild_cstr.h"
+
 #ifndef _WIN32
 #    include <sys/types.h>
+#    include <sys/uio.h>
 typedef pid_t Pid;
 typedef int Fd;
+typedef struct iovec Fd_Iovec;
 #else
 #    define WIN32_MEAN_AND_LEAN
 #    include <windows.h>
 typedef HANDLE Pid;
 typedef HANDLE Fd;
+typedef struct {
+    void *iov_base;
+    size_t iov_len;
+} Fd_Iovec;
 #endif
 
 #ifndef NOBUILD_PRINTF_FORMAT
@@ -29,9 +37,163 @@ Pipe pipe_make(void);
 
 Fd fd_open_for_read(const char *path);
 Fd fd_open_for_write(const char *path);
+// Opens for reading and writing, creates the file but keeps its contents
+Fd fd_open_for_update(const char *path);
 size_t fd_read(Fd fd, void *buf, unsigned long count);
 size_t fd_write(Fd fd, void *buf, unsigned long count);
+// Keeps writing until all of `buf` is written, returns 0 on error
+int fd_write_all(Fd fd, const void *buf, size_t count);
+// Like `fd_write_all()` at `offset`, without moving the file offset
+int fd_pwrite_all(Fd fd, const void *buf, size_t count, unsigned long long offset);
+// Cuts or extends the file to `size` bytes, returns 0 on error
+int fd_truncate(Fd fd, unsigned long long size);
+// Writes all of the buffers, with as few syscalls as possible, returns 0 on error
+int fd_writev(Fd fd, const Fd_Iovec *iov, int count);
+// Reads into the buffers in order with one syscall, returns the bytes read
+size_t fd_readv(Fd fd, const Fd_Iovec *iov, int count);
+
+// Size of the intermediate buffer used when none of the kernel side copy
+// mechanisms (reflink, copy_file_range, sendfile, splice) are available
+#ifndef NOBUILD_COPY_BUFFER_SIZE
+#	define NOBUILD_COPY_BUFFER_SIZE (1024 * 1024)
+#endif
+
+// Copy `count` bytes, or everything up to the end of the file if `count` is 0,
+// from the current offset of `src` to `dst` without going through user space
+// when the kernel allows it. Return the number of bytes copied.
+//
+// `fd_sendfile()` is meant for a regular file as `src`, `fd_splice()` for
+// pipes on either end. Both fall back to a read/write loop.
+size_t fd_sendfile(Fd dst, Fd src, size_t count);
+size_t fd_splice(Fd dst, Fd src, size_t count);
+
+// Batches of independent stat/open/read operations. Define `NOBUILD_IO_URING`
+// before including nobuild to run them through io_uring on Linux, with up to
+// `NOBUILD_IO_URING_ENTRIES` of them in flight per syscall. Without it, or when
+// the kernel refuses io_uring, they run one by one with the usual syscalls.
+//
+//   Fd_Batch batch = {0};
+//   for (size_t i = 0; i < paths.count; ++i) {
+//       fd_batch_stat(&batch, paths.elems[i]);
+//   }
+//   fd_batch_submit(&batch);
+//   // batch.elems[i].error, .is_dir, .file_size, .mtime
+//   ARRAY_FREE(&batch);
+//
+// The operations of one batch may complete in any order, so open a batch of
+// files and read them in the next one.
+#ifndef NOBUILD_IO_URING_ENTRIES
+#define NOBUILD_IO_URING_ENTRIES 256
+#endif
+
+typedef enum {
+    FD_BATCH_STAT,
+    FD_BATCH_OPEN,
+    FD_BATCH_READ,
+} Fd_Batch_Kind;
+
+typedef struct {
+    Fd_Batch_Kind kind;
+    Cstr path;
+    // Input of FD_BATCH_READ, result of FD_BATCH_OPEN
+    Fd fd;
+    void *buf;
+    size_t size;
+    unsigned long long offset;
+
+    // Results, `error` is 0 on success or an errno value
+    int error;
+    size_t bytes;
+    int is_dir;
+    unsigned long long file_size;
+    // Nanoseconds on POSIX, 100ns ticks on Windows
+    long long mtime;
+} Fd_Batch_Op;
+
+typedef struct {
+    Fd_Batch_Op *elems;
+    size_t count;
+    size_t capacity;
+} Fd_Batch;
+
+void fd_batch_stat(Fd_Batch *batch, Cstr path);
+// Opens `path` for reading
+void fd_batch_open(Fd_Batch *batch, Cstr path);
+// Reads at most `size` bytes at `offset` without moving the file offset
+void fd_batch_read(Fd_Batch *batch, Fd fd, void *buf, size_t size, unsigned long long offset);
+// Runs every operation of the batch and fills in their results
+void fd_batch_submit(Fd_Batch *batch);
 int fd_printf(Fd fd, const char *fmt, ...) NOBUILD_PRINTF_FORMAT(2, 3);
+// Writes the whole contents of the builder, returns 0 on error
+int fd_write_sb(Fd fd, const String_Builder *sb);
 void fd_close(Fd fd);
 
+// Reads the whole file into one allocation sized from its file size. The
+// result is null terminated and must be freed with free(). `size` may be NULL.
+// Returns NULL on error.
+char *read_entire_file(Cstr path, size_t *size);
+
+#ifndef NOBUILD_MAP_THRESHOLD
+#define NOBUILD_MAP_THRESHOLD (64 * 1024)
+#endif
+
+// Read-only view of a whole file. Files of at least `NOBUILD_MAP_THRESHOLD`
+// bytes are memory mapped, smaller ones are cheaper to read with
+// `read_entire_file()`. `data` is not null terminated when the file is mapped.
+typedef struct {
+    const char *data;
+    size_t size;
+    int is_mapped;
+} File_Map;
+
+// `data` is NULL on error
+File_Map file_map(Cstr path);
+void file_unmap(File_Map *map);
+
+#ifndef NOBUILD_FD_BUFFER_SIZE
+#define NOBUILD_FD_BUFFER_SIZE (64 * 1024)
+#endif
+
+// Buffered writer, so many small writes cost one write syscall per
+// `buffer_size` bytes. Writes larger than the buffer go straight to the fd.
+//
+//   Fd_Writer out = fdw_make(fd_open_for_write("out.txt"), 0);
+//   fdw_printf(&out, "%d\n", 69);
+//   fdw_close(&out);
+typedef struct {
+    Fd fd;
+    char *buffer;
+    size_t count;
+    size_t capacity;
+} Fd_Writer;
+
+// A `buffer_size` of 0 uses `NOBUILD_FD_BUFFER_SIZE`
+Fd_Writer fdw_make(Fd fd, size_t buffer_size);
+// The write functions return 0 on error
+int fdw_write(Fd_Writer *writer, const void *buf, size_t count);
+int fdw_write_cstr(Fd_Writer *writer, Cstr cstr);
+int fdw_printf(Fd_Writer *writer, const char *fmt, ...) NOBUILD_PRINTF_FORMAT(2, 3);
+int fdw_flush(Fd_Writer *writer);
+// Flushes the writer, closes its fd and frees the buffer
+void fdw_close(Fd_Writer *writer);
+
+// Buffered reader, the counterpart of `Fd_Writer`
+typedef struct {
+    Fd fd;
+    char *buffer;
+    size_t begin;
+    size_t end;
+    size_t capacity;
+} Fd_Reader;
+
+// A `buffer_size` of 0 uses `NOBUILD_FD_BUFFER_SIZE`
+Fd_Reader fdr_make(Fd fd, size_t buffer_size);
+size_t fdr_read(Fd_Reader *reader, void *buf, size_t count);
+// Reads the next line without its line ending. `line` points into the buffer
+// of the reader and stays valid until the next read. Returns 0 at the end of
+// the file. The buffer grows to fit lines longer than it.
+int fdr_read_line(Fd_Reader *reader, String_View *line);
+// Closes the fd of the reader and frees the buffer
+void fdr_close(Fd_Reader *reader);
+
 void pid_wait(Pid pid);
@@ -17,12 +17,51 @@
 #	include <sys/stat.h>
 #	include <unistd.h>
 #	include <dirent.h>
+#	include <fcntl.h>
+#	include <utime.h>
+#	ifdef __linux__
+#		include <sys/ioctl.h>
+#		ifndef FICLONE
+#			define FICLONE _IOW(0x94, 9, int)
+#		endif
+#	endif
+
+// Avoid requiring the user to define `_XOPEN_SOURCE`
+char *realpath(const char *path, char *resolved_path);
 #else
 #	define WIN32_MEAN_AND_LEAN
 #	include <windows.h>
 #	include <direct.h>
 #endif // _WIN32
 
+#if !defined(NOBUILD_NO_THREADS) && !defined(_WIN32)
+#	include <pthread.h>
+#endif
+
+// Multiple modules could define these, so add a guard around them to prevent redefinition
+#ifndef NOBUILD__MUTEX
+#define NOBUILD__MUTEX
+#ifdef NOBUILD_NO_THREADS
+typedef int Nobuild__Mutex;
+#	define NOBUILD__MUTEX_INIT 0
+#	define nobuild__mutex_lock(mutex) ((void) (mutex))
+#	define nobuild__mutex_unlock(mutex) ((void) (mutex))
+#elif !defined(_WIN32)
+#	include <pthread.h>
+typedef pthread_mutex_t Nobuild__Mutex;
+#	define NOBUILD__MUTEX_INIT PTHREAD_MUTEX_INITIALIZER
+#	define nobuild__mutex_lock(mutex) pthread_mutex_lock(mutex)
+#	define nobuild__mutex_unlock(mutex) pthread_mutex_unlock(mutex)
+#else
+#	define WIN32_MEAN_AND_LEAN
+#	include <windows.h>
+typedef SRWLOCK Nobuild__Mutex;
+#	define NOBUILD__MUTEX_INIT SRWLOCK_INIT
+#	define nobuild__mutex_lock(mutex) AcquireSRWLockExclusive(mutex)
+#	define nobuild__mutex_unlock(mutex) ReleaseSRWLockExclusive(mutex)
+#endif
+#endif // NOBUILD__MUTEX
+
 // Multiple modules could define this function, so add a guard around it to prevent redefinition
 #ifndef NOBUILD__STRERROR
 #define NOBUILD__STRERROR
@@ -91,38 +130,41 @@ int nobuild__unlink(const char *pathname)
 #endif
 }
 
-Cstr path_no_ext(Cstr path)
+// Index of the dot that starts the extension of `basename`, 0 if there is none
+static size_t nobuild__extension_dot(String_View basename)
 {
-    size_t n = strlen(path);
-    while (n > 0 && path[n - 1] != '.') {
-        n -= 1;
+    for (size_t i = basename.count; i > 1; --i) {
+        if (basename.data[i - 1] == '.') {
+            return i - 1;
+        }
     }
+    return 0;
+}
 
-    if (n > 0) {
-        char *result = malloc(n);
-        memcpy(result, path, n);
-        result[n - 1] = '\0';
-
-        return result;
-    } else {
-        return path;
+String_View path_no_ext_sv(Cstr path)
+{
+    String_View basename = path_basename_sv(path);
+    size_t dot = nobuild__extension_dot(basename);
+    if (dot == 0) {
+        return sv_from_cstr(path);
     }
+    return sv_from_parts(path, (size_t) (basename.data + dot - path));
 }
 
-Cstr path_dirname(Cstr path)
+String_View path_dirname_sv(Cstr path)
 {
     char path_sep = *PATH_SEP;
     size_t prefix_len = 0;
 
     // Get length of directory prefix
-    for (size_t i = 1; i < strlen(path); ++i) {
+    for (size_t i = 1; path[i - 1] != '\0' && path[i] != '\0'; ++i) {
         if (path[i] != path_sep && path[i-1] == path_sep) {
             prefix_len = i;
         }
     }
 
     if (prefix_len == 0) {
-        return *path == path_sep ? PATH_SEP : ".";
+        return sv_from_cstr(*path == path_sep ? PATH_SEP : ".");
     }
 
     // Strip trailing slashes
@@ -130,33 +172,20 @@ Cstr path_dirname(Cstr path)
         --prefix_len;
     }
 
-    // copy prefix
-    size_t len = prefix_len;
-    char* dirname = malloc(len+1);
-    if (dirname == NULL) {
-        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
-    }
-
-    return dirname[len] = '\0', memcpy(dirname, path, len);
+    return sv_from_parts(path, prefix_len);
 }
 
-Cstr path_basename(Cstr path)
+String_View path_basename_sv(Cstr path)
 {
     char path_sep = *PATH_SEP;
     Cstr last_sep = strrchr(path, path_sep);
     if (last_sep == NULL) {
-        return path;
+        return sv_from_cstr(path);
     }
 
     // Last character is not a separator
     if (*(last_sep + 1) != '\0') {
-        size_t len = strlen(last_sep + 1);
-        char* basename = malloc(len + 1);
-        if (basename == NULL) {
-            PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
-        }
-
-        return basename[len] = '\0', memcpy(basename, last_sep + 1, len);
+        return sv_from_cstr(last_sep + 1);
     }
 
     // Skip consecutive seprators
@@ -165,7 +194,7 @@ Cstr path_basename(Cstr path)
     }
 
     if (last_sep == path) {
-        return PATH_SEP;
+        return sv_from_cstr(PATH_SEP);
     }
 
     // Find the start of the basename
@@ -175,13 +204,66 @@ Cstr path_basename(Cstr path)
     }
     assert(last_sep >= start && "last_sep must never be less than start");
 
-    size_t len = (size_t)(last_sep - start);
-    char *basename = malloc(len + 1);
-    if (basename == NULL) {
-        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    return sv_from_parts(start, (size_t)(last_sep - start));
+}
+
+String_View path_extension_sv(Cstr path)
+{
+    String_View basename = path_basename_sv(path);
+    size_t dot = nobuild__extension_dot(basename);
+    if (dot == 0) {
+        return sv_from_parts(basename.data + basename.count, 0);
+    }
+    return sv_from_parts(basename.data + dot + 1, basename.count - dot - 1);
+}
+
+String_View path_stem_sv(Cstr path)
+{
+    String_View basename = path_basename_sv(path);
+    size_t dot = nobuild__extension_dot(basename);
+    return dot == 0 ? basename : sv_from_parts(basename.data, dot);
+}
+
+int path_next_component(Cstr path, String_View *component)
+{
+    char path_sep = *PATH_SEP;
+    Cstr start = component->data == NULL ? path : component->data + component->count;
+
+    // Keep the root as its own component
+    if (component->data == NULL && *start == path_sep) {
+        *component = sv_from_parts(start, 1);
+        return 1;
+    }
+
+    while (*start == path_sep) {
+        ++start;
+    }
+    if (*start == '\0') {
+        return 0;
+    }
+
+    Cstr end = start;
+    while (*end != '\0' && *end != path_sep) {
+        ++end;
     }
 
-    return basename[len] = '\0', memcpy(basename, start, len);
+    *component = sv_from_parts(start, (size_t) (end - start));
+    return 1;
+}
+
+Cstr path_no_ext(Cstr path)
+{
+    return sv_to_cstr(path_no_ext_sv(path));
+}
+
+Cstr path_dirname(Cstr path)
+{
+    return sv_to_cstr(path_dirname_sv(path));
+}
+
+Cstr path_basename(Cstr path)
+{
+    return sv_to_cstr(path_basename_sv(path));
 }
 
 int path_is_dir(Cstr path)
@@ -275,7 +357,15 @@ long long nobuild__get_modification_time(Cstr path) {
         if (stat(path, &statbuf) < 0) {
             PANIC("Could not stat %s: %s\n", path, nobuild__strerror(errno));
         }
-        return (long long) statbuf.st_mtime;
+#if defined(UTIME_NOW)
+#	ifdef __APPLE__
+        return (long long) statbuf.st_mtimespec.tv_sec * 1000000000LL + statbuf.st_mtimespec.tv_nsec;
+#	else
+        return (long long) statbuf.st_mtim.tv_sec * 1000000000LL + statbuf.st_mtim.tv_nsec;
+#	endif
+#else
+        return (long long) statbuf.st_mtime * 1000000000LL;
+#endif
 #else
         FILETIME path_time;
         Fd path_fd = fd_open_for_read(path);
@@ -288,6 +378,56 @@ long long nobuild__get_modification_time(Cstr path) {
     }
 }
 
+static long long nobuild__restat_mtime(Cstr path, long long mtime);
+
+// Returns 1 and fills `st` if `path` exists, 0 otherwise
+int nobuild__stat(Cstr path, Nobuild__Stat *st)
+{
+    memset(st, 0, sizeof *st);
+
+#ifndef _WIN32
+    struct stat statbuf = {0};
+    if (stat(path, &statbuf) < 0) {
+        if (errno == ENOENT || errno == ENOTDIR) {
+            errno = 0;
+            return 0;
+        }
+
+        PANIC("Could not stat %s: %s", path, nobuild__strerror(errno));
+    }
+
+    st->exists = 1;
+    st->is_dir = S_ISDIR(statbuf.st_mode);
+    st->size = (unsigned long long) statbuf.st_size;
+#if defined(UTIME_NOW)
+#	ifdef __APPLE__
+    st->mtime = (long long) statbuf.st_mtimespec.tv_sec * 1000000000LL + statbuf.st_mtimespec.tv_nsec;
+#	else
+    st->mtime = (long long) statbuf.st_mtim.tv_sec * 1000000000LL + statbuf.st_mtim.tv_nsec;
+#	endif
+#else
+    st->mtime = (long long) statbuf.st_mtime * 1000000000LL;
+#endif
+#else
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesEx(path, GetFileExInfoStandard, &data)) {
+        DWORD error = GetLastError();
+        if (error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND) {
+            return 0;
+        }
+
+        PANIC("Could not stat %s: %s", path, nobuild__GetLastErrorAsString());
+    }
+
+    st->exists = 1;
+    st->is_dir = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    st->size = ((unsigned long long) data.nFileSizeHigh) << 32 | data.nFileSizeLow;
+    st->mtime = ((long long) data.ftLastWriteTime.dwHighDateTime) << 32 | data.ftLastWriteTime.dwLowDateTime;
+#endif // _WIN32
+
+    return 1;
+}
+
 int path_is_newer(Cstr path1, Cstr path2)
 {
     // Warn the user that the path is missing
@@ -300,7 +440,232 @@ int path_is_newer(Cstr path1, Cstr path2)
         return 1;
     }
 
-    return nobuild__get_modification_time(path1) > nobuild__get_modification_time(path2);
+    const long long mtime1 = nobuild__restat_mtime(path1, nobuild__get_modification_time(path1));
+    return mtime1 > nobuild__get_modification_time(path2);
+}
+
+// Process wide set of directories that are known to exist, so creating the
+// output directories of thousands of files does not hit the filesystem again
+static Cstr_Set nobuild__dir_cache = {0};
+static Nobuild__Mutex nobuild__dir_cache_lock = NOBUILD__MUTEX_INIT;
+
+static int nobuild__dir_cache_contains(Cstr path)
+{
+    nobuild__mutex_lock(&nobuild__dir_cache_lock);
+    int found = cstr_set_contains(&nobuild__dir_cache, path);
+    nobuild__mutex_unlock(&nobuild__dir_cache_lock);
+    return found;
+}
+
+static void nobuild__dir_cache_add(Cstr path)
+{
+    nobuild__mutex_lock(&nobuild__dir_cache_lock);
+    if (!cstr_set_contains(&nobuild__dir_cache, path)) {
+        size_t len = strlen(path);
+        char *key = malloc(len + 1);
+        if (key == NULL) {
+            PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+        }
+        cstr_set_add(&nobuild__dir_cache, memcpy(key, path, len + 1));
+    }
+    nobuild__mutex_unlock(&nobuild__dir_cache_lock);
+}
+
+// Forget every cached directory. Called whenever nobuild removes or renames
+// something, since that could have been one of the cached directories.
+static void nobuild__dir_cache_clear(void)
+{
+    nobuild__mutex_lock(&nobuild__dir_cache_lock);
+    for (size_t i = 0; i < nobuild__dir_cache.capacity; ++i) {
+        if (nobuild__dir_cache.entries[i].hash != 0) {
+            free((char *) nobuild__dir_cache.entries[i].key);
+        }
+    }
+    cstr_set_clear(&nobuild__dir_cache);
+    nobuild__mutex_unlock(&nobuild__dir_cache_lock);
+}
+
+int nobuild__is_path_sep(char c)
+{
+#ifndef _WIN32
+    return c == '/';
+#else
+    return c == '\\' || c == '/';
+#endif
+}
+
+Cstr path_normalize(Cstr path)
+{
+    const size_t len = strlen(path);
+
+    // Most paths are short enough to be normalized on the stack before they
+    // are interned
+    char buffer[256];
+    char *result = len + 2 <= sizeof(buffer) ? buffer : malloc(len + 2);
+    if (result == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+
+    // `root` is the prefix that `..` can not go above
+    size_t count = 0;
+    size_t root = 0;
+    Cstr p = path;
+#ifdef _WIN32
+    if (((p[0] >= 'a' && p[0] <= 'z') || (p[0] >= 'A' && p[0] <= 'Z')) && p[1] == ':') {
+        result[count++] = *p++;
+        result[count++] = *p++;
+        root = count;
+    }
+#endif
+    if (nobuild__is_path_sep(*p)) {
+        result[count++] = *PATH_SEP;
+        root = count;
+    }
+
+    while (*p != '\0') {
+        while (nobuild__is_path_sep(*p)) {
+            ++p;
+        }
+        if (*p == '\0') {
+            break;
+        }
+
+        Cstr start = p;
+        while (*p != '\0' && !nobuild__is_path_sep(*p)) {
+            ++p;
+        }
+        const size_t comp_len = (size_t) (p - start);
+
+        if (comp_len == 1 && start[0] == '.') {
+            continue;
+        }
+
+        if (comp_len == 2 && start[0] == '.' && start[1] == '.') {
+            size_t last = count;
+            while (last > root && !nobuild__is_path_sep(result[last - 1])) {
+                --last;
+            }
+
+            const int last_is_dotdot = count - last == 2 && result[last] == '.' && result[last + 1] == '.';
+            if (count > root && !last_is_dotdot) {
+                // Drop the previous component and the separator in front of it
+                count = last > root ? last - 1 : last;
+                continue;
+            }
+            if (count == root && root > 0) {
+                // There is nothing above the root
+                continue;
+            }
+        }
+
+        if (count > root) {
+            result[count++] = *PATH_SEP;
+        }
+        memcpy(result + count, start, comp_len);
+        count += comp_len;
+    }
+
+    if (count == 0) {
+        result[count++] = '.';
+    }
+
+    Cstr interned = cstr_intern_n(result, count);
+    if (result != buffer) {
+        free(result);
+    }
+    return interned;
+}
+
+// `path_realpath()` results for the rest of the run, keyed by normalized path
+static Cstr_Map nobuild__realpath_cache = {0};
+static Nobuild__Mutex nobuild__realpath_cache_lock = NOBUILD__MUTEX_INIT;
+
+Cstr path_realpath(Cstr path)
+{
+    Cstr normalized = path_normalize(path);
+
+    nobuild__mutex_lock(&nobuild__realpath_cache_lock);
+    Cstr cached = cstr_map_get(&nobuild__realpath_cache, normalized);
+    nobuild__mutex_unlock(&nobuild__realpath_cache_lock);
+    if (cached != NULL) {
+        return cached;
+    }
+
+#ifndef _WIN32
+    char *resolved = realpath(normalized, NULL);
+#else
+    char *resolved = _fullpath(NULL, normalized, 0);
+#endif
+    Cstr result = resolved != NULL ? path_normalize(resolved) : normalized;
+    free(resolved);
+
+    nobuild__mutex_lock(&nobuild__realpath_cache_lock);
+    cstr_map_put(&nobuild__realpath_cache, normalized, (void *) result);
+    nobuild__mutex_unlock(&nobuild__realpath_cache_lock);
+
+    return result;
+}
+
+void path_realpath_cache_clear(void)
+{
+    nobuild__mutex_lock(&nobuild__realpath_cache_lock);
+    cstr_map_clear(&nobuild__realpath_cache);
+    nobuild__mutex_unlock(&nobuild__realpath_cache_lock);
+}
+
+// Forget the resolved path of `path`, it is about to be replaced
+static void nobuild__realpath_cache_evict(Cstr path)
+{
+    path = path_normalize(path);
+
+    nobuild__mutex_lock(&nobuild__realpath_cache_lock);
+    cstr_map_remove(&nobuild__realpath_cache, path);
+    nobuild__mutex_unlock(&nobuild__realpath_cache_lock);
+}
+
+// Create `path` and its missing parents. `path` is modified temporarily while
+// walking up, so it must be writable.
+static void nobuild__mkdirs(char *path)
+{
+    if (*path == '\0' || nobuild__dir_cache_contains(path)) {
+        return;
+    }
+
+    // Most of the time the parent already exists, so try the full path first
+    // and only walk up when the kernel tells us that a parent is missing
+    if (nobuild__mkdir(path, 0755) < 0) {
+        if (errno == ENOENT) {
+            size_t len = strlen(path);
+            while (len > 1 && nobuild__is_path_sep(path[len - 1])) {
+                len -= 1;
+            }
+            while (len > 0 && !nobuild__is_path_sep(path[len - 1])) {
+                len -= 1;
+            }
+            while (len > 1 && nobuild__is_path_sep(path[len - 1])) {
+                len -= 1;
+            }
+
+            if (len > 0) {
+                char sep = path[len];
+                path[len] = '\0';
+                nobuild__mkdirs(path);
+                path[len] = sep;
+            }
+
+            errno = 0;
+            if (nobuild__mkdir(path, 0755) < 0 && errno != EEXIST) {
+                PANIC("could not create directory %s: %s", path, nobuild__strerror(errno));
+            }
+        } else if (errno != EEXIST) {
+            PANIC("could not create directory %s: %s", path, nobuild__strerror(errno));
+        } else if (!path_is_dir(path)) {
+            PANIC("could not create directory %s: %s", path, nobuild__strerror(ENOTDIR));
+        }
+        errno = 0;
+    }
+
+    nobuild__dir_cache_add(path);
 }
 
 void path_mkdirs(Cstr_Array path)
@@ -318,6 +683,9 @@ void path_mkdirs(Cstr_Array path)
     const size_t sep_len = strlen(PATH_SEP);
 
     char *result = malloc(len + seps_count * sep_len + 1);
+    if (result == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
 
     len = 0;
     for (size_t i = 0; i < path.count; ++i) {
@@ -325,111 +693,1306 @@ void path_mkdirs(Cstr_Array path)
         memcpy(result + len, path.elems[i], n);
         len += n;
 
-        if (seps_count > 0) {
+        if (i + 1 < path.count) {
             memcpy(result + len, PATH_SEP, sep_len);
             len += sep_len;
-            seps_count -= 1;
-        }
-
-        result[len] = '\0';
-
-        if (nobuild__mkdir(result, 0755) < 0) {
-            if (errno == EEXIST) {
-                errno = 0;
-                WARN("directory %s already exists", result);
-            } else {
-                PANIC("could not create directory %s: %s", result, nobuild__strerror(errno));
-            }
         }
     }
+    result[len] = '\0';
+
+    nobuild__mkdirs(result);
+    free(result);
 }
 
-void path_rename(Cstr old_path, Cstr new_path)
+void path_mkdirs_parent(Cstr path)
 {
-#ifndef _WIN32
-    if (rename(old_path, new_path) < 0) {
-        PANIC("could not rename %s to %s: %s", old_path, new_path,
-              nobuild__strerror(errno));
+    size_t len = strlen(path);
+    while (len > 0 && !nobuild__is_path_sep(path[len - 1])) {
+        len -= 1;
     }
-#else
-    if (!MoveFileEx(old_path, new_path, MOVEFILE_REPLACE_EXISTING)) {
-        PANIC("could not rename %s to %s: %s", old_path, new_path,
-              nobuild__GetLastErrorAsString());
+
+    if (len == 0) {
+        // The parent is the current directory
+        return;
     }
-#endif // _WIN32
+
+    char *parent = malloc(len + 1);
+    if (parent == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+    memcpy(parent, path, len);
+    parent[len] = '\0';
+
+    nobuild__mkdirs(parent);
+    free(parent);
 }
 
-void path_copy(Cstr old_path, Cstr new_path) {
-    if (IS_DIR(old_path)) {
-        path_mkdirs(cstr_array_make(new_path, NULL));
-        FOREACH_FILE_IN_DIR(file, old_path, {
+// Stats of the paths looked at by `path_needs_rebuild()` for the rest of the
+// run, so a header included by every object of the project is stat'ed once
+static Cstr_Map nobuild__stat_cache = {0};
+static Nobuild__Mutex nobuild__stat_cache_lock = NOBUILD__MUTEX_INIT;
+
+// Like `nobuild__stat()` but goes through the cache. Directories get the
+// modification time of the most recently modified file inside of them,
+// same as `path_is_newer()`.
+static Nobuild__Stat nobuild__stat_cached(Cstr path)
+{
+    // Key by the normalized path, so `./src/a.c` and `src/a.c` share the entry
+    path = path_normalize(path);
+
+    nobuild__mutex_lock(&nobuild__stat_cache_lock);
+    Nobuild__Stat *cached = cstr_map_get(&nobuild__stat_cache, path);
+    if (cached != NULL) {
+        Nobuild__Stat st = *cached;
+        nobuild__mutex_unlock(&nobuild__stat_cache_lock);
+        return st;
+    }
+    nobuild__mutex_unlock(&nobuild__stat_cache_lock);
+
+    Nobuild__Stat st;
+    nobuild__stat(path, &st);
+    if (st.is_dir) {
+        st.mtime = -1;
+        FOREACH_FILE_IN_DIR(file, path, {
             if (strcmp(file, ".") == 0 || strcmp(file, "..") == 0) {
                 continue;
             }
 
-            path_copy(PATH(old_path, file), PATH(new_path, file));
+            Nobuild__Stat child = nobuild__stat_cached(PATH(path, file));
+            st.mtime = child.mtime > st.mtime ? child.mtime : st.mtime;
         });
-    } else {
-        Fd f1 = fd_open_for_read(old_path);
-        Fd f2 = fd_open_for_write(new_path);
+    }
 
-        unsigned char buffer[4096];
-        while (1) {
-#ifndef _WIN32
-            ssize_t bytes = read(f1, buffer, sizeof buffer);
-            if (bytes == -1) {
-                ERRO("Could not copy %s to %s due to read error: %s", old_path, new_path, nobuild__strerror(errno));
-                break;
-            }
+    nobuild__mutex_lock(&nobuild__stat_cache_lock);
+    Cstr_Map_Entry *entry = cstr_map_find(&nobuild__stat_cache, path);
+    if (entry != NULL) {
+        *(Nobuild__Stat *) entry->value = st;
+    } else {
+        Nobuild__Stat *value = malloc(sizeof *value);
+        if (value == NULL) {
+            PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+        }
+        *value = st;
+        cstr_map_put(&nobuild__stat_cache, path, value);
+    }
+    nobuild__mutex_unlock(&nobuild__stat_cache_lock);
 
-            if (bytes == 0) {
-                break;
-            }
+    return st;
+}
 
-            bytes = write(f2, buffer, (size_t)bytes);
-            if (bytes == -1) {
-                ERRO("Could not copy %s to %s due to write error: %s", old_path, new_path, nobuild__strerror(errno));
-                break;
-            }
+// Forget the cached stat of `path`, it is about to change
+static void nobuild__stat_cache_evict(Cstr path)
+{
+    path = path_normalize(path);
 
-            if (bytes == 0) {
-                break;
-            }
-#else
-            DWORD bytes;
-            if (!ReadFile(f1, buffer, sizeof buffer, &bytes, NULL)) {
-                ERRO("Could not copy %s to %s due to read error: %s", old_path, new_path, nobuild__GetLastErrorAsString());
-                break;
+    nobuild__mutex_lock(&nobuild__stat_cache_lock);
+    free(cstr_map_remove(&nobuild__stat_cache, path));
+    nobuild__mutex_unlock(&nobuild__stat_cache_lock);
+}
 
-            }
+void path_stat_cache_clear(void)
+{
+    nobuild__mutex_lock(&nobuild__stat_cache_lock);
+    for (size_t i = 0; i < nobuild__stat_cache.capacity; ++i) {
+        if (nobuild__stat_cache.entries[i].hash != 0) {
+            free(nobuild__stat_cache.entries[i].value);
+        }
+    }
+    cstr_map_clear(&nobuild__stat_cache);
+    nobuild__mutex_unlock(&nobuild__stat_cache_lock);
+}
 
-            if (bytes == 0) {
-                break;
-            }
+#ifdef NOBUILD_IO_URING
+// Stat every path of `outputs` and `inputs` missing from the cache in a single
+// batch, so a rebuild check over thousands of inputs costs a handful of
+// io_uring submissions instead of one syscall per file. Directories are left
+// to `nobuild__stat_cached()`, which walks them.
+static void nobuild__stat_cache_prefetch(Cstr_Array outputs, Cstr_Array inputs)
+{
+    Fd_Batch batch = {0};
+    nobuild__mutex_lock(&nobuild__stat_cache_lock);
+    for (size_t i = 0; i < outputs.count + inputs.count; ++i) {
+        Cstr path = path_normalize(i < outputs.count ? outputs.elems[i] : inputs.elems[i - outputs.count]);
+        if (cstr_map_get(&nobuild__stat_cache, path) == NULL) {
+            fd_batch_stat(&batch, path);
+        }
+    }
+    nobuild__mutex_unlock(&nobuild__stat_cache_lock);
 
-            if (!WriteFile(f2, buffer, bytes, &bytes, NULL)) {
-                ERRO("Could not copy %s to %s due to write error: %s", old_path, new_path, nobuild__GetLastErrorAsString());
-                break;
-            }
+    fd_batch_submit(&batch);
 
-            if (bytes == 0) {
-                break;
-            }
-#endif
+    nobuild__mutex_lock(&nobuild__stat_cache_lock);
+    for (size_t i = 0; i < batch.count; ++i) {
+        Fd_Batch_Op *op = &batch.elems[i];
+        if (op->is_dir || (op->error != 0 && op->error != ENOENT && op->error != ENOTDIR)) {
+            continue;
+        }
+        if (cstr_map_get(&nobuild__stat_cache, op->path) != NULL) {
+            continue;
         }
 
-        fd_close(f1);
-        fd_close(f2);
+        Nobuild__Stat *value = malloc(sizeof *value);
+        if (value == NULL) {
+            PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+        }
+        value->exists = op->error == 0;
+        value->is_dir = 0;
+        value->size = op->error == 0 ? op->file_size : 0;
+        value->mtime = op->error == 0 ? op->mtime : 0;
+        cstr_map_put(&nobuild__stat_cache, op->path, value);
     }
+    nobuild__mutex_unlock(&nobuild__stat_cache_lock);
+
+    ARRAY_FREE(&batch);
 }
+#endif // NOBUILD_IO_URING
 
-void path_rm(Cstr path)
+int path_needs_rebuild(Cstr_Array outputs, Cstr_Array inputs)
 {
-    if (IS_DIR(path)) {
-        FOREACH_FILE_IN_DIR(file, path, {
-            if (strcmp(file, ".") != 0 && strcmp(file, "..") != 0)
-            {
-                path_rm(PATH(path, file));
+    long long oldest_output = 0;
+    int rebuild = outputs.count == 0;
+
+#ifdef NOBUILD_IO_URING
+    nobuild__stat_cache_prefetch(outputs, inputs);
+#endif
+
+    for (size_t i = 0; i < outputs.count && !rebuild; ++i) {
+        Nobuild__Stat st = nobuild__stat_cached(outputs.elems[i]);
+        if (!st.exists) {
+            rebuild = 1;
+        } else if (i == 0 || st.mtime < oldest_output) {
+            oldest_output = st.mtime;
+        }
+    }
+
+    for (size_t i = 0; i < inputs.count && !rebuild; ++i) {
+        Nobuild__Stat st = nobuild__stat_cached(inputs.elems[i]);
+        if (!st.exists) {
+            WARN("File %s does not exist", inputs.elems[i]);
+            continue;
+        }
+
+        rebuild = nobuild__restat_mtime(inputs.elems[i], st.mtime) > oldest_output;
+    }
+
+    if (rebuild) {
+        // The caller is going to regenerate the outputs, so their stats are stale now
+        for (size_t i = 0; i < outputs.count; ++i) {
+            nobuild__stat_cache_evict(outputs.elems[i]);
+        }
+    }
+
+    return rebuild;
+}
+
+typedef struct {
+    // Modification time of the file when it was hashed
+    long long mtime;
+    // Modification time of the last restat that saw different contents
+    long long changed_mtime;
+    unsigned long long hash;
+} Nobuild__Restat;
+
+// Contents of `NOBUILD_RESTAT_LOG`, keyed by normalized path, loaded on first use
+static Cstr_Map nobuild__restat_log = {0};
+static int nobuild__restat_log_loaded = 0;
+static Nobuild__Mutex nobuild__restat_lock = NOBUILD__MUTEX_INIT;
+
+// One line per output: `<mtime> <changed_mtime> <hash> <path>`
+static void nobuild__restat_log_load(void)
+{
+    nobuild__restat_log_loaded = 1;
+    if (!PATH_EXISTS(NOBUILD_RESTAT_LOG)) {
+        return;
+    }
+
+    char *log = read_entire_file(NOBUILD_RESTAT_LOG, NULL);
+    if (log == NULL) {
+        return;
+    }
+
+    char *line = log;
+    while (*line != '\0') {
+        char *end = strchr(line, '\n');
+        if (end == NULL) {
+            break;
+        }
+        *end = '\0';
+
+        Nobuild__Restat entry;
+        int path_start = 0;
+        if (sscanf(line, "%lld %lld %llx %n", &entry.mtime, &entry.changed_mtime, &entry.hash, &path_start) == 3
+                && path_start > 0 && line[path_start] != '\0') {
+            Nobuild__Restat *value = malloc(sizeof(*value));
+            if (value == NULL) {
+                PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+            }
+            *value = entry;
+            free(cstr_map_put(&nobuild__restat_log, path_normalize(line + path_start), value));
+        }
+        line = end + 1;
+    }
+
+    free(log);
+}
+
+static void nobuild__restat_log_save(void)
+{
+    String_Builder sb = {0};
+    for (size_t i = 0; i < nobuild__restat_log.capacity; ++i) {
+        const Cstr_Map_Entry *e = &nobuild__restat_log.entries[i];
+        if (e->hash != 0) {
+            const Nobuild__Restat *entry = e->value;
+            sb_appendf(&sb, "%lld %lld %llx %s\n", entry->mtime, entry->changed_mtime, entry->hash, e->key);
+        }
+    }
+
+    path_write_if_changed(NOBUILD_RESTAT_LOG, sb.elems, sb.count);
+    ARRAY_FREE(&sb);
+}
+
+// The modification time dependents should see for `path`: the time its
+// contents last changed, if `path_restat()` knows the file as it is now
+static long long nobuild__restat_mtime(Cstr path, long long mtime)
+{
+    path = path_normalize(path);
+
+    nobuild__mutex_lock(&nobuild__restat_lock);
+    if (!nobuild__restat_log_loaded) {
+        nobuild__restat_log_load();
+    }
+    const Nobuild__Restat *entry = cstr_map_get(&nobuild__restat_log, path);
+    if (entry != NULL && entry->mtime == mtime) {
+        mtime = entry->changed_mtime;
+    }
+    nobuild__mutex_unlock(&nobuild__restat_lock);
+
+    return mtime;
+}
+
+void path_restat(Cstr_Array outputs)
+{
+    nobuild__mutex_lock(&nobuild__restat_lock);
+    if (!nobuild__restat_log_loaded) {
+        nobuild__restat_log_load();
+    }
+
+    for (size_t i = 0; i < outputs.count; ++i) {
+        Cstr path = path_normalize(outputs.elems[i]);
+        nobuild__stat_cache_evict(path);
+
+        Nobuild__Stat st;
+        File_Map contents = {0};
+        if (!nobuild__stat(path, &st) || st.is_dir || (contents = file_map(path)).data == NULL) {
+            WARN("Could not restat %s, it is not a file", path);
+            free(cstr_map_remove(&nobuild__restat_log, path));
+            continue;
+        }
+        const unsigned long long hash = cstr_hash_n(contents.data, contents.size);
+        file_unmap(&contents);
+
+        Nobuild__Restat *entry = cstr_map_get(&nobuild__restat_log, path);
+        if (entry == NULL) {
+            entry = malloc(sizeof(*entry));
+            if (entry == NULL) {
+                PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+            }
+            entry->hash = ~hash;
+            cstr_map_put(&nobuild__restat_log, path, entry);
+        }
+
+        if (entry->hash != hash) {
+            entry->hash = hash;
+            entry->changed_mtime = st.mtime;
+        }
+        entry->mtime = st.mtime;
+    }
+
+    nobuild__restat_log_save();
+    nobuild__mutex_unlock(&nobuild__restat_lock);
+}
+
+typedef struct {
+    long long mtime;
+    unsigned long long size;
+    unsigned long long hash;
+    // `#include` targets of the file, interned and prefixed with `"` or `<`
+    const Cstr_Array *directives;
+} Nobuild__Include_File;
+
+// Directives of every file scanned so far, by path and by content hash, so a
+// file is only scanned again when its contents change and copies of the same
+// file are scanned once. Loaded from `NOBUILD_INCLUDE_LOG` on first use.
+static Cstr_Map nobuild__include_files = {0};
+static Cstr_Map nobuild__include_contents = {0};
+static int nobuild__include_log_loaded = 0;
+// Size of `NOBUILD_INCLUDE_LOG`, where the records of `nobuild__include_pending` go
+static unsigned long long nobuild__include_log_size = 0;
+static String_Builder nobuild__include_pending = {0};
+static Nobuild__Mutex nobuild__include_lock = NOBUILD__MUTEX_INIT;
+
+// Appends the record of `path` to `sb`: `<mtime> <size> <hash> <count> <path>`
+// followed by `count` lines with one directive each
+static void nobuild__include_record(String_Builder *sb, Cstr path, const Nobuild__Include_File *file)
+{
+    sb_appendf(sb, "%lld %llu %llx %zu %s\n", file->mtime, file->size, file->hash, file->directives->count, path);
+    for (size_t i = 0; i < file->directives->count; ++i) {
+        sb_append_cstr(sb, file->directives->elems[i]);
+        ARRAY_APPEND(sb, '\n');
+    }
+}
+
+// Records `file` as the entry of `path`, sharing the directives of files with
+// the same contents. Takes ownership of `directives`, which may be NULL when
+// the contents are already known.
+static const Cstr_Array *nobuild__include_put(Cstr path, Nobuild__Include_File file, Cstr_Array *directives)
+{
+    char key[2 * sizeof(unsigned long long) + 1];
+    snprintf(key, sizeof(key), "%016llx", file.hash);
+
+    const Cstr_Array *shared = cstr_map_get(&nobuild__include_contents, key);
+    if (shared == NULL) {
+        cstr_map_put(&nobuild__include_contents, cstr_intern(key), directives);
+        shared = directives;
+    } else if (directives != NULL) {
+        ARRAY_FREE(directives);
+        free(directives);
+    }
+
+    Nobuild__Include_File *entry = cstr_map_get(&nobuild__include_files, path);
+    if (entry == NULL) {
+        entry = malloc(sizeof(*entry));
+        if (entry == NULL) {
+            PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+        }
+        cstr_map_put(&nobuild__include_files, path, entry);
+    }
+    *entry = file;
+    entry->directives = shared;
+    return shared;
+}
+
+// Records are only ever appended, later ones replace earlier ones of the
+// same path. The log is rewritten without the replaced records once they
+// outnumber the others.
+static void nobuild__include_log_load(void)
+{
+    nobuild__include_log_loaded = 1;
+    if (!PATH_EXISTS(NOBUILD_INCLUDE_LOG)) {
+        return;
+    }
+
+    size_t size = 0;
+    char *log = read_entire_file(NOBUILD_INCLUDE_LOG, &size);
+    if (log == NULL) {
+        return;
+    }
+
+    size_t records = 0;
+    char *line = log;
+    char *end;
+    while ((end = strchr(line, '\n')) != NULL) {
+        *end = '\0';
+
+        Nobuild__Include_File file = {0};
+        size_t count = 0;
+        int path_start = 0;
+        if (sscanf(line, "%lld %llu %llx %zu %n", &file.mtime, &file.size, &file.hash, &count, &path_start) != 4
+                || path_start <= 0 || line[path_start] == '\0') {
+            break;
+        }
+        Cstr path = path_normalize(line + path_start);
+
+        Cstr_Array *directives = malloc(sizeof(*directives));
+        if (directives == NULL) {
+            PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+        }
+        memset(directives, 0, sizeof(*directives));
+        line = end + 1;
+        while (directives->count < count && (end = strchr(line, '\n')) != NULL) {
+            ARRAY_APPEND(directives, cstr_intern_n(line, (size_t) (end - line)));
+            line = end + 1;
+        }
+
+        // A record cut short by an interrupted run ends the log
+        if (directives->count < count) {
+            ARRAY_FREE(directives);
+            free(directives);
+            break;
+        }
+        nobuild__include_put(path, file, directives);
+        records += 1;
+    }
+    const int truncated = line != log + size;
+    free(log);
+
+    if (records > 2 * nobuild__include_files.count || truncated) {
+        String_Builder sb = {0};
+        for (size_t i = 0; i < nobuild__include_files.capacity; ++i) {
+            const Cstr_Map_Entry *e = &nobuild__include_files.entries[i];
+            if (e->hash != 0) {
+                nobuild__include_record(&sb, e->key, e->value);
+            }
+        }
+        path_write_if_changed(NOBUILD_INCLUDE_LOG, sb.elems, sb.count);
+        nobuild__include_log_size = sb.count;
+        ARRAY_FREE(&sb);
+    } else {
+        nobuild__include_log_size = size;
+    }
+}
+
+// Appends the records of the files scanned since the last call to the log
+static void nobuild__include_log_flush(void)
+{
+    nobuild__mutex_lock(&nobuild__include_lock);
+    if (nobuild__include_pending.count > 0) {
+        Fd fd = fd_open_for_update(NOBUILD_INCLUDE_LOG);
+        if (fd_pwrite_all(fd, nobuild__include_pending.elems, nobuild__include_pending.count, nobuild__include_log_size)) {
+            nobuild__include_log_size += nobuild__include_pending.count;
+        } else {
+            ERRO("Could not write %s", NOBUILD_INCLUDE_LOG);
+        }
+        fd_close(fd);
+        nobuild__include_pending.count = 0;
+    }
+    nobuild__mutex_unlock(&nobuild__include_lock);
+}
+
+static int nobuild__is_blank(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+// Finds the `#include` lines of `data`. Jumps from `#` to `#` with memchr(),
+// which is vectorized by the C library, and only looks closer at the ones that
+// start a line. Comments and conditionals are not interpreted, so the result
+// is a superset of what the compiler would include.
+static Cstr_Array *nobuild__scan_directives(const char *data, size_t size)
+{
+    Cstr_Array *directives = malloc(sizeof(*directives));
+    if (directives == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+    memset(directives, 0, sizeof(*directives));
+
+    const char *const end = data + size;
+    const char *hash = data;
+    while ((hash = memchr(hash, '#', (size_t) (end - hash))) != NULL) {
+        const char *line = hash;
+        while (line > data && nobuild__is_blank(line[-1])) {
+            line -= 1;
+        }
+
+        const char *p = hash + 1;
+        hash = p;
+        if (line > data && line[-1] != '\n') {
+            continue;
+        }
+
+        while (p < end && nobuild__is_blank(*p)) {
+            p += 1;
+        }
+        if ((size_t) (end - p) < 7 || memcmp(p, "include", 7) != 0) {
+            continue;
+        }
+        p += 7;
+        while (p < end && nobuild__is_blank(*p)) {
+            p += 1;
+        }
+        if (p == end || (*p != '"' && *p != '<')) {
+            continue;
+        }
+
+        const char close = *p == '"' ? '"' : '>';
+        const char *name = p + 1;
+        const char *name_end = name;
+        while (name_end < end && *name_end != close && *name_end != '\n') {
+            name_end += 1;
+        }
+        if (name_end == end || *name_end != close || name_end == name) {
+            continue;
+        }
+
+        // Keep the opening character, it tells where to look for the file
+        ARRAY_APPEND(directives, cstr_intern_n(p, (size_t) (name_end - p)));
+        hash = name_end;
+    }
+
+    return directives;
+}
+
+static const Cstr_Array *nobuild__include_directives(Cstr path)
+{
+    Nobuild__Stat st = nobuild__stat_cached(path);
+    if (!st.exists || st.is_dir) {
+        return NULL;
+    }
+
+    nobuild__mutex_lock(&nobuild__include_lock);
+    if (!nobuild__include_log_loaded) {
+        nobuild__include_log_load();
+    }
+    Nobuild__Include_File *cached = cstr_map_get(&nobuild__include_files, path);
+    if (cached != NULL && cached->mtime == st.mtime && cached->size == st.size) {
+        const Cstr_Array *directives = cached->directives;
+        nobuild__mutex_unlock(&nobuild__include_lock);
+        return directives;
+    }
+    nobuild__mutex_unlock(&nobuild__include_lock);
+
+    File_Map contents = file_map(path);
+    if (contents.data == NULL) {
+        return NULL;
+    }
+
+    Nobuild__Include_File file = {
+        .mtime = st.mtime,
+        .size = st.size,
+        .hash = (unsigned long long) cstr_hash_n(contents.data, contents.size),
+    };
+    char key[2 * sizeof(unsigned long long) + 1];
+    snprintf(key, sizeof(key), "%016llx", file.hash);
+
+    nobuild__mutex_lock(&nobuild__include_lock);
+    const int known = cstr_map_get(&nobuild__include_contents, key) != NULL;
+    nobuild__mutex_unlock(&nobuild__include_lock);
+    Cstr_Array *scanned = known ? NULL : nobuild__scan_directives(contents.data, contents.size);
+    file_unmap(&contents);
+
+    nobuild__mutex_lock(&nobuild__include_lock);
+    const Cstr_Array *directives = nobuild__include_put(path, file, scanned);
+    nobuild__include_record(&nobuild__include_pending, path, cstr_map_get(&nobuild__include_files, path));
+    nobuild__mutex_unlock(&nobuild__include_lock);
+
+    return directives;
+}
+
+// Normalized `dir/name` if it is a file, NULL otherwise
+static Cstr nobuild__include_candidate(String_Builder *sb, String_View dir, const char *name)
+{
+    sb->count = 0;
+    if (dir.count > 0) {
+        sb_append_sv(sb, dir);
+        sb_append_cstr(sb, PATH_SEP);
+    }
+    sb_append_cstr(sb, name);
+    ARRAY_APPEND(sb, '\0');
+
+    Cstr candidate = path_normalize(sb->elems);
+    Nobuild__Stat st = nobuild__stat_cached(candidate);
+    return st.exists && !st.is_dir ? candidate : NULL;
+}
+
+Cstr_Array path_scan_includes(Cstr path, Cstr_Array include_dirs)
+{
+    // Accept the include directories as compiler flags too
+    String_View *dirs = malloc(sizeof(*dirs) * (include_dirs.count + 1));
+    if (dirs == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+    for (size_t i = 0; i < include_dirs.count; ++i) {
+        Cstr dir = include_dirs.elems[i];
+        dirs[i] = sv_from_cstr(strncmp(dir, "-I", 2) == 0 ? dir + 2 : dir);
+    }
+
+    Cstr_Array headers = cstr_array_make(NULL);
+    Cstr_Set seen = {0};
+    String_Builder sb = {0};
+
+    // `headers` doubles as the work list, `next` is the first one not scanned yet
+    Cstr current = path_normalize(path);
+    cstr_set_add(&seen, current);
+    for (size_t next = 0; current != NULL; current = next < headers.count ? headers.elems[next++] : NULL) {
+        const Cstr_Array *directives = nobuild__include_directives(current);
+        for (size_t i = 0; directives != NULL && i < directives->count; ++i) {
+            const char *name = directives->elems[i] + 1;
+            Cstr found = NULL;
+            if (directives->elems[i][0] == '"') {
+                found = nobuild__include_candidate(&sb, path_dirname_sv(current), name);
+            }
+            for (size_t j = 0; found == NULL && j < include_dirs.count; ++j) {
+                found = nobuild__include_candidate(&sb, dirs[j], name);
+            }
+
+            // System headers are not in `include_dirs`, leave them out
+            if (found != NULL && cstr_set_add(&seen, found)) {
+                headers = cstr_array_append(headers, found);
+            }
+        }
+    }
+
+    ARRAY_FREE(&sb);
+    cstr_set_free(&seen);
+    free(dirs);
+    nobuild__include_log_flush();
+    return headers;
+}
+
+void path_rename(Cstr old_path, Cstr new_path)
+{
+    nobuild__dir_cache_clear();
+    path_stat_cache_clear();
+    path_realpath_cache_clear();
+
+#ifndef _WIN32
+    if (rename(old_path, new_path) < 0) {
+        PANIC("could not rename %s to %s: %s", old_path, new_path,
+              nobuild__strerror(errno));
+    }
+#else
+    if (!MoveFileEx(old_path, new_path, MOVEFILE_REPLACE_EXISTING)) {
+        PANIC("could not rename %s to %s: %s", old_path, new_path,
+              nobuild__GetLastErrorAsString());
+    }
+#endif // _WIN32
+}
+
+#ifndef _WIN32
+// Copy the whole contents of `src` into the freshly truncated `dst` using the
+// fastest mechanism available. Returns 0 on success, -1 on error.
+int nobuild__copy_fd(Fd src, Fd dst, size_t size)
+{
+#ifdef __linux__
+    // On copy-on-write filesystems (btrfs, xfs, ...) the extents can be shared outright
+    if (ioctl(dst, FICLONE, src) == 0) {
+        return 0;
+    }
+#endif // __linux__
+
+    errno = 0;
+    const size_t copied = fd_sendfile(dst, src, 0);
+    if (copied < size) {
+        // The source shrank or the copy stopped early without saying why
+        if (errno == 0) {
+            errno = EIO;
+        }
+        return -1;
+    }
+    return 0;
+}
+#endif // _WIN32
+
+// Returns 0 if the copy failed, after logging why
+int nobuild__copy_file(Cstr old_path, Cstr new_path)
+{
+    int ok = 1;
+    nobuild__stat_cache_evict(new_path);
+
+#ifndef _WIN32
+    Fd f1 = fd_open_for_read(old_path);
+
+    struct stat statbuf = {0};
+    if (fstat(f1, &statbuf) < 0) {
+        PANIC("Could not stat %s: %s", old_path, nobuild__strerror(errno));
+    }
+
+    const mode_t mode = statbuf.st_mode & 07777;
+    Fd f2 = open(new_path, O_WRONLY | O_CREAT | O_TRUNC, mode);
+    if (f2 < 0 && errno == EACCES) {
+        // A previous copy of a read-only file, replace it
+        nobuild__unlink(new_path);
+        f2 = open(new_path, O_WRONLY | O_CREAT | O_TRUNC, mode);
+    }
+
+    if (f2 < 0) {
+        PANIC("Could not open file %s: %s", new_path, nobuild__strerror(errno));
+    }
+
+    if (nobuild__copy_fd(f1, f2, (size_t) statbuf.st_size) < 0) {
+        ERRO("Could not copy %s to %s: %s", old_path, new_path, nobuild__strerror(errno));
+        ok = 0;
+    } else {
+        // Keep the permissions and timestamps of the original so the copy
+        // does not look newer than its inputs to `path_is_newer()`
+        if (chmod(new_path, mode) < 0) {
+            WARN("Could not set mode of %s: %s", new_path, nobuild__strerror(errno));
+        }
+
+#if defined(UTIME_NOW)
+#	ifdef __APPLE__
+        struct timespec times[2] = { statbuf.st_atimespec, statbuf.st_mtimespec };
+#	else
+        struct timespec times[2] = { statbuf.st_atim, statbuf.st_mtim };
+#	endif
+        if (futimens(f2, times) < 0) {
+#else
+        // No nanosecond timestamps without POSIX.1-2008
+        struct utimbuf times = { statbuf.st_atime, statbuf.st_mtime };
+        if (utime(new_path, &times) < 0) {
+#endif
+            WARN("Could not set timestamps of %s: %s", new_path, nobuild__strerror(errno));
+        }
+    }
+
+    fd_close(f1);
+    fd_close(f2);
+#else
+    // CopyFile keeps the attributes and the last write time of the original
+    if (!CopyFile(old_path, new_path, FALSE)) {
+        ERRO("Could not copy %s to %s: %s", old_path, new_path, nobuild__GetLastErrorAsString());
+        ok = 0;
+    }
+#endif // _WIN32
+
+    return ok;
+}
+
+void path_copy(Cstr old_path, Cstr new_path) {
+    if (IS_DIR(old_path)) {
+        path_mkdirs(cstr_array_make(new_path, NULL));
+        FOREACH_FILE_IN_DIR(file, old_path, {
+            if (strcmp(file, ".") == 0 || strcmp(file, "..") == 0) {
+                continue;
+            }
+
+            path_copy(PATH(old_path, file), PATH(new_path, file));
+        });
+    } else {
+        nobuild__copy_file(old_path, new_path);
+    }
+}
+
+// Returns 1 if the file at `path` holds exactly `size` bytes of `data`
+static int nobuild__file_equals(Cstr path, const void *data, size_t size)
+{
+    Nobuild__Stat st;
+    if (!nobuild__stat(path, &st) || st.is_dir || st.size != size) {
+        return 0;
+    }
+
+    File_Map map = file_map(path);
+    const int equal = map.data != NULL && map.size == size && memcmp(map.data, data, size) == 0;
+    if (map.data != NULL) {
+        file_unmap(&map);
+    }
+    return equal;
+}
+
+// Moves `temp_path` over `path`, the rest of the tree stays as it was
+static void nobuild__replace_file(Cstr temp_path, Cstr path)
+{
+    nobuild__stat_cache_evict(path);
+    nobuild__realpath_cache_evict(path);
+
+#ifndef _WIN32
+    if (rename(temp_path, path) < 0) {
+        PANIC("could not rename %s to %s: %s", temp_path, path,
+              nobuild__strerror(errno));
+    }
+#else
+    if (!MoveFileEx(temp_path, path, MOVEFILE_REPLACE_EXISTING)) {
+        PANIC("could not rename %s to %s: %s", temp_path, path,
+              nobuild__GetLastErrorAsString());
+    }
+#endif // _WIN32
+}
+
+Output_File output_file_open(Cstr path)
+{
+    Cstr temp_path = CONCAT(path, ".tmp");
+    Output_File file = {
+        .writer = fdw_make(fd_open_for_write(temp_path), 0),
+        .path = path,
+        .temp_path = temp_path,
+    };
+    return file;
+}
+
+int output_file_close(Output_File *file)
+{
+    const int ok = fdw_flush(&file->writer);
+    fdw_close(&file->writer);
+    if (!ok) {
+        ERRO("Could not write %s, leaving it as it was", file->path);
+        nobuild__unlink(file->temp_path);
+        return 0;
+    }
+
+    // Only read the old contents when the sizes match
+    int changed = 1;
+    Nobuild__Stat old_st, new_st;
+    if (nobuild__stat(file->path, &old_st) && nobuild__stat(file->temp_path, &new_st)
+            && !old_st.is_dir && old_st.size == new_st.size) {
+        File_Map contents = file_map(file->temp_path);
+        if (contents.data != NULL) {
+            changed = !nobuild__file_equals(file->path, contents.data, contents.size);
+            file_unmap(&contents);
+        }
+    }
+
+    if (changed) {
+        nobuild__replace_file(file->temp_path, file->path);
+    } else {
+        nobuild__unlink(file->temp_path);
+    }
+    return changed;
+}
+
+int path_write_if_changed(Cstr path, const void *data, size_t size)
+{
+    if (nobuild__file_equals(path, data, size)) {
+        return 0;
+    }
+
+    Cstr temp_path = CONCAT(path, ".tmp");
+    Fd fd = fd_open_for_write(temp_path);
+    const int ok = fd_write_all(fd, data, size);
+    fd_close(fd);
+    if (!ok) {
+        ERRO("Could not write %s, leaving it as it was", path);
+        nobuild__unlink(temp_path);
+        return 0;
+    }
+
+    nobuild__replace_file(temp_path, path);
+    return 1;
+}
+
+size_t nobuild__cpu_count(void)
+{
+#ifndef _WIN32
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (size_t) count : 1;
+#else
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (size_t) info.dwNumberOfProcessors : 1;
+#endif // _WIN32
+}
+
+typedef struct {
+    size_t next;
+    size_t count;
+    void (*task)(size_t index, void *ctx);
+    void *ctx;
+#ifndef NOBUILD_NO_THREADS
+#	ifndef _WIN32
+    pthread_mutex_t lock;
+#	else
+    CRITICAL_SECTION lock;
+#	endif
+#endif
+} Nobuild__Parallel_For;
+
+#ifndef NOBUILD_NO_THREADS
+#	ifndef _WIN32
+static void *nobuild__parallel_for_worker(void *arg)
+#	else
+static DWORD WINAPI nobuild__parallel_for_worker(LPVOID arg)
+#	endif
+{
+    Nobuild__Parallel_For *pf = arg;
+    for (;;) {
+#	ifndef _WIN32
+        pthread_mutex_lock(&pf->lock);
+        size_t index = pf->next++;
+        pthread_mutex_unlock(&pf->lock);
+#	else
+        EnterCriticalSection(&pf->lock);
+        size_t index = pf->next++;
+        LeaveCriticalSection(&pf->lock);
+#	endif
+
+        if (index >= pf->count) {
+            break;
+        }
+
+        pf->task(index, pf->ctx);
+    }
+
+    return 0;
+}
+#endif // NOBUILD_NO_THREADS
+
+// Run `task(index, ctx)` for every index in [0, count) on up to `jobs` threads.
+// `jobs == 0` means one thread per CPU. Define `NOBUILD_NO_THREADS` to always
+// run the tasks serially on the calling thread.
+void nobuild__parallel_for(size_t count, size_t jobs, void (*task)(size_t index, void *ctx), void *ctx)
+{
+    if (jobs == 0) {
+        jobs = nobuild__cpu_count();
+    }
+
+    if (jobs > count) {
+        jobs = count;
+    }
+
+#ifndef NOBUILD_NO_THREADS
+    if (jobs > 1) {
+        Nobuild__Parallel_For pf = {
+            .count = count,
+            .task = task,
+            .ctx = ctx,
+        };
+
+#	ifndef _WIN32
+        pthread_t *threads = malloc(sizeof *threads * jobs);
+        if (threads == NULL) {
+            PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+        }
+        pthread_mutex_init(&pf.lock, NULL);
+
+        // The calling thread is a worker as well
+        size_t started = 0;
+        for (; started < jobs - 1; ++started) {
+            if (pthread_create(&threads[started], NULL, nobuild__parallel_for_worker, &pf) != 0) {
+                break;
+            }
+        }
+        nobuild__parallel_for_worker(&pf);
+
+        for (size_t i = 0; i < started; ++i) {
+            pthread_join(threads[i], NULL);
+        }
+        pthread_mutex_destroy(&pf.lock);
+#	else
+        HANDLE *threads = malloc(sizeof *threads * jobs);
+        if (threads == NULL) {
+            PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+        }
+        InitializeCriticalSection(&pf.lock);
+
+        // The calling thread is a worker as well
+        size_t started = 0;
+        for (; started < jobs - 1; ++started) {
+            threads[started] = CreateThread(NULL, 0, nobuild__parallel_for_worker, &pf, 0, NULL);
+            if (threads[started] == NULL) {
+                break;
+            }
+        }
+        nobuild__parallel_for_worker(&pf);
+
+        for (size_t i = 0; i < started; ++i) {
+            WaitForSingleObject(threads[i], INFINITE);
+            CloseHandle(threads[i]);
+        }
+        DeleteCriticalSection(&pf.lock);
+#	endif // _WIN32
+
+        free(threads);
+        return;
+    }
+#endif // NOBUILD_NO_THREADS
+
+    for (size_t i = 0; i < count; ++i) {
+        task(i, ctx);
+    }
+}
+
+int nobuild__same_contents(Cstr path1, Cstr path2)
+{
+    const size_t buffer_size = 64 * 1024;
+    unsigned char *buffer1 = malloc(buffer_size * 2);
+    if (buffer1 == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+    unsigned char *buffer2 = buffer1 + buffer_size;
+
+    Fd f1 = fd_open_for_read(path1);
+    Fd f2 = fd_open_for_read(path2);
+
+    int same = 1;
+    while (same) {
+        size_t bytes1 = fd_read(f1, buffer1, buffer_size);
+        size_t bytes2 = 0;
+        while (bytes2 < bytes1) {
+            size_t bytes = fd_read(f2, buffer2 + bytes2, bytes1 - bytes2);
+            if (bytes == 0) {
+                break;
+            }
+            bytes2 += bytes;
+        }
+
+        if (bytes1 != bytes2 || memcmp(buffer1, buffer2, bytes1) != 0) {
+            same = 0;
+        }
+
+        if (bytes1 == 0) {
+            break;
+        }
+    }
+
+    fd_close(f1);
+    fd_close(f2);
+    free(buffer1);
+    return same;
+}
+
+typedef struct {
+    Cstr src_path;
+    Cstr dst_path;
+    int copied;
+    int failed;
+    int deleted;
+    unsigned long long bytes;
+} Nobuild__Sync_Job;
+
+typedef struct {
+    Nobuild__Sync_Job *elems;
+    size_t count;
+    size_t capacity;
+    Sync_Options options;
+} Nobuild__Sync;
+
+static void nobuild__sync_file(size_t index, void *ctx)
+{
+    Nobuild__Sync *sync = ctx;
+    Nobuild__Sync_Job *job = &sync->elems[index];
+
+    Nobuild__Stat src_st, dst_st;
+    nobuild__stat(job->src_path, &src_st);
+    nobuild__stat(job->dst_path, &dst_st);
+    job->bytes = src_st.size;
+
+    if (dst_st.exists && !dst_st.is_dir && dst_st.size == src_st.size) {
+        int same = sync->options.compare_contents
+                   ? nobuild__same_contents(job->src_path, job->dst_path)
+                   : dst_st.mtime == src_st.mtime;
+        if (same) {
+            return;
+        }
+    }
+
+    if (dst_st.is_dir) {
+        path_rm(job->dst_path);
+        job->deleted = 1;
+    }
+
+    if (nobuild__copy_file(job->src_path, job->dst_path)) {
+        job->copied = 1;
+    } else {
+        job->failed = 1;
+    }
+}
+
+static void nobuild__sync_push(Nobuild__Sync *sync, Cstr src_path, Cstr dst_path)
+{
+    Nobuild__Sync_Job job = {
+        .src_path = src_path,
+        .dst_path = dst_path,
+    };
+    ARRAY_APPEND(sync, job);
+}
+
+static void nobuild__sync_dir(Nobuild__Sync *sync, Cstr src_path, Cstr dst_path, Sync_Stats *stats)
+{
+    Nobuild__Stat dst_st;
+    nobuild__stat(dst_path, &dst_st);
+    if (dst_st.exists && !dst_st.is_dir) {
+        path_rm(dst_path);
+        stats->files_deleted += 1;
+        dst_st.exists = 0;
+    }
+
+    if (!dst_st.exists) {
+        if (nobuild__mkdir(dst_path, 0755) < 0) {
+            PANIC("could not create directory %s: %s", dst_path, nobuild__strerror(errno));
+        }
+    } else if (sync->options.delete_extraneous) {
+        FOREACH_FILE_IN_DIR(file, dst_path, {
+            if (strcmp(file, ".") == 0 || strcmp(file, "..") == 0) {
+                continue;
+            }
+
+            if (!PATH_EXISTS(PATH(src_path, file))) {
+                path_rm(PATH(dst_path, file));
+                stats->files_deleted += 1;
+            }
+        });
+    }
+
+    FOREACH_FILE_IN_DIR(file, src_path, {
+        if (strcmp(file, ".") == 0 || strcmp(file, "..") == 0) {
+            continue;
+        }
+
+        Cstr src_child = PATH(src_path, file);
+        Cstr dst_child = PATH(dst_path, file);
+        if (IS_DIR(src_child)) {
+            nobuild__sync_dir(sync, src_child, dst_child, stats);
+            continue;
+        }
+
+        nobuild__sync_push(sync, src_child, dst_child);
+    });
+}
+
+Sync_Stats path_sync(Cstr src_path, Cstr dst_path, Sync_Options options)
+{
+    Sync_Stats stats = {0};
+    Nobuild__Sync sync = { .options = options };
+
+    if (IS_DIR(src_path)) {
+        // Only the root may need missing parents, `nobuild__sync_dir()` creates the rest
+        Cstr parent = path_dirname(dst_path);
+        if (!PATH_EXISTS(parent)) {
+            path_mkdirs(cstr_array_make(parent, NULL));
+        }
+        nobuild__sync_dir(&sync, src_path, dst_path, &stats);
+    } else {
+        nobuild__sync_push(&sync, src_path, dst_path);
+    }
+
+    nobuild__parallel_for(sync.count, options.jobs, nobuild__sync_file, &sync);
+
+    for (size_t i = 0; i < sync.count; ++i) {
+        Nobuild__Sync_Job *job = &sync.elems[i];
+        if (job->copied) {
+            stats.files_copied += 1;
+            stats.bytes_copied += job->bytes;
+        } else if (job->failed) {
+            stats.files_failed += 1;
+        } else {
+            stats.files_skipped += 1;
+            stats.bytes_skipped += job->bytes;
+        }
+
+        if (job->deleted) {
+            stats.files_deleted += 1;
+        }
+    }
+
+    free(sync.elems);
+    return stats;
+}
+
+#if !defined(_WIN32) && defined(AT_REMOVEDIR)
+typedef struct {
+    int dirfd;
+    Cstr path;
+    Cstr_Array names;
+} Nobuild__Rm_Subtrees;
+
+static void nobuild__rm_dir_at(int dirfd, Cstr parent, Cstr name, int parallel);
+
+static void nobuild__rm_subtree(size_t index, void *ctx)
+{
+    Nobuild__Rm_Subtrees *subtrees = ctx;
+    nobuild__rm_dir_at(subtrees->dirfd, subtrees->path, subtrees->names.elems[index], 0);
+}
+
+// Remove the directory `name` relative to `dirfd` together with its contents.
+// Entries are removed with `unlinkat()` relative to the directory fd and `d_type`
+// avoids a stat per entry. `parent` is only used for error messages. With `parallel`
+// set the subdirectories are removed on a pool of worker threads.
+static void nobuild__rm_dir_at(int dirfd, Cstr parent, Cstr name, int parallel)
+{
+    int fd = openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            errno = 0;
+            return;
+        }
+
+        PANIC("Could not open directory %s: %s", PATH(parent, name), nobuild__strerror(errno));
+    }
+
+    DIR *dir = fdopendir(fd);
+    if (dir == NULL) {
+        PANIC("Could not open directory %s: %s", PATH(parent, name), nobuild__strerror(errno));
+    }
+
+    Cstr path = NULL;
+    Nobuild__Rm_Subtrees subtrees = { .dirfd = fd };
+
+    errno = 0;
+    struct dirent *dp = NULL;
+    while ((dp = readdir(dir))) {
+        const char *file = dp->d_name;
+        if (strcmp(file, ".") == 0 || strcmp(file, "..") == 0) {
+            continue;
+        }
+
+        int is_dir = 0;
+#ifdef DT_DIR
+        if (dp->d_type == DT_DIR) {
+            is_dir = 1;
+        } else
+#endif
+        if (unlinkat(fd, file, 0) < 0) {
+            // Either `d_type` is not supported by the filesystem or the entry is a directory
+            if (errno == EISDIR || errno == EPERM) {
+                is_dir = 1;
+            } else if (errno != ENOENT) {
+                PANIC("Could not remove file %s: %s", PATH(parent, name, file), nobuild__strerror(errno));
+            }
+        }
+
+        if (is_dir) {
+            if (path == NULL) {
+                path = PATH(parent, name);
+            }
+
+            if (parallel) {
+                size_t len = strlen(file);
+                char *copy = malloc(len + 1);
+                if (copy == NULL) {
+                    PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+                }
+                memcpy(copy, file, len + 1);
+                subtrees.names = cstr_array_append(subtrees.names, copy);
+            } else {
+                nobuild__rm_dir_at(fd, path, file, 0);
+            }
+        }
+        errno = 0;
+    }
+
+    if (errno > 0) {
+        PANIC("Could not read directory %s: %s", PATH(parent, name), nobuild__strerror(errno));
+    }
+
+    if (subtrees.names.count == 1) {
+        // Keep descending until the tree branches out
+        nobuild__rm_dir_at(fd, path, subtrees.names.elems[0], 1);
+    } else if (subtrees.names.count > 1) {
+        subtrees.path = path;
+        nobuild__parallel_for(subtrees.names.count, 0, nobuild__rm_subtree, &subtrees);
+    }
+
+    for (size_t i = 0; i < subtrees.names.count; ++i) {
+        free((char *) subtrees.names.elems[i]);
+    }
+    free(subtrees.names.elems);
+    closedir(dir);
+
+    if (unlinkat(dirfd, name, AT_REMOVEDIR) < 0 && errno != ENOENT) {
+        PANIC("Could not remove directory %s: %s", PATH(parent, name), nobuild__strerror(errno));
+    }
+    errno = 0;
+}
+#endif // !_WIN32 && AT_REMOVEDIR
+
+void path_rm(Cstr path)
+{
+    nobuild__stat_cache_evict(path);
+
+#if !defined(_WIN32) && defined(AT_REMOVEDIR)
+    // Don't stat up front, the unlink fails for directories anyway
+    if (nobuild__unlink(path) == 0) {
+        return;
+    }
+
+    if (errno == ENOENT) {
+        errno = 0;
+        WARN("File %s does not exist", path);
+    } else if (errno == EISDIR || errno == EPERM) {
+        errno = 0;
+        nobuild__dir_cache_clear();
+        path_stat_cache_clear();
+        nobuild__rm_dir_at(AT_FDCWD, ".", path, 1);
+    } else {
+        PANIC("Could not remove file %s: %s", path, nobuild__strerror(errno));
+    }
+#else
+    if (IS_DIR(path)) {
+        nobuild__dir_cache_clear();
+        path_stat_cache_clear();
+        FOREACH_FILE_IN_DIR(file, path, {
+            if (strcmp(file, ".") != 0 && strcmp(file, "..") != 0)
+            {
+                path_rm(PATH(path, file));
             }
         });
 
@@ -451,4 +2014,119 @@ void path_rm(Cstr path)
             }
         }
     }
+#endif // !_WIN32 && AT_REMOVEDIR
+}
+
+#ifndef NOBUILD_NO_THREADS
+#	ifndef _WIN32
+static pthread_t *nobuild__rm_background_threads = NULL;
+#	else
+static HANDLE *nobuild__rm_background_threads = NULL;
+#	endif
+static size_t nobuild__rm_background_count = 0;
+static Nobuild__Mutex nobuild__rm_background_lock = NOBUILD__MUTEX_INIT;
+
+#	ifndef _WIN32
+static void *nobuild__rm_background_worker(void *arg)
+#	else
+static DWORD WINAPI nobuild__rm_background_worker(LPVOID arg)
+#	endif
+{
+    path_rm(arg);
+    free(arg);
+    return 0;
+}
+#endif // NOBUILD_NO_THREADS
+
+void path_rm_wait(void)
+{
+#ifndef NOBUILD_NO_THREADS
+    nobuild__mutex_lock(&nobuild__rm_background_lock);
+    for (size_t i = 0; i < nobuild__rm_background_count; ++i) {
+#	ifndef _WIN32
+        pthread_join(nobuild__rm_background_threads[i], NULL);
+#	else
+        WaitForSingleObject(nobuild__rm_background_threads[i], INFINITE);
+        CloseHandle(nobuild__rm_background_threads[i]);
+#	endif // _WIN32
+    }
+    nobuild__rm_background_count = 0;
+    nobuild__mutex_unlock(&nobuild__rm_background_lock);
+#endif // NOBUILD_NO_THREADS
+}
+
+void path_rm_background(Cstr path)
+{
+#ifndef NOBUILD_NO_THREADS
+    static size_t counter = 0;
+
+    if (!PATH_EXISTS(path)) {
+        WARN("File %s does not exist", path);
+        return;
+    }
+
+    // Strip trailing separators so the trash ends up next to `path` and not inside of it
+    size_t len = strlen(path);
+    while (len > 1 && path[len - 1] == *PATH_SEP) {
+        len -= 1;
+    }
+
+    const size_t trash_size = len + 64;
+    char *trash = malloc(trash_size);
+    if (trash == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+
+    // `PANIC` exits and the atexit handler `path_rm_wait()` takes the lock,
+    // so nothing that can panic runs while it is held
+    nobuild__mutex_lock(&nobuild__rm_background_lock);
+    const size_t id = counter++;
+    nobuild__mutex_unlock(&nobuild__rm_background_lock);
+
+#	ifndef _WIN32
+    snprintf(trash, trash_size, "%.*s.nobuild-trash-%ld-%zu", (int) len, path, (long) getpid(), id);
+#	else
+    snprintf(trash, trash_size, "%.*s.nobuild-trash-%lu-%zu", (int) len, path, GetCurrentProcessId(), id);
+#	endif
+
+    // Renaming is atomic, so `path` is free to be recreated right away
+    path_rename(path, trash);
+
+    int started = 0;
+    nobuild__mutex_lock(&nobuild__rm_background_lock);
+    static int registered = 0;
+    if (!registered) {
+        atexit(path_rm_wait);
+        registered = 1;
+    }
+
+    void *threads = realloc(nobuild__rm_background_threads,
+                            sizeof *nobuild__rm_background_threads * (nobuild__rm_background_count + 1));
+    if (threads != NULL) {
+        nobuild__rm_background_threads = threads;
+#	ifndef _WIN32
+        started = pthread_create(&nobuild__rm_background_threads[nobuild__rm_background_count], NULL,
+                                 nobuild__rm_background_worker, trash) == 0;
+#	else
+        HANDLE thread = CreateThread(NULL, 0, nobuild__rm_background_worker, trash, 0, NULL);
+        nobuild__rm_background_threads[nobuild__rm_background_count] = thread;
+        started = thread != NULL;
+#	endif // _WIN32
+        if (started) {
+            nobuild__rm_background_count += 1;
+        }
+    }
+    nobuild__mutex_unlock(&nobuild__rm_background_lock);
+
+    if (threads == NULL) {
+        PANIC("Could not allocate memory: %s", nobuild__strerror(errno));
+    }
+
+    if (!started) {
+        path_rm(trash);
+        free(trash);
+    }
+#else
+    path_rm(path);
+#endif // NOBUILD_NO_THREADS
 }
@@ -1,6 +1,13 @@
 #pragma once
 
 #include "nobuild_cstr.h"
+#include "nobuild_io.h"
+
+#ifndef _WIN32
+#	include <dirent.h>
+#else
+#	include "minirent.h"
+#endif
 
 #ifndef NOBUILD__DEPRECATED
 #	if defined(__GNUC__) || (defined(__clang__) && !defined(_MSC_VER))
@@ -27,6 +34,41 @@ Cstr path_dirname(Cstr path);
 Cstr path_basename(Cstr path);
 #define BASENAME(path) path_basename(path)
 
+// Variants of the helpers above that return a view into `path` (or into a
+// string literal) instead of allocating. Use `sv_to_cstr()` to keep the result.
+String_View path_no_ext_sv(Cstr path);
+String_View path_dirname_sv(Cstr path);
+String_View path_basename_sv(Cstr path);
+
+// Extension of the basename without the dot, "c" for "src/main.c". Empty if the
+// basename has no dot or only a leading one, like ".gitignore".
+String_View path_extension_sv(Cstr path);
+
+// Basename without its extension, "main" for "src/main.c"
+String_View path_stem_sv(Cstr path);
+
+// Iterates over the components of `path`, skipping repeated separators. Start
+// with a zero initialized `component`, returns 0 once there are no more.
+//
+//   String_View component = {0};
+//   while (path_next_component(path, &component)) {
+//       INFO(SV_FMT, SV_ARG(component));
+//   }
+int path_next_component(Cstr path, String_View *component);
+
+// Collapses `.`, `..` and repeated separators without touching the filesystem,
+// so `./src/a.c`, `src//a.c` and `src/../src/a.c` all become `src/a.c`. The
+// result is interned. Note that `..` is removed lexically, which differs from
+// what the filesystem does when the previous component is a symlink.
+Cstr path_normalize(Cstr path);
+#define NORMALIZE(path) path_normalize(path)
+
+// Normalized absolute path with the symlinks resolved. Results are memoized
+// for the rest of the run; paths that do not exist yet are only normalized.
+Cstr path_realpath(Cstr path);
+#define REALPATH(path) path_realpath(path)
+void path_realpath_cache_clear(void);
+
 int path_is_dir(Cstr path);
 #define IS_DIR(path) path_is_dir(path)
 
@@ -40,6 +82,53 @@ NOBUILD__DEPRECATED(int is_path1_modified_after_path2(Cstr path1, Cstr path2));
 int path_is_newer(Cstr path1, Cstr path2);
 #define IS_NEWER(path1, path2) path_is_newer(path1, path2)
 
+// Returns 1 if any of `outputs` is missing or older than any of `inputs`.
+// Every path is stat'ed at most once per run: the results are cached and only
+// the outputs reported as stale are forgotten, since the caller is about to
+// regenerate them. Call `path_stat_cache_clear()` after changing files behind
+// nobuild's back.
+int path_needs_rebuild(Cstr_Array outputs, Cstr_Array inputs);
+#define NEEDS_REBUILD(output, ...) path_needs_rebuild(cstr_array_make(output, NULL), cstr_array_make(__VA_ARGS__, NULL))
+void path_stat_cache_clear(void);
+
+// Early cutoff for commands that rewrite their outputs with the same contents.
+// `path_restat()` hashes the outputs after the command ran and records them in
+// `NOBUILD_RESTAT_LOG`. Outputs whose hash did not change keep the modification
+// time of their previous contents when `path_needs_rebuild()` and
+// `path_is_newer()` look at them as inputs, so their dependents stay clean:
+//
+//   if (NEEDS_REBUILD("build/parser.h", "parser.y")) {
+//       CMD("bison", "--header=build/parser.h", "-o", "build/parser.c", "parser.y");
+//       RESTAT("build/parser.h", "build/parser.c");
+//   }
+#ifndef NOBUILD_RESTAT_LOG
+#define NOBUILD_RESTAT_LOG ".nobuild_restat"
+#endif
+
+void path_restat(Cstr_Array outputs);
+#define RESTAT(...) path_restat(cstr_array_make(__VA_ARGS__, NULL))
+
+// Headers that `path` includes, directly or through other headers, found the
+// way the compiler would: `"..."` next to the including file and then in
+// `include_dirs`, `<...>` only in `include_dirs`. The directories may be given
+// as `-I` flags. Headers outside of them, like the system headers, are left
+// out. Meant as the inputs of `path_needs_rebuild()` before a depfile exists:
+//
+//   Cstr_Array deps = SCAN_INCLUDES("src/main.c", "-Iinclude");
+//   if (path_needs_rebuild(cstr_array_make("build/main.o", NULL), cstr_array_append(deps, "src/main.c"))) ...
+//
+// The `#include` lines of each file are cached by content hash in
+// `NOBUILD_INCLUDE_LOG`, across runs, and a file is only read again when its
+// size or modification time changes.
+#ifndef NOBUILD_INCLUDE_LOG
+#define NOBUILD_INCLUDE_LOG ".nobuild_includes"
+#endif
+
+Cstr_Array path_scan_includes(Cstr path, Cstr_Array include_dirs);
+#define SCAN_INCLUDES(path, ...) path_scan_includes(path, cstr_array_make(__VA_ARGS__, NULL))
+
+// Directories created or found by `path_mkdirs()` are remembered for the rest of
+// the process, so calling it again for the same directory is cheap
 void path_mkdirs(Cstr_Array path);
 #define MKDIRS(...)                                             \
     do {                                                        \
@@ -48,6 +137,9 @@ void path_mkdirs(Cstr_Array path);
         path_mkdirs(path);                                      \
     } while (0)
 
+// Make sure the directory that will contain `path` exists
+void path_mkdirs_parent(Cstr path);
+
 void path_rename(Cstr old_path, Cstr new_path);
 #define RENAME(old_path, new_path)                    \
     do {                                              \
@@ -62,6 +154,64 @@ void path_copy(Cstr old_path, Cstr new_path);
         path_copy(old_path, new_path);              \
     } while(0)
 
+// Generated files that keep their modification time when regenerated with
+// the same contents, so whatever depends on them is not rebuilt:
+//
+//   Output_File out = output_file_open("build/config.h");
+//   fdw_printf(&out.writer, "#define VERSION %d\n", 69);
+//   output_file_close(&out);
+//
+// The contents go to `<path>.tmp` first. Closing compares it to `path`, size
+// first, and renames it over `path` only if they differ.
+typedef struct {
+    Fd_Writer writer;
+    Cstr path;
+    Cstr temp_path;
+} Output_File;
+
+Output_File output_file_open(Cstr path);
+// Returns 1 if `path` was replaced, 0 if it was left alone
+int output_file_close(Output_File *file);
+// Same for contents that are already in memory, no temporary file is written
+// when `path` already holds them
+int path_write_if_changed(Cstr path, const void *data, size_t size);
+
+typedef struct {
+    // Remove the files and directories of the destination that are not in the source
+    int delete_extraneous;
+    // Compare the contents of files of the same size instead of their modification times
+    int compare_contents;
+    // Number of threads copying files, 0 means one per CPU
+    size_t jobs;
+} Sync_Options;
+
+typedef struct {
+    size_t files_copied;
+    size_t files_skipped;
+    size_t files_deleted;
+    // Files that could not be copied, each one is logged with `ERRO`
+    size_t files_failed;
+    unsigned long long bytes_copied;
+    unsigned long long bytes_skipped;
+} Sync_Stats;
+
+// Make `dst_path` a copy of `src_path` by only copying the files that differ
+// in size or modification time. Directories are walked up front and the
+// copies are then spread over a pool of worker threads. Check `files_failed`
+// to know whether every file made it.
+Sync_Stats path_sync(Cstr src_path, Cstr dst_path, Sync_Options options);
+#define SYNC(src_path, dst_path)                                                    \
+    do {                                                                            \
+        INFO("SYNC: %s -> %s", src_path, dst_path);                                 \
+        Sync_Stats stats = path_sync(src_path, dst_path, (Sync_Options) {0});       \
+        INFO("SYNC: copied %zu files (%llu bytes), skipped %zu files (%llu bytes)", \
+             stats.files_copied, stats.bytes_copied,                                \
+             stats.files_skipped, stats.bytes_skipped);                             \
+        if (stats.files_failed > 0) {                                               \
+            PANIC("SYNC: could not copy %zu files", stats.files_failed);            \
+        }                                                                           \
+    } while(0)
+
 void path_rm(Cstr path);
 #define RM(path)                                \
     do {                                        \
@@ -69,6 +219,37 @@ void path_rm(Cstr path);
         path_rm(path);                          \
     } while(0)
 
+// Rename `path` aside and remove it on a background thread so that `path`
+// can be recreated right away. Pending removals are finished by
+// `path_rm_wait()`, which also runs at exit.
+void path_rm_background(Cstr path);
+void path_rm_wait(void);
+#define RM_BACKGROUND(path)                     \
+    do {                                        \
+        INFO("RM_BACKGROUND: %s", path);        \
+        path_rm_background(path);               \
+    } while(0)
+
+// One stat of one path, for the modules that need a single size or modification
+// time. Many paths are better stat'ed with an `Fd_Batch`.
+typedef struct {
+    int exists;
+    int is_dir;
+    unsigned long long size;
+    // Nanoseconds on POSIX (whole seconds when the platform lacks POSIX.1-2008
+    // timestamps), 100ns ticks on Windows. Only meaningful when compared to
+    // another `Nobuild__Stat` or an `Fd_Batch_Op`.
+    long long mtime;
+} Nobuild__Stat;
+
+// Returns 1 and fills `st` if `path` exists, 0 otherwise
+int nobuild__stat(Cstr path, Nobuild__Stat *st);
+
+int nobuild__is_path_sep(char c);
+
+// Defined by the cmd and path modules, behind `NOBUILD__STRERROR`
+Cstr nobuild__strerror(int errnum);
+
 #define FOREACH_FILE_IN_DIR(file, dirpath, body)        \
     do {                                                \
         struct dirent *dp = NULL;                       \